@@ -64,6 +64,13 @@ volatile struct limine_smp_request smp_request = {
     .flags = 0,
 };
 
+__attribute__((used, section(".limine_requests")))
+static volatile struct limine_rsdp_request rsdp_request = {
+    .id = LIMINE_RSDP_REQUEST,
+    .revision = 0,
+    .response = NULL,
+};
+
 __attribute__((used, section(".limine_requests_end")))
 static volatile uint64_t limine_requests_end_marker = 0;
 
@@ -110,6 +117,8 @@ static void populate_boot_info(void)
     g_boot_info.module_count = 0;
     g_boot_info.modules = g_modules;
 
+    g_boot_info.rsdp_addr = 0;
+
     if (hhdm_request.response)
         g_boot_info.hhdm_offset = hhdm_request.response->offset;
 
@@ -166,6 +175,10 @@ static void populate_boot_info(void)
         g_boot_info.module_count = count;
     }
 
+    /* Base revision 3 reports the RSDP by physical address. */
+    if (rsdp_request.response)
+        g_boot_info.rsdp_addr = (uint64_t)(uintptr_t)rsdp_request.response->address;
+
     (void)kernel_address_request;
 }
 
@@ -2,7 +2,10 @@
 #include <stddef.h>
 
 #include "idt.h"
+#include "include/klog.h"
 #include "include/kprintf.h"
+#include "include/lapic.h"
+#include "drv/irq.h"
 #include "drv/fb.h"
 #include "drv/serial.h"
 #include "gfx/blit.h"
@@ -76,6 +79,39 @@ extern void isr_x64_44(void);
 extern void isr_x64_45(void);
 extern void isr_x64_46(void);
 extern void isr_x64_47(void);
+extern void isr_x64_48(void);
+extern void isr_x64_80(void);
+extern void isr_x64_81(void);
+extern void isr_x64_82(void);
+extern void isr_x64_83(void);
+extern void isr_x64_84(void);
+extern void isr_x64_85(void);
+extern void isr_x64_86(void);
+extern void isr_x64_87(void);
+extern void isr_x64_88(void);
+extern void isr_x64_89(void);
+extern void isr_x64_90(void);
+extern void isr_x64_91(void);
+extern void isr_x64_92(void);
+extern void isr_x64_93(void);
+extern void isr_x64_94(void);
+extern void isr_x64_95(void);
+extern void isr_x64_96(void);
+extern void isr_x64_97(void);
+extern void isr_x64_98(void);
+extern void isr_x64_99(void);
+extern void isr_x64_100(void);
+extern void isr_x64_101(void);
+extern void isr_x64_102(void);
+extern void isr_x64_103(void);
+extern void isr_x64_104(void);
+extern void isr_x64_105(void);
+extern void isr_x64_106(void);
+extern void isr_x64_107(void);
+extern void isr_x64_108(void);
+extern void isr_x64_109(void);
+extern void isr_x64_110(void);
+extern void isr_x64_111(void);
 extern void isr_x64_ignore(void);
 
 static void (*const exception_stubs[32])(void) = {
@@ -89,6 +125,17 @@ static void (*const exception_stubs[32])(void) = {
     isr_x64_28, isr_x64_29, isr_x64_30, isr_x64_31,
 };
 
+static void (*const device_stubs[IRQ_VECTOR_DYN_COUNT])(void) = {
+    isr_x64_80, isr_x64_81, isr_x64_82, isr_x64_83,
+    isr_x64_84, isr_x64_85, isr_x64_86, isr_x64_87,
+    isr_x64_88, isr_x64_89, isr_x64_90, isr_x64_91,
+    isr_x64_92, isr_x64_93, isr_x64_94, isr_x64_95,
+    isr_x64_96, isr_x64_97, isr_x64_98, isr_x64_99,
+    isr_x64_100, isr_x64_101, isr_x64_102, isr_x64_103,
+    isr_x64_104, isr_x64_105, isr_x64_106, isr_x64_107,
+    isr_x64_108, isr_x64_109, isr_x64_110, isr_x64_111,
+};
+
 static struct idt_ptr idtp;
 
 static void set_gate(uint8_t vec, void (*handler)(void), uint8_t flags)
@@ -140,6 +187,7 @@ void idt_exception_handler_x64(uint64_t vector, uint64_t error_code, uint64_t ri
 
     __asm__ volatile ("mov %%cr2, %0" : "=r"(cr2));
     __asm__ volatile ("cli");
+    klog_panic();
 
     kprintf("[x64][exc] vec=%u err=0x%08x%08x rip=0x%08x%08x cr2=0x%08x%08x\n",
             (uint32_t)vector,
@@ -183,6 +231,10 @@ void idt_init_x64(void)
     set_gate(45, isr_x64_45, 0x8Eu);
     set_gate(46, isr_x64_46, 0x8Eu);
     set_gate(47, isr_x64_47, 0x8Eu);
+    set_gate(LAPIC_TIMER_VECTOR, isr_x64_48, 0x8Eu);
+
+    for (uint32_t i = 0; i < IRQ_VECTOR_DYN_COUNT; i++)
+        set_gate((uint8_t)(IRQ_VECTOR_DYN_BASE + i), device_stubs[i], 0x8Eu);
 
     idtp.limit = (uint16_t)(sizeof(idt) - 1);
     idtp.base = (uint64_t)(uintptr_t)&idt;
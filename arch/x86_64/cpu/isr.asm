@@ -136,6 +136,41 @@ IRQ_STUB 44
 IRQ_STUB 45
 IRQ_STUB 46
 IRQ_STUB 47
+IRQ_STUB 48
+
+; Allocatable device vectors (IRQ_VECTOR_DYN_BASE/COUNT in drv/irq.h).
+IRQ_STUB 80
+IRQ_STUB 81
+IRQ_STUB 82
+IRQ_STUB 83
+IRQ_STUB 84
+IRQ_STUB 85
+IRQ_STUB 86
+IRQ_STUB 87
+IRQ_STUB 88
+IRQ_STUB 89
+IRQ_STUB 90
+IRQ_STUB 91
+IRQ_STUB 92
+IRQ_STUB 93
+IRQ_STUB 94
+IRQ_STUB 95
+IRQ_STUB 96
+IRQ_STUB 97
+IRQ_STUB 98
+IRQ_STUB 99
+IRQ_STUB 100
+IRQ_STUB 101
+IRQ_STUB 102
+IRQ_STUB 103
+IRQ_STUB 104
+IRQ_STUB 105
+IRQ_STUB 106
+IRQ_STUB 107
+IRQ_STUB 108
+IRQ_STUB 109
+IRQ_STUB 110
+IRQ_STUB 111
 
 isr_exception_common:
     PUSH_GPRS
@@ -6,9 +6,12 @@
 #include "cpu/gdt.h"
 #include "cpu/idt.h"
 
+#include "include/klog.h"
 #include "include/kprintf.h"
 #include "include/smp.h"
 #include "include/lapic.h"
+#include "include/acpi.h"
+#include "include/ioapic.h"
 #include "mm/pmm.h"
 #include "mm/heap.h"
 #include "mm/vmm_x64.h"
@@ -140,7 +143,11 @@ void kernel_main_x64(const struct tsukasa_boot_info *boot_info)
     rtc_init();
 
     event_init();
+    if (acpi_init(boot_info ? boot_info->rsdp_addr : 0) != 0)
+        kprintf("[boot:x64] no ACPI tables\n");
     pic_init();
+    if (ioapic_init() != 0)
+        kprintf("[boot:x64] no IOAPIC, device INTx stays on the 8259\n");
     pit_init(100);
     pci_init();
     network_init();
@@ -200,6 +207,8 @@ void kernel_main_x64(const struct tsukasa_boot_info *boot_info)
     kprintf("[boot:x64] phase8 selftests spawn...\n");
     process_run_phase8_selftests();
 
+    /* From here on kprintf no longer spins on the UART; IRQ4 drains the log. */
+    klog_start_async();
     __asm__ volatile ("sti");
     kprintf("[boot:x64] interrupts enabled, preemptive scheduler active\n");
     process_start_scheduler();
@@ -12,9 +12,26 @@
 
 #ifdef __x86_64__
 
+#include "../drv/pic.h"
+#include "../include/acpi.h"
+#include "../include/ioapic.h"
+#include "../include/lapic.h"
+#include "../include/smp.h"
+#include "../mm/vmm_x64.h"
+
 #define PCI_CONFIG_ADDRESS 0xCF8u
 #define PCI_CONFIG_DATA    0xCFCu
 
+#define PCI_CMD_INTX_DISABLE  (1u << 10)
+#define PCI_MSI_CTRL_ENABLE   (1u << 0)
+#define PCI_MSI_CTRL_64BIT    (1u << 7)
+#define PCI_MSI_CTRL_MME      (7u << 4)
+#define PCI_MSIX_CTRL_SIZE    0x07FFu
+#define PCI_MSIX_CTRL_MASKALL (1u << 14)
+#define PCI_MSIX_CTRL_ENABLE  (1u << 15)
+/* Message address: fixed delivery, physical destination in bits 19:12. */
+#define PCI_MSI_ADDR_BASE     0xFEE00000u
+
 typedef struct pci_driver_slot {
     int used;
     pci_driver_t driver;
@@ -25,6 +42,17 @@ static int g_pci_device_count;
 static pci_driver_slot_t g_pci_drivers[PCI_MAX_DRIVERS];
 static int g_pci_driver_count;
 static spinlock_t g_pci_lock = SPINLOCK_INIT;
+static uint16_t g_intx_routed;    /* 8259 lines handed to the IOAPIC */
+
+/* Memory-mapped config space (PCIe ECAM) for segment 0, from the ACPI MCFG. */
+typedef struct pci_ecam {
+    uint64_t base;
+    uint8_t bus_start;
+    uint8_t bus_end;
+} pci_ecam_t;
+
+static pci_ecam_t g_ecam;
+static volatile uint8_t *g_ecam_bus[256];
 
 static int kstrcmp(const char *a, const char *b)
 {
@@ -61,37 +89,104 @@ static uint32_t pci_cfg_addr(uint8_t bus, uint8_t device, uint8_t function, uint
                       ((uint32_t)offset & 0xFCu));
 }
 
+/* ECAM window of config space for (bus, device, function); NULL to use port I/O. */
+static volatile uint8_t *pci_ecam_ptr(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset)
+{
+    volatile uint8_t *win;
+
+    if (!g_ecam.base || bus < g_ecam.bus_start || bus > g_ecam.bus_end)
+        return NULL;
+    win = g_ecam_bus[bus];
+    if (!win) {
+        /* Buses are mapped 1 MiB at a time, the first time they are touched. */
+        uintptr_t va = 0;
+        uint64_t phys = g_ecam.base + ((uint64_t)(bus - g_ecam.bus_start) << 20);
+        if (vmm_map_io_region(phys, 1u << 20, &va) != 0)
+            return NULL;
+        win = (volatile uint8_t *)va;
+        g_ecam_bus[bus] = win;
+    }
+    return win + (((uint32_t)device & 0x1Fu) << 15) + (((uint32_t)function & 0x7u) << 12) + offset;
+}
+
+/* Take segment 0 from the MCFG, if the firmware has one. */
+static void pci_ecam_init(void)
+{
+    uint32_t len = 0;
+    const uint8_t *mcfg = acpi_find_table("MCFG", &len);
+
+    /* 36-byte header and 8 reserved bytes, then 16-byte allocations. */
+    for (uint32_t off = 44; mcfg && off + 16 <= len; off += 16) {
+        uint16_t segment = (uint16_t)(mcfg[off + 8] | (mcfg[off + 9] << 8));
+        if (segment != 0 || mcfg[off + 10] > mcfg[off + 11])
+            continue;
+        g_ecam.base = acpi_rd64(mcfg + off);
+        g_ecam.bus_start = mcfg[off + 10];
+        g_ecam.bus_end = mcfg[off + 11];
+        kprintf("[pci] ecam base=0x%08x%08x bus=%u-%u\n",
+                (uint32_t)(g_ecam.base >> 32), (uint32_t)g_ecam.base,
+                (unsigned)g_ecam.bus_start, (unsigned)g_ecam.bus_end);
+        return;
+    }
+}
+
 uint32_t pci_read32(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset)
 {
+    volatile uint8_t *p = pci_ecam_ptr(bus, device, function, (uint8_t)(offset & 0xFCu));
+    if (p)
+        return *(volatile uint32_t *)p;
     io_outl(PCI_CONFIG_ADDRESS, pci_cfg_addr(bus, device, function, offset));
     return io_inl(PCI_CONFIG_DATA);
 }
 
 uint16_t pci_read16(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset)
 {
-    uint32_t value = pci_read32(bus, device, function, offset);
+    volatile uint8_t *p = pci_ecam_ptr(bus, device, function, (uint8_t)(offset & 0xFEu));
+    uint32_t value;
+    if (p)
+        return *(volatile uint16_t *)p;
+    value = pci_read32(bus, device, function, offset);
     return (uint16_t)((value >> ((offset & 2u) * 8u)) & 0xFFFFu);
 }
 
 uint8_t pci_read8(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset)
 {
-    uint32_t value = pci_read32(bus, device, function, offset);
+    volatile uint8_t *p = pci_ecam_ptr(bus, device, function, offset);
+    uint32_t value;
+    if (p)
+        return *p;
+    value = pci_read32(bus, device, function, offset);
     return (uint8_t)((value >> ((offset & 3u) * 8u)) & 0xFFu);
 }
 
 void pci_write32(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset, uint32_t value)
 {
+    volatile uint8_t *p = pci_ecam_ptr(bus, device, function, (uint8_t)(offset & 0xFCu));
+    if (p) {
+        *(volatile uint32_t *)p = value;
+        return;
+    }
     io_outl(PCI_CONFIG_ADDRESS, pci_cfg_addr(bus, device, function, offset));
     io_outl(PCI_CONFIG_DATA, value);
 }
 
 void pci_write16(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset, uint16_t value)
 {
-    uint32_t aligned = pci_read32(bus, device, function, (uint8_t)(offset & 0xFCu));
-    uint32_t shift = (uint32_t)((offset & 2u) * 8u);
-    uint32_t mask = (uint32_t)(0xFFFFu << shift);
-    uint32_t merged = (aligned & ~mask) | ((uint32_t)value << shift);
-    pci_write32(bus, device, function, (uint8_t)(offset & 0xFCu), merged);
+    volatile uint8_t *p = pci_ecam_ptr(bus, device, function, (uint8_t)(offset & 0xFEu));
+    uint32_t aligned;
+    uint32_t shift;
+    uint32_t mask;
+
+    /* ECAM takes a 16-bit store; port I/O has to read-modify-write the dword. */
+    if (p) {
+        *(volatile uint16_t *)p = value;
+        return;
+    }
+    aligned = pci_read32(bus, device, function, (uint8_t)(offset & 0xFCu));
+    shift = (uint32_t)((offset & 2u) * 8u);
+    mask = (uint32_t)(0xFFFFu << shift);
+    pci_write32(bus, device, function, (uint8_t)(offset & 0xFCu),
+                (aligned & ~mask) | ((uint32_t)value << shift));
 }
 
 static int pci_device_present(uint8_t bus, uint8_t device, uint8_t function)
@@ -99,52 +194,114 @@ static int pci_device_present(uint8_t bus, uint8_t device, uint8_t function)
     return pci_read16(bus, device, function, 0x00) != 0xFFFFu;
 }
 
+static uint16_t cfg16(const uint8_t *cfg, uint8_t offset)
+{
+    return (uint16_t)(cfg[offset] | (cfg[offset + 1] << 8));
+}
+
+static uint32_t cfg32(const uint8_t *cfg, uint8_t offset)
+{
+    return (uint32_t)cfg16(cfg, offset) | ((uint32_t)cfg16(cfg, (uint8_t)(offset + 2)) << 16);
+}
+
+/* Snapshot the header, plus the capability area when the status register lists one. */
 static void pci_fill_device(pci_device_info_t *out, uint8_t bus, uint8_t device, uint8_t function)
 {
-    uint32_t class_rev = pci_read32(bus, device, function, 0x08);
-    uint32_t hdr = pci_read32(bus, device, function, 0x0C);
-    uint16_t irq = pci_read16(bus, device, function, 0x3C);
+    uint8_t *cfg;
+    uint32_t end = 0x40u;
 
     if (!out)
         return;
+    cfg = out->config;
+    for (uint32_t off = 0; off < end; off += 4) {
+        uint32_t v = pci_read32(bus, device, function, (uint8_t)off);
+        cfg[off] = (uint8_t)v;
+        cfg[off + 1] = (uint8_t)(v >> 8);
+        cfg[off + 2] = (uint8_t)(v >> 16);
+        cfg[off + 3] = (uint8_t)(v >> 24);
+        if (off == 0x04 && (v & (1u << 20)))
+            end = PCI_CONFIG_CACHE_SIZE;
+    }
+    for (uint32_t off = end; off < PCI_CONFIG_CACHE_SIZE; off++)
+        cfg[off] = 0;
 
     out->bus = bus;
     out->device = device;
     out->function = function;
-    out->vendor_id = pci_read16(bus, device, function, 0x00);
-    out->device_id = pci_read16(bus, device, function, 0x02);
-    out->revision = (uint8_t)(class_rev & 0xFFu);
-    out->prog_if = (uint8_t)((class_rev >> 8) & 0xFFu);
-    out->subclass = (uint8_t)((class_rev >> 16) & 0xFFu);
-    out->class_code = (uint8_t)((class_rev >> 24) & 0xFFu);
-    out->header_type = (uint8_t)((hdr >> 16) & 0xFFu);
-    out->irq_line = (uint8_t)(irq & 0xFFu);
-    out->irq_pin = (uint8_t)((irq >> 8) & 0xFFu);
+    out->vendor_id = cfg16(cfg, 0x00);
+    out->device_id = cfg16(cfg, 0x02);
+    out->revision = cfg[0x08];
+    out->prog_if = cfg[0x09];
+    out->subclass = cfg[0x0A];
+    out->class_code = cfg[0x0B];
+    out->header_type = cfg[0x0E];
+    out->irq_line = cfg[0x3C];
+    out->irq_pin = cfg[0x3D];
     out->bound_driver[0] = '\0';
 
     for (int i = 0; i < 6; i++)
-        out->bars[i] = pci_read32(bus, device, function, (uint8_t)(0x10 + i * 4));
+        out->bars[i] = cfg32(cfg, (uint8_t)(0x10 + i * 4));
+}
+
+static void pci_scan_bus_locked(uint8_t bus, int *count, uint8_t *seen);
+
+static void pci_scan_function_locked(uint8_t bus, uint8_t device, uint8_t function,
+                                     int *count, uint8_t *seen)
+{
+    pci_device_info_t *dev;
+    uint8_t secondary;
+
+    if (*count >= PCI_MAX_DEVICES)
+        return;
+    dev = &g_pci_devices[*count];
+    pci_fill_device(dev, bus, device, function);
+    (*count)++;
+
+    /* PCI-to-PCI bridge: descend into the bus behind it. */
+    if (dev->class_code != 0x06 || dev->subclass != 0x04 || (dev->header_type & 0x7Fu) != 1u)
+        return;
+    secondary = dev->config[0x19];
+    if (secondary != 0)
+        pci_scan_bus_locked(secondary, count, seen);
 }
 
+static void pci_scan_bus_locked(uint8_t bus, int *count, uint8_t *seen)
+{
+    if (seen[bus >> 3] & (1u << (bus & 7u)))
+        return;
+    seen[bus >> 3] |= (uint8_t)(1u << (bus & 7u));
+
+    for (uint8_t dev = 0; dev < 32 && *count < PCI_MAX_DEVICES; dev++) {
+        uint8_t max_fn = 1;
+        if (!pci_device_present(bus, dev, 0))
+            continue;
+        if (pci_read8(bus, dev, 0, 0x0E) & 0x80u)
+            max_fn = 8;
+        for (uint8_t fn = 0; fn < max_fn; fn++) {
+            if (fn == 0 || pci_device_present(bus, dev, fn))
+                pci_scan_function_locked(bus, dev, fn, count, seen);
+        }
+    }
+}
+
+/*
+ * Walk from bus 0 through the bridges instead of probing all 256 buses.  A
+ * multi-function host bridge at 00:00 means one root bus per function.
+ */
 static int pci_scan_locked(void)
 {
+    uint8_t seen[32];
     int count = 0;
-    for (uint16_t bus = 0; bus < 256 && count < PCI_MAX_DEVICES; bus++) {
-        for (uint8_t dev = 0; dev < 32 && count < PCI_MAX_DEVICES; dev++) {
-            uint8_t max_fn = 1;
-            if (!pci_device_present((uint8_t)bus, dev, 0))
-                continue;
-
-            if (pci_read8((uint8_t)bus, dev, 0, 0x0E) & 0x80u)
-                max_fn = 8;
 
-            for (uint8_t fn = 0; fn < max_fn && count < PCI_MAX_DEVICES; fn++) {
-                if (!pci_device_present((uint8_t)bus, dev, fn))
-                    continue;
-                pci_fill_device(&g_pci_devices[count], (uint8_t)bus, dev, fn);
-                count++;
-            }
+    for (int i = 0; i < 32; i++)
+        seen[i] = 0;
+    if (pci_read8(0, 0, 0, 0x0E) & 0x80u) {
+        for (uint8_t fn = 0; fn < 8; fn++) {
+            if (pci_device_present(0, 0, fn))
+                pci_scan_bus_locked(fn, &count, seen);
         }
+    } else {
+        pci_scan_bus_locked(0, &count, seen);
     }
     g_pci_device_count = count;
     return count;
@@ -161,10 +318,17 @@ int pci_rescan(void)
 
 void pci_init(void)
 {
-    int count = pci_rescan();
+    int count;
+    pci_ecam_init();
+    count = pci_rescan();
     kprintf("[pci] discovered devices=%d\n", count);
 }
 
+int pci_ecam_active(void)
+{
+    return g_ecam.base != 0;
+}
+
 int pci_device_count(void)
 {
     return g_pci_device_count;
@@ -283,10 +447,200 @@ void pci_enable_mmio(const pci_device_info_t *dev)
     pci_cmd_set(dev, cmd);
 }
 
+uint8_t pci_find_capability(const pci_device_info_t *dev, uint8_t cap_id, uint8_t after)
+{
+    uint8_t ptr;
+    if (!dev)
+        return 0;
+    if ((pci_cached_read16(dev, 0x06) & (1u << 4)) == 0)
+        return 0;
+
+    ptr = pci_cached_read8(dev, after ? (uint8_t)(after + 1) : 0x34);
+    /* Bounded so a looping list cannot hang the scan. */
+    for (int guard = 0; guard < 48 && ptr >= 0x40; guard++) {
+        ptr &= 0xFCu;
+        if (pci_cached_read8(dev, ptr) == cap_id)
+            return ptr;
+        ptr = pci_cached_read8(dev, (uint8_t)(ptr + 1));
+    }
+    return 0;
+}
+
+uint64_t pci_bar_phys(const pci_device_info_t *dev, int bar)
+{
+    uint32_t lo;
+    uint64_t phys;
+    if (!dev || bar < 0 || bar >= 6)
+        return 0;
+
+    lo = dev->bars[bar];
+    if (lo & 1u)
+        return 0;
+    phys = (uint64_t)(lo & ~0x0Fu);
+    if (((lo >> 1) & 3u) == 2u && bar < 5)
+        phys |= (uint64_t)dev->bars[bar + 1] << 32;
+    return phys;
+}
+
+static void pci_disable_intx(const pci_device_info_t *dev)
+{
+    pci_cmd_set(dev, (uint16_t)(pci_cmd_get(dev) | PCI_CMD_INTX_DISABLE));
+}
+
+int pci_enable_msi(const pci_device_info_t *dev, uint8_t vector, uint32_t lapic_id)
+{
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI, 0);
+    uint16_t ctrl;
+
+    if (!cap)
+        return -1;
+    ctrl = pci_read16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 2));
+    /* One message; the data register moves up when the address is 64-bit. */
+    ctrl &= (uint16_t)~(PCI_MSI_CTRL_ENABLE | PCI_MSI_CTRL_MME);
+    pci_write16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 2), ctrl);
+    pci_write32(dev->bus, dev->device, dev->function, (uint8_t)(cap + 4),
+                PCI_MSI_ADDR_BASE | ((lapic_id & 0xFFu) << 12));
+    if (ctrl & PCI_MSI_CTRL_64BIT) {
+        pci_write32(dev->bus, dev->device, dev->function, (uint8_t)(cap + 8), 0);
+        pci_write16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 12), vector);
+    } else {
+        pci_write16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 8), vector);
+    }
+    pci_write16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 2),
+                (uint16_t)(ctrl | PCI_MSI_CTRL_ENABLE));
+    pci_disable_intx(dev);
+    return 0;
+}
+
+int pci_enable_msix(const pci_device_info_t *dev, uint16_t entry, uint8_t vector, uint32_t lapic_id)
+{
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSIX, 0);
+    uint16_t ctrl;
+    uint32_t table;
+    uint64_t phys;
+    uintptr_t va = 0;
+    volatile uint32_t *slot;
+
+    if (!cap)
+        return -1;
+    ctrl = pci_read16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 2));
+    if (entry > (ctrl & PCI_MSIX_CTRL_SIZE))
+        return -1;
+    table = pci_cached_read32(dev, (uint8_t)(cap + 4));
+    phys = pci_bar_phys(dev, (int)(table & 7u));
+    if (!phys)
+        return -1;
+    phys += (uint64_t)(table & ~7u) + (uint64_t)entry * 16u;
+    if (vmm_map_io_region(phys, 16u, &va) != 0)
+        return -1;
+    slot = (volatile uint32_t *)va;
+    pci_enable_mmio(dev);
+
+    /* Entries power up masked; hold the whole function while one is written. */
+    ctrl |= PCI_MSIX_CTRL_ENABLE | PCI_MSIX_CTRL_MASKALL;
+    pci_write16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 2), ctrl);
+    slot[0] = PCI_MSI_ADDR_BASE | ((lapic_id & 0xFFu) << 12);
+    slot[1] = 0;
+    slot[2] = vector;
+    slot[3] = 0;
+    ctrl &= (uint16_t)~PCI_MSIX_CTRL_MASKALL;
+    pci_write16(dev->bus, dev->device, dev->function, (uint8_t)(cap + 2), ctrl);
+    pci_disable_intx(dev);
+    return 0;
+}
+
+/* INTx through the IOAPIC: level/active-low as PCI defines it, unless the MADT overrides the line. */
+static int pci_route_intx(const pci_device_info_t *dev, uint8_t vector, uint32_t lapic_id)
+{
+    uint32_t flags = IOAPIC_LEVEL | IOAPIC_ACTIVE_LOW;
+    uint32_t gsi;
+
+    if (!dev->irq_pin || dev->irq_line >= 16 || !ioapic_available())
+        return -1;
+    if (g_intx_routed & (1u << dev->irq_line))
+        return -1;
+    gsi = ioapic_isa_gsi(dev->irq_line, &flags);
+    if (ioapic_route(gsi, vector, lapic_id, flags) != 0)
+        return -1;
+    pic_mask_irq(dev->irq_line);
+    g_intx_routed |= (uint16_t)(1u << dev->irq_line);
+    return 0;
+}
+
+static uint32_t pci_irq_attach_mode(const pci_device_info_t *dev, uint32_t allow,
+                                    irq_callback_t callback, void *ctx,
+                                    uint32_t lapic_id, int *vector_out)
+{
+    int vector;
+
+    *vector_out = -1;
+    if (allow & (PCI_IRQ_MSIX | PCI_IRQ_MSI | PCI_IRQ_IOAPIC)) {
+        vector = irq_alloc_vector(callback, ctx);
+        if (vector >= 0) {
+            *vector_out = vector;
+            if ((allow & PCI_IRQ_MSIX) && pci_enable_msix(dev, 0, (uint8_t)vector, lapic_id) == 0)
+                return PCI_IRQ_MSIX;
+            if ((allow & PCI_IRQ_MSI) && pci_enable_msi(dev, (uint8_t)vector, lapic_id) == 0)
+                return PCI_IRQ_MSI;
+            if ((allow & PCI_IRQ_IOAPIC) && pci_route_intx(dev, (uint8_t)vector, lapic_id) == 0)
+                return PCI_IRQ_IOAPIC;
+            irq_free_vector((uint8_t)vector);
+        }
+    }
+
+    /* A line already moved to the IOAPIC is masked at the 8259. */
+    if ((allow & PCI_IRQ_PIC) && dev->irq_line < 16 && !(g_intx_routed & (1u << dev->irq_line))) {
+        if (irq_register_handler(dev->irq_line, callback, ctx) == 0) {
+            pic_unmask_irq(dev->irq_line);
+            *vector_out = 32 + dev->irq_line;
+            return PCI_IRQ_PIC;
+        }
+    }
+    *vector_out = -1;
+    return PCI_IRQ_NONE;
+}
+
+uint32_t pci_irq_attach(const pci_device_info_t *dev, uint32_t allow,
+                        irq_callback_t callback, void *ctx, uint32_t cpu)
+{
+    uint32_t lapic_id = smp_get_lapic_id(cpu);
+    uint32_t mode;
+    int vector;
+
+    if (!dev || !callback)
+        return PCI_IRQ_NONE;
+    if (lapic_id == 0xFFFFFFFFu) {
+        cpu = smp_this_cpu_id();
+        lapic_id = lapic_read_id();
+    }
+
+    mode = pci_irq_attach_mode(dev, allow, callback, ctx, lapic_id, &vector);
+    if (mode == PCI_IRQ_NONE)
+        kprintf("[pci] %02x:%02x.%u no usable interrupt\n",
+                (unsigned)dev->bus, (unsigned)dev->device, (unsigned)dev->function);
+    else
+        kprintf("[pci] %02x:%02x.%u irq %s vector=%d cpu=%u\n",
+                (unsigned)dev->bus, (unsigned)dev->device, (unsigned)dev->function,
+                pci_irq_mode_name(mode), vector, cpu);
+    return mode;
+}
+
+const char *pci_irq_mode_name(uint32_t mode)
+{
+    switch (mode) {
+    case PCI_IRQ_PIC: return "intx-pic";
+    case PCI_IRQ_IOAPIC: return "intx-ioapic";
+    case PCI_IRQ_MSI: return "msi";
+    case PCI_IRQ_MSIX: return "msi-x";
+    default: return "none";
+    }
+}
+
 #else
 
 void pci_init(void) {}
 int pci_rescan(void) { return 0; }
+int pci_ecam_active(void) { return 0; }
 int pci_device_count(void) { return 0; }
 const pci_device_info_t *pci_device_at(int index) { (void)index; return NULL; }
 const pci_device_info_t *pci_find_device(uint16_t vendor_id, uint16_t device_id)
@@ -329,5 +683,28 @@ void pci_write32(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset,
 void pci_enable_bus_mastering(const pci_device_info_t *dev) { (void)dev; }
 void pci_enable_io(const pci_device_info_t *dev) { (void)dev; }
 void pci_enable_mmio(const pci_device_info_t *dev) { (void)dev; }
+uint8_t pci_find_capability(const pci_device_info_t *dev, uint8_t cap_id, uint8_t after)
+{
+    (void)dev; (void)cap_id; (void)after;
+    return 0;
+}
+uint64_t pci_bar_phys(const pci_device_info_t *dev, int bar) { (void)dev; (void)bar; return 0; }
+int pci_enable_msi(const pci_device_info_t *dev, uint8_t vector, uint32_t lapic_id)
+{
+    (void)dev; (void)vector; (void)lapic_id;
+    return -1;
+}
+int pci_enable_msix(const pci_device_info_t *dev, uint16_t entry, uint8_t vector, uint32_t lapic_id)
+{
+    (void)dev; (void)entry; (void)vector; (void)lapic_id;
+    return -1;
+}
+uint32_t pci_irq_attach(const pci_device_info_t *dev, uint32_t allow,
+                        irq_callback_t callback, void *ctx, uint32_t cpu)
+{
+    (void)dev; (void)allow; (void)callback; (void)ctx; (void)cpu;
+    return PCI_IRQ_NONE;
+}
+const char *pci_irq_mode_name(uint32_t mode) { (void)mode; return "none"; }
 
 #endif /* __x86_64__ */
@@ -7,12 +7,27 @@
 
 #include <stdint.h>
 
+#include "../drv/irq.h"
+
 #define PCI_MAX_DEVICES 128
 #define PCI_MAX_DRIVERS 16
+#define PCI_CONFIG_CACHE_SIZE 256
 
 #define PCI_CLASS_NETWORK 0x02
 #define PCI_SUBCLASS_ETHERNET 0x00
 
+#define PCI_CAP_ID_MSI     0x05
+#define PCI_CAP_ID_VENDOR  0x09
+#define PCI_CAP_ID_MSIX    0x11
+
+/* Interrupt delivery modes; also used as the `allow` mask of pci_irq_attach(). */
+#define PCI_IRQ_NONE   0x0u
+#define PCI_IRQ_PIC    0x1u    /* INTx through the 8259 */
+#define PCI_IRQ_IOAPIC 0x2u    /* INTx through the IOAPIC */
+#define PCI_IRQ_MSI    0x4u
+#define PCI_IRQ_MSIX   0x8u
+#define PCI_IRQ_ANY    0xFu
+
 typedef struct pci_device_info {
     uint8_t bus;
     uint8_t device;
@@ -32,6 +47,14 @@ typedef struct pci_device_info {
 
     uint32_t bars[6];
     char bound_driver[24];
+
+    /*
+     * Config space as read at scan time: the header, and the capability
+     * area when there is one.  Good for IDs and capability bodies, not for
+     * registers the device or a driver changes (command, status, MSI
+     * control).
+     */
+    uint8_t config[PCI_CONFIG_CACHE_SIZE];
 } pci_device_info_t;
 
 typedef int (*pci_driver_match_fn)(const pci_device_info_t *dev);
@@ -46,6 +69,9 @@ typedef struct pci_driver {
 void pci_init(void);
 int pci_rescan(void);
 
+/* 1 if config space goes through the MCFG's ECAM window rather than I/O ports. */
+int pci_ecam_active(void);
+
 int pci_device_count(void);
 const pci_device_info_t *pci_device_at(int index);
 const pci_device_info_t *pci_find_device(uint16_t vendor_id, uint16_t device_id);
@@ -54,6 +80,7 @@ const pci_device_info_t *pci_find_class(uint8_t class_code, uint8_t subclass);
 int pci_register_driver(const pci_driver_t *driver);
 int pci_probe_and_attach(void);
 
+/* Config space through ECAM when the MCFG provides it, else ports 0xCF8/0xCFC. */
 uint8_t pci_read8(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset);
 uint16_t pci_read16(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset);
 uint32_t pci_read32(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset);
@@ -64,4 +91,52 @@ void pci_enable_bus_mastering(const pci_device_info_t *dev);
 void pci_enable_io(const pci_device_info_t *dev);
 void pci_enable_mmio(const pci_device_info_t *dev);
 
+static inline uint8_t pci_cached_read8(const pci_device_info_t *dev, uint8_t offset)
+{
+    return dev->config[offset];
+}
+
+static inline uint16_t pci_cached_read16(const pci_device_info_t *dev, uint8_t offset)
+{
+    return (uint16_t)(dev->config[offset & 0xFEu] | (dev->config[(offset & 0xFEu) + 1] << 8));
+}
+
+static inline uint32_t pci_cached_read32(const pci_device_info_t *dev, uint8_t offset)
+{
+    offset &= 0xFCu;
+    return (uint32_t)pci_cached_read16(dev, offset) |
+           ((uint32_t)pci_cached_read16(dev, (uint8_t)(offset + 2)) << 16);
+}
+
+/**
+ * Walk the cached capability list for `cap_id`, starting after the capability at
+ * config offset `after` (0 to start from the head).
+ *
+ * @return Config offset of the capability, or 0 if there is none.
+ */
+uint8_t pci_find_capability(const pci_device_info_t *dev, uint8_t cap_id, uint8_t after);
+
+/** Physical base of memory BAR `bar` (64-bit BARs span two slots); 0 if it is I/O or unset. */
+uint64_t pci_bar_phys(const pci_device_info_t *dev, int bar);
+
+/**
+ * Program MSI (or MSI-X table entry `entry`) to deliver `vector` to the
+ * local APIC `lapic_id`, and turn off INTx.  Fails if the capability is
+ * missing.
+ */
+int pci_enable_msi(const pci_device_info_t *dev, uint8_t vector, uint32_t lapic_id);
+int pci_enable_msix(const pci_device_info_t *dev, uint16_t entry, uint8_t vector, uint32_t lapic_id);
+
+/**
+ * Hook `callback` to the device's interrupt, steered to `cpu`.  Tries the
+ * modes in `allow` from cheapest to dearest: MSI-X entry 0, MSI,
+ * IOAPIC-routed INTx, then the 8259 line.
+ *
+ * @return The PCI_IRQ_* mode in use, or PCI_IRQ_NONE.
+ */
+uint32_t pci_irq_attach(const pci_device_info_t *dev, uint32_t allow,
+                        irq_callback_t callback, void *ctx, uint32_t cpu);
+
+const char *pci_irq_mode_name(uint32_t mode);
+
 #endif /* TSUKASA_PCI_H */
@@ -0,0 +1,83 @@
+/*
+ * acpi.c - Locate ACPI tables through the RSDP the loader hands over.
+ *
+ * Only table lookup; the MADT and MCFG are parsed by their users
+ * (ioapic.c, dev/pci.c).  Tables are reached through the direct map.
+ */
+
+#include "acpi.h"
+#include "mm/vmm_x64.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ACPI_SDT_HEADER_LEN 36u
+
+static const uint8_t *g_root;
+static uint32_t g_root_len;
+static int g_root_xsdt;
+
+static const uint8_t *acpi_map(uint64_t phys, size_t len)
+{
+    uintptr_t va = 0;
+    if (!phys || vmm_map_io_region(phys, len, &va) != 0)
+        return NULL;
+    return (const uint8_t *)va;
+}
+
+/* Map a whole SDT given its physical address; NULL unless it carries `sig`. */
+static const uint8_t *acpi_map_table(uint64_t phys, const char *sig, uint32_t *len_out)
+{
+    const uint8_t *hdr = acpi_map(phys, ACPI_SDT_HEADER_LEN);
+    uint32_t len;
+
+    if (!hdr)
+        return NULL;
+    for (int i = 0; i < 4; i++) {
+        if (hdr[i] != (uint8_t)sig[i])
+            return NULL;
+    }
+    len = acpi_rd32(hdr + 4);
+    if (len < ACPI_SDT_HEADER_LEN || len > 0x10000u)
+        return NULL;
+    *len_out = len;
+    return acpi_map(phys, len);
+}
+
+int acpi_init(uint64_t rsdp_phys)
+{
+    static const char rsdp_sig[8] = { 'R', 'S', 'D', ' ', 'P', 'T', 'R', ' ' };
+    const uint8_t *rsdp;
+
+    if (g_root)
+        return 0;
+    rsdp = acpi_map(rsdp_phys, 36);
+    if (!rsdp)
+        return -1;
+    for (int i = 0; i < 8; i++) {
+        if (rsdp[i] != (uint8_t)rsdp_sig[i])
+            return -1;
+    }
+
+    g_root_xsdt = rsdp[15] >= 2 && acpi_rd64(rsdp + 24) != 0;
+    if (g_root_xsdt)
+        g_root = acpi_map_table(acpi_rd64(rsdp + 24), "XSDT", &g_root_len);
+    else
+        g_root = acpi_map_table(acpi_rd32(rsdp + 16), "RSDT", &g_root_len);
+    return g_root ? 0 : -1;
+}
+
+const uint8_t *acpi_find_table(const char *sig, uint32_t *len_out)
+{
+    uint32_t step = g_root_xsdt ? 8u : 4u;
+
+    if (!g_root || !sig || !len_out)
+        return NULL;
+    for (uint32_t off = ACPI_SDT_HEADER_LEN; off + step <= g_root_len; off += step) {
+        uint64_t phys = g_root_xsdt ? acpi_rd64(g_root + off) : acpi_rd32(g_root + off);
+        const uint8_t *table = acpi_map_table(phys, sig, len_out);
+        if (table)
+            return table;
+    }
+    return NULL;
+}
@@ -0,0 +1,198 @@
+/*
+ * ioapic.c - I/O APIC redirection for device interrupt lines.
+ *
+ * The 8259 keeps the legacy ISA devices; lines moved here are masked at the
+ * PIC by the caller and EOI'd at the local APIC.  The IOAPICs and the ISA
+ * interrupt source overrides come from the ACPI MADT.
+ */
+
+#include "ioapic.h"
+#include "acpi.h"
+#include "include/kprintf.h"
+#include "mm/vmm_x64.h"
+#include "include/spinlock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IOAPIC_MAX       4
+#define IOAPIC_ISO_MAX   16
+#define IOAPIC_DEFAULT_BASE 0xFEC00000ULL
+
+#define IOAPIC_REGSEL    (0x00 / 4)
+#define IOAPIC_WIN       (0x10 / 4)
+#define IOAPIC_REG_VER   0x01u
+#define IOAPIC_REG_REDIR 0x10u
+
+#define IOAPIC_REDIR_POLARITY_LOW (1u << 13)
+#define IOAPIC_REDIR_LEVEL        (1u << 15)
+#define IOAPIC_REDIR_MASKED       (1u << 16)
+
+#define MADT_TYPE_IOAPIC 1
+#define MADT_TYPE_ISO    2
+
+typedef struct ioapic {
+    volatile uint32_t *base;
+    uint32_t gsi_base;
+    uint32_t pins;
+} ioapic_t;
+
+/* MADT interrupt source override for an ISA line. */
+typedef struct ioapic_iso {
+    uint8_t irq;
+    uint16_t flags;
+    uint32_t gsi;
+} ioapic_iso_t;
+
+static ioapic_t g_ioapics[IOAPIC_MAX];
+static int g_ioapic_count;
+static ioapic_iso_t g_isos[IOAPIC_ISO_MAX];
+static int g_iso_count;
+static spinlock_t g_ioapic_lock = SPINLOCK_INIT;
+
+static uint32_t ioapic_read(const ioapic_t *io, uint32_t reg)
+{
+    io->base[IOAPIC_REGSEL] = reg;
+    return io->base[IOAPIC_WIN];
+}
+
+static void ioapic_write(const ioapic_t *io, uint32_t reg, uint32_t value)
+{
+    io->base[IOAPIC_REGSEL] = reg;
+    io->base[IOAPIC_WIN] = value;
+}
+
+static int ioapic_add(uint64_t phys, uint32_t gsi_base)
+{
+    ioapic_t *io;
+    uintptr_t va = 0;
+    uint32_t ver;
+
+    if (g_ioapic_count >= IOAPIC_MAX)
+        return -1;
+    if (vmm_map_io_region(phys, 0x20u, &va) != 0)
+        return -1;
+
+    io = &g_ioapics[g_ioapic_count];
+    io->base = (volatile uint32_t *)va;
+    ver = ioapic_read(io, IOAPIC_REG_VER);
+    if (ver == 0xFFFFFFFFu)
+        return -1;
+    io->gsi_base = gsi_base;
+    io->pins = ((ver >> 16) & 0xFFu) + 1u;
+
+    for (uint32_t pin = 0; pin < io->pins; pin++) {
+        ioapic_write(io, IOAPIC_REG_REDIR + pin * 2u, IOAPIC_REDIR_MASKED);
+        ioapic_write(io, IOAPIC_REG_REDIR + pin * 2u + 1u, 0);
+    }
+    g_ioapic_count++;
+    kprintf("[ioapic] base=0x%08x gsi=%u-%u\n",
+            (uint32_t)phys, gsi_base, gsi_base + io->pins - 1u);
+    return 0;
+}
+
+int ioapic_init(void)
+{
+    const uint8_t *madt;
+    uint32_t madt_len = 0;
+
+    if (g_ioapic_count)
+        return 0;
+
+    madt = acpi_find_table("APIC", &madt_len);
+    if (madt) {
+        uint32_t off = 44;
+        while (off + 2 <= madt_len) {
+            uint8_t type = madt[off];
+            uint8_t len = madt[off + 1];
+            if (len < 2 || off + len > madt_len)
+                break;
+            if (type == MADT_TYPE_IOAPIC && len >= 12) {
+                (void)ioapic_add(acpi_rd32(madt + off + 4), acpi_rd32(madt + off + 8));
+            } else if (type == MADT_TYPE_ISO && len >= 10 && g_iso_count < IOAPIC_ISO_MAX) {
+                g_isos[g_iso_count].irq = madt[off + 3];
+                g_isos[g_iso_count].gsi = acpi_rd32(madt + off + 4);
+                g_isos[g_iso_count].flags = (uint16_t)(madt[off + 8] | (madt[off + 9] << 8));
+                g_iso_count++;
+            }
+            off += len;
+        }
+    }
+
+    /* No MADT: a single IOAPIC at the PC default address, if one answers. */
+    if (!g_ioapic_count)
+        (void)ioapic_add(IOAPIC_DEFAULT_BASE, 0);
+    return g_ioapic_count ? 0 : -1;
+}
+
+int ioapic_available(void)
+{
+    return g_ioapic_count > 0;
+}
+
+uint32_t ioapic_isa_gsi(uint8_t irq, uint32_t *flags)
+{
+    for (int i = 0; i < g_iso_count; i++) {
+        uint16_t mps;
+        if (g_isos[i].irq != irq)
+            continue;
+        /* MPS INTI flags: polarity in bits 1:0, trigger in 3:2; 0 conforms to the bus. */
+        mps = g_isos[i].flags;
+        if (flags && (mps & 0x3u) == 1u)
+            *flags &= ~IOAPIC_ACTIVE_LOW;
+        else if (flags && (mps & 0x3u) == 3u)
+            *flags |= IOAPIC_ACTIVE_LOW;
+        if (flags && ((mps >> 2) & 0x3u) == 1u)
+            *flags &= ~IOAPIC_LEVEL;
+        else if (flags && ((mps >> 2) & 0x3u) == 3u)
+            *flags |= IOAPIC_LEVEL;
+        return g_isos[i].gsi;
+    }
+    return irq;
+}
+
+static ioapic_t *ioapic_for_gsi(uint32_t gsi, uint32_t *pin)
+{
+    for (int i = 0; i < g_ioapic_count; i++) {
+        ioapic_t *io = &g_ioapics[i];
+        if (gsi >= io->gsi_base && gsi - io->gsi_base < io->pins) {
+            *pin = gsi - io->gsi_base;
+            return io;
+        }
+    }
+    return NULL;
+}
+
+int ioapic_route(uint32_t gsi, uint8_t vector, uint32_t lapic_id, uint32_t flags)
+{
+    uint32_t pin = 0;
+    ioapic_t *io = ioapic_for_gsi(gsi, &pin);
+    uint32_t low = vector;
+
+    if (!io)
+        return -1;
+    if (flags & IOAPIC_LEVEL)
+        low |= IOAPIC_REDIR_LEVEL;
+    if (flags & IOAPIC_ACTIVE_LOW)
+        low |= IOAPIC_REDIR_POLARITY_LOW;
+
+    /* Fixed delivery, physical destination; unmask last. */
+    spin_lock(&g_ioapic_lock);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2u, IOAPIC_REDIR_MASKED);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2u + 1u, (lapic_id & 0xFFu) << 24);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2u, low);
+    spin_unlock(&g_ioapic_lock);
+    return 0;
+}
+
+void ioapic_mask(uint32_t gsi)
+{
+    uint32_t pin = 0;
+    ioapic_t *io = ioapic_for_gsi(gsi, &pin);
+    if (!io)
+        return;
+    spin_lock(&g_ioapic_lock);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2u,
+                 ioapic_read(io, IOAPIC_REG_REDIR + pin * 2u) | IOAPIC_REDIR_MASKED);
+    spin_unlock(&g_ioapic_lock);
+}
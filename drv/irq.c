@@ -10,9 +10,13 @@
 #include "ps2mouse.h"
 #include "pic.h"
 #include "pit.h"
+#include "../include/trace.h"
 
 #ifdef __x86_64__
-#include "../include/kprintf.h"
+#include "../include/klog.h"
+#include "../include/lapic.h"
+#include "../include/profile.h"
+#include "../include/spinlock.h"
 #include "../proc/process.h"
 #endif
 
@@ -50,7 +54,7 @@ static int irq_invoke_hook(uint8_t irq)
     return 1;
 }
 
-void irq_handler(unsigned int vector)
+static void irq_dispatch(unsigned int vector)
 {
     if (vector == 32) {
         pit_irq_tick();
@@ -86,48 +90,67 @@ void irq_handler(unsigned int vector)
         pic_eoi(vector - 32);
 }
 
+void irq_handler(unsigned int vector)
+{
+    TRACE(TRACE_EV_IRQ_ENTRY, vector, 0);
+    irq_dispatch(vector);
+    TRACE(TRACE_EV_IRQ_EXIT, vector, 0);
+}
+
 #ifdef __x86_64__
-static int g_irq32_trace_once;
 
-uint64_t irq_handler_x64(unsigned int vector, uint64_t context_rsp)
+static irq_hook_t g_vector_hooks[IRQ_VECTOR_DYN_COUNT];
+static spinlock_t g_vector_lock = SPINLOCK_INIT;
+
+int irq_alloc_vector(irq_callback_t callback, void *ctx)
+{
+    int vector = -1;
+    if (!callback)
+        return -1;
+
+    spin_lock(&g_vector_lock);
+    for (int i = 0; i < IRQ_VECTOR_DYN_COUNT; i++) {
+        if (g_vector_hooks[i].callback)
+            continue;
+        g_vector_hooks[i].ctx = ctx;
+        g_vector_hooks[i].callback = callback;
+        vector = IRQ_VECTOR_DYN_BASE + i;
+        break;
+    }
+    spin_unlock(&g_vector_lock);
+    return vector;
+}
+
+void irq_free_vector(uint8_t vector)
+{
+    unsigned int slot = (unsigned int)vector - IRQ_VECTOR_DYN_BASE;
+    if (vector < IRQ_VECTOR_DYN_BASE || slot >= IRQ_VECTOR_DYN_COUNT)
+        return;
+    spin_lock(&g_vector_lock);
+    g_vector_hooks[slot].callback = NULL;
+    g_vector_hooks[slot].ctx = NULL;
+    spin_unlock(&g_vector_lock);
+}
+
+static uint64_t irq_dispatch_x64(unsigned int vector, uint64_t context_rsp)
 {
     if (vector == 32) {
         uint64_t next_rsp;
         pit_irq_tick();
+        profile_sample_irq(PROFILE_SRC_PIT, context_rsp);
         (void)irq_invoke_hook(0);
         pic_eoi(0);
         next_rsp = process_schedule_tick(context_rsp);
-
-        if (!g_irq32_trace_once) {
-            g_irq32_trace_once = 1;
-            if (next_rsp) {
-                uint64_t *ctx = (uint64_t *)(uintptr_t)next_rsp;
-                kprintf("[irq32] cur_rsp=0x%08x%08x next_rsp=0x%08x%08x pid=%d\n",
-                        (uint32_t)(context_rsp >> 32), (uint32_t)(context_rsp & 0xFFFFFFFFu),
-                        (uint32_t)(next_rsp >> 32), (uint32_t)(next_rsp & 0xFFFFFFFFu),
-                        process_current_pid());
-                kprintf("[irq32] frame rax=0x%08x%08x vec=0x%08x%08x rip=0x%08x%08x cs=0x%08x%08x rflags=0x%08x%08x\n",
-                        (uint32_t)(ctx[0] >> 32), (uint32_t)(ctx[0] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[15] >> 32), (uint32_t)(ctx[15] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[16] >> 32), (uint32_t)(ctx[16] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[17] >> 32), (uint32_t)(ctx[17] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[18] >> 32), (uint32_t)(ctx[18] & 0xFFFFFFFFu));
-                kprintf("[irq32] q15=0x%08x%08x q16=0x%08x%08x q17=0x%08x%08x q18=0x%08x%08x q19=0x%08x%08x\n",
-                        (uint32_t)(ctx[15] >> 32), (uint32_t)(ctx[15] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[16] >> 32), (uint32_t)(ctx[16] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[17] >> 32), (uint32_t)(ctx[17] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[18] >> 32), (uint32_t)(ctx[18] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[19] >> 32), (uint32_t)(ctx[19] & 0xFFFFFFFFu));
-                kprintf("[irq32] q20=0x%08x%08x q21=0x%08x%08x q22=0x%08x%08x q23=0x%08x%08x\n",
-                        (uint32_t)(ctx[20] >> 32), (uint32_t)(ctx[20] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[21] >> 32), (uint32_t)(ctx[21] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[22] >> 32), (uint32_t)(ctx[22] & 0xFFFFFFFFu),
-                        (uint32_t)(ctx[23] >> 32), (uint32_t)(ctx[23] & 0xFFFFFFFFu));
-            }
-        }
+        klog_poll();
         return next_rsp;
     }
 
+    if (vector == LAPIC_TIMER_VECTOR) {
+        profile_sample_irq(PROFILE_SRC_LAPIC, context_rsp);
+        lapic_eoi();
+        return context_rsp;
+    }
+
     if (vector == 33) {
         if (irq_invoke_hook(1))
             pic_eoi(1);
@@ -154,11 +177,37 @@ uint64_t irq_handler_x64(unsigned int vector, uint64_t context_rsp)
     if (vector >= 32 && vector < 48)
         pic_eoi(vector - 32);
 
+    if (vector >= IRQ_VECTOR_DYN_BASE && vector < IRQ_VECTOR_DYN_BASE + IRQ_VECTOR_DYN_COUNT) {
+        irq_hook_t *hook = &g_vector_hooks[vector - IRQ_VECTOR_DYN_BASE];
+        if (hook->callback)
+            hook->callback((uint8_t)vector, hook->ctx);
+        lapic_eoi();
+    }
+
     return context_rsp;
 }
 
+uint64_t irq_handler_x64(unsigned int vector, uint64_t context_rsp)
+{
+    uint64_t next_rsp;
+
+    TRACE(TRACE_EV_IRQ_ENTRY, vector, 0);
+    next_rsp = irq_dispatch_x64(vector, context_rsp);
+    TRACE(TRACE_EV_IRQ_EXIT, vector, 0);
+    return next_rsp;
+}
+
 #else
 
 void irq_handler_x64_stub(void) {}
 
+int irq_alloc_vector(irq_callback_t callback, void *ctx)
+{
+    (void)callback;
+    (void)ctx;
+    return -1;
+}
+
+void irq_free_vector(uint8_t vector) { (void)vector; }
+
 #endif
@@ -1,5 +1,5 @@
 /*
- * irq.h - IRQ callback registration for PIC IRQ lines.
+ * irq.h - IRQ callback registration for PIC IRQ lines and allocated vectors.
  */
 
 #ifndef TSUKASA_IRQ_H
@@ -12,4 +12,21 @@ typedef void (*irq_callback_t)(uint8_t irq, void *ctx);
 int irq_register_handler(uint8_t irq, irq_callback_t callback, void *ctx);
 void irq_unregister_handler(uint8_t irq);
 
+/*
+ * Vectors handed out for MSI/MSI-X and IOAPIC-routed lines.  They are EOI'd
+ * at the local APIC, never the 8259.  Keep in sync with the IRQ_STUB range
+ * in arch/x86_64/cpu/isr.asm.
+ */
+#define IRQ_VECTOR_DYN_BASE  80
+#define IRQ_VECTOR_DYN_COUNT 32
+
+/**
+ * Reserve a free vector and attach `callback` to it; the callback gets the
+ * vector number as its `irq` argument.
+ *
+ * @return The vector, or -1 if none is left.
+ */
+int irq_alloc_vector(irq_callback_t callback, void *ctx);
+void irq_free_vector(uint8_t vector);
+
 #endif /* TSUKASA_IRQ_H */
@@ -1,6 +1,8 @@
 #include "lapic.h"
 #include "mm/vmm_x64.h"
 #include "include/spinlock.h"
+#include "include/tsc.h"
+#include "drv/pit.h"
 
 #include <stdint.h>
 
@@ -12,6 +14,17 @@ static spinlock_t lapic_lock = SPINLOCK_INIT;
 #define LAPIC_SVR      (0x0F0 / 4)
 #define LAPIC_ICR_LOW  (0x300 / 4)
 #define LAPIC_ICR_HIGH (0x310 / 4)
+#define LAPIC_LVT_TIMER (0x320 / 4)
+#define LAPIC_TIMER_INIT (0x380 / 4)
+#define LAPIC_TIMER_CUR (0x390 / 4)
+#define LAPIC_TIMER_DIV (0x3E0 / 4)
+
+#define LAPIC_LVT_MASKED (1u << 16)
+#define LAPIC_TIMER_PERIODIC (1u << 17)
+#define LAPIC_TIMER_DIV_16 0x3u
+#define LAPIC_CAL_MS 10u
+
+static uint32_t g_lapic_timer_hz;
 
 static inline volatile uint32_t *lapic_ptr(void)
 {
@@ -98,3 +111,60 @@ void lapic_send_ipi(uint32_t lapic_id, uint8_t vector)
         __asm__ volatile ("pause");
     spin_unlock(&lapic_lock);
 }
+
+uint32_t lapic_timer_frequency(void)
+{
+    volatile uint32_t *lapic = lapic_ptr();
+    uint64_t tsc_hz;
+    uint64_t t0;
+    uint64_t wait;
+    uint32_t elapsed;
+
+    if (g_lapic_timer_hz || !lapic)
+        return g_lapic_timer_hz;
+    tsc_hz = pit_tsc_hz();
+    if (!tsc_hz)
+        return 0;
+
+    /* Count down from the maximum, masked, for LAPIC_CAL_MS of TSC time. */
+    lapic[LAPIC_TIMER_DIV] = LAPIC_TIMER_DIV_16;
+    lapic[LAPIC_LVT_TIMER] = LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR;
+    wait = tsc_hz * LAPIC_CAL_MS / 1000u;
+    lapic[LAPIC_TIMER_INIT] = 0xFFFFFFFFu;
+    t0 = tsc_read();
+    while (tsc_read() - t0 < wait)
+        __asm__ volatile ("pause");
+    elapsed = 0xFFFFFFFFu - lapic[LAPIC_TIMER_CUR];
+    lapic[LAPIC_TIMER_INIT] = 0;
+
+    g_lapic_timer_hz = elapsed * (1000u / LAPIC_CAL_MS);
+    return g_lapic_timer_hz;
+}
+
+uint32_t lapic_timer_start(uint32_t hz)
+{
+    volatile uint32_t *lapic = lapic_ptr();
+    uint32_t freq = lapic_timer_frequency();
+    uint32_t count;
+
+    if (!lapic || !freq || hz == 0)
+        return 0;
+    count = freq / hz;
+    if (count == 0)
+        count = 1;
+
+    lapic[LAPIC_TIMER_DIV] = LAPIC_TIMER_DIV_16;
+    lapic[LAPIC_LVT_TIMER] = LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR;
+    lapic[LAPIC_TIMER_INIT] = count;
+    return freq / count;
+}
+
+void lapic_timer_stop(void)
+{
+    volatile uint32_t *lapic = lapic_ptr();
+    if (!lapic)
+        return;
+
+    lapic[LAPIC_LVT_TIMER] = LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR;
+    lapic[LAPIC_TIMER_INIT] = 0;
+}
@@ -4,9 +4,15 @@
 
 #include "pit.h"
 #include "ps2.h"
+#include "../include/tsc.h"
+
+#define PIT_BASE_HZ        1193182u
+#define PIT_CAL_MS         10u
+#define PIT_CAL_SPIN_LIMIT 100000000u
 
 static volatile uint64_t g_pit_ticks;
 static volatile uint32_t g_pit_hz;
+static uint64_t g_tsc_hz;
 
 void pit_init(uint32_t hz)
 {
@@ -44,3 +50,35 @@ uint32_t pit_frequency(void)
     return g_pit_hz;
 }
 
+
+uint64_t pit_tsc_hz(void)
+{
+    uint16_t count = (uint16_t)(PIT_BASE_HZ * PIT_CAL_MS / 1000u);
+    uint8_t port61;
+    uint64_t t0;
+    uint64_t t1;
+    uint32_t spins = 0;
+
+    if (g_tsc_hz)
+        return g_tsc_hz;
+
+    /* Channel 2, mode 0 (one-shot); its output shows up in port 0x61 bit 5. */
+    port61 = inb(0x61);
+    outb(0x61, (unsigned char)((port61 & ~0x02u) | 0x01u));   /* gate on, speaker off */
+    outb(0x43, 0xB0);
+    outb(0x42, (uint8_t)(count & 0xFFu));
+    outb(0x42, (uint8_t)(count >> 8));
+
+    t0 = tsc_read();
+    while ((inb(0x61) & 0x20u) == 0) {
+        if (++spins >= PIT_CAL_SPIN_LIMIT)
+            break;
+    }
+    t1 = tsc_read();
+    outb(0x61, port61);
+
+    if (spins >= PIT_CAL_SPIN_LIMIT)
+        return 0;
+    g_tsc_hz = (t1 - t0) * (1000u / PIT_CAL_MS);
+    return g_tsc_hz;
+}
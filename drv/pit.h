@@ -12,5 +12,12 @@ void pit_irq_tick(void);
 uint64_t pit_ticks(void);
 uint32_t pit_frequency(void);
 
+/**
+ * TSC ticks per second, measured once against PIT channel 2.  Polls the
+ * channel, so it works with interrupts disabled.  Returns 0 if the channel
+ * never fires (no PIT).
+ */
+uint64_t pit_tsc_hz(void);
+
 #endif /* TSUKASA_PIT_H */
 
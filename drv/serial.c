@@ -8,6 +8,10 @@
  *   +3  LCR (line control, bit7 = DLAB)
  *   +4  MCR (modem control)
  *   +5  LSR (line status, bit5 = TX empty)
+ *
+ * Besides the blocking serial_putc() path, the driver exposes raw FIFO
+ * access and THRE interrupt control so lib/klog.c can drain its ring from
+ * IRQ4 instead of spinning on LSR for every byte.
  */
 
 #include "../drv/serial.h"
@@ -15,6 +19,12 @@
 
 #define COM1_BASE  0x3F8u
 
+#define UART_IER_THRE  0x02u
+#define UART_MCR_OUT2  0x08u   /* gates the UART IRQ line on PC hardware */
+#define UART_LSR_THRE  0x20u
+
+static uint8_t g_ier;
+
 static inline void outb(uint16_t port, uint8_t val)
 {
     __asm__ volatile ("outb %0, %1" :: "a"(val), "Nd"(port));
@@ -30,7 +40,8 @@ static inline uint8_t inb(uint16_t port)
 void serial_init(void)
 {
     /* Disable interrupts. */
-    outb(COM1_BASE + 1u, 0x00u);
+    g_ier = 0x00u;
+    outb(COM1_BASE + 1u, g_ier);
 
     /* Enable DLAB to set baud divisor. */
     outb(COM1_BASE + 3u, 0x80u);
@@ -52,7 +63,7 @@ void serial_init(void)
 /* Block until the Transmit Holding Register is empty. */
 static void serial_wait_tx(void)
 {
-    while ((inb(COM1_BASE + 5u) & 0x20u) == 0u)
+    while ((inb(COM1_BASE + 5u) & UART_LSR_THRE) == 0u)
         __asm__ volatile ("pause");
 }
 
@@ -72,3 +83,31 @@ void serial_puts(const char *s)
     while (*s)
         serial_putc(*s++);
 }
+
+int serial_tx_ready(void)
+{
+    return (inb(COM1_BASE + 5u) & UART_LSR_THRE) != 0u;
+}
+
+void serial_tx_raw(uint8_t b)
+{
+    outb(COM1_BASE, b);
+}
+
+void serial_set_tx_irq(int enable)
+{
+    uint8_t ier = enable ? (uint8_t)(g_ier | UART_IER_THRE)
+                         : (uint8_t)(g_ier & ~UART_IER_THRE);
+    if (ier == g_ier)
+        return;
+    g_ier = ier;
+    if (enable)
+        outb(COM1_BASE + 4u, 0x03u | UART_MCR_OUT2);
+    outb(COM1_BASE + 1u, g_ier);
+}
+
+void serial_ack_irq(void)
+{
+    /* Reading IIR clears a pending THRE interrupt. */
+    (void)inb(COM1_BASE + 2u);
+}
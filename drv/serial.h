@@ -8,6 +8,9 @@
 
 #include <stdint.h>
 
+#define SERIAL_COM1_IRQ     4
+#define SERIAL_FIFO_DEPTH   16
+
 /** Initialise COM1 at 115200 baud, 8N1.  Must be called before serial_putc. */
 void serial_init(void);
 
@@ -17,4 +20,16 @@ void serial_putc(char c);
 /** Transmit a NUL-terminated string. */
 void serial_puts(const char *s);
 
+/** Non-zero when the THR/FIFO is empty and can take SERIAL_FIFO_DEPTH bytes. */
+int serial_tx_ready(void);
+
+/** Write one byte to THR without waiting and without CR/LF translation. */
+void serial_tx_raw(uint8_t b);
+
+/** Enable/disable the "THR empty" interrupt on SERIAL_COM1_IRQ. */
+void serial_set_tx_irq(int enable);
+
+/** Acknowledge a COM1 interrupt (reads IIR). */
+void serial_ack_irq(void);
+
 #endif /* SERIAL_H */
@@ -3,6 +3,7 @@
  */
 
 #include "memfs.h"
+#include "../include/kutils.h"
 #include "../mm/heap.h"
 #include <stdint.h>
 #include <stddef.h>
@@ -84,7 +85,7 @@ size_t memfs_read(int inode, size_t pos, void *buf, size_t count)
     if (pos >= n->size) return 0;
     if (count > n->size - pos) count = n->size - pos;
     uint8_t *dst = (uint8_t *)buf;
-    for (size_t i = 0; i < count; i++) dst[i] = n->data[pos + i];
+    k_memcpy(dst, n->data + pos, count);
     return count;
 }
 
@@ -101,7 +102,8 @@ size_t memfs_write(int inode, size_t pos, const void *buf, size_t count)
         while (new_cap < needed) new_cap *= 2;
         uint8_t *new_data = (uint8_t *)kmalloc(new_cap);
         if (!new_data) return 0;
-        for (size_t i = 0; i < n->size; i++) new_data[i] = n->data[i];
+        if (n->data)
+            k_memcpy(new_data, n->data, n->size);
         kfree(n->data);
         n->data     = new_data;
         n->capacity = new_cap;
@@ -110,7 +112,7 @@ size_t memfs_write(int inode, size_t pos, const void *buf, size_t count)
     const uint8_t *src = (const uint8_t *)buf;
     if (count > 0 && !src)
         return 0;
-    for (size_t i = 0; i < count; i++) n->data[pos + i] = src[i];
+    k_memcpy(n->data + pos, src, count);
     if (pos + count > n->size) n->size = pos + count;
     return count;
 }
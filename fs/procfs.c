@@ -5,12 +5,16 @@
  *   /proc/processes           (file)
  *   /proc/self/               (dir)
  *   /proc/self/status         (file)
+ *   /proc/self/sched          (file)
  *   /proc/<pid>/              (dir)
  *   /proc/<pid>/status        (file)
+ *   /proc/<pid>/sched         (file, scheduler counters and latency)
  */
 
 #include "procfs.h"
 
+#include "../drv/pit.h"
+#include "../include/kutils.h"
 #include "../mm/heap.h"
 #include "../proc/process.h"
 
@@ -56,10 +60,7 @@ typedef struct out_buf {
 
 static int kstrlen(const char *s)
 {
-    int n = 0;
-    while (s && s[n])
-        n++;
-    return n;
+    return s ? (int)k_strlen(s) : 0;
 }
 
 static int kstrcmp(const char *a, const char *b)
@@ -142,8 +143,8 @@ static int out_reserve(out_buf_t *ob, size_t add)
     nb = (char *)kmalloc(ncap);
     if (!nb)
         return -1;
-    for (size_t i = 0; i < ob->len; i++)
-        nb[i] = ob->data[i];
+    if (ob->data)
+        k_memcpy(nb, ob->data, ob->len);
     if (ob->data)
         kfree(ob->data);
     ob->data = nb;
@@ -158,8 +159,8 @@ static int out_append_str(out_buf_t *ob, const char *s)
     int slen = kstrlen(s);
     if (out_reserve(ob, (size_t)slen) != 0)
         return -1;
-    for (int i = 0; i < slen; i++)
-        ob->data[ob->len++] = s[i];
+    k_memcpy(ob->data + ob->len, s, (size_t)slen);
+    ob->len += (size_t)slen;
     ob->data[ob->len] = '\0';
     return 0;
 }
@@ -211,6 +212,40 @@ static int fill_status(uint32_t pid, out_buf_t *ob)
     return 0;
 }
 
+static int fill_sched(uint32_t pid, out_buf_t *ob)
+{
+    process_snapshot_t ps;
+    process_sched_stats_t st;
+    char hist[SCHED_LATENCY_HIST_TEXT_MAX];
+    uint64_t hz = pit_tsc_hz();
+    uint64_t mhz = hz / 1000000u;
+
+    if (process_get_info((int)pid, &ps) != 0 ||
+        process_get_sched_stats((int)pid, &st) != 0)
+        return -1;
+    if (mhz == 0)
+        mhz = 1;
+    if (out_append_str(ob, "priority: ") != 0) return -1;
+    if (out_append_u64(ob, ps.priority) != 0) return -1;
+    if (out_append_str(ob, "\nticks: ") != 0) return -1;
+    if (out_append_u64(ob, ps.sched_ticks) != 0) return -1;
+    if (out_append_str(ob, "\nwakeups: ") != 0) return -1;
+    if (out_append_u64(ob, st.wakeups) != 0) return -1;
+    if (out_append_str(ob, "\nvoluntary_switches: ") != 0) return -1;
+    if (out_append_u64(ob, st.voluntary_switches) != 0) return -1;
+    if (out_append_str(ob, "\ninvoluntary_switches: ") != 0) return -1;
+    if (out_append_u64(ob, st.involuntary_switches) != 0) return -1;
+    if (out_append_str(ob, "\nslice_expiries: ") != 0) return -1;
+    if (out_append_u64(ob, st.slice_expiries) != 0) return -1;
+    if (out_append_str(ob, "\nrun_delay_us: ") != 0) return -1;
+    if (out_append_u64(ob, st.run_delay_cycles / mhz) != 0) return -1;
+    if (out_append_str(ob, "\nrun_delay_max_us: ") != 0) return -1;
+    if (out_append_u64(ob, st.run_delay_max / mhz) != 0) return -1;
+    if (out_append_str(ob, "\n") != 0) return -1;
+    sched_format_latency_hist(st.latency_hist, hist, sizeof(hist));
+    return out_append_str(ob, hist);
+}
+
 static int is_pid_dir(const char *path, uint32_t *pid_out)
 {
     if (!path || path[0] != '/')
@@ -218,7 +253,8 @@ static int is_pid_dir(const char *path, uint32_t *pid_out)
     return parse_u32(path + 1, pid_out) == 0;
 }
 
-static int is_pid_status(const char *path, uint32_t *pid_out)
+/* Matches "/<pid><leaf>", e.g. leaf "/status". */
+static int is_pid_file(const char *path, const char *leaf, uint32_t *pid_out)
 {
     int i = 1;
     uint32_t pid;
@@ -229,7 +265,7 @@ static int is_pid_status(const char *path, uint32_t *pid_out)
     while (path[i] && path[i] != '/' && ni < (int)sizeof(num) - 1)
         num[ni++] = path[i++];
     num[ni] = '\0';
-    if (path[i] != '/' || kstrcmp(path + i, "/status") != 0)
+    if (path[i] != '/' || kstrcmp(path + i, leaf) != 0)
         return 0;
     if (parse_u32(num, &pid) != 0)
         return 0;
@@ -263,7 +299,7 @@ int procfs_stat(const char *path, vfs_stat_t *out)
         out->type = VFS_TYPE_DIR;
         return 0;
     }
-    if (kstreq(path, "/self/status")) {
+    if (kstreq(path, "/self/status") || kstreq(path, "/self/sched")) {
         out->type = VFS_TYPE_FILE;
         return 0;
     }
@@ -271,7 +307,8 @@ int procfs_stat(const char *path, vfs_stat_t *out)
         out->type = VFS_TYPE_DIR;
         return 0;
     }
-    if (is_pid_status(path, &pid) && process_get_info((int)pid, NULL) == 0) {
+    if ((is_pid_file(path, "/status", &pid) || is_pid_file(path, "/sched", &pid)) &&
+        process_get_info((int)pid, NULL) == 0) {
         out->type = VFS_TYPE_FILE;
         return 0;
     }
@@ -319,7 +356,9 @@ int procfs_list(const char *path, char names[][VFS_NAME_MAX], int max)
 
     if (kstreq(path, "/self")) {
         kstrncpy(names[0], "status", VFS_NAME_MAX);
-        return 1;
+        if (max > 1)
+            kstrncpy(names[1], "sched", VFS_NAME_MAX);
+        return max > 1 ? 2 : 1;
     }
 
     {
@@ -327,6 +366,8 @@ int procfs_list(const char *path, char names[][VFS_NAME_MAX], int max)
         if (is_pid_dir(path, &pid) && process_get_info((int)pid, NULL) == 0) {
             kstrncpy(names[0], "status", VFS_NAME_MAX);
             count = 1;
+            if (max > 1)
+                kstrncpy(names[count++], "sched", VFS_NAME_MAX);
             goto out;
         }
     }
@@ -379,9 +420,18 @@ int procfs_read_file(const char *path, uint8_t **buf_out, size_t *size_out)
             goto fail;
         if (fill_status((uint32_t)cur, &ob) != 0)
             goto fail;
-    } else if (is_pid_status(path, &pid)) {
+    } else if (kstreq(path, "/self/sched")) {
+        int cur = process_current_pid();
+        if (cur <= 0)
+            goto fail;
+        if (fill_sched((uint32_t)cur, &ob) != 0)
+            goto fail;
+    } else if (is_pid_file(path, "/status", &pid)) {
         if (fill_status(pid, &ob) != 0)
             goto fail;
+    } else if (is_pid_file(path, "/sched", &pid)) {
+        if (fill_sched(pid, &ob) != 0)
+            goto fail;
     } else {
         goto fail;
     }
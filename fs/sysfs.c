@@ -3,23 +3,43 @@
  *
  * Layout:
  *   /sys/memory
+ *   /sys/klog
  *   /sys/devices/summary
  *   /sys/devices/pci
  *   /sys/mounts
  *   /sys/net/status
  *   /sys/net/stats
+ *   /sys/net/dns_cache     (resolver counters, then one line per live entry)
+ *   /sys/gfx/glyph_cache
+ *   /sys/gfx/fontbench     (glyphs/s from the last "bench font" run)
+ *   /sys/heap/sites        (kmalloc call sites, largest live bytes first)
+ *   /sys/sched             (scheduler counters, run queue, wake-up latency)
+ *   /sys/trace             (binary tracepoint dump, see include/trace.h)
+ *   /sys/profile           (sampling profiler, hottest functions first)
+ *   /sys/syscalls          (per-command call and cycle counters, costliest first)
  */
 
 #include "sysfs.h"
 
 #include "../drv/ata.h"
 #include "../drv/fb.h"
+#include "../drv/pit.h"
 #include "../dev/pci.h"
+#include "../gfx/font.h"
+#include "../include/bench.h"
+#include "../include/klog.h"
+#include "../include/kutils.h"
+#include "../include/profile.h"
+#include "../include/trace.h"
 #include "../ipc/shm.h"
 #include "../mm/heap.h"
 #include "../mm/pmm.h"
+#include "../mm/vm_anon.h"
+#include "../net/dns_cache.h"
 #include "../net/network.h"
+#include "../net/nic/nic.h"
 #include "../proc/process.h"
+#include "../syscall/syscall.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -63,10 +83,7 @@ typedef struct out_buf {
 
 static int kstrlen(const char *s)
 {
-    int n = 0;
-    while (s && s[n])
-        n++;
-    return n;
+    return s ? (int)k_strlen(s) : 0;
 }
 
 static int kstrcmp(const char *a, const char *b)
@@ -115,8 +132,8 @@ static int out_reserve(out_buf_t *ob, size_t add)
     nb = (char *)kmalloc(ncap);
     if (!nb)
         return -1;
-    for (size_t i = 0; i < ob->len; i++)
-        nb[i] = ob->data[i];
+    if (ob->data)
+        k_memcpy(nb, ob->data, ob->len);
     if (ob->data)
         kfree(ob->data);
     ob->data = nb;
@@ -131,8 +148,8 @@ static int out_append_str(out_buf_t *ob, const char *s)
     int slen = kstrlen(s);
     if (out_reserve(ob, (size_t)slen) != 0)
         return -1;
-    for (int i = 0; i < slen; i++)
-        ob->data[ob->len++] = s[i];
+    k_memcpy(ob->data + ob->len, s, (size_t)slen);
+    ob->len += (size_t)slen;
     ob->data[ob->len] = '\0';
     return 0;
 }
@@ -190,16 +207,26 @@ int sysfs_stat(const char *path, vfs_stat_t *out)
         out->type = VFS_TYPE_DIR;
         return 0;
     }
-    if (kstreq(path, "/devices") || kstreq(path, "/net")) {
+    if (kstreq(path, "/devices") || kstreq(path, "/net") || kstreq(path, "/gfx") ||
+        kstreq(path, "/heap")) {
         out->type = VFS_TYPE_DIR;
         return 0;
     }
     if (kstreq(path, "/memory") ||
+        kstreq(path, "/klog") ||
+        kstreq(path, "/sched") ||
+        kstreq(path, "/trace") ||
+        kstreq(path, "/profile") ||
+        kstreq(path, "/syscalls") ||
         kstreq(path, "/devices/summary") ||
         kstreq(path, "/devices/pci") ||
         kstreq(path, "/mounts") ||
         kstreq(path, "/net/status") ||
-        kstreq(path, "/net/stats")) {
+        kstreq(path, "/net/stats") ||
+        kstreq(path, "/net/dns_cache") ||
+        kstreq(path, "/gfx/glyph_cache") ||
+        kstreq(path, "/gfx/fontbench") ||
+        kstreq(path, "/heap/sites")) {
         out->type = VFS_TYPE_FILE;
         return 0;
     }
@@ -215,7 +242,23 @@ int sysfs_list(const char *path, char names[][VFS_NAME_MAX], int max)
         if (max > 1) kstrncpy(names[1], "devices", VFS_NAME_MAX);
         if (max > 2) kstrncpy(names[2], "mounts", VFS_NAME_MAX);
         if (max > 3) kstrncpy(names[3], "net", VFS_NAME_MAX);
-        return max >= 4 ? 4 : max;
+        if (max > 4) kstrncpy(names[4], "klog", VFS_NAME_MAX);
+        if (max > 5) kstrncpy(names[5], "gfx", VFS_NAME_MAX);
+        if (max > 6) kstrncpy(names[6], "heap", VFS_NAME_MAX);
+        if (max > 7) kstrncpy(names[7], "sched", VFS_NAME_MAX);
+        if (max > 8) kstrncpy(names[8], "trace", VFS_NAME_MAX);
+        if (max > 9) kstrncpy(names[9], "profile", VFS_NAME_MAX);
+        if (max > 10) kstrncpy(names[10], "syscalls", VFS_NAME_MAX);
+        return max >= 11 ? 11 : max;
+    }
+    if (kstreq(path, "/heap")) {
+        if (max > 0) kstrncpy(names[0], "sites", VFS_NAME_MAX);
+        return 1;
+    }
+    if (kstreq(path, "/gfx")) {
+        if (max > 0) kstrncpy(names[0], "glyph_cache", VFS_NAME_MAX);
+        if (max > 1) kstrncpy(names[1], "fontbench", VFS_NAME_MAX);
+        return max >= 2 ? 2 : max;
     }
     if (kstreq(path, "/devices")) {
         if (max > 0) kstrncpy(names[0], "summary", VFS_NAME_MAX);
@@ -225,7 +268,8 @@ int sysfs_list(const char *path, char names[][VFS_NAME_MAX], int max)
     if (kstreq(path, "/net")) {
         if (max > 0) kstrncpy(names[0], "status", VFS_NAME_MAX);
         if (max > 1) kstrncpy(names[1], "stats", VFS_NAME_MAX);
-        return max >= 2 ? 2 : max;
+        if (max > 2) kstrncpy(names[2], "dns_cache", VFS_NAME_MAX);
+        return max >= 3 ? 3 : max;
     }
     return -1;
 }
@@ -234,6 +278,7 @@ static int build_memory(out_buf_t *ob)
 {
     heap_stats_t hs = {0};
     struct shm_stats ss = {0};
+    struct vm_anon_stats as = {0};
     size_t pc = 0;
     size_t pm = 0;
     size_t psp = 0;
@@ -241,6 +286,7 @@ static int build_memory(out_buf_t *ob)
 
     heap_get_stats(&hs);
     shm_get_stats(&ss);
+    vm_anon_get_stats(&as);
     process_get_memory_totals(&pc, &pm, &psp, &psa);
 
     if (out_append_str(ob, "pmm_total_pages: ") != 0) return -1;
@@ -256,6 +302,14 @@ static int build_memory(out_buf_t *ob)
     if (out_append_u64(ob, hs.allocated_bytes) != 0) return -1;
     if (out_append_str(ob, "\nheap_peak_bytes: ") != 0) return -1;
     if (out_append_u64(ob, hs.peak_allocated_bytes) != 0) return -1;
+    if (out_append_str(ob, "\nheap_pools: ") != 0) return -1;
+    if (out_append_u64(ob, hs.pool_count) != 0) return -1;
+    if (out_append_str(ob, "\nheap_direct_bytes: ") != 0) return -1;
+    if (out_append_u64(ob, hs.direct_bytes) != 0) return -1;
+    if (out_append_str(ob, "\nheap_direct_allocs: ") != 0) return -1;
+    if (out_append_u64(ob, hs.direct_count) != 0) return -1;
+    if (out_append_str(ob, "\nheap_released_bytes: ") != 0) return -1;
+    if (out_append_u64(ob, hs.released_bytes) != 0) return -1;
 
     if (out_append_str(ob, "\nprocess_count: ") != 0) return -1;
     if (out_append_u64(ob, pc) != 0) return -1;
@@ -272,6 +326,13 @@ static int build_memory(out_buf_t *ob)
     if (out_append_u64(ob, ss.attachment_count) != 0) return -1;
     if (out_append_str(ob, "\nshm_reserved_pages: ") != 0) return -1;
     if (out_append_u64(ob, ss.reserved_pages) != 0) return -1;
+
+    if (out_append_str(ob, "\nanon_maps: ") != 0) return -1;
+    if (out_append_u64(ob, as.map_count) != 0) return -1;
+    if (out_append_str(ob, "\nanon_pages: ") != 0) return -1;
+    if (out_append_u64(ob, as.mapped_pages) != 0) return -1;
+    if (out_append_str(ob, "\nanon_peak_pages: ") != 0) return -1;
+    if (out_append_u64(ob, as.peak_pages) != 0) return -1;
     if (out_append_str(ob, "\n") != 0) return -1;
     return 0;
 }
@@ -327,10 +388,13 @@ static int build_pci(out_buf_t *ob)
     int count = pci_device_count();
     if (out_append_str(ob, "pci.count: ") != 0) return -1;
     if (out_append_u64(ob, (uint64_t)count) != 0) return -1;
+    if (out_append_str(ob, "\npci.config: ") != 0) return -1;
+    if (out_append_str(ob, pci_ecam_active() ? "ecam" : "port") != 0) return -1;
     if (out_append_str(ob, "\n") != 0) return -1;
 
     for (int i = 0; i < count; i++) {
         const pci_device_info_t *dev = pci_device_at(i);
+        uint8_t cap = 0;
         if (!dev)
             continue;
         if (out_append_str(ob, "pci.") != 0) return -1;
@@ -353,6 +417,18 @@ static int build_pci(out_buf_t *ob)
         if (out_append_hex(ob, dev->prog_if, 2) != 0) return -1;
         if (out_append_str(ob, " irq=") != 0) return -1;
         if (out_append_u64(ob, dev->irq_line) != 0) return -1;
+        /* Capability IDs, from the copy taken at scan time. */
+        if (out_append_str(ob, " caps=") != 0) return -1;
+        if ((dev->config[0x06] & 0x10u) && dev->config[0x34] >= 0x40) {
+            cap = dev->config[0x34] & 0xFCu;
+            for (int guard = 0; guard < 48 && cap >= 0x40; guard++) {
+                if (guard && out_append_str(ob, ",") != 0) return -1;
+                if (out_append_hex(ob, dev->config[cap], 2) != 0) return -1;
+                cap = dev->config[cap + 1] & 0xFCu;
+            }
+        } else if (out_append_str(ob, "none") != 0) {
+            return -1;
+        }
         if (out_append_str(ob, " driver=") != 0) return -1;
         if (out_append_str(ob, dev->bound_driver[0] ? dev->bound_driver : "none") != 0) return -1;
         if (out_append_str(ob, "\n") != 0) return -1;
@@ -395,8 +471,12 @@ static int build_net_status(out_buf_t *ob)
 static int build_net_stats(out_buf_t *ob)
 {
     net_runtime_stats_t st;
+    nic_stats_t nst;
+    nic_stack_tuning_t tun;
     if (network_get_stats(&st) != 0)
         return -1;
+    nic_get_stats(&nst);
+    nic_stack_tuning(&tun);
     if (out_append_str(ob, "tx_packets: ") != 0) return -1;
     if (out_append_u64(ob, st.tx_packets) != 0) return -1;
     if (out_append_str(ob, "\ntx_bytes: ") != 0) return -1;
@@ -411,14 +491,428 @@ static int build_net_stats(out_buf_t *ob)
     if (out_append_u64(ob, st.irq_count) != 0) return -1;
     if (out_append_str(ob, "\nrx_poll_calls: ") != 0) return -1;
     if (out_append_u64(ob, st.rx_poll_calls) != 0) return -1;
+    if (out_append_str(ob, "\nrx_zero_copy: ") != 0) return -1;
+    if (out_append_u64(ob, nst.rx_zero_copy) != 0) return -1;
+    if (out_append_str(ob, "\ntx_zero_copy: ") != 0) return -1;
+    if (out_append_u64(ob, nst.tx_zero_copy) != 0) return -1;
+    if (out_append_str(ob, "\nrx_budget: ") != 0) return -1;
+    if (out_append_u64(ob, (uint64_t)nic_rx_budget()) != 0) return -1;
+    if (out_append_str(ob, "\nrx_worker_runs: ") != 0) return -1;
+    if (out_append_u64(ob, nst.rx_worker_runs) != 0) return -1;
+    if (out_append_str(ob, "\nrx_budget_hits: ") != 0) return -1;
+    if (out_append_u64(ob, nst.rx_budget_hits) != 0) return -1;
     if (out_append_str(ob, "\nstack_initialized: ") != 0) return -1;
     if (out_append_u64(ob, st.stack_initialized) != 0) return -1;
     if (out_append_str(ob, "\nhas_ip: ") != 0) return -1;
     if (out_append_u64(ob, st.has_ip) != 0) return -1;
+    if (out_append_str(ob, "\nlwip_profile: ") != 0) return -1;
+    if (out_append_str(ob, tun.profile) != 0) return -1;
+    if (out_append_str(ob, "\ntcp_mss: ") != 0) return -1;
+    if (out_append_u64(ob, tun.tcp_mss) != 0) return -1;
+    if (out_append_str(ob, "\ntcp_wnd: ") != 0) return -1;
+    if (out_append_u64(ob, tun.tcp_wnd) != 0) return -1;
+    if (out_append_str(ob, "\ntcp_snd_buf: ") != 0) return -1;
+    if (out_append_u64(ob, tun.tcp_snd_buf) != 0) return -1;
+    if (out_append_str(ob, "\ntcp_wnd_scale: ") != 0) return -1;
+    if (out_append_u64(ob, tun.tcp_wnd_scale) != 0) return -1;
+    if (out_append_str(ob, "\ntcp_sack_blocks: ") != 0) return -1;
+    if (out_append_u64(ob, tun.tcp_sack) != 0) return -1;
+    if (out_append_str(ob, "\npbuf_pool_size: ") != 0) return -1;
+    if (out_append_u64(ob, tun.pbuf_pool_size) != 0) return -1;
+    if (out_append_str(ob, "\ntcp_pcbs: ") != 0) return -1;
+    if (out_append_u64(ob, tun.tcp_pcbs) != 0) return -1;
+    if (out_append_str(ob, "\n") != 0) return -1;
+    return 0;
+}
+
+/* "<name> <ok|notfound|failed|pending> <ipv4> ttl=<s> hits=<n>" per entry. */
+static int build_net_dns_cache(out_buf_t *ob)
+{
+    static const char *const status_names[] = { "ok", "notfound", "failed" };
+    dns_cache_stats_t st;
+    dns_cache_info_t *rows;
+    int n;
+    int rc = -1;
+
+    rows = (dns_cache_info_t *)kmalloc(sizeof(*rows) * DNS_CACHE_ENTRIES);
+    if (!rows)
+        return -1;
+    n = dns_cache_snapshot(rows, DNS_CACHE_ENTRIES, &st);
+
+    if (out_append_str(ob, "entries: ") != 0) goto out;
+    if (out_append_u64(ob, (uint64_t)n) != 0) goto out;
+    if (out_append_str(ob, "\ncapacity: ") != 0) goto out;
+    if (out_append_u64(ob, DNS_CACHE_ENTRIES) != 0) goto out;
+    if (out_append_str(ob, "\nlookups: ") != 0) goto out;
+    if (out_append_u64(ob, st.lookups) != 0) goto out;
+    if (out_append_str(ob, "\nhits: ") != 0) goto out;
+    if (out_append_u64(ob, st.hits) != 0) goto out;
+    if (out_append_str(ob, "\nnegative_hits: ") != 0) goto out;
+    if (out_append_u64(ob, st.negative_hits) != 0) goto out;
+    if (out_append_str(ob, "\nmisses: ") != 0) goto out;
+    if (out_append_u64(ob, st.misses) != 0) goto out;
+    if (out_append_str(ob, "\ninflight_joins: ") != 0) goto out;
+    if (out_append_u64(ob, st.joins) != 0) goto out;
+    if (out_append_str(ob, "\nqueries_sent: ") != 0) goto out;
+    if (out_append_u64(ob, st.queries_sent) != 0) goto out;
+    if (out_append_str(ob, "\ntimeouts: ") != 0) goto out;
+    if (out_append_u64(ob, st.timeouts) != 0) goto out;
+    if (out_append_str(ob, "\nevictions: ") != 0) goto out;
+    if (out_append_u64(ob, st.evictions) != 0) goto out;
+    if (out_append_str(ob, "\n") != 0) goto out;
+
+    for (int i = 0; i < n; i++) {
+        const dns_cache_info_t *r = &rows[i];
+        int status = r->result.status;
+        if (status < DNS_STATUS_OK || status > DNS_STATUS_FAILED)
+            status = DNS_STATUS_FAILED;
+        if (out_append_str(ob, r->name) != 0) goto out;
+        if (out_append_str(ob, " ") != 0) goto out;
+        if (out_append_str(ob, r->pending ? "pending" : status_names[status]) != 0) goto out;
+        if (out_append_str(ob, " ") != 0) goto out;
+        if (out_append_ipv4(ob, r->result.ip) != 0) goto out;
+        if (out_append_str(ob, " ttl=") != 0) goto out;
+        if (out_append_u64(ob, r->result.ttl) != 0) goto out;
+        if (out_append_str(ob, " hits=") != 0) goto out;
+        if (out_append_u64(ob, r->hits) != 0) goto out;
+        if (out_append_str(ob, "\n") != 0) goto out;
+    }
+    rc = 0;
+out:
+    kfree(rows);
+    return rc;
+}
+
+/* Retained log history; each line is prefixed with "[sec.msec cpuN] ". */
+static int build_klog(out_buf_t *ob)
+{
+    klog_iter_t it;
+    klog_record_t rec;
+    klog_stats_t st;
+    uint32_t hz = pit_frequency();
+    int line_start = 1;
+
+    klog_get_stats(&st);
+    if (out_append_str(ob, "# seq=") != 0) return -1;
+    if (out_append_u64(ob, st.next_seq) != 0) return -1;
+    if (out_append_str(ob, " dropped=") != 0) return -1;
+    if (out_append_u64(ob, st.dropped) != 0) return -1;
+    if (out_append_str(ob, " async=") != 0) return -1;
+    if (out_append_u64(ob, (uint64_t)st.async) != 0) return -1;
+    if (out_append_str(ob, "\n") != 0) return -1;
+
+    klog_iter_init(&it);
+    while (klog_iter_next(&it, &rec)) {
+        if (line_start) {
+            uint64_t ms = hz ? (rec.ticks * 1000u) / hz : 0;
+            if (out_append_str(ob, "[") != 0) return -1;
+            if (out_append_u64(ob, ms / 1000u) != 0) return -1;
+            if (out_append_str(ob, ".") != 0) return -1;
+            if (out_append_u64(ob, (ms % 1000u) / 100u) != 0) return -1;
+            if (out_append_u64(ob, (ms % 100u) / 10u) != 0) return -1;
+            if (out_append_u64(ob, ms % 10u) != 0) return -1;
+            if (out_append_str(ob, " cpu") != 0) return -1;
+            if (out_append_u64(ob, rec.cpu) != 0) return -1;
+            if (out_append_str(ob, "] ") != 0) return -1;
+        }
+        if (out_reserve(ob, rec.len) != 0)
+            return -1;
+        for (uint16_t i = 0; i < rec.len; i++)
+            ob->data[ob->len++] = rec.text[i];
+        ob->data[ob->len] = '\0';
+        line_start = rec.len > 0 && rec.text[rec.len - 1] == '\n';
+    }
+    return 0;
+}
+
+static int build_glyph_cache(out_buf_t *ob)
+{
+    font_cache_stats_t st;
+    font_cache_get_stats(&st);
+    if (out_append_str(ob, "slots=") != 0) return -1;
+    if (out_append_u64(ob, st.slots) != 0) return -1;
+    if (out_append_str(ob, "\nhits=") != 0) return -1;
+    if (out_append_u64(ob, st.hits) != 0) return -1;
+    if (out_append_str(ob, "\nmisses=") != 0) return -1;
+    if (out_append_u64(ob, st.misses) != 0) return -1;
+    if (out_append_str(ob, "\n") != 0) return -1;
+    return 0;
+}
+
+/*
+ * Glyphs per second for the old per-pixel and the new cached/span paths, as
+ * last measured by the bench "font" suite; reading never runs it.
+ */
+static int build_fontbench(out_buf_t *ob)
+{
+    static const char *const cases[] = { "fb_pixel", "fb_cached", "buf_pixel", "buf_span" };
+    int measured = 0;
+
+    if (out_append_str(ob, "glyphs_per_case=") != 0) return -1;
+    if (out_append_u64(ob, FONT_BENCH_COLS) != 0) return -1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bench_last_t last;
+        uint64_t gps = 0;
+        if (bench_last("font", cases[i], &last) == 0 && last.median_ns) {
+            gps = (uint64_t)FONT_BENCH_COLS * 1000000000u / last.median_ns;
+            measured++;
+        }
+        if (out_append_str(ob, "\n") != 0) return -1;
+        if (out_append_str(ob, cases[i]) != 0) return -1;
+        if (out_append_str(ob, "_gps=") != 0) return -1;
+        if (out_append_u64(ob, gps) != 0) return -1;
+    }
+    if (out_append_str(ob, "\n") != 0) return -1;
+    if (!measured && out_append_str(ob, "not measured; run: bench font\n") != 0) return -1;
+    return 0;
+}
+
+static int append_heap_sites(out_buf_t *ob, heap_site_t *sites, int n)
+{
+    /* Largest live footprint first; n is at most a few hundred. */
+    for (int i = 1; i < n; i++) {
+        heap_site_t key = sites[i];
+        int j = i - 1;
+        while (j >= 0 && sites[j].live_bytes < key.live_bytes) {
+            sites[j + 1] = sites[j];
+            j--;
+        }
+        sites[j + 1] = key;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (out_append_str(ob, "0x") != 0) return -1;
+        if (out_append_hex(ob, (uint64_t)sites[i].caller, 16) != 0) return -1;
+        if (out_append_str(ob, " live_bytes=") != 0) return -1;
+        if (out_append_u64(ob, sites[i].live_bytes) != 0) return -1;
+        if (out_append_str(ob, " live=") != 0) return -1;
+        if (out_append_u64(ob, sites[i].live_count) != 0) return -1;
+        if (out_append_str(ob, " allocs=") != 0) return -1;
+        if (out_append_u64(ob, sites[i].total_allocs) != 0) return -1;
+        if (out_append_str(ob, " bytes=") != 0) return -1;
+        if (out_append_u64(ob, sites[i].total_bytes) != 0) return -1;
+        if (out_append_str(ob, " peak_bytes=") != 0) return -1;
+        if (out_append_u64(ob, sites[i].peak_bytes) != 0) return -1;
+        if (out_append_str(ob, "\n") != 0) return -1;
+    }
+    return 0;
+}
+
+static int build_heap_sites(out_buf_t *ob)
+{
+    static const char *modes[] = { "off", "sampled", "all" };
+    heap_profile_info_t info;
+    heap_site_t *sites = NULL;
+    int cap;
+    int n = 0;
+    int rc;
+
+    heap_profile_snapshot(NULL, 0, &info);
+    /* Some headroom for sites first seen between the two snapshots. */
+    cap = (int)info.sites + 16;
+    if (info.mode != 0) {
+        sites = (heap_site_t *)kmalloc((size_t)cap * sizeof(*sites));
+        if (!sites)
+            return -1;
+        n = heap_profile_snapshot(sites, cap, &info);
+    }
+
+    rc = -1;
+    if (out_append_str(ob, "mode=") != 0) goto out;
+    if (out_append_str(ob, modes[(info.mode >= 0 && info.mode <= 2) ? info.mode : 0]) != 0) goto out;
+    if (out_append_str(ob, "\nsample_period=") != 0) goto out;
+    if (out_append_u64(ob, info.sample_period) != 0) goto out;
+    if (out_append_str(ob, "\nsites=") != 0) goto out;
+    if (out_append_u64(ob, info.sites) != 0) goto out;
+    if (out_append_str(ob, "\nsampled=") != 0) goto out;
+    if (out_append_u64(ob, info.sampled) != 0) goto out;
+    if (out_append_str(ob, "\ndropped=") != 0) goto out;
+    if (out_append_u64(ob, info.dropped) != 0) goto out;
+    if (out_append_str(ob, "\n") != 0) goto out;
+    rc = append_heap_sites(ob, sites, n);
+out:
+    if (sites)
+        kfree(sites);
+    return rc;
+}
+
+static int append_sched(out_buf_t *ob, const sched_stats_t *st)
+{
+    uint64_t ticks = st->ticks ? st->ticks : 1;
+    char hist[SCHED_LATENCY_HIST_TEXT_MAX];
+
+    if (out_append_str(ob, "ticks: ") != 0) return -1;
+    if (out_append_u64(ob, st->ticks) != 0) return -1;
+    if (out_append_str(ob, "\nidle_ticks: ") != 0) return -1;
+    if (out_append_u64(ob, st->idle_ticks) != 0) return -1;
+    if (out_append_str(ob, "\ncontext_switches: ") != 0) return -1;
+    if (out_append_u64(ob, st->context_switches) != 0) return -1;
+    if (out_append_str(ob, "\nvoluntary_switches: ") != 0) return -1;
+    if (out_append_u64(ob, st->voluntary_switches) != 0) return -1;
+    if (out_append_str(ob, "\ninvoluntary_switches: ") != 0) return -1;
+    if (out_append_u64(ob, st->involuntary_switches) != 0) return -1;
+    if (out_append_str(ob, "\nslice_expiries: ") != 0) return -1;
+    if (out_append_u64(ob, st->slice_expiries) != 0) return -1;
+    if (out_append_str(ob, "\nwakeups: ") != 0) return -1;
+    if (out_append_u64(ob, st->wakeups) != 0) return -1;
+    if (out_append_str(ob, "\nrunq_len: ") != 0) return -1;
+    if (out_append_u64(ob, st->runq_len) != 0) return -1;
+    if (out_append_str(ob, "\nrunq_max: ") != 0) return -1;
+    if (out_append_u64(ob, st->runq_max) != 0) return -1;
+    if (out_append_str(ob, "\nrunq_mean_x100: ") != 0) return -1;
+    if (out_append_u64(ob, st->runq_len_sum * 100u / ticks) != 0) return -1;
+
+    /* Oldest first; each value is the longest queue seen in its window. */
+    if (out_append_str(ob, "\nrunq_history_window_ticks: ") != 0) return -1;
+    if (out_append_u64(ob, PROCESS_SCHED_RQ_WINDOW) != 0) return -1;
+    if (out_append_str(ob, "\nrunq_history:") != 0) return -1;
+    for (uint32_t i = 0; i < st->runq_history_len; i++) {
+        if (out_append_str(ob, " ") != 0) return -1;
+        if (out_append_u64(ob, st->runq_history[i]) != 0) return -1;
+    }
     if (out_append_str(ob, "\n") != 0) return -1;
+
+    sched_format_latency_hist(st->latency_hist, hist, sizeof(hist));
+    if (out_append_str(ob, hist) != 0) return -1;
+
+    for (int pri = 0; pri < PROCESS_PRIORITY_LEVELS; pri++) {
+        if (st->priority_ticks[pri] == 0)
+            continue;
+        if (out_append_str(ob, "priority_ticks.") != 0) return -1;
+        if (out_append_u64(ob, (uint64_t)pri) != 0) return -1;
+        if (out_append_str(ob, ": ") != 0) return -1;
+        if (out_append_u64(ob, st->priority_ticks[pri]) != 0) return -1;
+        if (out_append_str(ob, "\n") != 0) return -1;
+    }
     return 0;
 }
 
+static int build_sched(out_buf_t *ob)
+{
+    sched_stats_t *st = (sched_stats_t *)kmalloc(sizeof(*st));
+    int rc;
+
+    if (!st)
+        return -1;
+    sched_get_stats(st);
+    rc = append_sched(ob, st);
+    kfree(st);
+    return rc;
+}
+
+#define PROFILE_REPORT_TOP 64
+
+static int append_profile(out_buf_t *ob, const profile_info_t *info,
+                          const profile_entry_t *ents, int n)
+{
+    static const char *sources[] = { "none", "pit", "lapic" };
+    uint64_t kept = info->samples - info->overwritten;
+
+    if (out_append_str(ob, "running: ") != 0) return -1;
+    if (out_append_u64(ob, (uint64_t)info->running) != 0) return -1;
+    if (out_append_str(ob, "\nsource: ") != 0) return -1;
+    if (out_append_str(ob, sources[(info->source >= 0 && info->source <= 2) ? info->source : 0]) != 0) return -1;
+    if (out_append_str(ob, "\nrate_hz: ") != 0) return -1;
+    if (out_append_u64(ob, info->hz) != 0) return -1;
+    if (out_append_str(ob, "\nsamples: ") != 0) return -1;
+    if (out_append_u64(ob, info->samples) != 0) return -1;
+    if (out_append_str(ob, "\noverwritten: ") != 0) return -1;
+    if (out_append_u64(ob, info->overwritten) != 0) return -1;
+    if (out_append_str(ob, "\nuser_samples: ") != 0) return -1;
+    if (out_append_u64(ob, info->user_samples) != 0) return -1;
+    if (out_append_str(ob, "\nunknown_samples: ") != 0) return -1;
+    if (out_append_u64(ob, info->unknown_samples) != 0) return -1;
+    if (out_append_str(ob, "\nsymbols: ") != 0) return -1;
+    if (out_append_u64(ob, info->symbols) != 0) return -1;
+    if (out_append_str(ob, "\n") != 0) return -1;
+
+    if (kept == 0)
+        kept = 1;
+    for (int i = 0; i < n; i++) {
+        uint64_t permille = (uint64_t)ents[i].samples * 1000u / kept;
+        if (out_append_u64(ob, ents[i].samples) != 0) return -1;
+        if (out_append_str(ob, " ") != 0) return -1;
+        if (out_append_u64(ob, permille / 10u) != 0) return -1;
+        if (out_append_str(ob, ".") != 0) return -1;
+        if (out_append_u64(ob, permille % 10u) != 0) return -1;
+        if (out_append_str(ob, "% ") != 0) return -1;
+        if (out_append_str(ob, ents[i].name) != 0) return -1;
+        if (ents[i].addr == 0) {
+            if (out_append_str(ob, " pid=") != 0) return -1;
+            if (out_append_u64(ob, ents[i].pid) != 0) return -1;
+        }
+        if (out_append_str(ob, "\n") != 0) return -1;
+    }
+    return 0;
+}
+
+static int build_profile(out_buf_t *ob)
+{
+    profile_entry_t *ents = (profile_entry_t *)kmalloc(PROFILE_REPORT_TOP * sizeof(*ents));
+    profile_info_t info;
+    int n;
+    int rc;
+
+    if (!ents)
+        return -1;
+    n = profile_snapshot(ents, PROFILE_REPORT_TOP, &info);
+    rc = append_profile(ob, &info, ents, n);
+    kfree(ents);
+    return rc;
+}
+
+static int append_syscalls(out_buf_t *ob, const syscall_stat_t *st, size_t n)
+{
+    if (out_append_str(ob, "tsc_hz=") != 0) return -1;
+    if (out_append_u64(ob, pit_tsc_hz()) != 0) return -1;
+    if (out_append_str(ob, "\n") != 0) return -1;
+    for (size_t i = 0; i < n; i++) {
+        if (out_append_str(ob, st[i].group) != 0) return -1;
+        if (out_append_str(ob, ".") != 0) return -1;
+        if (out_append_str(ob, st[i].name) != 0) return -1;
+        if (out_append_str(ob, " nr=") != 0) return -1;
+        if (out_append_u64(ob, st[i].nr) != 0) return -1;
+        if (out_append_str(ob, " calls=") != 0) return -1;
+        if (out_append_u64(ob, st[i].calls) != 0) return -1;
+        if (out_append_str(ob, " rejected=") != 0) return -1;
+        if (out_append_u64(ob, st[i].rejected) != 0) return -1;
+        if (out_append_str(ob, " cycles=") != 0) return -1;
+        if (out_append_u64(ob, st[i].cycles) != 0) return -1;
+        if (out_append_str(ob, " avg_cycles=") != 0) return -1;
+        if (out_append_u64(ob, st[i].cycles / st[i].calls) != 0) return -1;
+        if (out_append_str(ob, "\n") != 0) return -1;
+    }
+    return 0;
+}
+
+static int build_syscalls(out_buf_t *ob)
+{
+    syscall_stat_t *st;
+    size_t cap = syscall_get_stats(NULL, 0) + 8;
+    size_t n;
+    int rc;
+
+    st = (syscall_stat_t *)kmalloc(cap * sizeof(*st));
+    if (!st)
+        return -1;
+    n = syscall_get_stats(st, cap);
+    if (n > cap)
+        n = cap;
+    /* Costliest first: insertion sort on cumulative cycles. */
+    for (size_t i = 1; i < n; i++) {
+        syscall_stat_t key = st[i];
+        size_t j = i;
+        while (j > 0 && st[j - 1].cycles < key.cycles) {
+            st[j] = st[j - 1];
+            j--;
+        }
+        st[j] = key;
+    }
+    rc = append_syscalls(ob, st, n);
+    kfree(st);
+    return rc;
+}
+
 static int build_mounts(out_buf_t *ob)
 {
     vfs_mount_info_t mounts[16];
@@ -443,6 +937,9 @@ int sysfs_read_file(const char *path, uint8_t **buf_out, size_t *size_out)
 
     if (!path || !buf_out || !size_out)
         return -1;
+    /* Binary: hand back the dump buffer as-is. */
+    if (kstreq(path, "/trace"))
+        return trace_dump(buf_out, size_out);
 
     ob.data = NULL;
     ob.len = 0;
@@ -450,6 +947,14 @@ int sysfs_read_file(const char *path, uint8_t **buf_out, size_t *size_out)
 
     if (kstreq(path, "/memory"))
         rc = build_memory(&ob);
+    else if (kstreq(path, "/klog"))
+        rc = build_klog(&ob);
+    else if (kstreq(path, "/sched"))
+        rc = build_sched(&ob);
+    else if (kstreq(path, "/profile"))
+        rc = build_profile(&ob);
+    else if (kstreq(path, "/syscalls"))
+        rc = build_syscalls(&ob);
     else if (kstreq(path, "/devices") || kstreq(path, "/devices/summary"))
         rc = build_devices(&ob);
     else if (kstreq(path, "/devices/pci"))
@@ -460,6 +965,14 @@ int sysfs_read_file(const char *path, uint8_t **buf_out, size_t *size_out)
         rc = build_net_status(&ob);
     else if (kstreq(path, "/net/stats"))
         rc = build_net_stats(&ob);
+    else if (kstreq(path, "/net/dns_cache"))
+        rc = build_net_dns_cache(&ob);
+    else if (kstreq(path, "/gfx/glyph_cache"))
+        rc = build_glyph_cache(&ob);
+    else if (kstreq(path, "/gfx/fontbench"))
+        rc = build_fontbench(&ob);
+    else if (kstreq(path, "/heap/sites"))
+        rc = build_heap_sites(&ob);
     else
         rc = -1;
 
@@ -16,17 +16,29 @@
 #include "../drv/fb.h"
 #include "../include/boot_info.h"
 #include "../include/kprintf.h"
+#include "../include/kutils.h"
+#include "../include/trace.h"
 #include "../include/multiboot.h"
+#include "../include/spinlock.h"
 #include "../mm/heap.h"
 #include "../proc/process.h"
 
+#ifdef __x86_64__
+#include "../drv/pit.h"
+#include "../net/dns_cache.h"
+#include "../net/socket.h"
+#endif
+
 #include <stddef.h>
 #include <stdint.h>
 
 #define VFS_MAX_MOUNTS        13
-#define VFS_MAX_OPEN_GLOBAL   128
-#define VFS_MAX_PIPES         16
-#define VFS_PIPE_CAPACITY     4096
+#define VFS_MAX_OPEN_GLOBAL   1024
+#define VFS_PIPE_MIN_CAPACITY 4096u
+#define VFS_PIPE_DEFAULT_LIMIT (64u * 1024u)
+#define VFS_PIPE_MAX_LIMIT    (1024u * 1024u)
+#define VFS_SPLICE_CHUNK      (16u * 1024u)   /* file bytes copied per pipe-lock hold */
+#define VFS_POLL_RESCAN_MS    50u             /* sleep cap while DNS queries are polled */
 
 typedef enum vfs_backend {
     VFS_BACKEND_NONE = 0,
@@ -38,7 +50,9 @@ typedef enum vfs_backend {
     VFS_BACKEND_SYSFS,
     VFS_BACKEND_BOOTFS,
     VFS_BACKEND_DEVFS,
-    VFS_BACKEND_PIPE
+    VFS_BACKEND_PIPE,
+    VFS_BACKEND_SOCKET,
+    VFS_BACKEND_DNS
 } vfs_backend_t;
 
 typedef enum vfs_device_kind {
@@ -58,14 +72,25 @@ typedef struct vfs_mount {
     const char *name;
 } vfs_mount_t;
 
+/*
+ * Pipes are heap-allocated byte rings.  The ring starts at one page and
+ * doubles whenever a writer would otherwise block, up to a per-pipe limit
+ * (F_SETPIPE_SZ), so a fast producer hands the reader large batches instead
+ * of ping-ponging every page.  Readers sleep while the pipe is empty and a
+ * writer remains; writers sleep while it is full and a reader remains.
+ */
 typedef struct vfs_pipe {
-    int used;
-    uint8_t data[VFS_PIPE_CAPACITY];
+    spinlock_t lock;
+    uint8_t *data;
+    size_t capacity;            /* ring size, power of two */
+    size_t limit;               /* growth ceiling, power of two */
     size_t read_pos;
-    size_t write_pos;
     size_t size;
     int readers;
     int writers;
+    int grow_failed;            /* last grow hit kmalloc failure; wait for a reader */
+    wait_queue_t readq;
+    wait_queue_t writeq;
 } vfs_pipe_t;
 
 typedef struct vfs_file {
@@ -98,12 +123,17 @@ typedef struct vfs_file {
             vfs_device_kind_t kind;
             int index;
         } device;
+        struct {
+            struct net_socket *sock;
+        } socket;
+        struct {
+            struct dns_query *query;
+        } dns;
     } u;
 } vfs_file_t;
 
 static vfs_mount_t g_mounts[VFS_MAX_MOUNTS];
 static vfs_file_t g_open_files[VFS_MAX_OPEN_GLOBAL];
-static vfs_pipe_t g_pipes[VFS_MAX_PIPES];
 
 static void *g_kernel_open_files[PROCESS_MAX_OPEN_FILES];
 static char g_kernel_cwd[VFS_PATH_MAX] = "/";
@@ -119,10 +149,7 @@ static int g_kd_mode = VFS_KD_TEXT;
 
 static int kstrlen(const char *s)
 {
-    int n = 0;
-    while (s && s[n])
-        n++;
-    return n;
+    return s ? (int)k_strlen(s) : 0;
 }
 
 static int kstrcmp(const char *a, const char *b)
@@ -412,14 +439,6 @@ static void file_pool_reset(void)
         g_open_files[i].used = 0;
         g_open_files[i].refcount = 0;
     }
-    for (int i = 0; i < VFS_MAX_PIPES; i++) {
-        g_pipes[i].used = 0;
-        g_pipes[i].read_pos = 0;
-        g_pipes[i].write_pos = 0;
-        g_pipes[i].size = 0;
-        g_pipes[i].readers = 0;
-        g_pipes[i].writers = 0;
-    }
     for (int i = 0; i < PROCESS_MAX_OPEN_FILES; i++)
         g_kernel_open_files[i] = NULL;
     kstrncpy(g_kernel_cwd, "/", VFS_PATH_MAX);
@@ -442,19 +461,428 @@ static vfs_file_t *file_alloc(void)
 
 static vfs_pipe_t *pipe_alloc(void)
 {
-    for (int i = 0; i < VFS_MAX_PIPES; i++) {
-        vfs_pipe_t *p = &g_pipes[i];
-        if (!p->used) {
-            p->used = 1;
-            p->read_pos = 0;
-            p->write_pos = 0;
-            p->size = 0;
-            p->readers = 0;
-            p->writers = 0;
-            return p;
+    vfs_pipe_t *p = (vfs_pipe_t *)kmalloc(sizeof(*p));
+    if (!p)
+        return NULL;
+    k_memset(p, 0, sizeof(*p));
+    p->data = (uint8_t *)kmalloc(VFS_PIPE_MIN_CAPACITY);
+    if (!p->data) {
+        kfree(p);
+        return NULL;
+    }
+    p->capacity = VFS_PIPE_MIN_CAPACITY;
+    p->limit = VFS_PIPE_DEFAULT_LIMIT;
+    return p;
+}
+
+static void pipe_free(vfs_pipe_t *p)
+{
+    if (!p)
+        return;
+    kfree(p->data);
+    kfree(p);
+}
+
+/*
+ * The pipe lock is always taken with interrupts off, so a holder is never
+ * preempted; the heap is never entered while it is held.
+ */
+static uintptr_t pipe_lock(vfs_pipe_t *p)
+{
+    uintptr_t flags;
+#ifdef __x86_64__
+    __asm__ volatile ("pushfq; popq %0; cli" : "=r"(flags) : : "memory");
+#else
+    __asm__ volatile ("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+#endif
+    spin_lock(&p->lock);
+    return flags;
+}
+
+static void pipe_unlock(vfs_pipe_t *p, uintptr_t flags)
+{
+    spin_unlock(&p->lock);
+    if (flags & (1u << 9))
+        __asm__ volatile ("sti" : : : "memory");
+}
+
+/* Lock two distinct pipes in address order. */
+static uintptr_t pipe_lock_pair(vfs_pipe_t *a, vfs_pipe_t *b)
+{
+    uintptr_t flags;
+    if ((uintptr_t)a > (uintptr_t)b) {
+        vfs_pipe_t *t = a;
+        a = b;
+        b = t;
+    }
+    flags = pipe_lock(a);
+    spin_lock(&b->lock);
+    return flags;
+}
+
+static void pipe_unlock_pair(vfs_pipe_t *a, vfs_pipe_t *b, uintptr_t flags)
+{
+    spin_unlock(&b->lock);
+    pipe_unlock(a, flags);
+}
+
+static size_t pipe_room_locked(const vfs_pipe_t *p)
+{
+    size_t cap = (p->capacity < p->limit) ? p->capacity : p->limit;
+    return (p->size < cap) ? cap - p->size : 0;
+}
+
+/* Copy up to `count` queued bytes out without consuming them (<= 2 spans). */
+static size_t pipe_peek_locked(const vfs_pipe_t *p, uint8_t *dst, size_t count)
+{
+    size_t n = (count < p->size) ? count : p->size;
+    size_t first = p->capacity - p->read_pos;
+    if (first > n)
+        first = n;
+    k_memcpy(dst, p->data + p->read_pos, first);
+    k_memcpy(dst + first, p->data, n - first);
+    return n;
+}
+
+static void pipe_consume_locked(vfs_pipe_t *p, size_t n)
+{
+    if (n > 0)
+        p->grow_failed = 0;
+    p->size -= n;
+    /* Rewind when drained so the next batch lands in one span. */
+    p->read_pos = p->size ? (p->read_pos + n) & (p->capacity - 1) : 0;
+}
+
+static size_t pipe_copy_in_locked(vfs_pipe_t *p, const uint8_t *src, size_t count)
+{
+    size_t room = pipe_room_locked(p);
+    size_t n = (count < room) ? count : room;
+    size_t wpos = (p->read_pos + p->size) & (p->capacity - 1);
+    size_t first = p->capacity - wpos;
+    if (first > n)
+        first = n;
+    k_memcpy(p->data + wpos, src, first);
+    k_memcpy(p->data, src + first, n - first);
+    p->size += n;
+    return n;
+}
+
+/*
+ * Ring size needed to hold `need` bytes, or 0 if the pipe cannot grow, or
+ * must not retry until a reader has consumed something.
+ */
+static size_t pipe_grow_target_locked(const vfs_pipe_t *p, size_t need)
+{
+    size_t cap = p->capacity;
+    if (p->grow_failed)
+        return 0;
+    while (cap < need && cap < p->limit)
+        cap <<= 1;
+    return (cap > p->capacity) ? cap : 0;
+}
+
+/* Re-home the ring in a larger buffer, linearised at offset 0. */
+static int pipe_grow(vfs_pipe_t *p, size_t new_cap)
+{
+    uint8_t *nb = (uint8_t *)kmalloc(new_cap);
+    uint8_t *old;
+    uintptr_t flags;
+
+    if (!nb) {
+        flags = pipe_lock(p);
+        p->grow_failed = 1;
+        pipe_unlock(p, flags);
+        return -1;
+    }
+    flags = pipe_lock(p);
+    if (p->capacity >= new_cap) {
+        pipe_unlock(p, flags);
+        kfree(nb);
+        return 0;
+    }
+    pipe_peek_locked(p, nb, p->size);
+    old = p->data;
+    p->data = nb;
+    p->capacity = new_cap;
+    p->read_pos = 0;
+    pipe_unlock(p, flags);
+    kfree(old);
+    return 0;
+}
+
+static int pipe_readable(const vfs_pipe_t *p)
+{
+    return p->size > 0 || p->writers == 0;
+}
+
+/* Room now, room a grow can make, or no readers left to wait for. */
+static int pipe_writable(const vfs_pipe_t *p)
+{
+    return pipe_room_locked(p) > 0 || p->readers == 0 ||
+           (p->capacity < p->limit && !p->grow_failed);
+}
+
+#ifdef __x86_64__
+/* Every vfs_poll() sleeper, whichever descriptors it waits on. */
+static wait_queue_t g_poll_wq = WAIT_QUEUE_INIT;
+#endif
+
+void vfs_poll_notify(void)
+{
+#ifdef __x86_64__
+    wait_queue_wake_all(&g_poll_wq);
+#endif
+}
+
+static void pipe_wake(wait_queue_t *wq)
+{
+#ifdef __x86_64__
+    wait_queue_wake_all(wq);
+#else
+    (void)wq;
+#endif
+    vfs_poll_notify();
+}
+
+/*
+ * Sleep on `wq` until `ready` may hold.  Returns -1 when the caller must not
+ * block: a signal is pending, or there is no process context to park.
+ */
+static int pipe_wait(vfs_pipe_t *p, wait_queue_t *wq, int (*ready)(const vfs_pipe_t *))
+{
+#ifdef __x86_64__
+    uintptr_t flags;
+    int ok;
+
+    if (wait_queue_prepare(wq) != 0)
+        return -1;
+    /*
+     * Parked, with interrupts off, before the re-check: a peer that changed
+     * the pipe earlier is seen here, a later one finds us on `wq`, and no
+     * tick can switch us out while we are BLOCKED but not yet yielding.
+     */
+    flags = pipe_lock(p);
+    ok = ready(p);
+    pipe_unlock(p, flags);
+    if (!ok)
+        process_yield();
+    wait_queue_finish(wq);
+    return 0;
+#else
+    (void)p;
+    (void)wq;
+    (void)ready;
+    return -1;
+#endif
+}
+
+static size_t pipe_read(vfs_file_t *f, uint8_t *dst, size_t count)
+{
+    vfs_pipe_t *p = f->u.pipe.pipe;
+
+    if (!p || !f->u.pipe.can_read || count == 0)
+        return 0;
+
+    for (;;) {
+        uintptr_t flags = pipe_lock(p);
+        size_t got = pipe_peek_locked(p, dst, count);
+        int eof = (p->writers == 0);
+        pipe_consume_locked(p, got);
+        pipe_unlock(p, flags);
+
+        if (got > 0) {
+            pipe_wake(&p->writeq);
+            return got;
         }
+        if (eof)
+            return 0;
+        if ((f->flags & VFS_O_NONBLOCK) || pipe_wait(p, &p->readq, pipe_readable) != 0)
+            return (size_t)-1;
     }
-    return NULL;
+}
+
+static size_t pipe_write(vfs_file_t *f, const uint8_t *src, size_t count)
+{
+    vfs_pipe_t *p = f->u.pipe.pipe;
+    size_t wr = 0;
+
+    if (!p || !f->u.pipe.can_write)
+        return 0;
+
+    while (wr < count) {
+        uintptr_t flags = pipe_lock(p);
+        int broken = (p->readers == 0);
+        size_t n = 0;
+        size_t grow_to = 0;
+
+        if (!broken) {
+            n = pipe_copy_in_locked(p, src + wr, count - wr);
+            wr += n;
+            if (wr < count)
+                grow_to = pipe_grow_target_locked(p, p->size + (count - wr));
+        }
+        pipe_unlock(p, flags);
+
+        if (n > 0)
+            pipe_wake(&p->readq);
+        if (broken)
+            return wr;
+        if (wr == count)
+            break;
+        if (grow_to && pipe_grow(p, grow_to) == 0)
+            continue;
+        if ((f->flags & VFS_O_NONBLOCK) || pipe_wait(p, &p->writeq, pipe_writable) != 0)
+            return wr ? wr : (size_t)-1;
+    }
+    return wr;
+}
+
+/*
+ * Pipe-to-pipe splice.  When the destination is empty and the whole source
+ * fits the request, the two rings swap buffers and no byte is copied;
+ * otherwise data moves ring to ring in contiguous spans.
+ */
+static size_t pipe_splice(vfs_file_t *in, vfs_file_t *out, size_t len)
+{
+    vfs_pipe_t *src = in->u.pipe.pipe;
+    vfs_pipe_t *dst = out->u.pipe.pipe;
+
+    if (!src || !dst || src == dst || !in->u.pipe.can_read || !out->u.pipe.can_write)
+        return (size_t)-1;
+    if (len == 0)
+        return 0;
+
+    for (;;) {
+        uintptr_t flags = pipe_lock_pair(src, dst);
+        size_t moved = 0;
+        size_t grow_to = 0;
+        int eof = (src->size == 0 && src->writers == 0);
+        int broken = (dst->readers == 0);
+
+        if (!eof && !broken && src->size > 0) {
+            if (dst->size == 0 && src->size <= len && src->capacity <= dst->limit) {
+                uint8_t *data = dst->data;
+                size_t cap = dst->capacity;
+                dst->data = src->data;
+                dst->capacity = src->capacity;
+                dst->read_pos = src->read_pos;
+                dst->size = src->size;
+                moved = src->size;
+                src->data = data;
+                src->capacity = cap;
+                src->read_pos = 0;
+                src->size = 0;
+                src->grow_failed = 0;
+                dst->grow_failed = 0;
+            } else {
+                size_t n = (len < src->size) ? len : src->size;
+                while (n > 0) {
+                    size_t span = src->capacity - src->read_pos;
+                    size_t done;
+                    if (span > n)
+                        span = n;
+                    done = pipe_copy_in_locked(dst, src->data + src->read_pos, span);
+                    pipe_consume_locked(src, done);
+                    moved += done;
+                    n -= done;
+                    if (done < span)
+                        break;
+                }
+                if (moved == 0)
+                    grow_to = pipe_grow_target_locked(dst, dst->size + 1);
+            }
+        }
+        pipe_unlock_pair(src, dst, flags);
+
+        if (moved > 0) {
+            pipe_wake(&dst->readq);
+            pipe_wake(&src->writeq);
+            return moved;
+        }
+        if (eof || broken)
+            return 0;
+        if (grow_to && pipe_grow(dst, grow_to) == 0)
+            continue;
+        if (src->size == 0) {
+            if ((in->flags & VFS_O_NONBLOCK) || pipe_wait(src, &src->readq, pipe_readable) != 0)
+                return (size_t)-1;
+        } else if ((out->flags & VFS_O_NONBLOCK) ||
+                   pipe_wait(dst, &dst->writeq, pipe_writable) != 0) {
+            return (size_t)-1;
+        }
+    }
+}
+
+/*
+ * File-to-pipe splice.  Another holder of `in` (fork, process_clone_fd) may
+ * write while we sleep and re-home the file image, so nothing is kept
+ * across a wait: each pass re-reads buf/pos/size and copies one bounded
+ * chunk under the pipe lock, with interrupts off.
+ */
+static size_t file_splice(vfs_file_t *in, vfs_file_t *out, size_t len)
+{
+    vfs_pipe_t *p = out->u.pipe.pipe;
+    size_t moved = 0;
+
+    if (!p || !out->u.pipe.can_write)
+        return (size_t)-1;
+
+    while (moved < len) {
+        uintptr_t flags = pipe_lock(p);
+        int broken = (p->readers == 0);
+        int eof = (!in->u.regular.buf || in->pos >= in->u.regular.size);
+        size_t want = 0;
+        size_t n = 0;
+        size_t grow_to = 0;
+
+        if (!broken && !eof) {
+            want = in->u.regular.size - in->pos;
+            if (want > len - moved)
+                want = len - moved;
+            if (want > VFS_SPLICE_CHUNK)
+                want = VFS_SPLICE_CHUNK;
+            n = pipe_copy_in_locked(p, in->u.regular.buf + in->pos, want);
+            in->pos += n;
+            moved += n;
+            if (n < want)
+                grow_to = pipe_grow_target_locked(p, p->size + (want - n));
+        }
+        pipe_unlock(p, flags);
+
+        if (n > 0)
+            pipe_wake(&p->readq);
+        if (broken || eof)
+            break;
+        if (n == want)
+            continue;
+        if (grow_to && pipe_grow(p, grow_to) == 0)
+            continue;
+        if ((out->flags & VFS_O_NONBLOCK) || pipe_wait(p, &p->writeq, pipe_writable) != 0)
+            return moved ? moved : (size_t)-1;
+    }
+    return moved;
+}
+
+static int pipe_set_limit(vfs_pipe_t *p, int arg)
+{
+    size_t limit = VFS_PIPE_MIN_CAPACITY;
+    uintptr_t flags;
+
+    if (arg <= 0 || (size_t)arg > VFS_PIPE_MAX_LIMIT)
+        return -1;
+    while (limit < (size_t)arg)
+        limit <<= 1;
+
+    flags = pipe_lock(p);
+    if (p->size > limit) {
+        pipe_unlock(p, flags);
+        return -1;
+    }
+    p->limit = limit;
+    pipe_unlock(p, flags);
+    /* Raising the limit may unblock a writer stuck at the old ceiling. */
+    pipe_wake(&p->writeq);
+    return (int)limit;
 }
 
 static int ensure_regular_capacity(vfs_file_t *f, size_t need)
@@ -471,8 +899,10 @@ static int ensure_regular_capacity(vfs_file_t *f, size_t need)
     new_buf = (uint8_t *)kmalloc(new_cap);
     if (!new_buf)
         return -1;
-    for (size_t i = 0; i < f->u.regular.size; i++)
-        new_buf[i] = f->u.regular.buf ? f->u.regular.buf[i] : 0;
+    if (f->u.regular.buf)
+        k_memcpy(new_buf, f->u.regular.buf, f->u.regular.size);
+    else
+        k_memset(new_buf, 0, f->u.regular.size);
     if (f->u.regular.owns_buf && f->u.regular.buf)
         kfree(f->u.regular.buf);
     f->u.regular.buf = new_buf;
@@ -516,13 +946,38 @@ static void file_release(vfs_file_t *f)
 
     if (f->backend == VFS_BACKEND_PIPE && f->u.pipe.pipe) {
         vfs_pipe_t *p = f->u.pipe.pipe;
+        uintptr_t flags = pipe_lock(p);
+        int last_reader = 0;
+        int last_writer = 0;
+        int dead;
         if (f->u.pipe.can_read && p->readers > 0)
-            p->readers--;
+            last_reader = (--p->readers == 0);
         if (f->u.pipe.can_write && p->writers > 0)
-            p->writers--;
-        if (p->readers == 0 && p->writers == 0)
-            p->used = 0;
+            last_writer = (--p->writers == 0);
+        dead = (p->readers == 0 && p->writers == 0);
+        pipe_unlock(p, flags);
+        if (dead) {
+            pipe_free(p);
+        } else {
+            /* EOF for sleeping readers, EPIPE for sleeping writers. */
+            if (last_writer)
+                pipe_wake(&p->readq);
+            if (last_reader)
+                pipe_wake(&p->writeq);
+        }
+        f->u.pipe.pipe = NULL;
+    }
+
+#ifdef __x86_64__
+    if (f->backend == VFS_BACKEND_SOCKET && f->u.socket.sock) {
+        net_socket_close(f->u.socket.sock);
+        f->u.socket.sock = NULL;
+    }
+    if (f->backend == VFS_BACKEND_DNS && f->u.dns.query) {
+        dns_query_release(f->u.dns.query);
+        f->u.dns.query = NULL;
     }
+#endif
 
     if (f->u.regular.owns_buf && f->u.regular.buf)
         kfree(f->u.regular.buf);
@@ -1129,7 +1584,7 @@ void vfs_close(int fd)
 /* Read/write/seek                                                       */
 /* --------------------------------------------------------------------- */
 
-size_t vfs_read(int fd, void *buf, size_t count)
+static size_t vfs_read_impl(int fd, void *buf, size_t count)
 {
     process_t *proc = vfs_current_process();
     vfs_file_t *f = fd_lookup(proc, fd);
@@ -1142,19 +1597,22 @@ size_t vfs_read(int fd, void *buf, size_t count)
         return got;
     }
 
-    if (f->backend == VFS_BACKEND_PIPE) {
-        vfs_pipe_t *p = f->u.pipe.pipe;
-        size_t got = 0;
-        uint8_t *dst = (uint8_t *)buf;
-        if (!p || !f->u.pipe.can_read)
-            return 0;
-        while (got < count && p->size > 0) {
-            dst[got++] = p->data[p->read_pos];
-            p->read_pos = (p->read_pos + 1) % VFS_PIPE_CAPACITY;
-            p->size--;
-        }
-        return got;
+    if (f->backend == VFS_BACKEND_PIPE)
+        return pipe_read(f, (uint8_t *)buf, count);
+
+#ifdef __x86_64__
+    if (f->backend == VFS_BACKEND_SOCKET)
+        return net_socket_recv(f->u.socket.sock, buf, count, NULL,
+                               (f->flags & VFS_O_NONBLOCK) != 0);
+    if (f->backend == VFS_BACKEND_DNS) {
+        /* One dns_result_t per read; the same answer on every read. */
+        if (count < sizeof(dns_result_t) ||
+            dns_query_result(f->u.dns.query, (f->flags & VFS_O_NONBLOCK) != 0,
+                             (dns_result_t *)buf) != 0)
+            return (size_t)-1;
+        return sizeof(dns_result_t);
     }
+#endif
 
     if (f->backend == VFS_BACKEND_DEVFS) {
         size_t size = fb_byte_size();
@@ -1163,8 +1621,7 @@ size_t vfs_read(int fd, void *buf, size_t count)
             return 0;
         if (count > size - f->pos)
             count = size - f->pos;
-        for (size_t i = 0; i < count; i++)
-            ((uint8_t *)buf)[i] = src[f->pos + i];
+        k_memcpy(buf, src + f->pos, count);
         f->pos += count;
         return count;
     }
@@ -1173,13 +1630,22 @@ size_t vfs_read(int fd, void *buf, size_t count)
         return 0;
     if (count > f->u.regular.size - f->pos)
         count = f->u.regular.size - f->pos;
-    for (size_t i = 0; i < count; i++)
-        ((uint8_t *)buf)[i] = f->u.regular.buf[f->pos + i];
+    k_memcpy(buf, f->u.regular.buf + f->pos, count);
     f->pos += count;
     return count;
 }
 
-size_t vfs_write(int fd, const void *buf, size_t count)
+size_t vfs_read(int fd, void *buf, size_t count)
+{
+    size_t got;
+
+    TRACE(TRACE_EV_VFS_READ_ENTRY, fd, count);
+    got = vfs_read_impl(fd, buf, count);
+    TRACE(TRACE_EV_VFS_READ_EXIT, fd, got);
+    return got;
+}
+
+static size_t vfs_write_impl(int fd, const void *buf, size_t count)
 {
     process_t *proc = vfs_current_process();
     vfs_file_t *f = fd_lookup(proc, fd);
@@ -1189,7 +1655,7 @@ size_t vfs_write(int fd, const void *buf, size_t count)
     if (f->flags & VFS_O_APPEND) {
         if (f->backend == VFS_BACKEND_MEMFS)
             f->pos = memfs_size(f->u.memfs.inode);
-        else if (f->backend != VFS_BACKEND_PIPE)
+        else if (f->backend != VFS_BACKEND_PIPE && f->backend != VFS_BACKEND_SOCKET)
             f->pos = f->u.regular.size;
     }
 
@@ -1199,19 +1665,14 @@ size_t vfs_write(int fd, const void *buf, size_t count)
         return wr;
     }
 
-    if (f->backend == VFS_BACKEND_PIPE) {
-        vfs_pipe_t *p = f->u.pipe.pipe;
-        const uint8_t *src = (const uint8_t *)buf;
-        size_t wr = 0;
-        if (!p || !f->u.pipe.can_write || p->readers == 0)
-            return 0;
-        while (wr < count && p->size < VFS_PIPE_CAPACITY) {
-            p->data[p->write_pos] = src[wr++];
-            p->write_pos = (p->write_pos + 1) % VFS_PIPE_CAPACITY;
-            p->size++;
-        }
-        return wr;
-    }
+    if (f->backend == VFS_BACKEND_PIPE)
+        return pipe_write(f, (const uint8_t *)buf, count);
+
+#ifdef __x86_64__
+    if (f->backend == VFS_BACKEND_SOCKET)
+        return net_socket_send(f->u.socket.sock, buf, count, NULL,
+                               (f->flags & VFS_O_NONBLOCK) != 0);
+#endif
 
     if (f->backend == VFS_BACKEND_DEVFS) {
         size_t size = fb_byte_size();
@@ -1220,8 +1681,7 @@ size_t vfs_write(int fd, const void *buf, size_t count)
             return 0;
         if (count > size - f->pos)
             count = size - f->pos;
-        for (size_t i = 0; i < count; i++)
-            dst[f->pos + i] = ((const uint8_t *)buf)[i];
+        k_memcpy(dst + f->pos, buf, count);
         f->pos += count;
         return count;
     }
@@ -1234,8 +1694,7 @@ size_t vfs_write(int fd, const void *buf, size_t count)
 
     if (ensure_regular_capacity(f, f->pos + count) != 0)
         return 0;
-    for (size_t i = 0; i < count; i++)
-        f->u.regular.buf[f->pos + i] = ((const uint8_t *)buf)[i];
+    k_memcpy(f->u.regular.buf + f->pos, buf, count);
     f->pos += count;
     if (f->pos > f->u.regular.size)
         f->u.regular.size = f->pos;
@@ -1243,6 +1702,16 @@ size_t vfs_write(int fd, const void *buf, size_t count)
     return count;
 }
 
+size_t vfs_write(int fd, const void *buf, size_t count)
+{
+    size_t wr;
+
+    TRACE(TRACE_EV_VFS_WRITE_ENTRY, fd, count);
+    wr = vfs_write_impl(fd, buf, count);
+    TRACE(TRACE_EV_VFS_WRITE_EXIT, fd, wr);
+    return wr;
+}
+
 size_t vfs_seek(int fd, size_t offset, int whence)
 {
     process_t *proc = vfs_current_process();
@@ -1250,7 +1719,8 @@ size_t vfs_seek(int fd, size_t offset, int whence)
     size_t size = 0;
     if (!f)
         return (size_t)-1;
-    if (f->backend == VFS_BACKEND_PIPE)
+    if (f->backend == VFS_BACKEND_PIPE || f->backend == VFS_BACKEND_SOCKET ||
+        f->backend == VFS_BACKEND_DNS)
         return (size_t)-1;
 
     if (f->backend == VFS_BACKEND_MEMFS)
@@ -1300,6 +1770,12 @@ size_t vfs_size(int fd)
             return 0;
         return f->u.pipe.pipe->size;
     }
+#ifdef __x86_64__
+    if (f->backend == VFS_BACKEND_SOCKET)
+        return net_socket_pending(f->u.socket.sock);
+    if (f->backend == VFS_BACKEND_DNS)
+        return 0;
+#endif
     if (f->backend == VFS_BACKEND_DEVFS)
         return (f->u.device.kind == VFS_DEV_FB0) ? fb_byte_size() : 0;
     return f->u.regular.size;
@@ -1369,8 +1845,7 @@ int vfs_pipe(int pipefd[2])
             file_release(fr);
         if (fw)
             file_release(fw);
-        if (p)
-            p->used = 0;
+        pipe_free(p);
         tbl[fd_r] = NULL;
         tbl[fd_w] = NULL;
         return -1;
@@ -1400,6 +1875,67 @@ int vfs_pipe(int pipefd[2])
     return 0;
 }
 
+#ifdef __x86_64__
+int vfs_socket_open(struct net_socket *sock, int flags)
+{
+    process_t *proc = vfs_current_process();
+    void **tbl = fd_table_for_process(proc);
+    vfs_file_t *f;
+    int fd;
+
+    if (!sock)
+        return -1;
+    fd = process_fd_alloc(proc);
+    if (fd < 0)
+        return -1;
+    f = file_alloc();
+    if (!f)
+        return -1;
+
+    f->backend = VFS_BACKEND_SOCKET;
+    f->mode = VFS_MODE_READ | VFS_MODE_WRITE;
+    f->flags = VFS_O_RDWR | (flags & VFS_O_NONBLOCK);
+    f->u.socket.sock = sock;
+    tbl[fd] = f;
+    return fd;
+}
+
+int vfs_dns_open(struct dns_query *query, int flags)
+{
+    process_t *proc = vfs_current_process();
+    void **tbl = fd_table_for_process(proc);
+    vfs_file_t *f;
+    int fd;
+
+    if (!query)
+        return -1;
+    fd = process_fd_alloc(proc);
+    if (fd < 0)
+        return -1;
+    f = file_alloc();
+    if (!f)
+        return -1;
+
+    f->backend = VFS_BACKEND_DNS;
+    f->mode = VFS_MODE_READ;
+    f->flags = VFS_O_RDONLY | (flags & VFS_O_NONBLOCK);
+    f->u.dns.query = query;
+    tbl[fd] = f;
+    return fd;
+}
+
+struct net_socket *vfs_socket_get(int fd, int *flags_out)
+{
+    vfs_file_t *f = fd_lookup(vfs_current_process(), fd);
+
+    if (!f || f->backend != VFS_BACKEND_SOCKET)
+        return NULL;
+    if (flags_out)
+        *flags_out = f->flags;
+    return f->u.socket.sock;
+}
+#endif
+
 int vfs_fcntl(int fd, int cmd, int arg)
 {
     process_t *proc = vfs_current_process();
@@ -1413,11 +1949,38 @@ int vfs_fcntl(int fd, int cmd, int arg)
         f->flags = (f->flags & ~(VFS_O_APPEND | VFS_O_NONBLOCK)) |
                    (arg & (VFS_O_APPEND | VFS_O_NONBLOCK));
         return 0;
+    case VFS_F_SETPIPE_SZ:
+        if (f->backend != VFS_BACKEND_PIPE || !f->u.pipe.pipe)
+            return -1;
+        return pipe_set_limit(f->u.pipe.pipe, arg);
+    case VFS_F_GETPIPE_SZ:
+        if (f->backend != VFS_BACKEND_PIPE || !f->u.pipe.pipe)
+            return -1;
+        return (int)f->u.pipe.pipe->limit;
     default:
         return -1;
     }
 }
 
+size_t vfs_splice(int fd_in, int fd_out, size_t len)
+{
+    process_t *proc = vfs_current_process();
+    vfs_file_t *in = fd_lookup(proc, fd_in);
+    vfs_file_t *out = fd_lookup(proc, fd_out);
+
+    if (!in || !out || !(in->mode & VFS_MODE_READ) || out->backend != VFS_BACKEND_PIPE)
+        return (size_t)-1;
+
+    if (in->backend == VFS_BACKEND_PIPE)
+        return pipe_splice(in, out, len);
+
+    /* memfs, devices and sockets have no resident image to copy from. */
+    if (in->backend == VFS_BACKEND_MEMFS || in->backend == VFS_BACKEND_DEVFS ||
+        in->backend == VFS_BACKEND_SOCKET || in->backend == VFS_BACKEND_DNS)
+        return (size_t)-1;
+    return file_splice(in, out, len);
+}
+
 int vfs_ioctl(int fd, unsigned long request, void *arg)
 {
     process_t *proc = vfs_current_process();
@@ -1498,12 +2061,19 @@ static int vfs_file_poll_mask(vfs_file_t *f)
         if (f->u.pipe.can_write) {
             if (p->readers == 0)
                 mask |= VFS_POLLHUP;
-            else if (p->size < VFS_PIPE_CAPACITY)
+            else if (pipe_room_locked(p) > 0 || p->capacity < p->limit)
                 mask |= VFS_POLLOUT;
         }
         return mask;
     }
 
+#ifdef __x86_64__
+    if (f->backend == VFS_BACKEND_SOCKET)
+        return net_socket_poll_mask(f->u.socket.sock);
+    if (f->backend == VFS_BACKEND_DNS)
+        return dns_query_poll_mask(f->u.dns.query);
+#endif
+
     if (f->backend == VFS_BACKEND_DEVFS) {
         if (f->u.device.kind == VFS_DEV_FB0 && fb_info.addr) {
             if (f->mode & VFS_MODE_READ)
@@ -1523,17 +2093,19 @@ static int vfs_file_poll_mask(vfs_file_t *f)
     return mask;
 }
 
-int vfs_poll(vfs_pollfd_t *fds, size_t nfds, int timeout_ms)
+/* One readiness pass over `fds`; notes whether any of them is a socket or DNS query. */
+static int poll_scan(process_t *proc, vfs_pollfd_t *fds, size_t nfds,
+                     int *has_socket, int *has_dns)
 {
-    process_t *proc = vfs_current_process();
     int ready = 0;
-    (void)timeout_ms;
 
-    if (!fds)
-        return -1;
     for (size_t i = 0; i < nfds; i++) {
         vfs_file_t *f = fd_lookup(proc, fds[i].fd);
         int mask = vfs_file_poll_mask(f);
+        if (f && f->backend == VFS_BACKEND_SOCKET)
+            *has_socket = 1;
+        if (f && f->backend == VFS_BACKEND_DNS)
+            *has_dns = 1;
         fds[i].revents = (int16_t)(mask & fds[i].events);
         if ((mask & (VFS_POLLERR | VFS_POLLHUP)) != 0)
             fds[i].revents |= (int16_t)(mask & (VFS_POLLERR | VFS_POLLHUP));
@@ -1543,6 +2115,67 @@ int vfs_poll(vfs_pollfd_t *fds, size_t nfds, int timeout_ms)
     return ready;
 }
 
+/*
+ * Waits up to `timeout_ms` (forever if negative) for a descriptor to become
+ * ready.  Pipes and sockets wake g_poll_wq when they change, so the caller
+ * sleeps between scans.  DNS retransmits run from the query's poll hook,
+ * so with a query in the set the sleep is capped at VFS_POLL_RESCAN_MS.
+ * Without a net-rx worker a set holding sockets or queries runs the stack
+ * once per pass and yields instead.
+ */
+int vfs_poll(vfs_pollfd_t *fds, size_t nfds, int timeout_ms)
+{
+    process_t *proc = vfs_current_process();
+    int has_socket = 0;
+    int has_dns = 0;
+    int ready;
+
+    if (!fds)
+        return -1;
+    ready = poll_scan(proc, fds, nfds, &has_socket, &has_dns);
+
+#ifdef __x86_64__
+    if (ready == 0 && timeout_ms != 0 && proc) {
+        uint64_t hz = pit_frequency();
+        uint64_t deadline = 0;
+
+        if (timeout_ms > 0)
+            deadline = pit_ticks() + ((uint64_t)timeout_ms * hz + 999u) / 1000u;
+        while (ready == 0) {
+            uint64_t wake = deadline;
+
+            if (timeout_ms > 0 && pit_ticks() >= deadline)
+                break;
+            if ((proc->signal_pending & ~proc->signal_mask) != 0)
+                break;
+            if ((has_socket || has_dns) && !net_socket_drive()) {
+                ready = poll_scan(proc, fds, nfds, &has_socket, &has_dns);
+                if (ready == 0)
+                    process_yield();
+                continue;
+            }
+            if (has_dns) {
+                uint64_t cap = pit_ticks() + (VFS_POLL_RESCAN_MS * hz + 999u) / 1000u;
+                if (!wake || cap < wake)
+                    wake = cap;
+            }
+            if (wait_queue_prepare_until(&g_poll_wq, wake) != 0)
+                break;
+            /* Parked before the scan, so a change after it wakes us. */
+            ready = poll_scan(proc, fds, nfds, &has_socket, &has_dns);
+            if (ready == 0)
+                process_yield();
+            wait_queue_finish(&g_poll_wq);
+            if (ready == 0)
+                ready = poll_scan(proc, fds, nfds, &has_socket, &has_dns);
+        }
+    }
+#else
+    (void)timeout_ms;
+#endif
+    return ready;
+}
+
 /* --------------------------------------------------------------------- */
 /* stat/fstat/cwd/list                                                   */
 /* --------------------------------------------------------------------- */
@@ -1577,8 +2210,12 @@ int vfs_fstat(int fd, vfs_stat_t *out)
     out->mode = f->mode;
     if (f->backend == VFS_BACKEND_PIPE)
         out->type = VFS_TYPE_PIPE;
+    else if (f->backend == VFS_BACKEND_SOCKET)
+        out->type = VFS_TYPE_SOCKET;
     else if (f->backend == VFS_BACKEND_DEVFS)
         out->type = VFS_TYPE_CHAR;
+    else if (f->backend == VFS_BACKEND_DNS)
+        out->type = VFS_TYPE_CHAR;      /* unseekable record stream, not a socket */
     else
         out->type = VFS_TYPE_FILE;
     return 0;
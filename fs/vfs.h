@@ -34,6 +34,8 @@
 
 #define VFS_F_GETFL 1
 #define VFS_F_SETFL 2
+#define VFS_F_SETPIPE_SZ 3    /* pipe buffer growth limit, bytes */
+#define VFS_F_GETPIPE_SZ 4
 
 #define VFS_POLLIN   0x0001
 #define VFS_POLLOUT  0x0004
@@ -63,6 +65,7 @@
 #define VFS_TYPE_PIPE    3
 #define VFS_TYPE_CHAR    4
 #define VFS_TYPE_BLOCK   5
+#define VFS_TYPE_SOCKET  6
 
 #define VFS_MODE_READ  0x01
 #define VFS_MODE_WRITE 0x02
@@ -131,11 +134,51 @@ int vfs_dup(int oldfd);
 int vfs_dup2(int oldfd, int newfd);
 int vfs_pipe(int pipefd[2]);
 int vfs_fcntl(int fd, int cmd, int arg);
+
+struct net_socket;
+
+/**
+ * Install `sock` as a new read/write descriptor of the current process.
+ * The descriptor owns the socket from then on and closes it on last close.
+ *
+ * @param flags VFS_O_NONBLOCK or 0.
+ * @return The descriptor, or -1 (the caller still owns `sock`).
+ */
+int vfs_socket_open(struct net_socket *sock, int flags);
+
+/** Socket behind `fd`, or NULL; `flags_out` (optional) gets its VFS_O_* flags. */
+struct net_socket *vfs_socket_get(int fd, int *flags_out);
+
+struct dns_query;
+
+/**
+ * Install an asynchronous DNS lookup as a read-only descriptor.  It polls
+ * readable once resolved; each read returns one dns_result_t.  The
+ * descriptor owns the query and releases it on last close.  fstat()
+ * reports it as VFS_TYPE_CHAR with size 0.
+ *
+ * @param flags VFS_O_NONBLOCK or 0.
+ * @return The descriptor, or -1 (the caller still owns `query`).
+ */
+int vfs_dns_open(struct dns_query *query, int flags);
+
+/**
+ * Move up to `len` bytes from `fd_in` into the pipe `fd_out` inside the
+ * kernel.  The source may be a pipe (buffers are handed over when the
+ * destination is empty) or a file whose contents are cached in memory.
+ *
+ * @return Bytes moved, 0 at end of input or on a reader-less pipe, or
+ *         (size_t)-1 if the pair is unsupported or would block.
+ */
+size_t vfs_splice(int fd_in, int fd_out, size_t len);
 int vfs_ioctl(int fd, unsigned long request, void *arg);
 void *vfs_mmap(void *addr, size_t length, int prot, int flags, int fd, size_t offset);
 int vfs_munmap(void *addr, size_t length);
 int vfs_poll(vfs_pollfd_t *fds, size_t nfds, int timeout_ms);
 
+/** Wake vfs_poll() sleepers after a pollable object (pipe, socket, query) changed. */
+void vfs_poll_notify(void);
+
 int vfs_stat(const char *path, vfs_stat_t *out);
 int vfs_fstat(int fd, vfs_stat_t *out);
 
@@ -149,21 +149,16 @@ static void fm_draw(wm_window_t *win)
     fb_fill_rect(cx, cy, cw, FM_TOOLBAR_H, rgba(16, 24, 36, 255));
     const char *hdr = "File Manager - /";
     int hx = cx + 8, hy = cy + (FM_TOOLBAR_H - 8) / 2;
-    for (int i = 0; hdr[i]; i++) {
-        fb_draw_char(hx, hy, hdr[i], (color_t)THEME_TEXT_ACCENT,
-                     rgba(16, 24, 36, 255));
-        hx += 8;
-    }
+    fb_draw_text(hx, hy, hdr, -1, (color_t)THEME_TEXT_ACCENT,
+                 rgba(16, 24, 36, 255));
 
     /* Status message (bottom strip). */
     fb_fill_rect(cx, cy + ch - 16, cw, 16, rgba(10, 16, 26, 255));
     if (fm->status_msg[0]) {
         int sx = cx + 8;
-        for (int i = 0; fm->status_msg[i] && sx + 8 <= cx + cw - 4; i++) {
-            fb_draw_char(sx, cy + ch - 12, fm->status_msg[i],
+        if (cx + cw - 4 - sx >= 8)
+            fb_draw_text(sx, cy + ch - 12, fm->status_msg, (cx + cw - 4 - sx) / 8,
                          (color_t)THEME_TEXT_DIM, rgba(10, 16, 26, 255));
-            sx += 8;
-        }
     }
 
     /* Icon grid. */
@@ -207,13 +202,10 @@ static void fm_draw(wm_window_t *win)
             if (label_len > max_chars) label_len = max_chars;
             int lx = ix + (FM_CELL_W - label_len * 8) / 2;
             int ly = iy + icon_size + 8;
-            for (int c = 0; label[c] && c < label_len; c++) {
-                fb_draw_char(lx, ly, label[c],
-                             idx == fm->selected ? (color_t)THEME_TEXT_ACCENT
-                                                 : (color_t)THEME_TEXT_DIM,
-                             (color_t)THEME_WIN_BG);
-                lx += 8;
-            }
+            fb_draw_text(lx, ly, label, label_len,
+                         idx == fm->selected ? (color_t)THEME_TEXT_ACCENT
+                                             : (color_t)THEME_TEXT_DIM,
+                         (color_t)THEME_WIN_BG);
         }
     }
 
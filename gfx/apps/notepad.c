@@ -171,10 +171,8 @@ static void notepad_draw(wm_window_t *win)
     if (nd->filepath[0]) status = nd->dirty ? "* Modified" : "Saved";
     const char *fname = nd->filepath[0] ? nd->filepath : "(untitled)";
     int ix = cx + 4;
-    for (int i = 0; fname[i] && ix + 8 < cx + cw - 80; i++) {
-        fb_draw_char(ix, cy + 4, fname[i], (color_t)THEME_TEXT_DIM, tb_col);
-        ix += 8;
-    }
+    fb_draw_text_clip(ix, cy + 4, fname, -1, (color_t)THEME_TEXT_DIM, tb_col,
+                      ix, cy, (cx + cw - 80) - ix, 16);
     /* Save hint on right. */
     {
         int hx = cx + cw - 88;
@@ -99,7 +99,7 @@ static void st_refresh_wallpapers(settings_data_t *st)
 
 static void draw_string(int x, int y, const char *s, color_t fg, color_t bg)
 {
-    while (*s) { fb_draw_char(x, y, *s, fg, bg); x += 8; s++; }
+    fb_draw_text(x, y, s, -1, fg, bg);
 }
 
 static void st_draw_personalize(settings_data_t *st,
@@ -1,39 +1,310 @@
 /*
  * font.c - Font renderer using embedded 8x8 bitmap.
+ *
+ * Opaque text goes through a small direct-mapped cache of glyphs expanded to
+ * ARGB for a given (glyph, fg, bg), so drawing a glyph is eight row copies.
+ * Transparent text uses per-row runs of set bits computed once for the font.
+ * Both paths clip a whole line up front; no per-pixel bounds checks remain.
  */
 
 #include "font.h"
 #include "font_8x8.h"
 #include "blit.h"
 #include "../drv/fb.h"
+#include "../include/kutils.h"
+#include "../include/spinlock.h"
 #include <stddef.h>
 
-void fb_draw_char(int x, int y, char c, color_t fg, color_t bg)
+#define GLYPH_CACHE_SLOTS 256       /* power of two */
+#define GLYPH_MAX_RUNS    4         /* an 8-bit row has at most 4 runs */
+#define GLYPH_COUNT       128
+
+typedef struct glyph_cache_entry {
+    uint32_t fg;
+    uint32_t bg;
+    uint16_t glyph;
+    uint16_t valid;
+    uint32_t px[FONT_HEIGHT][FONT_WIDTH];
+} glyph_cache_entry_t;
+
+typedef struct glyph_row_runs {
+    uint8_t count;
+    uint8_t start[GLYPH_MAX_RUNS];
+    uint8_t len[GLYPH_MAX_RUNS];
+} glyph_row_runs_t;
+
+static glyph_cache_entry_t g_glyph_cache[GLYPH_CACHE_SLOTS];
+static spinlock_t g_glyph_lock = SPINLOCK_INIT;
+static uint64_t g_cache_hits;
+static uint64_t g_cache_misses;
+
+static glyph_row_runs_t g_runs[GLYPH_COUNT][FONT_HEIGHT];
+static volatile int g_runs_ready;
+
+static unsigned int glyph_index(char c)
 {
     unsigned int idx = (unsigned char)c;
-    if (idx >= 128)
-        idx = 0;
+    return (idx >= GLYPH_COUNT) ? 0 : idx;
+}
+
+static int text_length(const char *text, int len)
+{
+    if (!text)
+        return 0;
+    if (len < 0)
+        return (int)k_strlen(text);
+    for (int i = 0; i < len; i++) {
+        if (!text[i])
+            return i;
+    }
+    return len;
+}
+
+/* ---- Span tables -------------------------------------------------------- */
+
+static void build_runs(void)
+{
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        for (int row = 0; row < FONT_HEIGHT; row++) {
+            glyph_row_runs_t *r = &g_runs[g][row];
+            uint8_t bits = font_8x8[g][row];
+            int col = 0;
+            r->count = 0;
+            while (col < FONT_WIDTH) {
+                int start;
+                while (col < FONT_WIDTH && !(bits & (0x80u >> col)))
+                    col++;
+                if (col >= FONT_WIDTH)
+                    break;
+                start = col;
+                while (col < FONT_WIDTH && (bits & (0x80u >> col)))
+                    col++;
+                r->start[r->count] = (uint8_t)start;
+                r->len[r->count] = (uint8_t)(col - start);
+                r->count++;
+            }
+        }
+    }
+    __asm__ volatile ("" ::: "memory");
+    g_runs_ready = 1;
+}
 
+/* ---- Glyph cache -------------------------------------------------------- */
+
+static uint32_t cache_slot(unsigned int glyph, uint32_t fg, uint32_t bg)
+{
+    uint32_t h = glyph * 0x9E3779B1u;
+    h ^= fg * 0x85EBCA77u;
+    h ^= bg * 0xC2B2AE3Du;
+    return (h >> 24) & (GLYPH_CACHE_SLOTS - 1);
+}
+
+/* Caller holds g_glyph_lock. */
+static const glyph_cache_entry_t *cache_lookup_locked(unsigned int glyph,
+                                                      uint32_t fg, uint32_t bg)
+{
+    glyph_cache_entry_t *e = &g_glyph_cache[cache_slot(glyph, fg, bg)];
+
+    if (e->valid && e->glyph == glyph && e->fg == fg && e->bg == bg) {
+        g_cache_hits++;
+        return e;
+    }
+
+    g_cache_misses++;
     for (int row = 0; row < FONT_HEIGHT; row++) {
-        uint8_t line = font_8x8[idx][row];
-        for (int col = 0; col < FONT_WIDTH; col++) {
-            color_t color = (line & (1u << (7 - col))) ? fg : bg;
-            fb_putpixel(x + col, y + row, color);
+        uint8_t bits = font_8x8[glyph][row];
+        for (int col = 0; col < FONT_WIDTH; col++)
+            e->px[row][col] = (bits & (0x80u >> col)) ? fg : bg;
+    }
+    e->glyph = (uint16_t)glyph;
+    e->fg = fg;
+    e->bg = bg;
+    e->valid = 1;
+    return e;
+}
+
+/* ---- Line clipping ------------------------------------------------------ */
+
+typedef struct text_clip {
+    int row0, row1;         /* visible glyph rows */
+    int first, last;        /* visible characters [first, last) */
+} text_clip_t;
+
+static int clip_line(const font_surface_t *s, int x, int y, int len, text_clip_t *c)
+{
+    if (!s || !s->pixels || len <= 0)
+        return -1;
+    c->row0 = (y < 0) ? -y : 0;
+    c->row1 = (y + FONT_HEIGHT > s->height) ? s->height - y : FONT_HEIGHT;
+    if (c->row0 >= c->row1)
+        return -1;
+    c->first = (x < 0) ? (-x) / FONT_WIDTH : 0;
+    c->last = len;
+    if (x + len * FONT_WIDTH > s->width)
+        c->last = (s->width - x + FONT_WIDTH - 1) / FONT_WIDTH;
+    if (c->last > len)
+        c->last = len;
+    return (c->first < c->last) ? 0 : -1;
+}
+
+void font_draw_text(const font_surface_t *s, int x, int y,
+                    const char *text, int len, color_t fg, color_t bg)
+{
+    text_clip_t c;
+    uint32_t f = fg | 0xFF000000u;
+    uint32_t b = bg | 0xFF000000u;
+
+    len = text_length(text, len);
+    if (clip_line(s, x, y, len, &c) != 0)
+        return;
+
+    spin_lock(&g_glyph_lock);
+    for (int i = c.first; i < c.last; i++) {
+        const glyph_cache_entry_t *e = cache_lookup_locked(glyph_index(text[i]), f, b);
+        int gx = x + i * FONT_WIDTH;
+        int c0 = (gx < 0) ? -gx : 0;
+        int c1 = (gx + FONT_WIDTH > s->width) ? s->width - gx : FONT_WIDTH;
+        uint32_t *dst = s->pixels + (size_t)(y + c.row0) * (size_t)s->pitch + gx;
+
+        if (c0 == 0 && c1 == FONT_WIDTH) {
+            for (int row = c.row0; row < c.row1; row++) {
+                const uint32_t *src = e->px[row];
+                dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3];
+                dst[4] = src[4]; dst[5] = src[5]; dst[6] = src[6]; dst[7] = src[7];
+                dst += s->pitch;
+            }
+        } else {
+            for (int row = c.row0; row < c.row1; row++) {
+                for (int col = c0; col < c1; col++)
+                    dst[col] = e->px[row][col];
+                dst += s->pitch;
+            }
         }
     }
+    spin_unlock(&g_glyph_lock);
+}
+
+void font_draw_text_mask(const font_surface_t *s, int x, int y,
+                         const char *text, int len, color_t fg)
+{
+    text_clip_t c;
+    uint32_t f = fg | 0xFF000000u;
+
+    len = text_length(text, len);
+    if (clip_line(s, x, y, len, &c) != 0)
+        return;
+    if (!g_runs_ready)
+        build_runs();
+
+    for (int i = c.first; i < c.last; i++) {
+        const glyph_row_runs_t *runs = g_runs[glyph_index(text[i])];
+        int gx = x + i * FONT_WIDTH;
+        int c0 = (gx < 0) ? -gx : 0;
+        int c1 = (gx + FONT_WIDTH > s->width) ? s->width - gx : FONT_WIDTH;
+        uint32_t *dst = s->pixels + (size_t)(y + c.row0) * (size_t)s->pitch + gx;
+
+        for (int row = c.row0; row < c.row1; row++) {
+            const glyph_row_runs_t *r = &runs[row];
+            for (int k = 0; k < r->count; k++) {
+                int a = r->start[k];
+                int e = a + r->len[k];
+                if (a < c0)
+                    a = c0;
+                if (e > c1)
+                    e = c1;
+                while (a < e)
+                    dst[a++] = f;
+            }
+            dst += s->pitch;
+        }
+    }
+}
+
+/* ---- Framebuffer entry points ------------------------------------------- */
+
+int font_fb_surface(font_surface_t *out)
+{
+    struct fb_info *fb = &fb_info;
+    if (!out || !fb->addr || fb->bpp != 32)
+        return -1;
+    out->pixels = (uint32_t *)fb->addr;
+    out->width = (int)fb->width;
+    out->height = (int)fb->height;
+    out->pitch = (int)(fb->pitch / 4u);
+    return 0;
+}
+
+void fb_draw_char(int x, int y, char c, color_t fg, color_t bg)
+{
+    font_surface_t s;
+    if (font_fb_surface(&s) == 0)
+        font_draw_text(&s, x, y, &c, 1, fg, bg);
+}
+
+void fb_draw_text(int x, int y, const char *text, int len, color_t fg, color_t bg)
+{
+    font_surface_t s;
+    if (font_fb_surface(&s) == 0)
+        font_draw_text(&s, x, y, text, len, fg, bg);
 }
 
 void fb_draw_string(int x, int y, const char *str, color_t fg, color_t bg)
 {
-    int ox = x;
-    while (str && *str) {
+    font_surface_t s;
+    if (!str || font_fb_surface(&s) != 0)
+        return;
+    while (*str) {
+        int n = 0;
+        while (str[n] && str[n] != '\n')
+            n++;
+        font_draw_text(&s, x, y, str, n, fg, bg);
+        str += n;
         if (*str == '\n') {
             y += FONT_HEIGHT;
-            x = ox;
-        } else {
-            fb_draw_char(x, y, *str, fg, bg);
-            x += FONT_WIDTH;
+            str++;
         }
-        str++;
     }
 }
+
+void fb_draw_text_clip(int x, int y, const char *text, int len,
+                       color_t fg, color_t bg,
+                       int clip_x, int clip_y, int clip_w, int clip_h)
+{
+    font_surface_t s;
+    font_surface_t sub;
+
+    if (font_fb_surface(&s) != 0)
+        return;
+    if (clip_x < 0) {
+        clip_w += clip_x;
+        clip_x = 0;
+    }
+    if (clip_y < 0) {
+        clip_h += clip_y;
+        clip_y = 0;
+    }
+    if (clip_x + clip_w > s.width)
+        clip_w = s.width - clip_x;
+    if (clip_y + clip_h > s.height)
+        clip_h = s.height - clip_y;
+    if (clip_w <= 0 || clip_h <= 0)
+        return;
+
+    /* A clip rectangle is just a smaller surface with the same pitch. */
+    sub.pixels = s.pixels + (size_t)clip_y * (size_t)s.pitch + clip_x;
+    sub.width = clip_w;
+    sub.height = clip_h;
+    sub.pitch = s.pitch;
+    font_draw_text(&sub, x - clip_x, y - clip_y, text, len, fg, bg);
+}
+
+void font_cache_get_stats(font_cache_stats_t *out)
+{
+    if (!out)
+        return;
+    spin_lock(&g_glyph_lock);
+    out->hits = g_cache_hits;
+    out->misses = g_cache_misses;
+    out->slots = GLYPH_CACHE_SLOTS;
+    spin_unlock(&g_glyph_lock);
+}
@@ -5,8 +5,24 @@
 #ifndef FONT_H
 #define FONT_H
 
+#include <stdint.h>
+
 #include "blit.h"
 
+/** Any 32-bit ARGB pixel buffer text can be rendered into. */
+typedef struct font_surface {
+    uint32_t *pixels;
+    int width;
+    int height;
+    int pitch;              /* pixels per row */
+} font_surface_t;
+
+typedef struct font_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint32_t slots;
+} font_cache_stats_t;
+
 /**
  * Draw a character at (x, y).
  *
@@ -29,4 +45,45 @@ void fb_draw_char(int x, int y, char c, color_t fg, color_t bg);
  */
 void fb_draw_string(int x, int y, const char *str, color_t fg, color_t bg);
 
+/**
+ * Draw one line of text (no newline handling).
+ *
+ * @param len Characters to draw, or -1 for the whole string.
+ */
+void fb_draw_text(int x, int y, const char *text, int len, color_t fg, color_t bg);
+
+/**
+ * Draw one line of text clipped to a rectangle of the framebuffer.
+ *
+ * @param len Characters to draw, or -1 for the whole string.
+ * @param clip_x,clip_y,clip_w,clip_h Clip rectangle in screen pixels.
+ */
+void fb_draw_text_clip(int x, int y, const char *text, int len,
+                       color_t fg, color_t bg,
+                       int clip_x, int clip_y, int clip_w, int clip_h);
+
+/** Describe the framebuffer as a surface; -1 if it is not 32 bpp. */
+int font_fb_surface(font_surface_t *out);
+
+/**
+ * Draw one line of opaque text (fg on bg) into a surface.  Glyphs come
+ * pre-expanded from the glyph cache and are copied a row at a time.
+ *
+ * @param len Characters to draw, or -1 for the whole string.
+ */
+void font_draw_text(const font_surface_t *s, int x, int y,
+                    const char *text, int len, color_t fg, color_t bg);
+
+/**
+ * Draw one line of transparent text: only set glyph pixels are written,
+ * as precomputed horizontal runs.
+ */
+void font_draw_text_mask(const font_surface_t *s, int x, int y,
+                         const char *text, int len, color_t fg);
+
+void font_cache_get_stats(font_cache_stats_t *out);
+
+/* Glyphs drawn per iteration by the bench "font" suite (lib/bench_suites.c). */
+#define FONT_BENCH_COLS 80
+
 #endif /* FONT_H */
@@ -4,9 +4,11 @@
 
 #include "gui_srv.h"
 
+#include "font.h"
 #include "font_8x8.h"
 #include "wm.h"
 #include "../drv/fb.h"
+#include "../include/kutils.h"
 #include "../include/spinlock.h"
 #include "../input/event.h"
 #include "../mm/heap.h"
@@ -28,6 +30,9 @@ typedef struct gui_window {
     char title[WM_TITLE_MAX];
     int resizable;
     int dirty_pending;
+    int batching;               /* inside gui_srv_batch_begin/end */
+    int batch_x0, batch_y0;     /* client-rect union deferred by the batch */
+    int batch_x1, batch_y1;
     int close_policy_autoclose;
     int close_requested;
     uint32_t dropped_events;
@@ -175,6 +180,42 @@ static gui_window_t *find_slot_by_wm(wm_window_t *win)
     return NULL;
 }
 
+/*
+ * Record an update of a client rect.  Returns 1 and fills `out` with the
+ * screen rect to hand to wm_mark_dirty_rect() once g_gui_lock is dropped,
+ * or 0 when there is nothing to post (clipped away, or deferred because the
+ * window is inside a batch).
+ */
+static int mark_dirty_locked(gui_window_t *gw, int x, int y, int w, int h,
+                             wm_dirty_rect_t *out)
+{
+    int cx, cy, cw, ch;
+
+    if (!clip_rect_to_client(gw, &x, &y, &w, &h))
+        return 0;
+    gw->dirty_pending = 1;
+    if (gw->batching) {
+        if (gw->batch_x1 <= gw->batch_x0) {
+            gw->batch_x0 = x;
+            gw->batch_y0 = y;
+            gw->batch_x1 = x + w;
+            gw->batch_y1 = y + h;
+        } else {
+            if (x < gw->batch_x0) gw->batch_x0 = x;
+            if (y < gw->batch_y0) gw->batch_y0 = y;
+            if (x + w > gw->batch_x1) gw->batch_x1 = x + w;
+            if (y + h > gw->batch_y1) gw->batch_y1 = y + h;
+        }
+        return 0;
+    }
+    wm_client_rect(gw->wm_win, &cx, &cy, &cw, &ch);
+    out->x = cx + x;
+    out->y = cy + y;
+    out->w = w;
+    out->h = h;
+    return 1;
+}
+
 static void queue_paint_event(gui_window_t *gw, int x, int y, int w, int h)
 {
     struct tsukasa_gui_event ev;
@@ -191,28 +232,6 @@ static void queue_paint_event(gui_window_t *gw, int x, int y, int w, int h)
     evt_enqueue(gw, &ev);
 }
 
-static void draw_char_to_buffer(gui_window_t *gw, int x, int y, char c, uint32_t color)
-{
-    uint8_t row_bits;
-    if (!gw || !gw->pixels)
-        return;
-    if ((unsigned char)c >= 128)
-        return;
-    for (int row = 0; row < FONT_HEIGHT; row++) {
-        int py = y + row;
-        if (py < 0 || py >= gw->client_h)
-            continue;
-        row_bits = font_8x8[(unsigned char)c][row];
-        for (int col = 0; col < FONT_WIDTH; col++) {
-            int px = x + col;
-            if (px < 0 || px >= gw->client_w)
-                continue;
-            if (row_bits & (1u << (7 - col)))
-                gw->pixels[py * gw->client_w + px] = color | 0xFF000000u;
-        }
-    }
-}
-
 static void gui_window_draw(wm_window_t *win)
 {
     gui_window_t *gw;
@@ -537,6 +556,9 @@ int gui_srv_window_set_resizable(int pid, int handle, int resizable)
 int gui_srv_draw_rect(int pid, int handle, int x, int y, int w, int h, uint32_t color)
 {
     gui_window_t *gw;
+    wm_dirty_rect_t dirty;
+    int post;
+
     spin_lock(&g_gui_lock);
     gw = find_slot_by_handle(handle);
     if (!gw) {
@@ -555,8 +577,11 @@ int gui_srv_draw_rect(int pid, int handle, int x, int y, int w, int h, uint32_t
         for (int col = 0; col < w; col++)
             gw->pixels[(y + row) * gw->client_w + (x + col)] = color | 0xFF000000u;
     }
+    post = mark_dirty_locked(gw, x, y, w, h, &dirty);
     spin_unlock(&g_gui_lock);
-    return gui_srv_mark_dirty(pid, handle, x, y, w, h);
+    if (post)
+        wm_mark_dirty_rect(dirty.x, dirty.y, dirty.w, dirty.h);
+    return GUI_OK;
 }
 
 int gui_srv_draw_rounded_rect(int pid, int handle,
@@ -568,6 +593,8 @@ int gui_srv_draw_rounded_rect(int pid, int handle,
     int draw_y = y;
     int draw_w = w;
     int draw_h = h;
+    wm_dirty_rect_t dirty;
+    int post;
 
     spin_lock(&g_gui_lock);
     gw = find_slot_by_handle(handle);
@@ -607,13 +634,19 @@ int gui_srv_draw_rounded_rect(int pid, int handle,
             }
         }
     }
+    post = mark_dirty_locked(gw, draw_x, draw_y, draw_w, draw_h, &dirty);
     spin_unlock(&g_gui_lock);
-    return gui_srv_mark_dirty(pid, handle, draw_x, draw_y, draw_w, draw_h);
+    if (post)
+        wm_mark_dirty_rect(dirty.x, dirty.y, dirty.w, dirty.h);
+    return GUI_OK;
 }
 
 int gui_srv_draw_text(int pid, int handle, int x, int y, const char *text, uint32_t color)
 {
     gui_window_t *gw;
+    wm_dirty_rect_t dirty;
+    int post;
+
     if (!text)
         return GUI_ERR_INVALID;
 
@@ -627,10 +660,19 @@ int gui_srv_draw_text(int pid, int handle, int x, int y, const char *text, uint3
         spin_unlock(&g_gui_lock);
         return GUI_ERR_PERM;
     }
-    for (int i = 0; text[i]; i++)
-        draw_char_to_buffer(gw, x + i * FONT_WIDTH, y, text[i], color);
+    if (gw->pixels) {
+        font_surface_t surf;
+        surf.pixels = gw->pixels;
+        surf.width = gw->client_w;
+        surf.height = gw->client_h;
+        surf.pitch = gw->client_w;
+        font_draw_text_mask(&surf, x, y, text, -1, color);
+    }
+    post = mark_dirty_locked(gw, x, y, str_len(text) * FONT_WIDTH, FONT_HEIGHT, &dirty);
     spin_unlock(&g_gui_lock);
-    return gui_srv_mark_dirty(pid, handle, x, y, str_len(text) * FONT_WIDTH, FONT_HEIGHT);
+    if (post)
+        wm_mark_dirty_rect(dirty.x, dirty.y, dirty.w, dirty.h);
+    return GUI_OK;
 }
 
 int gui_srv_draw_image(int pid, int handle,
@@ -644,6 +686,8 @@ int gui_srv_draw_image(int pid, int handle,
     int draw_h = h;
     int src_x = 0;
     int src_y = 0;
+    wm_dirty_rect_t dirty;
+    int post;
 
     if (!pixels || w <= 0 || h <= 0)
         return GUI_ERR_INVALID;
@@ -684,18 +728,19 @@ int gui_srv_draw_image(int pid, int handle,
             gw->pixels[(draw_y + row) * gw->client_w + (draw_x + col)] = c | 0xFF000000u;
         }
     }
+    post = mark_dirty_locked(gw, draw_x, draw_y, draw_w, draw_h, &dirty);
     spin_unlock(&g_gui_lock);
-    return gui_srv_mark_dirty(pid, handle, draw_x, draw_y, draw_w, draw_h);
+    if (post)
+        wm_mark_dirty_rect(dirty.x, dirty.y, dirty.w, dirty.h);
+    return GUI_OK;
 }
 
-int gui_srv_mark_dirty(int pid, int handle, int x, int y, int w, int h)
+int gui_srv_scroll_rect(int pid, int handle, int x, int y, int w, int h, int dy)
 {
     gui_window_t *gw;
-    int cx, cy, cw, ch;
-    int mx = x;
-    int my = y;
-    int mw = w;
-    int mh = h;
+    int rows;
+    wm_dirty_rect_t dirty;
+    int post;
 
     spin_lock(&g_gui_lock);
     gw = find_slot_by_handle(handle);
@@ -707,18 +752,92 @@ int gui_srv_mark_dirty(int pid, int handle, int x, int y, int w, int h)
         spin_unlock(&g_gui_lock);
         return GUI_ERR_PERM;
     }
-    if (!clip_rect_to_client(gw, &mx, &my, &mw, &mh)) {
+    if (!gw->pixels || !clip_rect_to_client(gw, &x, &y, &w, &h)) {
         spin_unlock(&g_gui_lock);
         return GUI_OK;
     }
-    gw->dirty_pending = 1;
-    wm_client_rect(gw->wm_win, &cx, &cy, &cw, &ch);
+    rows = h - (dy < 0 ? -dy : dy);
+    if (dy != 0 && rows > 0) {
+        /* Walk rows away from the destination so sources are read first. */
+        for (int i = 0; i < rows; i++) {
+            int dst_row = (dy < 0) ? y + i : y + h - 1 - i;
+            int src_row = dst_row - dy;
+            k_memcpy(&gw->pixels[dst_row * gw->client_w + x],
+                     &gw->pixels[src_row * gw->client_w + x],
+                     (size_t)w * sizeof(uint32_t));
+        }
+    }
+    post = mark_dirty_locked(gw, x, y, w, h, &dirty);
     spin_unlock(&g_gui_lock);
+    if (post)
+        wm_mark_dirty_rect(dirty.x, dirty.y, dirty.w, dirty.h);
+    return GUI_OK;
+}
+
+int gui_srv_mark_dirty(int pid, int handle, int x, int y, int w, int h)
+{
+    gui_window_t *gw;
+    wm_dirty_rect_t dirty;
+    int post;
 
-    wm_mark_dirty_rect(cx + mx, cy + my, mw, mh);
+    spin_lock(&g_gui_lock);
+    gw = find_slot_by_handle(handle);
+    if (!gw) {
+        spin_unlock(&g_gui_lock);
+        return GUI_ERR_NOTFOUND;
+    }
+    if (gw->owner_pid != pid) {
+        spin_unlock(&g_gui_lock);
+        return GUI_ERR_PERM;
+    }
+    post = mark_dirty_locked(gw, x, y, w, h, &dirty);
+    spin_unlock(&g_gui_lock);
+    if (post)
+        wm_mark_dirty_rect(dirty.x, dirty.y, dirty.w, dirty.h);
     return GUI_OK;
 }
 
+void gui_srv_batch_begin(int pid)
+{
+    spin_lock(&g_gui_lock);
+    for (int i = 0; i < GUI_SRV_MAX_WINDOWS; i++) {
+        gui_window_t *gw = &g_windows[i];
+        if (!gw->used || gw->owner_pid != pid)
+            continue;
+        gw->batching = 1;
+        gw->batch_x0 = gw->batch_x1 = 0;
+        gw->batch_y0 = gw->batch_y1 = 0;
+    }
+    spin_unlock(&g_gui_lock);
+}
+
+void gui_srv_batch_end(int pid)
+{
+    wm_dirty_rect_t rects[GUI_SRV_MAX_WINDOWS];
+    int n = 0;
+
+    spin_lock(&g_gui_lock);
+    for (int i = 0; i < GUI_SRV_MAX_WINDOWS; i++) {
+        gui_window_t *gw = &g_windows[i];
+        int cx, cy, cw, ch;
+        if (!gw->used || gw->owner_pid != pid || !gw->batching)
+            continue;
+        gw->batching = 0;
+        if (gw->batch_x1 <= gw->batch_x0 || gw->batch_y1 <= gw->batch_y0)
+            continue;
+        wm_client_rect(gw->wm_win, &cx, &cy, &cw, &ch);
+        rects[n].x = cx + gw->batch_x0;
+        rects[n].y = cy + gw->batch_y0;
+        rects[n].w = gw->batch_x1 - gw->batch_x0;
+        rects[n].h = gw->batch_y1 - gw->batch_y0;
+        n++;
+    }
+    spin_unlock(&g_gui_lock);
+
+    for (int i = 0; i < n; i++)
+        wm_mark_dirty_rect(rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+}
+
 int gui_srv_get_event(int pid, int handle, struct tsukasa_gui_event *out)
 {
     gui_window_t *gw;
@@ -36,8 +36,19 @@ int gui_srv_draw_image(int pid, int handle,
                        const uint32_t *pixels);
 int gui_srv_mark_dirty(int pid, int handle,
                        int x, int y, int w, int h);
+/* Move the pixels of a client rect by dy rows; the exposed strip is left as is. */
+int gui_srv_scroll_rect(int pid, int handle,
+                        int x, int y, int w, int h, int dy);
 int gui_srv_get_event(int pid, int handle, struct tsukasa_gui_event *out);
 
+/*
+ * Batch the updates of every window `pid` owns: until gui_srv_batch_end()
+ * each window's dirty rects are merged into one, which is then posted to
+ * the window manager once instead of once per draw call.
+ */
+void gui_srv_batch_begin(int pid);
+void gui_srv_batch_end(int pid);
+
 int gui_srv_get_string_width(const char *str);
 int gui_srv_get_font_height(void);
 int gui_srv_get_screen_size(uint64_t *out_w, uint64_t *out_h);
@@ -104,15 +104,12 @@ void ui_draw_window(int x, int y, int w, int h,
         int title_x_start = x + UI_BORDER + 14 + 2 * UI_TBTN_SPACING + UI_TBTN_R + 8;
         int title_y  = y + UI_BORDER + (UI_TITLE_H - FONT_HEIGHT) / 2;
         int max_w    = w - (title_x_start - x) - UI_BORDER - 8;
-        /* Draw each character but stop when we'd overflow. */
-        int cx2 = title_x_start;
-        for (int i = 0; title[i] && cx2 + 8 <= title_x_start + max_w; i++) {
-            fb_draw_char(cx2, title_y, title[i],
+        /* Whole characters only; stop when we'd overflow. */
+        if (max_w >= 8)
+            fb_draw_text(title_x_start, title_y, title, max_w / 8,
                          (color_t)THEME_TEXT,
                          active ? (color_t)THEME_TITLEBAR_ACTIVE_TOP
                                 : (color_t)THEME_TITLEBAR_TOP);
-            cx2 += 8;
-        }
     }
 }
 
@@ -138,10 +135,7 @@ void ui_draw_button(int x, int y, int w, int h,
         int len   = kstrlen_ui(label);
         int tx    = x + (w - len * 8) / 2;
         int ty    = y + (h - FONT_HEIGHT) / 2;
-        for (int i = 0; label[i]; i++) {
-            fb_draw_char(tx, ty, label[i], (color_t)THEME_TEXT, bg);
-            tx += 8;
-        }
+        fb_draw_text(tx, ty, label, len, (color_t)THEME_TEXT, bg);
     }
 }
 
@@ -200,12 +194,9 @@ void ui_draw_sidebar_item(int x, int y, int w, int h,
     if (label) {
         int ty = y + (h - FONT_HEIGHT) / 2;
         int tx = x + 16;
-        for (int i = 0; label[i] && tx + 8 <= x + w - 4; i++) {
-            fb_draw_char(tx, ty, label[i], fg,
-                         selected ? rgba(14, 22, 34, 0xFF)
-                                  : rgba(14, 22, 34, 0xFF));
-            tx += 8;
-        }
+        if (x + w - 4 - tx >= 8)
+            fb_draw_text(tx, ty, label, (x + w - 4 - tx) / 8, fg,
+                         rgba(14, 22, 34, 0xFF));
     }
 }
 
@@ -5,6 +5,7 @@
 #include "wm.h"
 #include "ui.h"
 #include "../drv/fb.h"
+#include "../include/trace.h"
 #include "../mm/heap.h"
 
 #include <stddef.h>
@@ -522,8 +523,21 @@ int wm_handle_input(const struct input_event *ev)
     return 0;
 }
 
+/* Pack a redraw rectangle into one tracepoint argument. */
+static uint64_t wm_trace_rect(int x, int y, int w, int h)
+{
+    return (uint64_t)(uint16_t)x |
+           ((uint64_t)(uint16_t)y << 16) |
+           ((uint64_t)(uint16_t)w << 32) |
+           ((uint64_t)(uint16_t)h << 48);
+}
+
 void wm_redraw_all(void)
 {
+    int drawn = 0;
+
+    TRACE(TRACE_EV_WM_REDRAW_BEGIN,
+          wm_trace_rect(0, 0, (int)fb_info.width, (int)fb_info.height), 0);
     for (wm_window_t *w = zlist_head; w; w = w->next) {
         int active;
         if (!(w->flags & WM_FLAG_VISIBLE))
@@ -532,12 +546,17 @@ void wm_redraw_all(void)
         ui_draw_window(w->x, w->y, w->w, w->h, w->title, active, w->accent);
         if (w->draw_content)
             w->draw_content(w);
+        drawn++;
     }
+    TRACE(TRACE_EV_WM_REDRAW_END, drawn, 0);
 }
 
 void wm_redraw_region(int x, int y, int w, int h)
 {
     int shadow_margin = UI_SHADOW_R + 2;
+    int drawn = 0;
+
+    TRACE(TRACE_EV_WM_REDRAW_BEGIN, wm_trace_rect(x, y, w, h), 0);
     for (wm_window_t *win = zlist_head; win; win = win->next) {
         int active;
         if (!(win->flags & WM_FLAG_VISIBLE))
@@ -552,7 +571,9 @@ void wm_redraw_region(int x, int y, int w, int h)
         ui_draw_window(win->x, win->y, win->w, win->h, win->title, active, win->accent);
         if (win->draw_content)
             win->draw_content(win);
+        drawn++;
     }
+    TRACE(TRACE_EV_WM_REDRAW_END, drawn, 0);
 }
 
 void wm_set_resizable(wm_window_t *win, int resizable)
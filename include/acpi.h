@@ -0,0 +1,23 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+/* Remember the RSDP (physical address from the loader); -1 if it is not valid. */
+int acpi_init(uint64_t rsdp_phys);
+
+/* Map the first root-table entry whose signature is `sig`; NULL if absent. */
+const uint8_t *acpi_find_table(const char *sig, uint32_t *len_out);
+
+/* Unaligned little-endian field reads for table bodies. */
+static inline uint32_t acpi_rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t acpi_rd64(const uint8_t *p)
+{
+    return (uint64_t)acpi_rd32(p) | ((uint64_t)acpi_rd32(p + 4) << 32);
+}
+
+#endif /* ACPI_H */
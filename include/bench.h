@@ -0,0 +1,64 @@
+/*
+ * bench.h - In-kernel microbenchmark harness.
+ *
+ * A case is registered with BENCH_CASE() anywhere in the x86_64 kernel; the
+ * descriptor lands in the .bench_cases section, which the linker script
+ * brackets with __bench_cases_start/__bench_cases_end.  bench_run() runs
+ * each selected case: optional setup, `warmup` untimed iterations, then
+ * `iters` iterations each timed with the TSC, and reports min, median,
+ * p99 and mean per iteration as CSV (one row per case, see BENCH_CSV_HEADER).
+ * The median of each case's last successful run is kept for bench_last().
+ */
+
+#ifndef TSUKASA_BENCH_H
+#define TSUKASA_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_CSV_HEADER \
+    "suite,case,status,iters,min_ns,median_ns,p99_ns,mean_ns,median_cycles,mb_per_s\n"
+
+/* bench_run() flags */
+#define BENCH_FLAG_LIST 0x1u    /* only list matching cases ("suite,case" rows) */
+
+typedef struct bench_case {
+    const char *suite;
+    const char *name;
+    uint32_t iters;
+    uint32_t warmup;
+    uint32_t bytes;                 /* moved per iteration; 0 = no mb_per_s */
+    int (*setup)(void **state);     /* optional; < 0 skips the case */
+    void (*run)(void *state);       /* one timed iteration */
+    void (*teardown)(void *state);  /* optional */
+} bench_case_t;
+
+#define BENCH_CASE(suite_, name_, ...)                                          \
+    static const bench_case_t bench_case_##suite_##_##name_                     \
+        __attribute__((used, section(".bench_cases"), aligned(8))) = {          \
+            .suite = #suite_, .name = #name_, __VA_ARGS__                       \
+        }
+
+/* Last successful run of one case. */
+typedef struct bench_last {
+    uint32_t iters;
+    uint64_t median_ns;
+    uint64_t median_cycles;
+} bench_last_t;
+
+/**
+ * Run every case whose suite equals `filter`, or whose "suite/case" does;
+ * NULL or "" selects all.  Writes CSV (with header) into `out`.
+ *
+ * @return Bytes written (truncated rows are dropped), or -1 on bad args.
+ */
+int bench_run(const char *filter, char *out, size_t cap, uint32_t flags);
+
+/**
+ * Median of the last successful run of `suite`/`name`.
+ *
+ * @return 0, or -1 if there is no such case or it has not run yet.
+ */
+int bench_last(const char *suite, const char *name, bench_last_t *out);
+
+#endif /* TSUKASA_BENCH_H */
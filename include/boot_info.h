@@ -53,6 +53,9 @@ struct tsukasa_boot_info {
 
     uint64_t module_count;
     const struct tsukasa_boot_module *modules;
+
+    /* Physical address of the ACPI RSDP; 0 if the loader did not report one. */
+    uint64_t rsdp_addr;
 };
 
 static inline int tsukasa_boot_info_is_valid(const void *opaque)
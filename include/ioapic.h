@@ -0,0 +1,26 @@
+#ifndef IOAPIC_H
+#define IOAPIC_H
+
+#include <stdint.h>
+
+/* Redirection entry trigger/polarity, as passed to ioapic_route(). */
+#define IOAPIC_EDGE        0x0u
+#define IOAPIC_LEVEL       0x1u
+#define IOAPIC_ACTIVE_HIGH 0x0u
+#define IOAPIC_ACTIVE_LOW  0x2u
+
+/* Find the IOAPICs and ISA overrides in the MADT (or assume the PC default) and mask every pin. */
+int ioapic_init(void);
+int ioapic_available(void);
+
+/*
+ * GSI an ISA IRQ line is wired to.  `flags` holds the trigger/polarity to
+ * assume on input and is replaced by the MADT override's, where it gives one.
+ */
+uint32_t ioapic_isa_gsi(uint8_t irq, uint32_t *flags);
+
+/* Deliver `gsi` as `vector` to the local APIC `lapic_id`; -1 if no IOAPIC owns it. */
+int ioapic_route(uint32_t gsi, uint8_t vector, uint32_t lapic_id, uint32_t flags);
+void ioapic_mask(uint32_t gsi);
+
+#endif /* IOAPIC_H */
@@ -0,0 +1,59 @@
+/*
+ * klog.h - Kernel log ring with deferred serial drain.
+ *
+ * kprintf() formats into records that are appended lock-free to a per-CPU
+ * ring.  Until klog_start_async() is called the ring is drained to COM1
+ * synchronously (boot behaviour); afterwards the UART THRE interrupt and
+ * the timer tick drain it in the background.  /sys/klog reads the ring
+ * without touching the serial line.
+ */
+
+#ifndef TSUKASA_KLOG_H
+#define TSUKASA_KLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KLOG_MAX_CPUS      4
+#define KLOG_RING_RECORDS  256      /* per CPU, power of two */
+#define KLOG_TEXT_MAX      112
+
+typedef struct klog_record {
+    uint32_t seq;
+    uint16_t cpu;
+    uint16_t len;
+    uint64_t ticks;                 /* PIT ticks at commit */
+    uint64_t tsc;
+    char text[KLOG_TEXT_MAX];       /* not NUL-terminated */
+} klog_record_t;
+
+typedef struct klog_iter {
+    uint32_t pos[KLOG_MAX_CPUS];
+} klog_iter_t;
+
+typedef struct klog_stats {
+    uint32_t next_seq;              /* == records committed so far */
+    uint32_t dropped;               /* overwritten before reaching serial */
+    uint32_t drain_irqs;
+    int async;
+} klog_stats_t;
+
+/** Append len bytes of text (split into records as needed). */
+void klog_write(const char *text, size_t len);
+
+/** Register the COM1 IRQ and switch to background draining. */
+void klog_start_async(void);
+
+/** Timer-tick backstop: re-arm the THRE interrupt if output is pending. */
+void klog_poll(void);
+
+/** Fall back to synchronous draining and flush everything (fatal paths). */
+void klog_panic(void);
+
+/** Iterate retained records in sequence order. */
+void klog_iter_init(klog_iter_t *it);
+int klog_iter_next(klog_iter_t *it, klog_record_t *out);
+
+void klog_get_stats(klog_stats_t *out);
+
+#endif /* TSUKASA_KLOG_H */
@@ -1,6 +1,7 @@
 /*
  * kprintf.h - Freestanding kernel printf.
- * Outputs to COM1 serial (captured by QEMU -serial stdio).
+ * Outputs to the kernel log ring, drained to COM1 serial (captured by
+ * QEMU -serial stdio) and readable from /sys/klog.
  * Supports: %d %i %u %x %X %s %c %% and width/zero-pad modifiers.
  */
 
@@ -11,7 +12,7 @@
 #include <stdarg.h>
 
 /**
- * Print a formatted string to the serial port.
+ * Print a formatted string to the kernel log.
  * Returns the number of characters written.
  */
 int kprintf(const char *fmt, ...);
@@ -22,7 +23,7 @@ int kprintf(const char *fmt, ...);
  */
 int ksprintf(char *buf, size_t n, const char *fmt, ...);
 
-/** Bare string output to serial (no formatting). */
+/** Bare string output to the kernel log (no formatting). */
 void kputs(const char *s);
 
 #endif /* KPRINTF_H */
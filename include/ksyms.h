@@ -0,0 +1,36 @@
+/*
+ * ksyms.h - Kernel symbol table embedded at link time.
+ *
+ * The x86_64 link runs twice: the first image is fed through
+ * tools/gen_ksyms.py to produce ksyms_gen.c (function addresses and names,
+ * sorted), which is linked into the final image.  The table only adds
+ * .rodata after all .text, so code addresses do not move between passes.
+ * Builds without a generated table see an empty one.
+ */
+
+#ifndef TSUKASA_KSYMS_H
+#define TSUKASA_KSYMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ksym {
+    uintptr_t addr;
+    uint32_t size;                  /* 0 if unknown: runs to the next symbol */
+    const char *name;
+} ksym_t;
+
+/** Number of symbols in the embedded table. */
+uint32_t ksym_count(void);
+
+/** Symbol `index` in address order, or NULL. */
+const ksym_t *ksym_at(uint32_t index);
+
+/**
+ * Find the function containing `addr`.
+ *
+ * @return Table index, or -1 if `addr` is outside every known function.
+ */
+int ksym_lookup(uintptr_t addr);
+
+#endif /* TSUKASA_KSYMS_H */
@@ -8,6 +8,7 @@
 // Kernel string utilities
 void k_memset(void *dest, int val, size_t len);
 void k_memcpy(void *dest, const void *src, size_t len);
+void k_memmove(void *dest, const void *src, size_t len);
 size_t k_strlen(const char *str);
 int k_strcmp(const char *s1, const char *s2);
 int k_strncmp(const char *s1, const char *s2, size_t n);
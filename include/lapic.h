@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 
+/* IDT vector of the local APIC timer (used by the sampling profiler). */
+#define LAPIC_TIMER_VECTOR 48
+
 void lapic_init(void);
 void lapic_enable(void);
 void lapic_eoi(void);
@@ -10,4 +13,10 @@ uint32_t lapic_read_id(void);
 void lapic_send_ipi_all(void);
 void lapic_send_ipi(uint32_t lapic_id, uint8_t vector);
 
+/* Timer input clock in Hz (bus clock / 16), calibrated against the TSC on first use; 0 if unknown. */
+uint32_t lapic_timer_frequency(void);
+/* Periodic LAPIC_TIMER_VECTOR interrupts on this CPU; returns the rate achieved, or 0. */
+uint32_t lapic_timer_start(uint32_t hz);
+void lapic_timer_stop(void);
+
 #endif /* LAPIC_H */
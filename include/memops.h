@@ -0,0 +1,50 @@
+/*
+ * memops.h - Shared memory/string primitives for the kernel and user libc.
+ *
+ * One implementation set backs k_memcpy/k_memset/k_strlen and the user
+ * library's memcpy/memset/memmove/strlen.  The bulk path is chosen once via
+ * CPUID: ERMS "rep movsb/stosb" when advertised, otherwise 16-byte SSE2
+ * (user builds only; the kernel is compiled without SSE) or word-at-a-time.
+ * Short operations always take the inline word path.
+ */
+
+#ifndef TSUKASA_MEMOPS_H
+#define TSUKASA_MEMOPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    MEMOPS_IMPL_BYTE = 0,
+    MEMOPS_IMPL_WORD,
+    MEMOPS_IMPL_ERMS,
+    MEMOPS_IMPL_SSE2,
+    MEMOPS_IMPL_COUNT
+};
+
+void memops_copy(void *dst, const void *src, size_t n);
+void memops_move(void *dst, const void *src, size_t n);
+void memops_set(void *dst, int c, size_t n);
+size_t memops_strlen(const char *s);
+
+/** Non-zero when `impl` is compiled in and supported by this CPU. */
+int memops_impl_supported(int impl);
+
+/** Implementation currently used for bulk operations. */
+int memops_impl_active(void);
+
+/* One implementation's copy/set, with the same small-size path as the defaults. */
+typedef struct memops_ops {
+    void (*copy)(void *dst, const void *src, size_t n);
+    void (*set)(void *dst, int c, size_t n);
+} memops_ops_t;
+
+/**
+ * Entry points bound to `impl`, for benchmarks; the global dispatch used by
+ * memops_copy/memops_set is left alone.  NULL if `impl` is unsupported.
+ */
+const memops_ops_t *memops_impl_ops(int impl);
+
+const char *memops_impl_name(int impl);
+
+#endif /* TSUKASA_MEMOPS_H */
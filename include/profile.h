@@ -0,0 +1,67 @@
+/*
+ * profile.h - Timer-driven sampling profiler.
+ *
+ * While running, every profiling interrupt records the interrupted RIP and
+ * pid into the current CPU's sample buffer.  The source is the local APIC
+ * timer at the requested rate; without a usable LAPIC it falls back to the
+ * PIT scheduler tick (pit_frequency() Hz).  /sys/profile folds the samples
+ * into per-function counts with the embedded symbol table (ksyms.h).
+ */
+
+#ifndef TSUKASA_PROFILE_H
+#define TSUKASA_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PROFILE_MAX_CPUS        4
+#define PROFILE_CPU_SAMPLES     16384   /* per CPU ring, allocated on start */
+#define PROFILE_DEFAULT_HZ      1000
+#define PROFILE_MAX_HZ          20000
+
+enum profile_source {
+    PROFILE_SRC_NONE = 0,
+    PROFILE_SRC_PIT,
+    PROFILE_SRC_LAPIC,
+};
+
+typedef struct profile_info {
+    int running;
+    int source;                 /* enum profile_source */
+    uint32_t hz;
+    uint64_t samples;           /* taken since start, all CPUs */
+    uint64_t overwritten;       /* older than the retained window */
+    uint64_t user_samples;      /* interrupted in ring 3 */
+    uint64_t unknown_samples;   /* kernel RIP outside every known function */
+    uint32_t symbols;           /* entries in the symbol table */
+} profile_info_t;
+
+/* One kernel function, or (name "[user]") one process's ring-3 time. */
+typedef struct profile_entry {
+    const char *name;
+    uintptr_t addr;
+    uint32_t pid;               /* user entries only */
+    uint32_t samples;
+} profile_entry_t;
+
+/**
+ * Clear the buffers and start sampling at `hz` (0 = PROFILE_DEFAULT_HZ).
+ *
+ * @return The achieved rate in Hz, or 0 if no source is available.
+ */
+uint32_t profile_start(uint32_t hz);
+
+void profile_stop(void);
+
+/** Called from the IRQ path with the interrupted context (isr.asm frame). */
+void profile_sample_irq(int source, uint64_t context_rsp);
+
+/**
+ * Fold the retained samples into per-function counts, most samples first.
+ *
+ * @param out May be NULL to fetch only `info`.
+ * @return Entries written (at most `max`).
+ */
+int profile_snapshot(profile_entry_t *out, int max, profile_info_t *info);
+
+#endif /* TSUKASA_PROFILE_H */
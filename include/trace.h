@@ -0,0 +1,98 @@
+/*
+ * trace.h - Static kernel tracepoints with a binary per-CPU trace ring.
+ *
+ * TRACE(ev, a0, a1) tests the event's bit in g_trace_mask and only calls
+ * out when it is set, so a disabled tracepoint costs one load, one test
+ * and a not-taken branch.  Building with TRACE_BUILD=0 removes them
+ * entirely.  Enabled events append fixed-size records (TSC timestamp, CPU,
+ * pid, two arguments) to the current CPU's ring, overwriting the oldest.
+ *
+ * /sys/trace returns a trace_dump_header_t followed by the retained
+ * records of every CPU, each CPU's oldest first.  All fields are
+ * little-endian; tools/trace_decode.py turns a dump into text.
+ */
+
+#ifndef TSUKASA_TRACE_H
+#define TSUKASA_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRACE_BUILD
+#define TRACE_BUILD 1
+#endif
+
+#define TRACE_MAX_CPUS      4
+#define TRACE_RING_RECORDS  2048    /* per CPU, power of two */
+#define TRACE_DUMP_MAGIC    0x31435254u     /* "TRC1" */
+#define TRACE_DUMP_VERSION  1
+
+/* Event ids; keep tools/trace_decode.py in sync. */
+enum trace_event {
+    TRACE_EV_IRQ_ENTRY = 1,         /* a0 = vector */
+    TRACE_EV_IRQ_EXIT,              /* a0 = vector */
+    TRACE_EV_SCHED_SWITCH,          /* a0 = prev pid, a1 = next pid */
+    TRACE_EV_SYSCALL_ENTRY,         /* a0 = number, a1 = first argument */
+    TRACE_EV_SYSCALL_EXIT,          /* a0 = number, a1 = return value */
+    TRACE_EV_VFS_READ_ENTRY,        /* a0 = fd, a1 = count */
+    TRACE_EV_VFS_READ_EXIT,         /* a0 = fd, a1 = bytes read */
+    TRACE_EV_VFS_WRITE_ENTRY,       /* a0 = fd, a1 = count */
+    TRACE_EV_VFS_WRITE_EXIT,        /* a0 = fd, a1 = bytes written */
+    TRACE_EV_NIC_SEND,              /* a0 = length, a1 = driver rc */
+    TRACE_EV_NIC_POLL_RX,           /* a0 = frames, a1 = bytes */
+    TRACE_EV_WM_REDRAW_BEGIN,       /* a0 = x | y << 16 | w << 32 | h << 48 */
+    TRACE_EV_WM_REDRAW_END,         /* a0 = windows drawn */
+    TRACE_EV_COUNT
+};
+
+#define TRACE_BIT(ev)   (1u << (ev))
+#define TRACE_MASK_ALL  (((1u << TRACE_EV_COUNT) - 1u) & ~1u)
+
+typedef struct trace_record {
+    uint64_t tsc;
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t pid;                   /* 0 when no process is current */
+    uint64_t arg0;
+    uint64_t arg1;
+} trace_record_t;
+
+typedef struct trace_dump_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t tsc_hz;                /* 0 if the TSC was not calibrated */
+    uint32_t record_count;
+    uint32_t dropped;               /* overwritten before this dump */
+    uint32_t mask;                  /* events enabled at dump time */
+    uint32_t reserved;
+} trace_dump_header_t;
+
+extern volatile uint32_t g_trace_mask;
+
+void trace_emit(uint32_t ev, uint64_t a0, uint64_t a1);
+
+#if TRACE_BUILD
+#define TRACE(ev, a0, a1)                                                   \
+    do {                                                                    \
+        if (__builtin_expect((g_trace_mask & TRACE_BIT(ev)) != 0, 0))       \
+            trace_emit((ev), (uint64_t)(a0), (uint64_t)(a1));               \
+    } while (0)
+#else
+#define TRACE(ev, a0, a1) do { } while (0)
+#endif
+
+/** Set the enabled-event mask; returns the previous one. */
+uint32_t trace_set_mask(uint32_t mask);
+
+/** Discard every retained record. */
+void trace_reset(void);
+
+/**
+ * Serialise the rings into a kmalloc'd buffer (header + records).
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int trace_dump(uint8_t **buf_out, size_t *size_out);
+
+#endif /* TSUKASA_TRACE_H */
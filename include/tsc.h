@@ -0,0 +1,19 @@
+/*
+ * tsc.h - Time-stamp counter helpers.
+ */
+
+#ifndef TSUKASA_TSC_H
+#define TSUKASA_TSC_H
+
+#include <stdint.h>
+
+/** Read the raw TSC (not serialized; cheap enough for hot paths). */
+static inline uint64_t tsc_read(void)
+{
+    uint32_t lo;
+    uint32_t hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | (uint64_t)lo;
+}
+
+#endif /* TSUKASA_TSC_H */
@@ -0,0 +1,214 @@
+/*
+ * ioring.c - Batched syscall submission rings.
+ *
+ * The kernel keeps its own copy of the ring geometry and of sq_head, and
+ * copies each SQE out of shared memory before acting on it, so a process
+ * scribbling over the shared header can only confuse itself.
+ */
+
+#include "ioring.h"
+
+#include "shm.h"
+#include "../gfx/gui_srv.h"
+#include "../include/spinlock.h"
+#include "../proc/process.h"
+#include "../syscall/syscall.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IORING_MAX_RINGS 16
+
+typedef struct ioring {
+    int in_use;
+    int id;
+    int owner_pid;
+    int shm_id;
+    struct tsukasa_ioring *hdr;     /* owner's mapping; valid in its context */
+    struct tsukasa_ioring_sqe *sqes;
+    struct tsukasa_ioring_cqe *cqes;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_head;
+    uint32_t cq_tail;
+} ioring_t;
+
+static ioring_t g_rings[IORING_MAX_RINGS];
+static int g_next_ring_id = 1;
+static spinlock_t g_ioring_lock = SPINLOCK_INIT;
+
+static ioring_t *ioring_find_locked(int id, int pid)
+{
+    for (int i = 0; i < IORING_MAX_RINGS; i++) {
+        if (g_rings[i].in_use && g_rings[i].id == id && g_rings[i].owner_pid == pid)
+            return &g_rings[i];
+    }
+    return NULL;
+}
+
+int ioring_setup(uint32_t entries, struct tsukasa_ioring_params *out)
+{
+    int pid = process_current_pid();
+    uint32_t sq = 1;
+    uint32_t cq;
+    size_t sq_off, cq_off, size;
+    struct tsukasa_ioring *hdr;
+    ioring_t *r = NULL;
+    int shm_id;
+
+    if (!out || pid <= 0 || entries == 0 || entries > TSUKASA_IORING_MAX_ENTRIES)
+        return -1;
+    while (sq < entries)
+        sq <<= 1;
+    cq = sq * 2u;
+
+    sq_off = (sizeof(*hdr) + 63u) & ~(size_t)63u;
+    cq_off = sq_off + (size_t)sq * sizeof(struct tsukasa_ioring_sqe);
+    size = cq_off + (size_t)cq * sizeof(struct tsukasa_ioring_cqe);
+
+    shm_id = shm_create(size);
+    if (shm_id < 0)
+        return -1;
+    hdr = (struct tsukasa_ioring *)shm_attach(shm_id);
+    if (!hdr) {
+        shm_destroy(shm_id);
+        return -1;
+    }
+
+    spin_lock(&g_ioring_lock);
+    for (int i = 0; i < IORING_MAX_RINGS; i++) {
+        if (!g_rings[i].in_use) {
+            r = &g_rings[i];
+            break;
+        }
+    }
+    if (!r) {
+        spin_unlock(&g_ioring_lock);
+        shm_detach(hdr);
+        shm_destroy(shm_id);
+        return -1;
+    }
+    r->in_use = 1;
+    r->id = g_next_ring_id++;
+    if (g_next_ring_id < 1)
+        g_next_ring_id = 1;
+    r->owner_pid = pid;
+    r->shm_id = shm_id;
+    r->hdr = hdr;
+    r->sqes = (struct tsukasa_ioring_sqe *)((uint8_t *)hdr + sq_off);
+    r->cqes = (struct tsukasa_ioring_cqe *)((uint8_t *)hdr + cq_off);
+    r->sq_entries = sq;
+    r->cq_entries = cq;
+    r->sq_head = 0;
+    r->cq_tail = 0;
+    spin_unlock(&g_ioring_lock);
+
+    hdr->sq_head = 0;
+    hdr->sq_tail = 0;
+    hdr->cq_head = 0;
+    hdr->cq_tail = 0;
+    hdr->sq_entries = sq;
+    hdr->cq_entries = cq;
+    hdr->sq_off = (uint32_t)sq_off;
+    hdr->cq_off = (uint32_t)cq_off;
+
+    out->id = r->id;
+    out->sq_entries = sq;
+    out->cq_entries = cq;
+    out->ring = hdr;
+    return r->id;
+}
+
+int ioring_enter(int id, uint32_t max_submit)
+{
+    int pid = process_current_pid();
+    ioring_t *r;
+    ioring_t ring;
+    uint32_t tail, pending;
+    int done = 0;
+
+    spin_lock(&g_ioring_lock);
+    r = ioring_find_locked(id, pid);
+    if (r)
+        ring = *r;
+    spin_unlock(&g_ioring_lock);
+    if (!r)
+        return -1;
+
+    tail = __atomic_load_n(&ring.hdr->sq_tail, __ATOMIC_ACQUIRE);
+    pending = tail - ring.sq_head;
+    if (pending > ring.sq_entries)
+        return -1;
+    if (pending > max_submit)
+        pending = max_submit;
+    if (pending == 0)
+        return 0;
+
+    gui_srv_batch_begin(pid);
+    while ((uint32_t)done < pending) {
+        struct tsukasa_ioring_sqe sqe = ring.sqes[ring.sq_head & (ring.sq_entries - 1u)];
+        int want_cqe = !(sqe.flags & TSUKASA_IORING_SQE_NO_CQE);
+        uintptr_t res;
+
+        if (want_cqe) {
+            uint32_t cq_head = __atomic_load_n(&ring.hdr->cq_head, __ATOMIC_ACQUIRE);
+            if (ring.cq_tail - cq_head >= ring.cq_entries)
+                break;
+        }
+
+        res = syscall_submit(sqe.nr, sqe.cmd, sqe.args);
+        ring.sq_head++;
+        __atomic_store_n(&ring.hdr->sq_head, ring.sq_head, __ATOMIC_RELEASE);
+        if (want_cqe) {
+            struct tsukasa_ioring_cqe *cqe = &ring.cqes[ring.cq_tail & (ring.cq_entries - 1u)];
+            cqe->user_data = sqe.user_data;
+            cqe->res = (int64_t)res;
+            ring.cq_tail++;
+            __atomic_store_n(&ring.hdr->cq_tail, ring.cq_tail, __ATOMIC_RELEASE);
+        }
+        done++;
+    }
+    gui_srv_batch_end(pid);
+
+    /* Only this process enters its ring, so nothing raced our copy. */
+    spin_lock(&g_ioring_lock);
+    r = ioring_find_locked(id, pid);
+    if (r) {
+        r->sq_head = ring.sq_head;
+        r->cq_tail = ring.cq_tail;
+    }
+    spin_unlock(&g_ioring_lock);
+    return done;
+}
+
+int ioring_destroy(int id)
+{
+    int pid = process_current_pid();
+    ioring_t *r;
+    struct tsukasa_ioring *hdr;
+    int shm_id;
+
+    spin_lock(&g_ioring_lock);
+    r = ioring_find_locked(id, pid);
+    if (!r) {
+        spin_unlock(&g_ioring_lock);
+        return -1;
+    }
+    hdr = r->hdr;
+    shm_id = r->shm_id;
+    r->in_use = 0;
+    spin_unlock(&g_ioring_lock);
+
+    shm_detach(hdr);
+    return shm_destroy(shm_id);
+}
+
+void ioring_process_cleanup(int pid)
+{
+    spin_lock(&g_ioring_lock);
+    for (int i = 0; i < IORING_MAX_RINGS; i++) {
+        if (g_rings[i].in_use && g_rings[i].owner_pid == pid)
+            g_rings[i].in_use = 0;
+    }
+    spin_unlock(&g_ioring_lock);
+}
@@ -0,0 +1,49 @@
+/*
+ * ioring.h - Batched syscall submission rings.
+ *
+ * A process sets up a ring in a shared memory region mapped into its own
+ * address space (layout in syscall/syscall.h), queues any number of
+ * SYS_GUI / SYS_FS / SYS_SYSTEM commands as SQEs and has the kernel run the
+ * whole batch with one SYSTEM_CMD_IORING_ENTER.  Completions are read
+ * straight out of the shared CQ without another syscall.  GUI updates made
+ * during a batch are merged per window before reaching the compositor.
+ */
+
+#ifndef IORING_H
+#define IORING_H
+
+#include <stdint.h>
+
+struct tsukasa_ioring_params;
+
+/**
+ * Create a ring with room for `entries` SQEs (rounded up to a power of
+ * two, at most TSUKASA_IORING_MAX_ENTRIES) and twice as many CQEs, and map
+ * it into the current process.
+ *
+ * @return Ring id (> 0) on success, -1 on error.
+ */
+int ioring_setup(uint32_t entries, struct tsukasa_ioring_params *out);
+
+/**
+ * Execute up to `max_submit` queued SQEs in order.  Stops early when the
+ * CQ has no room for the next completion.
+ *
+ * @return Number of SQEs consumed, or -1 if `id` is not the caller's ring.
+ */
+int ioring_enter(int id, uint32_t max_submit);
+
+/**
+ * Unmap and free a ring.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int ioring_destroy(int id);
+
+/**
+ * Drop every ring owned by an exiting process.  The backing shared memory
+ * is released by shm_process_cleanup().
+ */
+void ioring_process_cleanup(int pid);
+
+#endif /* IORING_H */
@@ -0,0 +1,226 @@
+/*
+ * bench.c - In-kernel microbenchmark harness (see include/bench.h).
+ */
+
+#include "../include/bench.h"
+#include "../include/kutils.h"
+#include "../include/spinlock.h"
+#include "../include/tsc.h"
+#include "../drv/pit.h"
+#include "../mm/heap.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern const bench_case_t __bench_cases_start[];
+extern const bench_case_t __bench_cases_end[];
+
+#ifndef BENCH_LAST_MAX
+#define BENCH_LAST_MAX 64       /* cases whose last result is kept */
+#endif
+
+typedef struct bench_out {
+    char *data;
+    size_t len;
+    size_t cap;
+} bench_out_t;
+
+typedef struct bench_result {
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+    uint64_t mean;
+} bench_result_t;
+
+/* Indexed like the .bench_cases section; iters == 0 means never run. */
+static bench_last_t g_last[BENCH_LAST_MAX];
+static spinlock_t g_last_lock = SPINLOCK_INIT;
+
+static void out_str(bench_out_t *ob, const char *s)
+{
+    while (*s && ob->len + 1 < ob->cap)
+        ob->data[ob->len++] = *s++;
+    ob->data[ob->len] = '\0';
+}
+
+static void out_u64(bench_out_t *ob, uint64_t v)
+{
+    char tmp[24];
+    int i = 0;
+
+    do {
+        tmp[i++] = (char)('0' + (v % 10u));
+        v /= 10u;
+    } while (v > 0);
+    while (i > 0 && ob->len + 1 < ob->cap)
+        ob->data[ob->len++] = tmp[--i];
+    ob->data[ob->len] = '\0';
+}
+
+static int bench_selected(const bench_case_t *c, const char *filter)
+{
+    size_t n;
+
+    if (!filter || !filter[0])
+        return 1;
+    if (k_strcmp(filter, c->suite) == 0)
+        return 1;
+    n = k_strlen(c->suite);
+    return k_strncmp(filter, c->suite, n) == 0 &&
+           filter[n] == '/' && k_strcmp(filter + n + 1, c->name) == 0;
+}
+
+/* Shell sort; the sample arrays are a few thousand entries at most. */
+static void bench_sort(uint64_t *v, uint32_t n)
+{
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < n; i++) {
+            uint64_t x = v[i];
+            uint32_t j = i;
+            while (j >= gap && v[j - gap] > x) {
+                v[j] = v[j - gap];
+                j -= gap;
+            }
+            v[j] = x;
+        }
+    }
+}
+
+static uint64_t cycles_to_ns(uint64_t cycles, uint64_t hz)
+{
+    if (hz < 1000u)
+        return 0;
+    return cycles * 1000000u / (hz / 1000u);
+}
+
+/* 0 on success, -1 if skipped by setup, -2 out of memory. */
+static int bench_one(const bench_case_t *c, bench_result_t *res)
+{
+    void *state = NULL;
+    uint64_t *samples;
+    uint64_t sum = 0;
+    uint32_t n = c->iters ? c->iters : 1;
+
+    samples = (uint64_t *)kmalloc((size_t)n * sizeof(uint64_t));
+    if (!samples)
+        return -2;
+    if (c->setup && c->setup(&state) < 0) {
+        kfree(samples);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < c->warmup; i++)
+        c->run(state);
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t t0 = tsc_read();
+        c->run(state);
+        samples[i] = tsc_read() - t0;
+    }
+
+    if (c->teardown)
+        c->teardown(state);
+
+    bench_sort(samples, n);
+    for (uint32_t i = 0; i < n; i++)
+        sum += samples[i];
+    res->min = samples[0];
+    res->median = samples[n / 2];
+    res->p99 = samples[(uint64_t)n * 99u / 100u];
+    res->mean = sum / n;
+    kfree(samples);
+    return 0;
+}
+
+int bench_run(const char *filter, char *out, size_t cap, uint32_t flags)
+{
+    bench_out_t ob;
+    uint64_t hz = pit_tsc_hz();
+
+    if (!out || cap == 0)
+        return -1;
+    ob.data = out;
+    ob.len = 0;
+    ob.cap = cap;
+    out[0] = '\0';
+
+    if (flags & BENCH_FLAG_LIST)
+        out_str(&ob, "suite,case\n");
+    else
+        out_str(&ob, BENCH_CSV_HEADER);
+
+    for (const bench_case_t *c = __bench_cases_start; c < __bench_cases_end; c++) {
+        bench_result_t r;
+        size_t row_start = ob.len;
+        int rc;
+
+        if (!bench_selected(c, filter))
+            continue;
+        out_str(&ob, c->suite);
+        out_str(&ob, ",");
+        out_str(&ob, c->name);
+        if (flags & BENCH_FLAG_LIST) {
+            out_str(&ob, "\n");
+        } else {
+            rc = bench_one(c, &r);
+            if (rc == 0) {
+                uint64_t med_ns = cycles_to_ns(r.median, hz);
+                size_t idx = (size_t)(c - __bench_cases_start);
+                if (idx < BENCH_LAST_MAX) {
+                    spin_lock(&g_last_lock);
+                    g_last[idx].iters = c->iters ? c->iters : 1;
+                    g_last[idx].median_ns = med_ns;
+                    g_last[idx].median_cycles = r.median;
+                    spin_unlock(&g_last_lock);
+                }
+                out_str(&ob, ",ok,");
+                out_u64(&ob, c->iters);
+                out_str(&ob, ",");
+                out_u64(&ob, cycles_to_ns(r.min, hz));
+                out_str(&ob, ",");
+                out_u64(&ob, med_ns);
+                out_str(&ob, ",");
+                out_u64(&ob, cycles_to_ns(r.p99, hz));
+                out_str(&ob, ",");
+                out_u64(&ob, cycles_to_ns(r.mean, hz));
+                out_str(&ob, ",");
+                out_u64(&ob, r.median);
+                out_str(&ob, ",");
+                if (c->bytes && med_ns)
+                    out_u64(&ob, (uint64_t)c->bytes * 1000u / med_ns);
+                out_str(&ob, "\n");
+            } else {
+                out_str(&ob, rc == -1 ? ",skipped,0,,,,,,\n" : ",nomem,0,,,,,,\n");
+            }
+        }
+        /* Never hand back a partial row. */
+        if (ob.len + 1 >= ob.cap) {
+            ob.len = row_start;
+            out[ob.len] = '\0';
+            break;
+        }
+    }
+    return (int)ob.len;
+}
+
+int bench_last(const char *suite, const char *name, bench_last_t *out)
+{
+    int rc = -1;
+
+    if (!suite || !name || !out)
+        return -1;
+    for (const bench_case_t *c = __bench_cases_start; c < __bench_cases_end; c++) {
+        size_t idx = (size_t)(c - __bench_cases_start);
+        if (idx >= BENCH_LAST_MAX)
+            break;
+        if (k_strcmp(c->suite, suite) != 0 || k_strcmp(c->name, name) != 0)
+            continue;
+        spin_lock(&g_last_lock);
+        if (g_last[idx].iters) {
+            *out = g_last[idx];
+            rc = 0;
+        }
+        spin_unlock(&g_last_lock);
+        break;
+    }
+    return rc;
+}
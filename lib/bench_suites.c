@@ -0,0 +1,434 @@
+/*
+ * bench_suites.c - Initial in-kernel benchmark cases (run with /bin/bench).
+ *
+ * Cases that touch the screen draw into the top-left corner and restore it
+ * afterwards.  The font cases compare the glyph cache and span renderers with
+ * the per-pixel loops they replaced; /sys/gfx/fontbench reports their last
+ * results as glyphs per second.  fat32/seq_read keeps /disk/BENCH.DAT between runs so that
+ * successive runs read the same clusters.
+ */
+
+#include "../include/bench.h"
+#include "../include/kutils.h"
+#include "../fs/vfs.h"
+#include "../gfx/blit.h"
+#include "../gfx/font.h"
+#include "../gfx/font_8x8.h"
+#include "../ipc/shm.h"
+#include "../mm/heap.h"
+#include "../mm/pmm.h"
+#include "../mm/vmm_x64.h"
+#include "../proc/process.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ---- kmalloc ------------------------------------------------------------ */
+
+#define BENCH_KMALLOC(sz)                                                       \
+    static void bench_kmalloc_##sz(void *state)                                 \
+    {                                                                           \
+        (void)state;                                                            \
+        kfree(kmalloc(sz));                                                     \
+    }                                                                           \
+    BENCH_CASE(kmalloc, size_##sz, .iters = 2000, .warmup = 100,                \
+               .run = bench_kmalloc_##sz)
+
+BENCH_KMALLOC(32);
+BENCH_KMALLOC(256);
+BENCH_KMALLOC(4096);
+BENCH_KMALLOC(65536);
+
+/* ---- pmm ---------------------------------------------------------------- */
+
+static void bench_pmm_1(void *state)
+{
+    uintptr_t p = pmm_alloc_pages(1);
+    (void)state;
+    if (p)
+        pmm_free_pages(p, 1);
+}
+
+static void bench_pmm_16(void *state)
+{
+    uintptr_t p = pmm_alloc_pages(16);
+    (void)state;
+    if (p)
+        pmm_free_pages(p, 16);
+}
+
+BENCH_CASE(pmm, alloc_pages_1, .iters = 2000, .warmup = 100, .run = bench_pmm_1);
+BENCH_CASE(pmm, alloc_pages_16, .iters = 1000, .warmup = 50, .run = bench_pmm_16);
+
+/* ---- vmm: map + unmap 16 pages in a scratch address space --------------- */
+
+#define BENCH_VMM_PAGES 16
+#define BENCH_VMM_VA    0x40000000ULL
+
+typedef struct bench_vmm {
+    uint64_t pml4;
+    uintptr_t phys;
+} bench_vmm_t;
+
+static int bench_vmm_setup(void **state)
+{
+    bench_vmm_t *v = (bench_vmm_t *)kmalloc(sizeof(*v));
+    if (!v)
+        return -1;
+    v->phys = pmm_alloc_pages(BENCH_VMM_PAGES);
+    if (!v->phys || vmm_create_address_space(&v->pml4) != 0) {
+        if (v->phys)
+            pmm_free_pages(v->phys, BENCH_VMM_PAGES);
+        kfree(v);
+        return -1;
+    }
+    *state = v;
+    return 0;
+}
+
+static void bench_vmm_run(void *state)
+{
+    bench_vmm_t *v = (bench_vmm_t *)state;
+    if (vmm_map_pages(v->pml4, BENCH_VMM_VA, v->phys, BENCH_VMM_PAGES,
+                      VMM_X64_PTE_PRESENT | VMM_X64_PTE_WRITABLE | VMM_X64_PTE_USER) == 0)
+        vmm_unmap_pages(v->pml4, BENCH_VMM_VA, BENCH_VMM_PAGES);
+}
+
+static void bench_vmm_teardown(void *state)
+{
+    bench_vmm_t *v = (bench_vmm_t *)state;
+    vmm_destroy_address_space(v->pml4);
+    pmm_free_pages(v->phys, BENCH_VMM_PAGES);
+    kfree(v);
+}
+
+BENCH_CASE(vmm, map_unmap_16, .iters = 500, .warmup = 20,
+           .setup = bench_vmm_setup, .run = bench_vmm_run,
+           .teardown = bench_vmm_teardown);
+
+/* ---- context switch: yield to a partner that yields straight back ------- */
+
+static volatile int g_bench_yield_stop;
+
+static void bench_yield_partner(void)
+{
+    while (!g_bench_yield_stop)
+        process_yield();
+}
+
+static int bench_ctxsw_setup(void **state)
+{
+    process_t *p;
+
+    g_bench_yield_stop = 0;
+    p = process_spawn_kernel("bench-yield", bench_yield_partner);
+    if (!p)
+        return -1;
+    *state = (void *)(uintptr_t)p->pid;
+    return 0;
+}
+
+static void bench_ctxsw_run(void *state)
+{
+    (void)state;
+    process_yield();
+}
+
+static void bench_ctxsw_teardown(void *state)
+{
+    int status;
+
+    g_bench_yield_stop = 1;
+    process_waitpid(process_current_pid(), (int)(uintptr_t)state, 0, &status);
+}
+
+/* Other runnable processes at the caller's priority also get a turn. */
+BENCH_CASE(sched, yield_round_trip, .iters = 500, .warmup = 20,
+           .setup = bench_ctxsw_setup, .run = bench_ctxsw_run,
+           .teardown = bench_ctxsw_teardown);
+
+/* ---- pipe: write one page, read it back --------------------------------- */
+
+#define BENCH_PIPE_CHUNK 4096
+
+typedef struct bench_pipe {
+    int fds[2];
+    uint8_t buf[BENCH_PIPE_CHUNK];
+} bench_pipe_t;
+
+static int bench_pipe_setup(void **state)
+{
+    bench_pipe_t *bp = (bench_pipe_t *)kmalloc(sizeof(*bp));
+    if (!bp)
+        return -1;
+    if (vfs_pipe(bp->fds) != 0) {
+        kfree(bp);
+        return -1;
+    }
+    k_memset(bp->buf, 0xA5, sizeof(bp->buf));
+    *state = bp;
+    return 0;
+}
+
+static void bench_pipe_run(void *state)
+{
+    bench_pipe_t *bp = (bench_pipe_t *)state;
+    if (vfs_write(bp->fds[1], bp->buf, BENCH_PIPE_CHUNK) == BENCH_PIPE_CHUNK)
+        vfs_read(bp->fds[0], bp->buf, BENCH_PIPE_CHUNK);
+}
+
+static void bench_pipe_teardown(void *state)
+{
+    bench_pipe_t *bp = (bench_pipe_t *)state;
+    vfs_close(bp->fds[0]);
+    vfs_close(bp->fds[1]);
+    kfree(bp);
+}
+
+BENCH_CASE(pipe, page_round_trip, .iters = 1000, .warmup = 50,
+           .bytes = BENCH_PIPE_CHUNK,
+           .setup = bench_pipe_setup, .run = bench_pipe_run,
+           .teardown = bench_pipe_teardown);
+
+/* ---- framebuffer: 128x128 fill and alpha blit --------------------------- */
+
+#define BENCH_FB_DIM 128
+
+typedef struct bench_fb {
+    font_surface_t fb;
+    uint32_t saved[BENCH_FB_DIM * BENCH_FB_DIM];
+    uint32_t sprite[BENCH_FB_DIM * BENCH_FB_DIM];
+} bench_fb_t;
+
+static int bench_fb_setup(void **state)
+{
+    bench_fb_t *b = (bench_fb_t *)kmalloc(sizeof(*b));
+    if (!b)
+        return -1;
+    if (font_fb_surface(&b->fb) != 0 ||
+        b->fb.width < BENCH_FB_DIM || b->fb.height < BENCH_FB_DIM) {
+        kfree(b);
+        return -1;
+    }
+    for (int y = 0; y < BENCH_FB_DIM; y++)
+        k_memcpy(&b->saved[y * BENCH_FB_DIM], b->fb.pixels + y * b->fb.pitch,
+                 BENCH_FB_DIM * 4u);
+    for (int i = 0; i < BENCH_FB_DIM * BENCH_FB_DIM; i++)
+        b->sprite[i] = ((uint32_t)(i & 0xFF) << 24) | 0x3070C0u;
+    *state = b;
+    return 0;
+}
+
+static void bench_fb_fill_run(void *state)
+{
+    (void)state;
+    fb_fill_rect(0, 0, BENCH_FB_DIM, BENCH_FB_DIM, 0xFF204060u);
+}
+
+static void bench_fb_alpha_run(void *state)
+{
+    bench_fb_t *b = (bench_fb_t *)state;
+    fb_blit_alpha(0, 0, b->sprite, BENCH_FB_DIM, BENCH_FB_DIM);
+}
+
+static void bench_fb_teardown(void *state)
+{
+    bench_fb_t *b = (bench_fb_t *)state;
+    for (int y = 0; y < BENCH_FB_DIM; y++)
+        k_memcpy(b->fb.pixels + y * b->fb.pitch, &b->saved[y * BENCH_FB_DIM],
+                 BENCH_FB_DIM * 4u);
+    kfree(b);
+}
+
+BENCH_CASE(fb, fill_rect_128, .iters = 500, .warmup = 20,
+           .bytes = BENCH_FB_DIM * BENCH_FB_DIM * 4,
+           .setup = bench_fb_setup, .run = bench_fb_fill_run,
+           .teardown = bench_fb_teardown);
+BENCH_CASE(fb, blit_alpha_128, .iters = 500, .warmup = 20,
+           .bytes = BENCH_FB_DIM * BENCH_FB_DIM * 4,
+           .setup = bench_fb_setup, .run = bench_fb_alpha_run,
+           .teardown = bench_fb_teardown);
+
+/* ---- font: one 80-glyph line, old and new renderers --------------------- */
+
+typedef struct bench_font {
+    font_surface_t fb;
+    font_surface_t buf;
+    char line[FONT_BENCH_COLS + 1];
+    uint32_t saved[FONT_BENCH_COLS * FONT_WIDTH * FONT_HEIGHT];
+    uint32_t pixels[FONT_BENCH_COLS * FONT_WIDTH * FONT_HEIGHT];
+} bench_font_t;
+
+static int bench_font_setup(void **state)
+{
+    bench_font_t *b = (bench_font_t *)kmalloc(sizeof(*b));
+    if (!b)
+        return -1;
+    if (font_fb_surface(&b->fb) != 0 ||
+        b->fb.width < FONT_BENCH_COLS * FONT_WIDTH || b->fb.height < FONT_HEIGHT) {
+        kfree(b);
+        return -1;
+    }
+    b->buf.pixels = b->pixels;
+    b->buf.width = FONT_BENCH_COLS * FONT_WIDTH;
+    b->buf.height = FONT_HEIGHT;
+    b->buf.pitch = b->buf.width;
+    for (int i = 0; i < FONT_BENCH_COLS; i++)
+        b->line[i] = (char)(' ' + 1 + (i % 94));
+    b->line[FONT_BENCH_COLS] = '\0';
+    for (int y = 0; y < FONT_HEIGHT; y++)
+        k_memcpy(&b->saved[y * b->buf.width], b->fb.pixels + y * b->fb.pitch,
+                 (size_t)b->buf.width * 4u);
+    *state = b;
+    return 0;
+}
+
+static void bench_font_teardown(void *state)
+{
+    bench_font_t *b = (bench_font_t *)state;
+    for (int y = 0; y < FONT_HEIGHT; y++)
+        k_memcpy(b->fb.pixels + y * b->fb.pitch, &b->saved[y * b->buf.width],
+                 (size_t)b->buf.width * 4u);
+    kfree(b);
+}
+
+/* The renderers gfx/font.c replaced, kept as the baseline. */
+static void bench_font_fb_pixel_run(void *state)
+{
+    bench_font_t *b = (bench_font_t *)state;
+    for (int i = 0; i < FONT_BENCH_COLS; i++) {
+        const uint8_t *glyph = font_8x8[(unsigned char)b->line[i] & 0x7F];
+        for (int row = 0; row < FONT_HEIGHT; row++)
+            for (int col = 0; col < FONT_WIDTH; col++)
+                fb_putpixel(i * FONT_WIDTH + col, row,
+                            (glyph[row] & (1u << (7 - col))) ? 0xFFFFFFFFu : 0xFF000000u);
+    }
+}
+
+static void bench_font_buf_pixel_run(void *state)
+{
+    bench_font_t *b = (bench_font_t *)state;
+    const font_surface_t *s = &b->buf;
+    for (int i = 0; i < FONT_BENCH_COLS; i++) {
+        const uint8_t *glyph = font_8x8[(unsigned char)b->line[i] & 0x7F];
+        for (int row = 0; row < FONT_HEIGHT; row++) {
+            if (row >= s->height)
+                continue;
+            for (int col = 0; col < FONT_WIDTH; col++) {
+                int px = i * FONT_WIDTH + col;
+                if (px >= s->width)
+                    continue;
+                if (glyph[row] & (1u << (7 - col)))
+                    s->pixels[row * s->pitch + px] = 0xFFFFFFFFu;
+            }
+        }
+    }
+}
+
+static void bench_font_fb_cached_run(void *state)
+{
+    bench_font_t *b = (bench_font_t *)state;
+    font_draw_text(&b->fb, 0, 0, b->line, FONT_BENCH_COLS, 0xFFFFFFFFu, 0xFF000000u);
+}
+
+static void bench_font_buf_span_run(void *state)
+{
+    bench_font_t *b = (bench_font_t *)state;
+    font_draw_text_mask(&b->buf, 0, 0, b->line, FONT_BENCH_COLS, 0xFFFFFFFFu);
+}
+
+#define BENCH_FONT_BYTES (FONT_BENCH_COLS * FONT_WIDTH * FONT_HEIGHT * 4)
+
+BENCH_CASE(font, fb_pixel, .iters = 256, .warmup = 8, .bytes = BENCH_FONT_BYTES,
+           .setup = bench_font_setup, .run = bench_font_fb_pixel_run,
+           .teardown = bench_font_teardown);
+BENCH_CASE(font, fb_cached, .iters = 256, .warmup = 8, .bytes = BENCH_FONT_BYTES,
+           .setup = bench_font_setup, .run = bench_font_fb_cached_run,
+           .teardown = bench_font_teardown);
+BENCH_CASE(font, buf_pixel, .iters = 256, .warmup = 8, .bytes = BENCH_FONT_BYTES,
+           .setup = bench_font_setup, .run = bench_font_buf_pixel_run,
+           .teardown = bench_font_teardown);
+BENCH_CASE(font, buf_span, .iters = 256, .warmup = 8, .bytes = BENCH_FONT_BYTES,
+           .setup = bench_font_setup, .run = bench_font_buf_span_run,
+           .teardown = bench_font_teardown);
+
+/* ---- FAT32: open + sequential read + close of a 256 KiB file ------------ */
+
+#define BENCH_FAT_PATH  "/disk/BENCH.DAT"
+#define BENCH_FAT_SIZE  (256u * 1024u)
+#define BENCH_FAT_CHUNK 4096u
+
+static int bench_fat_setup(void **state)
+{
+    vfs_stat_t st;
+    uint8_t *buf = (uint8_t *)kmalloc(BENCH_FAT_CHUNK);
+    int fd;
+
+    if (!buf)
+        return -1;
+    if (vfs_stat(BENCH_FAT_PATH, &st) != 0 || st.size != BENCH_FAT_SIZE) {
+        fd = vfs_open_flags(BENCH_FAT_PATH, VFS_O_WRONLY | VFS_O_CREAT | VFS_O_TRUNC);
+        if (fd < 0) {
+            kfree(buf);
+            return -1;
+        }
+        for (uint32_t off = 0; off < BENCH_FAT_SIZE; off += BENCH_FAT_CHUNK) {
+            k_memset(buf, (int)(off >> 12), BENCH_FAT_CHUNK);
+            vfs_write(fd, buf, BENCH_FAT_CHUNK);
+        }
+        vfs_close(fd);
+        if (vfs_stat(BENCH_FAT_PATH, &st) != 0 || st.size != BENCH_FAT_SIZE) {
+            kfree(buf);
+            return -1;
+        }
+    }
+    *state = buf;
+    return 0;
+}
+
+static void bench_fat_run(void *state)
+{
+    int fd = vfs_open(BENCH_FAT_PATH);
+    if (fd < 0)
+        return;
+    while (vfs_read(fd, state, BENCH_FAT_CHUNK) == BENCH_FAT_CHUNK)
+        ;
+    vfs_close(fd);
+}
+
+static void bench_fat_teardown(void *state)
+{
+    kfree(state);
+}
+
+BENCH_CASE(fat32, seq_read_256k, .iters = 20, .warmup = 2,
+           .bytes = BENCH_FAT_SIZE,
+           .setup = bench_fat_setup, .run = bench_fat_run,
+           .teardown = bench_fat_teardown);
+
+/* ---- SHM: attach + detach of a 64 KiB segment --------------------------- */
+
+static int bench_shm_setup(void **state)
+{
+    int id = shm_create(64u * 1024u);
+    if (id < 0)
+        return -1;
+    *state = (void *)(intptr_t)id;
+    return 0;
+}
+
+static void bench_shm_run(void *state)
+{
+    void *p = shm_attach((int)(intptr_t)state);
+    if (p)
+        shm_detach(p);
+}
+
+static void bench_shm_teardown(void *state)
+{
+    shm_destroy((int)(intptr_t)state);
+}
+
+BENCH_CASE(shm, attach_detach_64k, .iters = 500, .warmup = 20,
+           .setup = bench_shm_setup, .run = bench_shm_run,
+           .teardown = bench_shm_teardown);
@@ -0,0 +1,354 @@
+/*
+ * klog.c - Lock-free per-CPU kernel log ring with deferred serial drain.
+ *
+ * Writers reserve a slot with one atomic add on their CPU's ring head, fill
+ * it and publish it by storing (position + 1) into the slot tag.  A single
+ * drainer (serialised by a trylock, never spun on) merges the rings in
+ * sequence order and feeds COM1:
+ *   - sync mode  (boot, panic): bytes go out through blocking serial_putc
+ *   - async mode (after klog_start_async): up to SERIAL_FIFO_DEPTH bytes per
+ *     THRE interrupt, with the PIT tick as a backstop
+ * When the UART falls behind, the oldest records are overwritten and
+ * counted as dropped; /sys/klog still shows the retained history.
+ */
+
+#include "../include/klog.h"
+#include "../include/kutils.h"
+#include "../include/spinlock.h"
+#include "../include/tsc.h"
+#include "../drv/irq.h"
+#include "../drv/pic.h"
+#include "../drv/pit.h"
+#include "../drv/serial.h"
+
+#ifdef __x86_64__
+#include "../include/smp.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KLOG_RING_MASK  (KLOG_RING_RECORDS - 1u)
+
+typedef struct klog_slot {
+    volatile uint32_t tag;          /* position + 1 once published, 0 while busy */
+    klog_record_t rec;
+} klog_slot_t;
+
+typedef struct klog_ring {
+    volatile uint32_t head;         /* next position to reserve */
+    uint32_t drain_pos;             /* drainer cursor (drain lock) */
+    klog_slot_t slots[KLOG_RING_RECORDS];
+} klog_ring_t;
+
+static klog_ring_t g_rings[KLOG_MAX_CPUS];
+static volatile uint32_t g_next_seq;
+
+static spinlock_t g_drain_lock = SPINLOCK_INIT;
+static volatile int g_async;
+static uint32_t g_dropped;
+static uint32_t g_drain_irqs;
+
+/* Record currently being emitted by the drainer (drain lock). */
+static char g_cur_text[KLOG_TEXT_MAX];
+static uint16_t g_cur_len;
+static uint16_t g_cur_off;
+static int g_cur_cr_sent;
+
+static uint32_t klog_cpu_id(void)
+{
+#ifdef __x86_64__
+    return smp_this_cpu_id() % KLOG_MAX_CPUS;
+#else
+    return 0;
+#endif
+}
+
+static void klog_commit(const char *text, size_t len)
+{
+    klog_ring_t *ring = &g_rings[klog_cpu_id()];
+    uint32_t pos = __atomic_fetch_add(&ring->head, 1u, __ATOMIC_RELAXED);
+    klog_slot_t *slot = &ring->slots[pos & KLOG_RING_MASK];
+
+    __atomic_store_n(&slot->tag, 0u, __ATOMIC_RELAXED);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    slot->rec.seq = __atomic_fetch_add(&g_next_seq, 1u, __ATOMIC_RELAXED);
+    slot->rec.cpu = (uint16_t)klog_cpu_id();
+    slot->rec.len = (uint16_t)len;
+    slot->rec.ticks = pit_ticks();
+    slot->rec.tsc = tsc_read();
+    k_memcpy(slot->rec.text, text, len);
+
+    __atomic_store_n(&slot->tag, pos + 1u, __ATOMIC_RELEASE);
+}
+
+/*
+ * Inspect ring position `pos`.  Returns 1 and the record's sequence number
+ * when published, 0 when the writer has not finished yet and -1 when the
+ * slot has already been reused by a newer record.
+ */
+static int klog_slot_peek(const klog_ring_t *ring, uint32_t pos, uint32_t *seq_out)
+{
+    const klog_slot_t *slot = &ring->slots[pos & KLOG_RING_MASK];
+    uint32_t tag = __atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE);
+    uint32_t seq;
+
+    if (tag != pos + 1u)
+        return (tag == 0u || (int32_t)(tag - (pos + 1u)) < 0) ? 0 : -1;
+    seq = slot->rec.seq;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE) != tag)
+        return -1;
+    *seq_out = seq;
+    return 1;
+}
+
+/* Copy a published record out; same return convention as klog_slot_peek. */
+static int klog_slot_read(const klog_ring_t *ring, uint32_t pos, klog_record_t *out)
+{
+    const klog_slot_t *slot = &ring->slots[pos & KLOG_RING_MASK];
+    uint32_t tag = __atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE);
+
+    if (tag != pos + 1u)
+        return (tag == 0u || (int32_t)(tag - (pos + 1u)) < 0) ? 0 : -1;
+    out->seq = slot->rec.seq;
+    out->cpu = slot->rec.cpu;
+    out->len = slot->rec.len;
+    out->ticks = slot->rec.ticks;
+    out->tsc = slot->rec.tsc;
+    if (out->len > KLOG_TEXT_MAX)
+        out->len = KLOG_TEXT_MAX;
+    k_memcpy(out->text, slot->rec.text, out->len);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE) != tag)
+        return -1;
+    return 1;
+}
+
+/*
+ * Pick the ring whose next record (from cursors[]) has the lowest sequence
+ * number.  Lost records advance the cursor; returns -1 when nothing is ready.
+ */
+static int klog_pick_next(uint32_t *cursors, uint32_t *lost)
+{
+    int best = -1;
+    uint32_t best_seq = 0;
+
+    for (int cpu = 0; cpu < KLOG_MAX_CPUS; cpu++) {
+        const klog_ring_t *ring = &g_rings[cpu];
+        for (;;) {
+            uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            uint32_t seq = 0;
+            int rc;
+
+            if (cursors[cpu] == head)
+                break;
+            if (head - cursors[cpu] > KLOG_RING_RECORDS) {
+                if (lost)
+                    *lost += head - cursors[cpu] - KLOG_RING_RECORDS;
+                cursors[cpu] = head - KLOG_RING_RECORDS;
+            }
+            rc = klog_slot_peek(ring, cursors[cpu], &seq);
+            if (rc == 0)
+                break;
+            if (rc < 0) {
+                if (lost)
+                    (*lost)++;
+                cursors[cpu]++;
+                continue;
+            }
+            if (best < 0 || (int32_t)(seq - best_seq) < 0) {
+                best = cpu;
+                best_seq = seq;
+            }
+            break;
+        }
+    }
+    return best;
+}
+
+static int klog_pending(void)
+{
+    for (int cpu = 0; cpu < KLOG_MAX_CPUS; cpu++) {
+        if (g_rings[cpu].drain_pos != __atomic_load_n(&g_rings[cpu].head, __ATOMIC_ACQUIRE))
+            return 1;
+    }
+    return 0;
+}
+
+/* Load the next record into the emit buffer.  Caller holds the drain lock. */
+static int klog_drain_fetch(void)
+{
+    uint32_t cursors[KLOG_MAX_CPUS];
+    klog_record_t rec;
+
+    for (;;) {
+        int cpu;
+        int rc;
+
+        for (int i = 0; i < KLOG_MAX_CPUS; i++)
+            cursors[i] = g_rings[i].drain_pos;
+        cpu = klog_pick_next(cursors, &g_dropped);
+        for (int i = 0; i < KLOG_MAX_CPUS; i++)
+            g_rings[i].drain_pos = cursors[i];
+        if (cpu < 0)
+            return 0;
+
+        rc = klog_slot_read(&g_rings[cpu], g_rings[cpu].drain_pos, &rec);
+        if (rc == 0)
+            return 0;
+        g_rings[cpu].drain_pos++;
+        if (rc < 0) {
+            g_dropped++;
+            continue;
+        }
+        k_memcpy(g_cur_text, rec.text, rec.len);
+        g_cur_len = rec.len;
+        g_cur_off = 0;
+        g_cur_cr_sent = 0;
+        return 1;
+    }
+}
+
+/*
+ * Push pending text to the UART.  In sync mode everything is written with
+ * blocking serial_putc; otherwise at most one FIFO's worth is queued.
+ * Returns non-zero when output remains.
+ */
+static int klog_drain_locked(int sync)
+{
+    int budget = SERIAL_FIFO_DEPTH;
+
+    if (!sync && !serial_tx_ready())
+        return 1;
+
+    for (;;) {
+        char c;
+
+        if (g_cur_off >= g_cur_len && !klog_drain_fetch())
+            return klog_pending();
+        if (!sync && budget == 0)
+            return 1;
+
+        c = g_cur_text[g_cur_off];
+        if (sync) {
+            serial_putc(c);
+            g_cur_off++;
+            continue;
+        }
+        if (c == '\n' && !g_cur_cr_sent) {
+            serial_tx_raw('\r');
+            g_cur_cr_sent = 1;
+            budget--;
+            continue;
+        }
+        serial_tx_raw((uint8_t)c);
+        g_cur_cr_sent = 0;
+        g_cur_off++;
+        budget--;
+    }
+}
+
+/*
+ * Drain if nobody else is.  A writer that loses the trylock leaves its
+ * record to the current holder, which re-checks for late arrivals after
+ * releasing the lock.
+ */
+static void klog_service(int sync)
+{
+    while (spin_trylock(&g_drain_lock)) {
+        int more = klog_drain_locked(sync);
+        if (!sync)
+            serial_set_tx_irq(more);
+        spin_unlock(&g_drain_lock);
+        if (!klog_pending() || (!sync && more))
+            break;
+    }
+}
+
+static void klog_serial_irq(uint8_t irq, void *ctx)
+{
+    (void)irq;
+    (void)ctx;
+    serial_ack_irq();
+    g_drain_irqs++;
+    klog_service(0);
+}
+
+void klog_write(const char *text, size_t len)
+{
+    if (!text)
+        return;
+    while (len > 0) {
+        size_t n = (len > KLOG_TEXT_MAX) ? KLOG_TEXT_MAX : len;
+        klog_commit(text, n);
+        text += n;
+        len -= n;
+    }
+    klog_service(!g_async);
+}
+
+void klog_start_async(void)
+{
+    if (g_async)
+        return;
+    if (irq_register_handler(SERIAL_COM1_IRQ, klog_serial_irq, NULL) != 0)
+        return;
+    pic_unmask_irq(SERIAL_COM1_IRQ);
+    g_async = 1;
+    klog_service(0);
+}
+
+void klog_poll(void)
+{
+    if (g_async && klog_pending())
+        klog_service(0);
+}
+
+void klog_panic(void)
+{
+    g_async = 0;
+    serial_set_tx_irq(0);
+    /* The holder may be the context we interrupted; it will never finish. */
+    spin_unlock(&g_drain_lock);
+    klog_service(1);
+}
+
+void klog_iter_init(klog_iter_t *it)
+{
+    if (!it)
+        return;
+    for (int cpu = 0; cpu < KLOG_MAX_CPUS; cpu++) {
+        uint32_t head = __atomic_load_n(&g_rings[cpu].head, __ATOMIC_ACQUIRE);
+        it->pos[cpu] = (head > KLOG_RING_RECORDS) ? head - KLOG_RING_RECORDS : 0u;
+    }
+}
+
+int klog_iter_next(klog_iter_t *it, klog_record_t *out)
+{
+    if (!it || !out)
+        return 0;
+    for (;;) {
+        int cpu = klog_pick_next(it->pos, NULL);
+        int rc;
+        if (cpu < 0)
+            return 0;
+        rc = klog_slot_read(&g_rings[cpu], it->pos[cpu], out);
+        if (rc == 0)
+            return 0;
+        it->pos[cpu]++;
+        if (rc > 0)
+            return 1;
+    }
+}
+
+void klog_get_stats(klog_stats_t *out)
+{
+    if (!out)
+        return;
+    out->next_seq = g_next_seq;
+    out->dropped = g_dropped;
+    out->drain_irqs = g_drain_irqs;
+    out->async = g_async;
+}
@@ -1,6 +1,7 @@
 /*
  * kprintf.c - Freestanding kernel printf implementation.
- * Outputs via serial_putc (COM1).
+ * Output is staged into records on the kernel log ring (lib/klog.c), which
+ * drains to COM1 synchronously at boot and from IRQ4 afterwards.
  *
  * Supported format specifiers:
  *   %d / %i  - signed decimal
@@ -14,18 +15,11 @@
  */
 
 #include "../include/kprintf.h"
-#include "../drv/serial.h"
+#include "../include/klog.h"
 #include <stdint.h>
 #include <stdarg.h>
 #include <stddef.h>
 
-/* ---- low-level output -------------------------------------------------- */
-
-static void out_char(char c)
-{
-    serial_putc(c);
-}
-
 /* ---- integer rendering ------------------------------------------------- */
 
 static const char hex_lower[] = "0123456789abcdef";
@@ -153,32 +147,48 @@ static int do_fmt(fmt_ctx_t *f, const char *fmt, va_list ap)
     return f->count;
 }
 
-/* ---- serial output context -------------------------------------------- */
+/* ---- log ring output context ------------------------------------------ */
 
-static void serial_put(void *ctx, char c)
+typedef struct {
+    char   buf[KLOG_TEXT_MAX];
+    size_t pos;
+} lbuf_t;
+
+static void lbuf_put(void *ctx, char c)
 {
-    (void)ctx;
-    out_char(c);
+    lbuf_t *l = (lbuf_t *)ctx;
+    if (l->pos == sizeof(l->buf)) {
+        klog_write(l->buf, l->pos);
+        l->pos = 0;
+    }
+    l->buf[l->pos++] = c;
 }
 
 int kprintf(const char *fmt, ...)
 {
+    lbuf_t lb;
     fmt_ctx_t f;
-    f.put   = serial_put;
-    f.ctx   = NULL;
+    lb.pos  = 0;
+    f.put   = lbuf_put;
+    f.ctx   = &lb;
     f.count = 0;
     va_list ap;
     va_start(ap, fmt);
     int n = do_fmt(&f, fmt, ap);
     va_end(ap);
+    if (lb.pos)
+        klog_write(lb.buf, lb.pos);
     return n;
 }
 
 void kputs(const char *s)
 {
+    lbuf_t lb;
     if (!s) return;
-    while (*s) out_char(*s++);
-    out_char('\n');
+    lb.pos = 0;
+    while (*s) lbuf_put(&lb, *s++);
+    lbuf_put(&lb, '\n');
+    klog_write(lb.buf, lb.pos);
 }
 
 /* ---- ksprintf ---------------------------------------------------------- */
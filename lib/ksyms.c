@@ -0,0 +1,51 @@
+/*
+ * ksyms.c - Address to function lookup over the link-time symbol table.
+ */
+
+#include "../include/ksyms.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Defined by the generated ksyms_gen.c in the final link.  The first pass
+ * (and the i386 kernel) links without it, so both resolve to NULL there.
+ */
+extern const ksym_t g_ksyms[] __attribute__((weak));
+extern const uint32_t g_ksyms_count __attribute__((weak));
+
+uint32_t ksym_count(void)
+{
+    if (!g_ksyms || !&g_ksyms_count)
+        return 0;
+    return g_ksyms_count;
+}
+
+const ksym_t *ksym_at(uint32_t index)
+{
+    if (index >= ksym_count())
+        return NULL;
+    return &g_ksyms[index];
+}
+
+int ksym_lookup(uintptr_t addr)
+{
+    uint32_t lo = 0;
+    uint32_t hi = ksym_count();
+    const ksym_t *sym;
+
+    /* Last symbol whose address is <= addr. */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (g_ksyms[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return -1;
+    sym = &g_ksyms[lo - 1];
+    if (sym->size != 0 && addr - sym->addr >= sym->size)
+        return -1;
+    return (int)(lo - 1);
+}
@@ -1,24 +1,20 @@
 #include "kutils.h"
+#include "memops.h"
 
 void k_memset(void *dest, int val, size_t len) {
-    unsigned char *ptr = dest;
-    while (len--) {
-        *ptr++ = (unsigned char)val;
-    }
+    memops_set(dest, val, len);
 }
 
 void k_memcpy(void *dest, const void *src, size_t len) {
-    unsigned char *d = dest;
-    const unsigned char *s = src;
-    while (len--) {
-        *d++ = *s++;
-    }
+    memops_copy(dest, src, len);
+}
+
+void k_memmove(void *dest, const void *src, size_t len) {
+    memops_move(dest, src, len);
 }
 
 size_t k_strlen(const char *str) {
-    const char *s = str;
-    while (*s) ++s;
-    return (size_t)(s - str);
+    return memops_strlen(str);
 }
 
 int k_strcmp(const char *s1, const char *s2) {
@@ -0,0 +1,380 @@
+/*
+ * memops.c - Shared memory/string primitives for the kernel and user libc.
+ *
+ * Built into the kernel (COMMON_OBJS) and into the standalone user SDK.
+ * Loops here must not be turned back into memcpy/memset calls by the
+ * optimiser, since memcpy/memset themselves call into this file.
+ */
+
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+
+#include "../include/memops.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Below this size the inline word path beats any bulk setup cost. */
+#define MEMOPS_SMALL 64u
+
+typedef uintptr_t memops_word_t;
+/* Word views of arbitrary memory: aligned stores, possibly unaligned loads. */
+typedef memops_word_t __attribute__((may_alias)) memops_aword_t;
+typedef memops_word_t __attribute__((may_alias, aligned(1))) memops_uword_t;
+
+#define MEMOPS_WORD ((size_t)sizeof(memops_word_t))
+#define MEMOPS_ONES ((memops_word_t)-1 / 0xFFu)
+#define MEMOPS_HIGHS (MEMOPS_ONES * 0x80u)
+
+static int g_impl = -1;
+
+/* ---- CPU feature detection ---------------------------------------------- */
+
+static void memops_cpuid(uint32_t leaf, uint32_t sub, uint32_t *a, uint32_t *b,
+                         uint32_t *c, uint32_t *d)
+{
+    __asm__ volatile("cpuid"
+                     : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                     : "a"(leaf), "c"(sub));
+}
+
+static int memops_cpu_has_erms(void)
+{
+    uint32_t a, b, c, d;
+    memops_cpuid(0, 0, &a, &b, &c, &d);
+    if (a < 7)
+        return 0;
+    memops_cpuid(7, 0, &a, &b, &c, &d);
+    return (b & (1u << 9)) ? 1 : 0;
+}
+
+#ifdef __SSE2__
+static int memops_cpu_has_sse2(void)
+{
+    uint32_t a, b, c, d;
+    memops_cpuid(1, 0, &a, &b, &c, &d);
+    return (d & (1u << 26)) ? 1 : 0;
+}
+#endif
+
+int memops_impl_supported(int impl)
+{
+    switch (impl) {
+    case MEMOPS_IMPL_BYTE:
+    case MEMOPS_IMPL_WORD:
+        return 1;
+    case MEMOPS_IMPL_ERMS:
+        return memops_cpu_has_erms();
+    case MEMOPS_IMPL_SSE2:
+#ifdef __SSE2__
+        return memops_cpu_has_sse2();
+#else
+        return 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+static int memops_current(void)
+{
+    if (g_impl < 0) {
+        if (memops_impl_supported(MEMOPS_IMPL_ERMS))
+            g_impl = MEMOPS_IMPL_ERMS;
+        else if (memops_impl_supported(MEMOPS_IMPL_SSE2))
+            g_impl = MEMOPS_IMPL_SSE2;
+        else
+            g_impl = MEMOPS_IMPL_WORD;
+    }
+    return g_impl;
+}
+
+int memops_impl_active(void)
+{
+    return memops_current();
+}
+
+const char *memops_impl_name(int impl)
+{
+    switch (impl) {
+    case MEMOPS_IMPL_BYTE: return "byte";
+    case MEMOPS_IMPL_WORD: return "word";
+    case MEMOPS_IMPL_ERMS: return "erms";
+    case MEMOPS_IMPL_SSE2: return "sse2";
+    default: return "?";
+    }
+}
+
+/* ---- copy --------------------------------------------------------------- */
+
+static void copy_bytes(uint8_t *d, const uint8_t *s, size_t n)
+{
+    while (n--)
+        *d++ = *s++;
+}
+
+/* Forward word copy; safe for overlapping moves with dst < src. */
+static void copy_words(uint8_t *d, const uint8_t *s, size_t n)
+{
+    while (n > 0 && ((uintptr_t)d & (MEMOPS_WORD - 1)) != 0) {
+        *d++ = *s++;
+        n--;
+    }
+    while (n >= 4 * MEMOPS_WORD) {
+        memops_word_t w0 = ((const memops_uword_t *)s)[0];
+        memops_word_t w1 = ((const memops_uword_t *)s)[1];
+        memops_word_t w2 = ((const memops_uword_t *)s)[2];
+        memops_word_t w3 = ((const memops_uword_t *)s)[3];
+        ((memops_aword_t *)d)[0] = w0;
+        ((memops_aword_t *)d)[1] = w1;
+        ((memops_aword_t *)d)[2] = w2;
+        ((memops_aword_t *)d)[3] = w3;
+        d += 4 * MEMOPS_WORD;
+        s += 4 * MEMOPS_WORD;
+        n -= 4 * MEMOPS_WORD;
+    }
+    while (n >= MEMOPS_WORD) {
+        *(memops_aword_t *)d = *(const memops_uword_t *)s;
+        d += MEMOPS_WORD;
+        s += MEMOPS_WORD;
+        n -= MEMOPS_WORD;
+    }
+    copy_bytes(d, s, n);
+}
+
+static void copy_erms(uint8_t *d, const uint8_t *s, size_t n)
+{
+    __asm__ volatile("rep movsb"
+                     : "+D"(d), "+S"(s), "+c"(n)
+                     :
+                     : "memory");
+}
+
+#ifdef __SSE2__
+typedef char memops_v16_t __attribute__((vector_size(16), may_alias, aligned(1)));
+typedef char memops_v16a_t __attribute__((vector_size(16), may_alias));
+
+static void copy_sse2(uint8_t *d, const uint8_t *s, size_t n)
+{
+    while (n > 0 && ((uintptr_t)d & 15u) != 0) {
+        *d++ = *s++;
+        n--;
+    }
+    while (n >= 64) {
+        memops_v16_t v0 = ((const memops_v16_t *)s)[0];
+        memops_v16_t v1 = ((const memops_v16_t *)s)[1];
+        memops_v16_t v2 = ((const memops_v16_t *)s)[2];
+        memops_v16_t v3 = ((const memops_v16_t *)s)[3];
+        ((memops_v16a_t *)d)[0] = v0;
+        ((memops_v16a_t *)d)[1] = v1;
+        ((memops_v16a_t *)d)[2] = v2;
+        ((memops_v16a_t *)d)[3] = v3;
+        d += 64;
+        s += 64;
+        n -= 64;
+    }
+    copy_words(d, s, n);
+}
+#endif
+
+static void copy_bulk(int impl, uint8_t *d, const uint8_t *s, size_t n)
+{
+    switch (impl) {
+    case MEMOPS_IMPL_BYTE:
+        copy_bytes(d, s, n);
+        break;
+    case MEMOPS_IMPL_ERMS:
+        copy_erms(d, s, n);
+        break;
+#ifdef __SSE2__
+    case MEMOPS_IMPL_SSE2:
+        copy_sse2(d, s, n);
+        break;
+#endif
+    default:
+        copy_words(d, s, n);
+        break;
+    }
+}
+
+static void copy_with(int impl, void *dst, const void *src, size_t n)
+{
+    if (n < MEMOPS_SMALL && impl != MEMOPS_IMPL_BYTE)
+        copy_words((uint8_t *)dst, (const uint8_t *)src, n);
+    else
+        copy_bulk(impl, (uint8_t *)dst, (const uint8_t *)src, n);
+}
+
+void memops_copy(void *dst, const void *src, size_t n)
+{
+    copy_with(memops_current(), dst, src, n);
+}
+
+static void copy_words_backward(uint8_t *d, const uint8_t *s, size_t n)
+{
+    d += n;
+    s += n;
+    while (n > 0 && ((uintptr_t)d & (MEMOPS_WORD - 1)) != 0) {
+        *--d = *--s;
+        n--;
+    }
+    while (n >= MEMOPS_WORD) {
+        d -= MEMOPS_WORD;
+        s -= MEMOPS_WORD;
+        *(memops_aword_t *)d = *(const memops_uword_t *)s;
+        n -= MEMOPS_WORD;
+    }
+    while (n--)
+        *--d = *--s;
+}
+
+void memops_move(void *dst, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (d == s || n == 0)
+        return;
+    if (d >= s + n || s >= d + n)
+        memops_copy(d, s, n);
+    else if (d < s)
+        copy_words(d, s, n);    /* loads each word before storing it */
+    else
+        copy_words_backward(d, s, n);
+}
+
+/* ---- set ---------------------------------------------------------------- */
+
+static void set_words(uint8_t *d, uint8_t c, size_t n)
+{
+    memops_word_t w = MEMOPS_ONES * c;
+
+    while (n > 0 && ((uintptr_t)d & (MEMOPS_WORD - 1)) != 0) {
+        *d++ = c;
+        n--;
+    }
+    while (n >= 4 * MEMOPS_WORD) {
+        ((memops_aword_t *)d)[0] = w;
+        ((memops_aword_t *)d)[1] = w;
+        ((memops_aword_t *)d)[2] = w;
+        ((memops_aword_t *)d)[3] = w;
+        d += 4 * MEMOPS_WORD;
+        n -= 4 * MEMOPS_WORD;
+    }
+    while (n >= MEMOPS_WORD) {
+        *(memops_aword_t *)d = w;
+        d += MEMOPS_WORD;
+        n -= MEMOPS_WORD;
+    }
+    while (n--)
+        *d++ = c;
+}
+
+static void set_bulk(int impl, uint8_t *d, uint8_t c, size_t n)
+{
+    switch (impl) {
+    case MEMOPS_IMPL_BYTE:
+        while (n--)
+            *d++ = c;
+        break;
+    case MEMOPS_IMPL_ERMS:
+        __asm__ volatile("rep stosb"
+                         : "+D"(d), "+c"(n)
+                         : "a"(c)
+                         : "memory");
+        break;
+#ifdef __SSE2__
+    case MEMOPS_IMPL_SSE2:
+    {
+        memops_v16a_t v = {
+            (char)c, (char)c, (char)c, (char)c, (char)c, (char)c, (char)c, (char)c,
+            (char)c, (char)c, (char)c, (char)c, (char)c, (char)c, (char)c, (char)c
+        };
+        while (n > 0 && ((uintptr_t)d & 15u) != 0) {
+            *d++ = c;
+            n--;
+        }
+        while (n >= 64) {
+            ((memops_v16a_t *)d)[0] = v;
+            ((memops_v16a_t *)d)[1] = v;
+            ((memops_v16a_t *)d)[2] = v;
+            ((memops_v16a_t *)d)[3] = v;
+            d += 64;
+            n -= 64;
+        }
+        set_words(d, c, n);
+        break;
+    }
+#endif
+    default:
+        set_words(d, c, n);
+        break;
+    }
+}
+
+static void set_with(int impl, void *dst, int c, size_t n)
+{
+    if (n < MEMOPS_SMALL && impl != MEMOPS_IMPL_BYTE)
+        set_words((uint8_t *)dst, (uint8_t)c, n);
+    else
+        set_bulk(impl, (uint8_t *)dst, (uint8_t)c, n);
+}
+
+void memops_set(void *dst, int c, size_t n)
+{
+    set_with(memops_current(), dst, c, n);
+}
+
+/* ---- per-implementation entry points ------------------------------------ */
+
+static void copy_byte_impl(void *d, const void *s, size_t n) { copy_with(MEMOPS_IMPL_BYTE, d, s, n); }
+static void copy_word_impl(void *d, const void *s, size_t n) { copy_with(MEMOPS_IMPL_WORD, d, s, n); }
+static void copy_erms_impl(void *d, const void *s, size_t n) { copy_with(MEMOPS_IMPL_ERMS, d, s, n); }
+static void set_byte_impl(void *d, int c, size_t n) { set_with(MEMOPS_IMPL_BYTE, d, c, n); }
+static void set_word_impl(void *d, int c, size_t n) { set_with(MEMOPS_IMPL_WORD, d, c, n); }
+static void set_erms_impl(void *d, int c, size_t n) { set_with(MEMOPS_IMPL_ERMS, d, c, n); }
+#ifdef __SSE2__
+static void copy_sse2_impl(void *d, const void *s, size_t n) { copy_with(MEMOPS_IMPL_SSE2, d, s, n); }
+static void set_sse2_impl(void *d, int c, size_t n) { set_with(MEMOPS_IMPL_SSE2, d, c, n); }
+#endif
+
+static const memops_ops_t g_impl_ops[MEMOPS_IMPL_COUNT] = {
+    [MEMOPS_IMPL_BYTE] = { copy_byte_impl, set_byte_impl },
+    [MEMOPS_IMPL_WORD] = { copy_word_impl, set_word_impl },
+    [MEMOPS_IMPL_ERMS] = { copy_erms_impl, set_erms_impl },
+#ifdef __SSE2__
+    [MEMOPS_IMPL_SSE2] = { copy_sse2_impl, set_sse2_impl },
+#endif
+};
+
+const memops_ops_t *memops_impl_ops(int impl)
+{
+    if (!memops_impl_supported(impl) || !g_impl_ops[impl].copy)
+        return NULL;
+    return &g_impl_ops[impl];
+}
+
+/* ---- strlen ------------------------------------------------------------- */
+
+size_t memops_strlen(const char *s)
+{
+    const char *p = s;
+    const memops_aword_t *w;
+
+    /* Aligned word reads never cross into an unmapped page. */
+    while (((uintptr_t)p & (MEMOPS_WORD - 1)) != 0) {
+        if (*p == '\0')
+            return (size_t)(p - s);
+        p++;
+    }
+    w = (const memops_aword_t *)(const void *)p;
+    for (;;) {
+        memops_word_t v = *(const volatile memops_aword_t *)w;
+        if (((v - MEMOPS_ONES) & ~v & MEMOPS_HIGHS) != 0)
+            break;
+        w++;
+    }
+    p = (const char *)w;
+    while (*p)
+        p++;
+    return (size_t)(p - s);
+}
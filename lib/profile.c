@@ -0,0 +1,236 @@
+/*
+ * profile.c - Timer-driven sampling profiler.
+ *
+ * Each CPU owns a ring of (rip, pid) samples written only from its own
+ * profiling interrupt, so recording needs no locks.  Rings are allocated
+ * on the first start and keep the most recent PROFILE_CPU_SAMPLES samples.
+ * Symbolisation happens at read time.
+ */
+
+#include "../include/profile.h"
+#include "../include/ksyms.h"
+#include "../include/kutils.h"
+#include "../mm/heap.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __x86_64__
+
+#include "../drv/pit.h"
+#include "../include/lapic.h"
+#include "../include/smp.h"
+#include "../proc/process.h"
+
+#define PROFILE_USER_PIDS 16
+
+/* isr.asm IRQ frame: 15 GPRs, vector, then the CPU's rip, cs, rflags. */
+#define PROFILE_FRAME_RIP 16
+#define PROFILE_FRAME_CS  17
+
+typedef struct profile_sample {
+    uint64_t rip;
+    uint32_t pid;
+    uint32_t user;
+} profile_sample_t;
+
+typedef struct profile_cpu {
+    volatile uint32_t head;
+    profile_sample_t *samples;
+} profile_cpu_t;
+
+static profile_cpu_t g_profile_cpus[PROFILE_MAX_CPUS];
+static volatile int g_profile_source;
+static uint32_t g_profile_hz;
+
+static int profile_alloc_buffers(void)
+{
+    for (int cpu = 0; cpu < PROFILE_MAX_CPUS; cpu++) {
+        if (g_profile_cpus[cpu].samples)
+            continue;
+        g_profile_cpus[cpu].samples =
+            (profile_sample_t *)kmalloc(PROFILE_CPU_SAMPLES * sizeof(profile_sample_t));
+        if (!g_profile_cpus[cpu].samples)
+            return -1;
+    }
+    return 0;
+}
+
+uint32_t profile_start(uint32_t hz)
+{
+    uint32_t got;
+
+    profile_stop();
+    if (profile_alloc_buffers() != 0)
+        return 0;
+    for (int cpu = 0; cpu < PROFILE_MAX_CPUS; cpu++)
+        g_profile_cpus[cpu].head = 0;
+
+    if (hz == 0)
+        hz = PROFILE_DEFAULT_HZ;
+    if (hz > PROFILE_MAX_HZ)
+        hz = PROFILE_MAX_HZ;
+
+    got = lapic_timer_start(hz);
+    if (got) {
+        g_profile_hz = got;
+        g_profile_source = PROFILE_SRC_LAPIC;
+        return got;
+    }
+    g_profile_hz = pit_frequency();
+    g_profile_source = g_profile_hz ? PROFILE_SRC_PIT : PROFILE_SRC_NONE;
+    return g_profile_hz;
+}
+
+void profile_stop(void)
+{
+    if (g_profile_source == PROFILE_SRC_LAPIC)
+        lapic_timer_stop();
+    g_profile_source = PROFILE_SRC_NONE;
+}
+
+void profile_sample_irq(int source, uint64_t context_rsp)
+{
+    const uint64_t *ctx = (const uint64_t *)(uintptr_t)context_rsp;
+    profile_cpu_t *pc;
+    profile_sample_t *s;
+    int pid;
+
+    if (source != g_profile_source || source == PROFILE_SRC_NONE || !ctx)
+        return;
+    pc = &g_profile_cpus[smp_this_cpu_id() % PROFILE_MAX_CPUS];
+    if (!pc->samples)
+        return;
+
+    s = &pc->samples[pc->head % PROFILE_CPU_SAMPLES];
+    pid = process_current_pid();
+    s->rip = ctx[PROFILE_FRAME_RIP];
+    s->user = (ctx[PROFILE_FRAME_CS] & 3u) ? 1u : 0u;
+    s->pid = pid > 0 ? (uint32_t)pid : 0u;
+    pc->head++;
+}
+
+/* Count the samples of `pid` in ring 3, in a small pid table. */
+static void profile_count_user(profile_entry_t *users, int *nusers, uint32_t pid)
+{
+    for (int i = 0; i < *nusers; i++) {
+        if (users[i].pid == pid) {
+            users[i].samples++;
+            return;
+        }
+    }
+    if (*nusers >= PROFILE_USER_PIDS)
+        return;
+    users[*nusers].name = "[user]";
+    users[*nusers].addr = 0;
+    users[*nusers].pid = pid;
+    users[*nusers].samples = 1;
+    (*nusers)++;
+}
+
+int profile_snapshot(profile_entry_t *out, int max, profile_info_t *info)
+{
+    uint32_t nsyms = ksym_count();
+    uint32_t *counts = NULL;
+    profile_entry_t users[PROFILE_USER_PIDS];
+    int nusers = 0;
+    profile_info_t tmp;
+    int n = 0;
+
+    k_memset(&tmp, 0, sizeof(tmp));
+    tmp.source = g_profile_source;
+    tmp.running = tmp.source != PROFILE_SRC_NONE;
+    tmp.hz = g_profile_hz;
+    tmp.symbols = nsyms;
+
+    if (out && max > 0 && nsyms > 0) {
+        counts = (uint32_t *)kmalloc(nsyms * sizeof(uint32_t));
+        if (counts)
+            k_memset(counts, 0, nsyms * sizeof(uint32_t));
+    }
+
+    for (int cpu = 0; cpu < PROFILE_MAX_CPUS; cpu++) {
+        const profile_cpu_t *pc = &g_profile_cpus[cpu];
+        uint32_t head = pc->head;
+        uint32_t kept = head < PROFILE_CPU_SAMPLES ? head : PROFILE_CPU_SAMPLES;
+
+        tmp.samples += head;
+        tmp.overwritten += head - kept;
+        if (!pc->samples)
+            continue;
+        for (uint32_t i = head - kept; i != head; i++) {
+            const profile_sample_t *s = &pc->samples[i % PROFILE_CPU_SAMPLES];
+            int sym;
+            if (s->user) {
+                tmp.user_samples++;
+                profile_count_user(users, &nusers, s->pid);
+                continue;
+            }
+            sym = ksym_lookup((uintptr_t)s->rip);
+            if (sym < 0)
+                tmp.unknown_samples++;
+            else if (counts)
+                counts[sym]++;
+        }
+    }
+
+    /* Repeatedly take the largest remaining count; max is small. */
+    while (out && n < max) {
+        uint32_t best = 0;
+        int best_sym = -1;
+        int best_user = -1;
+
+        for (uint32_t i = 0; counts && i < nsyms; i++) {
+            if (counts[i] > best) {
+                best = counts[i];
+                best_sym = (int)i;
+            }
+        }
+        for (int i = 0; i < nusers; i++) {
+            if (users[i].samples > best) {
+                best = users[i].samples;
+                best_sym = -1;
+                best_user = i;
+            }
+        }
+        if (best == 0)
+            break;
+        if (best_user >= 0) {
+            out[n] = users[best_user];
+            users[best_user].samples = 0;
+        } else {
+            const ksym_t *sym = ksym_at((uint32_t)best_sym);
+            out[n].name = sym->name;
+            out[n].addr = sym->addr;
+            out[n].pid = 0;
+            out[n].samples = best;
+            counts[best_sym] = 0;
+        }
+        n++;
+    }
+
+    if (counts)
+        kfree(counts);
+    if (info)
+        *info = tmp;
+    return n;
+}
+
+#else
+
+uint32_t profile_start(uint32_t hz) { (void)hz; return 0; }
+void profile_stop(void) {}
+void profile_sample_irq(int source, uint64_t context_rsp) { (void)source; (void)context_rsp; }
+
+int profile_snapshot(profile_entry_t *out, int max, profile_info_t *info)
+{
+    (void)out;
+    (void)max;
+    if (info) {
+        k_memset(info, 0, sizeof(*info));
+        info->symbols = ksym_count();
+    }
+    return 0;
+}
+
+#endif /* __x86_64__ */
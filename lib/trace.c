@@ -0,0 +1,161 @@
+/*
+ * trace.c - Binary per-CPU trace ring behind the TRACE() tracepoints.
+ *
+ * Same publication scheme as the klog ring: a writer reserves a position
+ * with one atomic add on its CPU's head, fills the slot and publishes it by
+ * storing (position + 1) into the slot tag.  Writers never wait; the ring
+ * simply overwrites its oldest records.  The dumper copies each slot and
+ * re-checks the tag, skipping slots that are mid-write or already reused.
+ */
+
+#include "../include/trace.h"
+#include "../include/kutils.h"
+#include "../include/tsc.h"
+#include "../drv/pit.h"
+#include "../mm/heap.h"
+
+#ifdef __x86_64__
+#include "../include/smp.h"
+#include "../proc/process.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_RING_MASK (TRACE_RING_RECORDS - 1u)
+
+#ifndef TRACE_DEFAULT_MASK
+#define TRACE_DEFAULT_MASK 0u
+#endif
+
+typedef struct trace_slot {
+    volatile uint32_t tag;          /* position + 1 once published, 0 while busy */
+    trace_record_t rec;
+} trace_slot_t;
+
+typedef struct trace_ring {
+    volatile uint32_t head;         /* next position to reserve */
+    volatile uint32_t base;         /* first position still wanted (reset) */
+    trace_slot_t slots[TRACE_RING_RECORDS];
+} trace_ring_t;
+
+volatile uint32_t g_trace_mask = TRACE_DEFAULT_MASK;
+
+static trace_ring_t g_trace_rings[TRACE_MAX_CPUS];
+
+static uint32_t trace_cpu_id(void)
+{
+#ifdef __x86_64__
+    return smp_this_cpu_id() % TRACE_MAX_CPUS;
+#else
+    return 0;
+#endif
+}
+
+static uint32_t trace_current_pid(void)
+{
+#ifdef __x86_64__
+    int pid = process_current_pid();
+    return pid > 0 ? (uint32_t)pid : 0u;
+#else
+    return 0;
+#endif
+}
+
+void trace_emit(uint32_t ev, uint64_t a0, uint64_t a1)
+{
+    uint32_t cpu = trace_cpu_id();
+    trace_ring_t *ring = &g_trace_rings[cpu];
+    uint32_t pos = __atomic_fetch_add(&ring->head, 1u, __ATOMIC_RELAXED);
+    trace_slot_t *slot = &ring->slots[pos & TRACE_RING_MASK];
+
+    __atomic_store_n(&slot->tag, 0u, __ATOMIC_RELAXED);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    slot->rec.tsc = tsc_read();
+    slot->rec.event = (uint16_t)ev;
+    slot->rec.cpu = (uint16_t)cpu;
+    slot->rec.pid = trace_current_pid();
+    slot->rec.arg0 = a0;
+    slot->rec.arg1 = a1;
+
+    __atomic_store_n(&slot->tag, pos + 1u, __ATOMIC_RELEASE);
+}
+
+uint32_t trace_set_mask(uint32_t mask)
+{
+    return __atomic_exchange_n(&g_trace_mask, mask & TRACE_MASK_ALL, __ATOMIC_RELAXED);
+}
+
+void trace_reset(void)
+{
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++) {
+        trace_ring_t *ring = &g_trace_rings[cpu];
+        __atomic_store_n(&ring->base, __atomic_load_n(&ring->head, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+}
+
+/* Oldest position of `ring` that can still be read. */
+static uint32_t trace_ring_start(const trace_ring_t *ring, uint32_t head, uint32_t *dropped)
+{
+    uint32_t base = ring->base;
+    uint32_t oldest = head - TRACE_RING_RECORDS;
+
+    if ((int32_t)(oldest - base) > 0) {
+        *dropped += oldest - base;
+        return oldest;
+    }
+    return base;
+}
+
+int trace_dump(uint8_t **buf_out, size_t *size_out)
+{
+    trace_dump_header_t *hdr;
+    trace_record_t *out;
+    uint32_t count = 0;
+    uint32_t dropped = 0;
+    size_t cap = sizeof(*hdr) + (size_t)TRACE_MAX_CPUS * TRACE_RING_RECORDS * sizeof(*out);
+    uint8_t *buf;
+
+    if (!buf_out || !size_out)
+        return -1;
+    buf = (uint8_t *)kmalloc(cap);
+    if (!buf)
+        return -1;
+    hdr = (trace_dump_header_t *)buf;
+    out = (trace_record_t *)(buf + sizeof(*hdr));
+
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++) {
+        const trace_ring_t *ring = &g_trace_rings[cpu];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t pos = trace_ring_start(ring, head, &dropped);
+
+        for (; pos != head; pos++) {
+            const trace_slot_t *slot = &ring->slots[pos & TRACE_RING_MASK];
+            uint32_t tag = __atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE);
+            if (tag != pos + 1u)
+                continue;
+            out[count] = slot->rec;
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&slot->tag, __ATOMIC_ACQUIRE) != tag) {
+                dropped++;
+                continue;
+            }
+            count++;
+        }
+    }
+
+    hdr->magic = TRACE_DUMP_MAGIC;
+    hdr->version = TRACE_DUMP_VERSION;
+    hdr->record_size = (uint16_t)sizeof(trace_record_t);
+    hdr->tsc_hz = pit_tsc_hz();
+    hdr->record_count = count;
+    hdr->dropped = dropped;
+    hdr->mask = g_trace_mask;
+    hdr->reserved = 0;
+
+    *buf_out = buf;
+    *size_out = sizeof(*hdr) + (size_t)count * sizeof(*out);
+    return 0;
+}
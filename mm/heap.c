@@ -1,5 +1,16 @@
 /*
  * heap.c - Kernel heap backed by TLSF (Two-Level Segregated Fit).
+ *
+ * Small and medium requests come from TLSF pools grown from the PMM on
+ * demand.  A grow pool that becomes completely free is handed back to the
+ * PMM once enough free pool space remains without it.  Requests of
+ * HEAP_DIRECT_MIN bytes or more skip TLSF and take a page run of their own,
+ * so a single large buffer never pins a pool.
+ *
+ * With HEAP_PROFILE set, allocations are also charged to the kmalloc()
+ * caller's return address in a small open-addressed table of call sites.
+ * Mode 1 records a random ~1/HEAP_PROFILE_PERIOD sample of allocations and
+ * costs one counter decrement otherwise; mode 2 records all of them.
  */
 
 #include "heap.h"
@@ -15,20 +26,128 @@
 
 #define HEAP_INIT_PAGES 256
 #define HEAP_GROW_PAGES 32
-#define HEAP_ALLOC_MAGIC 0x4850414C4C4F434FULL
+#define HEAP_DIRECT_MIN (64u * 1024u)
+#define HEAP_RETAIN_BYTES (HEAP_GROW_PAGES * 4096u)
+#define HEAP_ALLOC_MAGIC 0x414C4F43u
+#define HEAP_DIRECT_MAGIC 0x44495243u
+#define HEAP_POOL_MAGIC 0x48504F4F4C484452ULL
+
+/* 0: no call-site tracking, 1: sampled, 2: every allocation. */
+#ifndef HEAP_PROFILE
+#define HEAP_PROFILE 1
+#endif
+#define HEAP_PROFILE_PERIOD 64u     /* power of two */
+#define HEAP_PROFILE_SITES 256u     /* power of two */
 
 typedef struct heap_alloc_header {
-    uint64_t magic;
+    uint32_t magic;
+    uint32_t site;              /* profiled call site + 1, or 0 */
     size_t size;
 } heap_alloc_header_t;
 
+/* Start of every grow pool's page run; the TLSF pool follows it. */
+typedef struct heap_pool {
+    uint64_t magic;
+    size_t pages;
+} heap_pool_t;
+
 static tlsf_t *g_heap = NULL;
 static spinlock_t g_lock = SPINLOCK_INIT;
 static size_t g_pool_bytes;
+static size_t g_pool_count;
+static size_t g_pool_used_bytes;
 static size_t g_allocated_bytes;
 static size_t g_peak_allocated_bytes;
+static size_t g_direct_bytes;
+static size_t g_direct_count;
+static size_t g_released_bytes;
 static int g_bad_free_warned;
 
+#if HEAP_PROFILE
+static heap_site_t g_sites[HEAP_PROFILE_SITES];
+static uint32_t g_site_count;
+static uint64_t g_profile_sampled;
+static uint64_t g_profile_dropped;
+
+#if HEAP_PROFILE == 1
+static uint32_t g_sample_countdown = HEAP_PROFILE_PERIOD;
+static uint32_t g_sample_rng = 0x2545F491u;
+
+/* Next gap between samples, uniform in [1, 2 * HEAP_PROFILE_PERIOD]. */
+static uint32_t heap_profile_next_gap(void)
+{
+    uint32_t x = g_sample_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_sample_rng = x;
+    return 1u + (x & (2u * HEAP_PROFILE_PERIOD - 1u));
+}
+#endif
+
+static heap_site_t *heap_profile_site_locked(uintptr_t caller, uint32_t *idx_out)
+{
+    uint32_t h = (uint32_t)((uint64_t)caller * 0x9E3779B97F4A7C15ULL >> 40);
+
+    for (uint32_t probe = 0; probe < HEAP_PROFILE_SITES; probe++) {
+        uint32_t idx = (h + probe) & (HEAP_PROFILE_SITES - 1u);
+        heap_site_t *site = &g_sites[idx];
+        if (site->caller == caller) {
+            *idx_out = idx;
+            return site;
+        }
+        if (site->caller == 0) {
+            site->caller = caller;
+            g_site_count++;
+            *idx_out = idx;
+            return site;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the value for heap_alloc_header_t.site. */
+static uint32_t heap_profile_alloc_locked(uintptr_t caller, size_t size)
+{
+    heap_site_t *site;
+    uint32_t idx;
+
+#if HEAP_PROFILE == 1
+    if (--g_sample_countdown != 0)
+        return 0;
+    g_sample_countdown = heap_profile_next_gap();
+#endif
+    g_profile_sampled++;
+    site = heap_profile_site_locked(caller, &idx);
+    if (!site) {
+        g_profile_dropped++;
+        return 0;
+    }
+    site->live_bytes += size;
+    site->live_count++;
+    site->total_allocs++;
+    site->total_bytes += size;
+    if (site->live_bytes > site->peak_bytes)
+        site->peak_bytes = site->live_bytes;
+    return idx + 1u;
+}
+
+static void heap_profile_free_locked(uint32_t site_id, size_t size)
+{
+    heap_site_t *site;
+
+    if (site_id == 0 || site_id > HEAP_PROFILE_SITES)
+        return;
+    site = &g_sites[site_id - 1u];
+    site->live_bytes = (site->live_bytes >= size) ? site->live_bytes - size : 0;
+    if (site->live_count > 0)
+        site->live_count--;
+}
+#else
+#define heap_profile_alloc_locked(caller, size) ((void)(caller), (void)(size), 0u)
+#define heap_profile_free_locked(site_id, size) ((void)(site_id), (void)(size))
+#endif
+
 void heap_init(void)
 {
     uintptr_t phys = pmm_alloc_pages(HEAP_INIT_PAGES);
@@ -41,13 +160,112 @@ void heap_init(void)
         g_pool_bytes = HEAP_INIT_PAGES * 4096u;
     else
     g_pool_bytes = 0;
+    g_pool_count = g_heap ? 1 : 0;
+    g_pool_used_bytes = 0;
     g_allocated_bytes = 0;
     g_peak_allocated_bytes = 0;
+    g_direct_bytes = 0;
+    g_direct_count = 0;
+    g_released_bytes = 0;
     g_bad_free_warned = 0;
 }
 
+static void heap_account_alloc(size_t size)
+{
+    g_allocated_bytes += size;
+    if (g_allocated_bytes > g_peak_allocated_bytes)
+        g_peak_allocated_bytes = g_allocated_bytes;
+}
+
+static void heap_account_free(size_t size)
+{
+    if (g_allocated_bytes >= size)
+        g_allocated_bytes -= size;
+    else
+        g_allocated_bytes = 0;
+}
+
+static size_t heap_direct_pages(size_t size)
+{
+    return (size + sizeof(heap_alloc_header_t) + 4095u) / 4096u;
+}
+
+static void *heap_direct_alloc(size_t size, uintptr_t caller)
+{
+    size_t pages = heap_direct_pages(size);
+    uintptr_t phys = pmm_alloc_pages(pages);
+    heap_alloc_header_t *hdr;
+
+    if (phys == 0)
+        return NULL;
+
+    hdr = (heap_alloc_header_t *)vmm_phys_to_virt((uint64_t)phys);
+    hdr->magic = HEAP_DIRECT_MAGIC;
+    hdr->size = size;
+
+    spin_lock(&g_lock);
+    hdr->site = heap_profile_alloc_locked(caller, size);
+    heap_account_alloc(size);
+    g_direct_bytes += pages * 4096u;
+    g_direct_count++;
+    spin_unlock(&g_lock);
+    return (void *)(hdr + 1);
+}
+
+static int heap_grow_locked(size_t req_size)
+{
+    size_t pages = (req_size + sizeof(heap_pool_t) + 64u + 4095u) / 4096u;
+    uintptr_t phys;
+    heap_pool_t *pool;
+
+    if (pages < HEAP_GROW_PAGES)
+        pages = HEAP_GROW_PAGES;
+    phys = pmm_alloc_pages(pages);
+    if (!phys)
+        return -1;
+
+    pool = (heap_pool_t *)vmm_phys_to_virt((uint64_t)phys);
+    pool->magic = HEAP_POOL_MAGIC;
+    pool->pages = pages;
+    if (tlsf_add_pool(g_heap, pool + 1, pages * 4096u - sizeof(*pool)) != 0) {
+        pmm_free_pages(phys, pages);
+        return -1;
+    }
+    g_pool_bytes += pages * 4096u;
+    g_pool_count++;
+    return 0;
+}
+
+/*
+ * `mem` is a grow pool that just became completely free.  Give it back
+ * unless the remaining pools would be left with less than
+ * HEAP_RETAIN_BYTES free, which would only make the next burst regrow it.
+ */
+static void heap_maybe_release_locked(void *mem)
+{
+    heap_pool_t *pool = (heap_pool_t *)mem - 1;
+    size_t bytes;
+    size_t in_pools;
+
+    if (pool->magic != HEAP_POOL_MAGIC)
+        return;
+    bytes = pool->pages * 4096u;
+    in_pools = g_pool_bytes - bytes;
+    if (in_pools < g_pool_used_bytes + HEAP_RETAIN_BYTES)
+        return;
+    if (tlsf_remove_pool(g_heap, mem) != 0)
+        return;
+
+    pool->magic = 0;
+    g_pool_bytes -= bytes;
+    g_pool_count--;
+    g_released_bytes += bytes;
+    pmm_free_pages((uintptr_t)vmm_virt_to_phys((uintptr_t)pool), pool->pages);
+}
+
 void *kmalloc(size_t size)
 {
+    uintptr_t caller = (uintptr_t)__builtin_return_address(0);
     void *ptr;
     size_t req_size;
 
@@ -57,31 +275,21 @@ void *kmalloc(size_t size)
     req_size = size + sizeof(heap_alloc_header_t);
     if (req_size < size)
         return NULL;
+    if (req_size >= HEAP_DIRECT_MIN)
+        return heap_direct_alloc(size, caller);
 
     spin_lock(&g_lock);
     ptr = tlsf_malloc(g_heap, req_size);
-    if (!ptr) {
-        size_t pages = (req_size + 4095u) / 4096u;
-        uintptr_t phys;
-        if (pages < HEAP_GROW_PAGES)
-            pages = HEAP_GROW_PAGES;
-        phys = pmm_alloc_pages(pages);
-        if (phys) {
-            tlsf_add_pool(g_heap,
-                          (void *)vmm_phys_to_virt((uint64_t)phys),
-                          pages * 4096u);
-            g_pool_bytes += pages * 4096u;
-            ptr = tlsf_malloc(g_heap, req_size);
-        }
-    }
+    if (!ptr && heap_grow_locked(req_size) == 0)
+        ptr = tlsf_malloc(g_heap, req_size);
 
     if (ptr) {
         heap_alloc_header_t *hdr = (heap_alloc_header_t *)ptr;
         hdr->magic = HEAP_ALLOC_MAGIC;
+        hdr->site = heap_profile_alloc_locked(caller, size);
         hdr->size = size;
-        g_allocated_bytes += size;
-        if (g_allocated_bytes > g_peak_allocated_bytes)
-            g_peak_allocated_bytes = g_allocated_bytes;
+        heap_account_alloc(size);
+        g_pool_used_bytes += req_size;
         ptr = (void *)(hdr + 1);
     }
 
@@ -99,20 +307,31 @@ void kfree(void *ptr)
     spin_lock(&g_lock);
     hdr = ((heap_alloc_header_t *)ptr) - 1;
     if (hdr->magic == HEAP_ALLOC_MAGIC) {
+        void *empty_pool;
         hdr->magic = 0;
-        if (g_allocated_bytes >= hdr->size)
-            g_allocated_bytes -= hdr->size;
-        else
-            g_allocated_bytes = 0;
-        tlsf_free(g_heap, hdr);
+        heap_profile_free_locked(hdr->site, hdr->size);
+        heap_account_free(hdr->size);
+        g_pool_used_bytes -= hdr->size + sizeof(*hdr);
+        empty_pool = tlsf_free_check(g_heap, hdr);
+        if (empty_pool)
+            heap_maybe_release_locked(empty_pool);
+    } else if (hdr->magic == HEAP_DIRECT_MAGIC) {
+        size_t pages = heap_direct_pages(hdr->size);
+        hdr->magic = 0;
+        heap_profile_free_locked(hdr->site, hdr->size);
+        heap_account_free(hdr->size);
+        g_direct_bytes -= pages * 4096u;
+        g_direct_count--;
+        spin_unlock(&g_lock);
+        pmm_free_pages((uintptr_t)vmm_virt_to_phys((uintptr_t)hdr), pages);
+        return;
     } else {
         if (!g_bad_free_warned) {
             g_bad_free_warned = 1;
-            kprintf("[heap] WARN: invalid/double free rejected ptr=0x%08x%08x magic=0x%08x%08x\n",
+            kprintf("[heap] WARN: invalid/double free rejected ptr=0x%08x%08x magic=0x%08x\n",
                     (uint32_t)((uint64_t)(uintptr_t)ptr >> 32),
                     (uint32_t)((uint64_t)(uintptr_t)ptr & 0xFFFFFFFFu),
-                    (uint32_t)(hdr->magic >> 32),
-                    (uint32_t)(hdr->magic & 0xFFFFFFFFu));
+                    hdr->magic);
         }
     }
     spin_unlock(&g_lock);
@@ -125,7 +344,43 @@ void heap_get_stats(heap_stats_t *out)
 
     spin_lock(&g_lock);
     out->pool_bytes = g_pool_bytes;
+    out->pool_count = g_pool_count;
     out->allocated_bytes = g_allocated_bytes;
     out->peak_allocated_bytes = g_peak_allocated_bytes;
+    out->direct_bytes = g_direct_bytes;
+    out->direct_count = g_direct_count;
+    out->released_bytes = g_released_bytes;
+    spin_unlock(&g_lock);
+}
+
+int heap_profile_snapshot(heap_site_t *out, int max, heap_profile_info_t *info)
+{
+    int n = 0;
+
+    if (info) {
+        info->mode = HEAP_PROFILE;
+        info->sample_period = (HEAP_PROFILE == 1) ? HEAP_PROFILE_PERIOD : 1u;
+        info->sites = 0;
+        info->sampled = 0;
+        info->dropped = 0;
+    }
+#if HEAP_PROFILE
+    spin_lock(&g_lock);
+    for (uint32_t i = 0; i < HEAP_PROFILE_SITES; i++) {
+        if (g_sites[i].caller == 0)
+            continue;
+        if (out && n < max)
+            out[n++] = g_sites[i];
+    }
+    if (info) {
+        info->sites = g_site_count;
+        info->sampled = g_profile_sampled;
+        info->dropped = g_profile_dropped;
+    }
     spin_unlock(&g_lock);
+#else
+    (void)out;
+    (void)max;
+#endif
+    return n;
 }
@@ -7,13 +7,36 @@
 #define HEAP_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct heap_stats {
-    size_t pool_bytes;
-    size_t allocated_bytes;
+    size_t pool_bytes;              /* bytes in TLSF pools */
+    size_t pool_count;
+    size_t allocated_bytes;         /* requested bytes live, pools + direct */
     size_t peak_allocated_bytes;
+    size_t direct_bytes;            /* page runs of large direct allocations */
+    size_t direct_count;
+    size_t released_bytes;          /* pool bytes returned to the PMM so far */
 } heap_stats_t;
 
+/** One kmalloc() call site, keyed by the caller's return address. */
+typedef struct heap_site {
+    uintptr_t caller;
+    uint64_t live_bytes;
+    uint64_t live_count;
+    uint64_t total_allocs;
+    uint64_t total_bytes;
+    uint64_t peak_bytes;        /* highest live_bytes seen */
+} heap_site_t;
+
+typedef struct heap_profile_info {
+    int mode;                   /* 0 off, 1 sampled, 2 every allocation */
+    uint32_t sample_period;     /* mean allocations per recorded one */
+    uint32_t sites;
+    uint64_t sampled;           /* allocations recorded */
+    uint64_t dropped;           /* recorded while the site table was full */
+} heap_profile_info_t;
+
 /**
  * Initialize the kernel heap. Must be called after pmm_init and paging_init.
  */
@@ -39,4 +62,12 @@ void kfree(void *ptr);
  */
 void heap_get_stats(heap_stats_t *out);
 
+/**
+ * Copy up to `max` call-site records (in table order) and fill `info`.
+ * In sampled mode the counters cover only the recorded allocations.
+ *
+ * @return Number of records copied (0 when profiling is compiled out).
+ */
+int heap_profile_snapshot(heap_site_t *out, int max, heap_profile_info_t *info);
+
 #endif /* HEAP_H */
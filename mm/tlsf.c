@@ -9,8 +9,13 @@
  *   A two-level bitmap (FL = floor(log2(size)), SL = next 4 bits) indexes
  *   free lists so any suitable block is found in O(1) bit operations.
  *
- *   FL range: 4..27 (16 bytes .. 128 MiB)
+ *   FL range: sizes up to 2^FL_INDEX_MAX (1 TiB with a 64-bit size_t,
+ *             1 GiB on 32-bit builds); FL 0 holds sizes below 16 bytes
  *   SL count:  16 (4 SL bits)
+ *
+ *   The first block of every pool added with tlsf_add_pool() is tagged, so
+ *   tlsf_free_check() can tell when a free leaves a whole pool unused and
+ *   the owner can take it back with tlsf_remove_pool().
  */
 
 #include "tlsf.h"
@@ -19,12 +24,15 @@
 
 /* ---- Configuration ---------------------------------------------------- */
 
-#define FL_INDEX_MAX   28
+#define FL_INDEX_MAX   (sizeof(size_t) >= 8 ? 40 : 30)
 #define SL_INDEX_BITS   4
 #define SL_INDEX_COUNT (1 << SL_INDEX_BITS)
+#define FL_INDEX_COUNT_MAX (40 - SL_INDEX_BITS + 1)
 #define FL_INDEX_COUNT (FL_INDEX_MAX - SL_INDEX_BITS + 1)
+#define BLOCK_SIZE_MAX (((size_t)1 << FL_INDEX_MAX) - 1)
 
-#define BLOCK_ALIGN  sizeof(void *)
+/* 8 bytes even on 32-bit builds so the low three size bits stay free. */
+#define BLOCK_ALIGN  ((size_t)8)
 #define BLOCK_MIN    (sizeof(block_t))
 
 /* ---- Block structure -------------------------------------------------- */
@@ -32,14 +40,15 @@
 /* Status bits stored in the low bits of block.size. */
 #define BLOCK_FREE    1u
 #define BLOCK_PREV_FREE 2u
-#define BLOCK_OVERHEAD  sizeof(uint32_t)   /* just size field at block start */
+#define BLOCK_POOL_FIRST 4u     /* first block of an added pool */
 
 typedef struct block_s {
     /* Size field: upper bits = payload size (multiple of BLOCK_ALIGN).
      * Bit 0: 1 = free, 0 = used.
      * Bit 1: 1 = previous physical block is free.
+     * Bit 2: 1 = first block of a pool added with tlsf_add_pool().
      */
-    uint32_t size;
+    size_t size;
 
     /* Intrusive free-list links (only valid when free). */
     struct block_s *prev_free;
@@ -56,13 +65,14 @@ typedef struct {
 
 /* ---- Helper macros ----------------------------------------------------- */
 
-#define SZ_MASK   (~3u)
+#define SZ_MASK   (~(size_t)7)
 
-static inline uint32_t block_size(const block_t *b)   { return b->size & SZ_MASK; }
+static inline size_t block_size(const block_t *b)   { return b->size & SZ_MASK; }
 static inline int  block_is_free(const block_t *b)    { return (b->size & BLOCK_FREE) ? 1 : 0; }
 static inline int  block_prev_free(const block_t *b)  { return (b->size & BLOCK_PREV_FREE) ? 1 : 0; }
+static inline int  block_pool_first(const block_t *b) { return (b->size & BLOCK_POOL_FIRST) ? 1 : 0; }
 
-static inline void block_set_size(block_t *b, uint32_t sz)
+static inline void block_set_size(block_t *b, size_t sz)
 {
     b->size = (b->size & ~SZ_MASK) | (sz & SZ_MASK);
 }
@@ -103,11 +113,11 @@ static inline void block_write_footer(block_t *b)
 
 /* ---- Find-first-bit helpers ------------------------------------------- */
 
-static inline int fls(uint32_t v)   /* floor(log2(v)); v must be != 0 */
+static inline int fls(size_t v)     /* floor(log2(v)); v must be != 0 */
 {
-    int n;
-    __asm__ ("bsrl %1, %0" : "=r"(n) : "r"(v));
-    return n;
+    size_t n;
+    __asm__ ("bsr %1, %0" : "=r"(n) : "r"(v));
+    return (int)n;
 }
 static inline int ffs(uint32_t v)   /* index of lowest set bit */
 {
@@ -115,13 +125,18 @@ static inline int ffs(uint32_t v)   /* index of lowest set bit */
     __asm__ ("bsfl %1, %0" : "=r"(n) : "r"(v));
     return n;
 }
+static inline int ffs64(uint64_t v)
+{
+    uint32_t lo = (uint32_t)v;
+    return lo ? ffs(lo) : 32 + ffs((uint32_t)(v >> 32));
+}
 
 /* ---- Control structure (stored inside the pool memory) ---------------- */
 
 typedef struct {
-    block_t  *free_lists[FL_INDEX_COUNT][SL_INDEX_COUNT];
-    uint32_t  fl_bitmap;
-    uint32_t  sl_bitmap[FL_INDEX_COUNT];
+    block_t  *free_lists[FL_INDEX_COUNT_MAX][SL_INDEX_COUNT];
+    uint64_t  fl_bitmap;
+    uint32_t  sl_bitmap[FL_INDEX_COUNT_MAX];
 
     /* Sentinel block — a dummy zero-size "used" block at the very end. */
     block_t   sentinel;
@@ -134,23 +149,24 @@ struct tlsf_s {
 
 /* ---- Mapping ---------------------------------------------------------- */
 
-static void mapping_insert(uint32_t size, int *fl, int *sl)
+/* size must be <= BLOCK_SIZE_MAX; FL 1 starts at 16 bytes. */
+static void mapping_insert(size_t size, int *fl, int *sl)
 {
-    if (size < (1u << SL_INDEX_BITS)) {
+    if (size < ((size_t)1 << SL_INDEX_BITS)) {
         *fl = 0;
         *sl = (int)size;
     } else {
-        *fl = fls(size);
-        *sl = (int)((size >> (*fl - SL_INDEX_BITS)) & (SL_INDEX_COUNT - 1));
-        /* Round up: use next SL bucket to guarantee the block is large enough. */
+        int top = fls(size);
+        *fl = top - SL_INDEX_BITS + 1;
+        *sl = (int)((size >> (top - SL_INDEX_BITS)) & (SL_INDEX_COUNT - 1));
     }
 }
 
-static void mapping_search(uint32_t size, int *fl, int *sl)
+static void mapping_search(size_t size, int *fl, int *sl)
 {
-    /* Round up size to next bucket boundary before searching. */
-    if (size >= (1u << SL_INDEX_BITS)) {
-        uint32_t round = (1u << (fls(size) - SL_INDEX_BITS)) - 1u;
+    /* Round up: use next SL bucket to guarantee the block is large enough. */
+    if (size >= ((size_t)1 << SL_INDEX_BITS)) {
+        size_t round = ((size_t)1 << (fls(size) - SL_INDEX_BITS)) - 1u;
         size += round;
     }
     mapping_insert(size, fl, sl);
@@ -161,13 +177,13 @@ static void mapping_search(uint32_t size, int *fl, int *sl)
 static inline void fl_sl_set(control_t *c, int fl, int sl)
 {
     c->sl_bitmap[fl] |= (1u << sl);
-    c->fl_bitmap     |= (1u << fl);
+    c->fl_bitmap     |= ((uint64_t)1 << fl);
 }
 static inline void fl_sl_clear(control_t *c, int fl, int sl)
 {
     c->sl_bitmap[fl] &= ~(1u << sl);
     if (!c->sl_bitmap[fl])
-        c->fl_bitmap &= ~(1u << fl);
+        c->fl_bitmap &= ~((uint64_t)1 << fl);
 }
 
 static void insert_block(control_t *c, block_t *b)
@@ -194,16 +210,17 @@ static void remove_block(control_t *c, block_t *b)
 }
 
 /* Find a free block >= size. Returns NULL if not found. */
-static block_t *find_suitable(control_t *c, uint32_t size)
+static block_t *find_suitable(control_t *c, size_t size)
 {
     int fl, sl;
     mapping_search(size, &fl, &sl);
+    if (fl >= FL_INDEX_COUNT) return NULL;
 
     uint32_t sl_map = c->sl_bitmap[fl] & (~0u << sl);
     if (!sl_map) {
-        uint32_t fl_map = c->fl_bitmap & (~0u << (fl + 1));
+        uint64_t fl_map = (fl + 1 < 64) ? c->fl_bitmap & (~(uint64_t)0 << (fl + 1)) : 0;
         if (!fl_map) return NULL;
-        fl = ffs(fl_map);
+        fl = ffs64(fl_map);
         sl_map = c->sl_bitmap[fl];
     }
     sl = ffs(sl_map);
@@ -233,10 +250,10 @@ static block_t *coalesce_next(control_t *c, block_t *b)
     return b;
 }
 
-static block_t *split_block(block_t *b, uint32_t size)
+static block_t *split_block(block_t *b, size_t size)
 {
-    uint32_t remain = block_size(b) - size - HDR_SIZE;
-    if (remain < (uint32_t)BLOCK_MIN) return NULL;
+    if (block_size(b) < size + HDR_SIZE + BLOCK_MIN) return NULL;
+    size_t remain = block_size(b) - size - HDR_SIZE;
 
     block_t *rest = (block_t *)((char *)b + HDR_SIZE + size);
     rest->size = remain;
@@ -248,17 +265,19 @@ static block_t *split_block(block_t *b, uint32_t size)
 
 /* ---- Pool bootstrap --------------------------------------------------- */
 
-static void pool_add(control_t *c, void *mem, size_t size)
+static int pool_add(control_t *c, void *mem, size_t size, size_t flags)
 {
     /* Minimum: one free block + sentinel. */
     if (size < (HDR_SIZE + BLOCK_MIN + HDR_SIZE + sizeof(footer_t) + 4))
-        return;
+        return -1;
 
     block_t *b = (block_t *)mem;
-    uint32_t bsz = (uint32_t)(size - HDR_SIZE - HDR_SIZE - sizeof(footer_t));
+    size_t bsz = size - HDR_SIZE - HDR_SIZE - sizeof(footer_t);
+    if (bsz > BLOCK_SIZE_MAX)
+        bsz = BLOCK_SIZE_MAX;
     bsz &= SZ_MASK;
 
-    b->size = 0;
+    b->size = flags;
     block_set_size(b, bsz);
     block_set_free(b, 1);
     block_set_prev_free(b, 0);
@@ -270,6 +289,7 @@ static void pool_add(control_t *c, void *mem, size_t size)
     block_set_prev_free(sent, 1);
 
     insert_block(c, b);
+    return 0;
 }
 
 /* ---- Public API ------------------------------------------------------- */
@@ -292,34 +312,50 @@ tlsf_t *tlsf_create(void *mem, size_t size)
     /* The remaining memory after the control structure becomes the pool. */
     void *pool = (char *)mem + sizeof(control_t);
     size_t pool_size = size - sizeof(control_t);
-    pool_add(c, pool, pool_size);
+    pool_add(c, pool, pool_size, 0);
 
     return t;
 }
 
-void tlsf_add_pool(tlsf_t *t, void *mem, size_t size)
+int tlsf_add_pool(tlsf_t *t, void *mem, size_t size)
+{
+    if (!t || !mem) return -1;
+    return pool_add(&t->ctrl, mem, size, BLOCK_POOL_FIRST);
+}
+
+int tlsf_remove_pool(tlsf_t *t, void *mem)
 {
-    if (!t || !mem) return;
-    pool_add(&t->ctrl, mem, size);
+    if (!t || !mem) return -1;
+    block_t *b = (block_t *)mem;
+    if (!block_pool_first(b) || !block_is_free(b) || block_size(block_phys_next(b)) != 0)
+        return -1;
+    remove_block(&t->ctrl, b);
+    b->size = 0;
+    return 0;
+}
+
+size_t tlsf_block_size(void *ptr)
+{
+    return ptr ? block_size(ptr_to_block(ptr)) : 0;
 }
 
 void *tlsf_malloc(tlsf_t *t, size_t size)
 {
-    if (!t || size == 0) return NULL;
+    if (!t || size == 0 || size > BLOCK_SIZE_MAX) return NULL;
 
     /* Align and clamp. */
     size = (size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
     if (size < BLOCK_MIN) size = BLOCK_MIN;
 
     control_t *c = &t->ctrl;
-    block_t *b = find_suitable(c, (uint32_t)size);
+    block_t *b = find_suitable(c, size);
     if (!b) return NULL;
 
     remove_block(c, b);
     block_set_free(b, 0);
 
     /* Split if there is enough remainder. */
-    block_t *rest = split_block(b, (uint32_t)size);
+    block_t *rest = split_block(b, size);
     if (rest) {
         block_set_free(rest, 1);
         block_write_footer(rest);
@@ -336,7 +372,12 @@ void *tlsf_malloc(tlsf_t *t, size_t size)
 
 void tlsf_free(tlsf_t *t, void *ptr)
 {
-    if (!t || !ptr) return;
+    tlsf_free_check(t, ptr);
+}
+
+void *tlsf_free_check(tlsf_t *t, void *ptr)
+{
+    if (!t || !ptr) return NULL;
     control_t *c = &t->ctrl;
     block_t *b = ptr_to_block(ptr);
 
@@ -352,10 +393,16 @@ void tlsf_free(tlsf_t *t, void *ptr)
     block_write_footer(b);
 
     insert_block(c, b);
+
+    /* Whole pool free: one tagged block followed by the sentinel. */
+    if (block_pool_first(b) && block_size(next) == 0)
+        return b;
+    return NULL;
 }
 
 void *tlsf_calloc(tlsf_t *t, size_t nmemb, size_t size)
 {
+    if (size != 0 && nmemb > SIZE_MAX / size) return NULL;
     size_t total = nmemb * size;
     void *p = tlsf_malloc(t, total);
     if (p) {
@@ -374,8 +421,8 @@ void *tlsf_realloc(tlsf_t *t, void *ptr, size_t size)
     if (!np) return NULL;
 
     block_t *b = ptr_to_block(ptr);
-    uint32_t old_size = block_size(b);
-    size_t copy = (size_t)old_size < size ? (size_t)old_size : size;
+    size_t old_size = block_size(b);
+    size_t copy = old_size < size ? old_size : size;
     uint8_t *src = (uint8_t *)ptr;
     uint8_t *dst = (uint8_t *)np;
     for (size_t i = 0; i < copy; i++) dst[i] = src[i];
@@ -8,6 +8,8 @@
  *   void *p = tlsf_malloc(h, 128);
  *   tlsf_free(h, p);
  *   tlsf_add_pool(h, more_mem, more_size);  // grow on demand
+ *   if ((pool = tlsf_free_check(h, p)) != NULL)
+ *       tlsf_remove_pool(h, pool);          // shrink when a pool empties
  */
 
 #ifndef TLSF_H
@@ -28,8 +30,15 @@ tlsf_t *tlsf_create(void *mem, size_t size);
 /**
  * Add an additional memory region to an existing TLSF heap.
  * Used to grow the heap from the PMM on demand.
+ * Returns 0, or -1 if the region is too small to hold a block.
  */
-void tlsf_add_pool(tlsf_t *t, void *mem, size_t size);
+int tlsf_add_pool(tlsf_t *t, void *mem, size_t size);
+
+/**
+ * Take back a pool added with tlsf_add_pool().  Only succeeds while the
+ * pool holds no allocations.  Returns 0 on success, -1 otherwise.
+ */
+int tlsf_remove_pool(tlsf_t *t, void *mem);
 
 /** Allocate `size` bytes.  Returns NULL on failure. */
 void *tlsf_malloc(tlsf_t *t, size_t size);
@@ -40,6 +49,16 @@ void *tlsf_calloc(tlsf_t *t, size_t nmemb, size_t size);
 /** Free a previously allocated block (NULL safe). */
 void tlsf_free(tlsf_t *t, void *ptr);
 
+/**
+ * Free a block like tlsf_free().  If that leaves a pool added with
+ * tlsf_add_pool() completely unused, returns the pool's start address
+ * (the `mem` it was added with); otherwise NULL.
+ */
+void *tlsf_free_check(tlsf_t *t, void *ptr);
+
+/** Usable size of an allocated block (>= the size requested). */
+size_t tlsf_block_size(void *ptr);
+
 /** Reallocate a block. */
 void *tlsf_realloc(tlsf_t *t, void *ptr, size_t size);
 
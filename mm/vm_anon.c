@@ -0,0 +1,285 @@
+/*
+ * vm_anon.c - Anonymous (zero-filled, private) user memory mappings.
+ *
+ * Backs MAP_ANONYMOUS for the user heap.  Mappings live in a dedicated
+ * window [VM_SPACE_ANON_BASE, VM_SPACE_ANON_LIMIT) and are tracked in one
+ * table sorted by address.  The window is allocated globally rather than per
+ * process because builtin apps run as kernel processes that share a single
+ * page table; a global first-fit keeps their heaps from overlapping.
+ */
+
+#include "vm_anon.h"
+
+#include "../include/spinlock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __x86_64__
+
+#include "../include/kutils.h"
+#include "../include/paging.h"
+#include "../proc/process.h"
+#include "pmm.h"
+#include "vm_space.h"
+#include "vmm_x64.h"
+
+#define VM_ANON_MAX_MAPS   512
+#define VM_ANON_MAX_PAGES  16384    /* 64 MiB per mapping */
+
+struct vm_anon_map {
+    uint32_t pid;
+    int releasing;              /* frames being freed; range still reserved */
+    uintptr_t virt_base;
+    size_t page_count;
+};
+
+/* Sorted by virt_base; entries [0, g_map_count) are live. */
+static struct vm_anon_map g_maps[VM_ANON_MAX_MAPS];
+static size_t g_map_count;
+static size_t g_mapped_pages;
+static size_t g_peak_pages;
+static spinlock_t g_anon_lock = SPINLOCK_INIT;
+
+static size_t vm_anon_index_locked(uintptr_t virt_base)
+{
+    for (size_t i = 0; i < g_map_count; i++) {
+        if (g_maps[i].virt_base == virt_base)
+            return i;
+        if (g_maps[i].virt_base > virt_base)
+            break;
+    }
+    return g_map_count;
+}
+
+static void vm_anon_remove_locked(size_t idx)
+{
+    if (idx >= g_map_count)
+        return;
+    if (g_mapped_pages >= g_maps[idx].page_count)
+        g_mapped_pages -= g_maps[idx].page_count;
+    else
+        g_mapped_pages = 0;
+    for (size_t i = idx + 1; i < g_map_count; i++)
+        g_maps[i - 1] = g_maps[i];
+    g_map_count--;
+}
+
+/* First-fit over the gaps between existing mappings. */
+static uintptr_t vm_anon_reserve_locked(uint32_t pid, size_t page_count)
+{
+    uint64_t span = (uint64_t)page_count * (uint64_t)PAGE_SIZE;
+    uint64_t cursor = VM_SPACE_ANON_BASE;
+    size_t idx;
+
+    if (g_map_count >= VM_ANON_MAX_MAPS)
+        return 0;
+
+    for (idx = 0; idx < g_map_count; idx++) {
+        if ((uint64_t)g_maps[idx].virt_base - cursor >= span)
+            break;
+        cursor = (uint64_t)g_maps[idx].virt_base +
+                 (uint64_t)g_maps[idx].page_count * (uint64_t)PAGE_SIZE;
+    }
+    if (cursor + span > VM_SPACE_ANON_LIMIT)
+        return 0;
+
+    for (size_t i = g_map_count; i > idx; i--)
+        g_maps[i] = g_maps[i - 1];
+    g_maps[idx].pid = pid;
+    g_maps[idx].releasing = 0;
+    g_maps[idx].virt_base = (uintptr_t)cursor;
+    g_maps[idx].page_count = page_count;
+    g_map_count++;
+
+    g_mapped_pages += page_count;
+    if (g_mapped_pages > g_peak_pages)
+        g_peak_pages = g_mapped_pages;
+    return (uintptr_t)cursor;
+}
+
+/* Free the frames behind a mapping and drop its PTEs. */
+static void vm_anon_release_pages(vm_space_t *space, uintptr_t virt_base, size_t page_count)
+{
+    for (size_t i = 0; i < page_count; i++) {
+        uint64_t phys = 0;
+        if (vmm_query_page(space->pml4_phys, virt_base + i * PAGE_SIZE, &phys, NULL) == 0)
+            pmm_free((uintptr_t)phys);
+    }
+    vm_space_unmap_user_pages(space, virt_base, page_count);
+}
+
+/*
+ * Back [virt_base, +page_count) with zeroed frames.  A contiguous run is
+ * tried first so the common case is one vmm_map_pages call; fragmented
+ * memory falls back to page-at-a-time.
+ */
+static int vm_anon_populate(vm_space_t *space, uintptr_t virt_base, size_t page_count)
+{
+    const uint64_t flags = PAGING_MAP_READ | PAGING_MAP_WRITE | PAGING_MAP_USER;
+    uintptr_t phys = pmm_alloc_pages(page_count);
+
+    if (phys) {
+        k_memset((void *)vmm_phys_to_virt(phys), 0, page_count * PAGE_SIZE);
+        if (vm_space_map_user_pages(space, virt_base, phys, page_count, flags) == 0)
+            return 0;
+        pmm_free_pages(phys, page_count);
+        return -1;
+    }
+
+    for (size_t i = 0; i < page_count; i++) {
+        phys = pmm_alloc();
+        if (!phys)
+            goto fail;
+        k_memset((void *)vmm_phys_to_virt(phys), 0, PAGE_SIZE);
+        if (vm_space_map_user_pages(space, virt_base + i * PAGE_SIZE, phys, 1, flags) != 0) {
+            pmm_free(phys);
+            goto fail;
+        }
+    }
+    return 0;
+
+fail:
+    vm_anon_release_pages(space, virt_base, page_count);
+    return -1;
+}
+
+void *vm_anon_map(size_t length)
+{
+    process_t *cur = process_current();
+    size_t page_count;
+    uintptr_t virt_base;
+
+    if (!cur || length == 0)
+        return NULL;
+
+    page_count = (length + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (page_count == 0 || page_count > VM_ANON_MAX_PAGES)
+        return NULL;
+
+    spin_lock(&g_anon_lock);
+    virt_base = vm_anon_reserve_locked(cur->pid, page_count);
+    spin_unlock(&g_anon_lock);
+    if (!virt_base)
+        return NULL;
+
+    if (vm_anon_populate(&cur->vm_space, virt_base, page_count) != 0) {
+        spin_lock(&g_anon_lock);
+        vm_anon_remove_locked(vm_anon_index_locked(virt_base));
+        spin_unlock(&g_anon_lock);
+        return NULL;
+    }
+
+    return (void *)virt_base;
+}
+
+int vm_anon_unmap(void *addr, size_t length)
+{
+    process_t *cur = process_current();
+    uintptr_t virt_base = (uintptr_t)addr;
+    size_t page_count;
+    size_t idx;
+
+    if (!cur || !addr)
+        return -1;
+
+    spin_lock(&g_anon_lock);
+    idx = vm_anon_index_locked(virt_base);
+    if (idx >= g_map_count || g_maps[idx].pid != cur->pid || g_maps[idx].releasing) {
+        spin_unlock(&g_anon_lock);
+        return -1;
+    }
+    page_count = g_maps[idx].page_count;
+    if (length != 0 && (length + PAGE_SIZE - 1) / PAGE_SIZE != page_count) {
+        spin_unlock(&g_anon_lock);
+        return -1;
+    }
+    /* Keep the range reserved until the frames are gone. */
+    g_maps[idx].releasing = 1;
+    spin_unlock(&g_anon_lock);
+
+    vm_anon_release_pages(&cur->vm_space, virt_base, page_count);
+
+    spin_lock(&g_anon_lock);
+    vm_anon_remove_locked(vm_anon_index_locked(virt_base));
+    spin_unlock(&g_anon_lock);
+    return 0;
+}
+
+void vm_anon_process_cleanup(struct process *proc)
+{
+    process_t *p = (process_t *)proc;
+
+    if (!p)
+        return;
+
+    for (;;) {
+        uintptr_t virt_base = 0;
+        size_t page_count = 0;
+        size_t idx;
+
+        spin_lock(&g_anon_lock);
+        for (idx = 0; idx < g_map_count; idx++) {
+            if (g_maps[idx].pid == p->pid && !g_maps[idx].releasing)
+                break;
+        }
+        if (idx < g_map_count) {
+            virt_base = g_maps[idx].virt_base;
+            page_count = g_maps[idx].page_count;
+            g_maps[idx].releasing = 1;
+        }
+        spin_unlock(&g_anon_lock);
+
+        if (!virt_base)
+            break;
+
+        vm_anon_release_pages(&p->vm_space, virt_base, page_count);
+
+        spin_lock(&g_anon_lock);
+        vm_anon_remove_locked(vm_anon_index_locked(virt_base));
+        spin_unlock(&g_anon_lock);
+    }
+}
+
+void vm_anon_get_stats(struct vm_anon_stats *out)
+{
+    if (!out)
+        return;
+
+    spin_lock(&g_anon_lock);
+    out->map_count = g_map_count;
+    out->mapped_pages = g_mapped_pages;
+    out->peak_pages = g_peak_pages;
+    spin_unlock(&g_anon_lock);
+}
+
+#else
+
+void *vm_anon_map(size_t length)
+{
+    (void)length;
+    return NULL;
+}
+
+int vm_anon_unmap(void *addr, size_t length)
+{
+    (void)addr;
+    (void)length;
+    return -1;
+}
+
+void vm_anon_process_cleanup(struct process *proc)
+{
+    (void)proc;
+}
+
+void vm_anon_get_stats(struct vm_anon_stats *out)
+{
+    if (!out)
+        return;
+    out->map_count = 0;
+    out->mapped_pages = 0;
+    out->peak_pages = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * vm_anon.h - Anonymous (zero-filled, private) user memory mappings.
+ */
+
+#ifndef TSUKASA_VM_ANON_H
+#define TSUKASA_VM_ANON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct process;
+
+struct vm_anon_stats {
+    size_t map_count;
+    size_t mapped_pages;
+    size_t peak_pages;
+};
+
+/**
+ * Map zero-filled read/write pages into the current process.
+ *
+ * @param length Size in bytes (rounded up to pages).
+ * @return Page-aligned user address, or NULL on error.
+ */
+void *vm_anon_map(size_t length);
+
+/**
+ * Unmap a mapping returned by vm_anon_map and release its frames.
+ *
+ * @param addr   Base address returned by vm_anon_map.
+ * @param length Length passed to vm_anon_map (0 = whole mapping).
+ * @return 0 on success, -1 if addr is not an anonymous mapping base.
+ */
+int vm_anon_unmap(void *addr, size_t length);
+
+/**
+ * Release every anonymous mapping owned by a process during exit/exec.
+ */
+void vm_anon_process_cleanup(struct process *proc);
+
+/**
+ * Populate snapshot statistics for diagnostics.
+ */
+void vm_anon_get_stats(struct vm_anon_stats *out);
+
+#endif /* TSUKASA_VM_ANON_H */
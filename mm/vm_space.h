@@ -11,6 +11,10 @@
 #define VM_SPACE_SHM_BASE  0x0000000040000000ULL
 #define VM_SPACE_SHM_LIMIT 0x0000000080000000ULL
 
+/* Anonymous memory window (see mm/vm_anon.c), shared by all processes. */
+#define VM_SPACE_ANON_BASE  0x0000001000000000ULL
+#define VM_SPACE_ANON_LIMIT 0x0000002000000000ULL
+
 typedef struct vm_space {
     uint64_t pml4_phys;
     uintptr_t user_min;
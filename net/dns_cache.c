@@ -0,0 +1,740 @@
+/*
+ * dns_cache.c - Caching stub resolver for IPv4 A records.
+ *
+ * The table is small and scanned linearly.  An entry is PENDING while its
+ * query is out; lookups that find it so queue on it as waiters and all get
+ * the answer when it lands.  Retransmits and timeouts run from
+ * dns_cache_tick(), which blocking waiters call each time they wake (on
+ * completion or when a resend is due) and pollers call on every scan.
+ * Table state is guarded by SYS_ARCH_PROTECT like the socket layer.
+ */
+
+#include "dns_cache.h"
+#include "network.h"
+#include "socket.h"
+
+#include "../drv/pit.h"
+#include "../fs/vfs.h"
+#include "../include/kutils.h"
+#include "../include/tsc.h"
+#include "../mm/heap.h"
+#include "../proc/process.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/udp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DNS_PORT            53
+#define DNS_MSG_MAX         512
+#define DNS_HDR_LEN         12
+#define DNS_TYPE_A          1
+#define DNS_TYPE_SOA        6
+#define DNS_CLASS_IN        1
+#define DNS_FLAG_QR         0x8000u
+#define DNS_FLAG_RD         0x0100u
+#define DNS_RCODE_NXDOMAIN  3
+#define DNS_SRC_PORT_BASE   49152u      /* IANA dynamic range */
+#define DNS_SRC_PORT_MASK   0x3FFFu
+#define DNS_BIND_TRIES      8
+
+typedef enum dns_entry_state {
+    DNS_ENTRY_FREE = 0,
+    DNS_ENTRY_PENDING,
+    DNS_ENTRY_DONE
+} dns_entry_state_t;
+
+typedef struct dns_entry {
+    char name[DNS_NAME_MAX];    /* lower case, no trailing dot */
+    dns_entry_state_t state;
+    dns_result_t result;        /* DONE; ttl as granted */
+    uint64_t expires_ms;
+    uint64_t hits;
+
+    /* PENDING */
+    struct udp_pcb *pcb;        /* this query's own socket */
+    uint16_t port;              /* its random local port */
+    uint16_t txid;
+    uint8_t server[4];
+    int tries;
+    uint64_t resend_ms;
+    dns_query_t *waiters;
+} dns_entry_t;
+
+struct dns_query {
+    dns_query_t *next;          /* on entry->waiters */
+    dns_entry_t *entry;         /* NULL once done */
+    int done;
+    dns_result_t result;
+};
+
+static dns_entry_t g_dns_cache[DNS_CACHE_ENTRIES];
+static dns_cache_stats_t g_dns_stats;
+static uint32_t g_dns_rand;
+static uint8_t g_dns_msg[DNS_MSG_MAX];
+static wait_queue_t g_dns_wq = WAIT_QUEUE_INIT;     /* blocking lookups */
+
+/* --------------------------------------------------------------------- */
+/* Helpers                                                               */
+/* --------------------------------------------------------------------- */
+
+static uint64_t dns_now_ms(void)
+{
+    uint32_t hz = pit_frequency();
+    return hz ? pit_ticks() * 1000u / hz : 0;
+}
+
+/* Query IDs and source ports: xorshift over state stirred with the TSC. */
+static uint16_t dns_random16(void)
+{
+    uint32_t x = g_dns_rand ^ (uint32_t)tsc_read();
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_dns_rand = x;
+    return (uint16_t)(x >> 16);
+}
+
+static uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static int dns_parse_ipv4(const char *s, uint8_t out[4])
+{
+    for (int i = 0; i < 4; i++) {
+        uint32_t v = 0;
+        int digits = 0;
+        while (*s >= '0' && *s <= '9' && digits < 4) {
+            v = v * 10u + (uint32_t)(*s - '0');
+            s++;
+            digits++;
+        }
+        if (digits == 0 || digits > 3 || v > 255)
+            return -1;
+        out[i] = (uint8_t)v;
+        if (i < 3) {
+            if (*s != '.')
+                return -1;
+            s++;
+        }
+    }
+    return *s == '\0' ? 0 : -1;
+}
+
+/* Lower-case copy of `in` without a trailing dot; -1 if it is no hostname. */
+static int dns_normalize(const char *in, char out[DNS_NAME_MAX])
+{
+    size_t n = 0;
+    size_t label = 0;
+
+    if (!in)
+        return -1;
+    for (; in[n]; n++) {
+        char c = in[n];
+        if (n >= DNS_NAME_MAX - 1)
+            return -1;
+        if (c == '.') {
+            if (label == 0)
+                return -1;
+            label = 0;
+        } else {
+            if (++label > 63 || (unsigned char)c <= ' ')
+                return -1;
+            if (c >= 'A' && c <= 'Z')
+                c = (char)(c - 'A' + 'a');
+        }
+        out[n] = c;
+    }
+    if (n > 0 && out[n - 1] == '.')
+        n--;
+    if (n == 0)
+        return -1;
+    out[n] = '\0';
+    return 0;
+}
+
+static int dns_pick_server(uint8_t out[4])
+{
+    net_link_info_t info;
+    const uint8_t *src;
+
+    if (!network_is_initialized() || network_get_link_info(&info) != 0)
+        return -1;
+    src = info.dns.bytes;
+    if (!(src[0] | src[1] | src[2] | src[3]))
+        src = info.gateway.bytes;
+    if (!(src[0] | src[1] | src[2] | src[3]))
+        return -1;
+    k_memcpy(out, src, 4);
+    return 0;
+}
+
+/* --------------------------------------------------------------------- */
+/* Table                                                                 */
+/* --------------------------------------------------------------------- */
+
+static dns_entry_t *dns_entry_find(const char *name)
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        dns_entry_t *e = &g_dns_cache[i];
+        if (e->state != DNS_ENTRY_FREE && k_strcmp(e->name, name) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* A free slot, else the finished entry closest to expiry. */
+static dns_entry_t *dns_entry_alloc(uint64_t now)
+{
+    dns_entry_t *victim = NULL;
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        dns_entry_t *e = &g_dns_cache[i];
+        if (e->state == DNS_ENTRY_FREE)
+            return e;
+        if (e->state == DNS_ENTRY_DONE && (!victim || e->expires_ms < victim->expires_ms))
+            victim = e;
+    }
+    if (victim && victim->expires_ms > now)
+        g_dns_stats.evictions++;
+    return victim;
+}
+
+/* Record the outcome and hand it to every waiter; called locked. */
+static void dns_entry_complete(dns_entry_t *e, int status, const uint8_t ip[4],
+                               uint32_t ttl, uint64_t now)
+{
+    dns_query_t *q = e->waiters;
+
+    /* udp_input() does not touch the PCB after its recv callback returns. */
+    if (e->pcb) {
+        udp_recv(e->pcb, NULL, NULL);
+        udp_remove(e->pcb);
+        e->pcb = NULL;
+        e->port = 0;
+    }
+    e->state = DNS_ENTRY_DONE;
+    e->result.status = status;
+    if (ip)
+        k_memcpy(e->result.ip, ip, 4);
+    else
+        k_memset(e->result.ip, 0, 4);
+    e->result.ttl = ttl;
+    e->expires_ms = now + (uint64_t)ttl * 1000u;
+    e->waiters = NULL;
+
+    while (q) {
+        dns_query_t *next = q->next;
+        q->result = e->result;
+        q->entry = NULL;
+        q->next = NULL;
+        q->done = 1;
+        q = next;
+    }
+    wait_queue_wake_all(&g_dns_wq);
+    vfs_poll_notify();
+}
+
+/* --------------------------------------------------------------------- */
+/* Wire format                                                           */
+/* --------------------------------------------------------------------- */
+
+static void dns_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                        const ip_addr_t *addr, u16_t port);
+
+/* A PCB for `e` on a random free port in the dynamic range; called locked. */
+static int dns_entry_open(dns_entry_t *e)
+{
+    struct udp_pcb *pcb = udp_new();
+
+    if (!pcb)
+        return -1;
+    for (int i = 0; i < DNS_BIND_TRIES; i++) {
+        uint16_t port = (uint16_t)(DNS_SRC_PORT_BASE + (dns_random16() & DNS_SRC_PORT_MASK));
+        if (udp_bind(pcb, IP_ADDR_ANY, port) == ERR_OK) {
+            udp_recv(pcb, dns_recv_cb, e);
+            e->pcb = pcb;
+            e->port = port;
+            return 0;
+        }
+    }
+    udp_remove(pcb);
+    return -1;
+}
+
+/* One A/IN question for `e`; called locked. */
+static int dns_send_query(dns_entry_t *e)
+{
+    uint8_t q[DNS_HDR_LEN + DNS_NAME_MAX + 6];
+    const char *s = e->name;
+    size_t off = DNS_HDR_LEN;
+    struct pbuf *p;
+    ip_addr_t ip;
+    err_t rc;
+
+    if (!e->pcb && dns_entry_open(e) != 0)
+        return -1;
+
+    k_memset(q, 0, DNS_HDR_LEN);
+    q[0] = (uint8_t)(e->txid >> 8);
+    q[1] = (uint8_t)e->txid;
+    q[2] = (uint8_t)(DNS_FLAG_RD >> 8);
+    q[5] = 1;
+    while (*s) {
+        const char *dot = s;
+        size_t len;
+        while (*dot && *dot != '.')
+            dot++;
+        len = (size_t)(dot - s);
+        q[off++] = (uint8_t)len;
+        k_memcpy(q + off, s, len);
+        off += len;
+        s = *dot ? dot + 1 : dot;
+    }
+    q[off++] = 0;
+    q[off++] = 0;
+    q[off++] = DNS_TYPE_A;
+    q[off++] = 0;
+    q[off++] = DNS_CLASS_IN;
+
+    IP_ADDR4(&ip, e->server[0], e->server[1], e->server[2], e->server[3]);
+    p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)off, PBUF_RAM);
+    if (!p)
+        return -1;
+    pbuf_take(p, q, (u16_t)off);
+    rc = udp_sendto(e->pcb, p, &ip, DNS_PORT);
+    pbuf_free(p);
+    if (rc != ERR_OK)
+        return -1;
+    g_dns_stats.queries_sent++;
+    return 0;
+}
+
+/* (Re)send the query for `e`, or give up after DNS_CACHE_TRIES; called locked. */
+static void dns_entry_transmit(dns_entry_t *e, uint64_t now)
+{
+    if (e->tries >= DNS_CACHE_TRIES) {
+        g_dns_stats.timeouts++;
+        dns_entry_complete(e, DNS_STATUS_FAILED, NULL, DNS_CACHE_FAIL_TTL, now);
+        return;
+    }
+    /* Retries reuse the ID and port, so a late answer to an earlier try still counts. */
+    if (e->tries == 0)
+        e->txid = dns_random16();
+    e->tries++;
+    e->resend_ms = now + DNS_CACHE_RETRY_MS;
+    /* A failed send (no ARP entry yet, no buffers) waits for the retry. */
+    (void)dns_send_query(e);
+}
+
+/* Offset just past the (possibly compressed) name at `off`, or 0. */
+static size_t dns_skip_name(const uint8_t *m, size_t len, size_t off)
+{
+    while (off < len) {
+        uint8_t l = m[off];
+        if (l == 0)
+            return off + 1;
+        if ((l & 0xC0u) == 0xC0u)
+            return off + 2 <= len ? off + 2 : 0;
+        if (l & 0xC0u)
+            return 0;
+        off += 1u + l;
+    }
+    return 0;
+}
+
+/* Offset past the question if it asks A/IN for `name`, else 0. */
+static size_t dns_match_question(const uint8_t *m, size_t len, const char *name)
+{
+    const char *s = name;
+    size_t off = DNS_HDR_LEN;
+
+    for (;;) {
+        uint8_t l;
+        if (off >= len)
+            return 0;
+        l = m[off++];
+        if (l == 0)
+            break;
+        if (l > 63 || off + l > len)
+            return 0;
+        if (s != name && *s++ != '.')
+            return 0;
+        for (uint8_t i = 0; i < l; i++) {
+            char c = (char)m[off + i];
+            if (c >= 'A' && c <= 'Z')
+                c = (char)(c - 'A' + 'a');
+            if (!s[i] || c != s[i])
+                return 0;
+        }
+        s += l;
+        off += l;
+    }
+    if (*s || off + 4 > len)
+        return 0;
+    if (rd16(m + off) != DNS_TYPE_A || rd16(m + off + 2) != DNS_CLASS_IN)
+        return 0;
+    return off + 4;
+}
+
+/* A reply that reached `e`'s PCB on local port `port`. */
+static void dns_handle_reply(dns_entry_t *e, uint16_t port, const uint8_t *m, size_t len,
+                             const ip_addr_t *from)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    uint32_t src = from ? ip4_addr_get_u32(ip_2_ip4(from)) : 0;
+    uint32_t server;
+    uint16_t id, flags, an, ns;
+    uint32_t ttl = DNS_CACHE_MAX_TTL;
+    uint32_t neg_ttl = DNS_CACHE_NEG_TTL;
+    uint8_t ip[4];
+    int have_a = 0;
+    size_t off;
+
+    if (len < DNS_HDR_LEN)
+        return;
+    id = rd16(m);
+    flags = rd16(m + 2);
+    an = rd16(m + 6);
+    ns = rd16(m + 8);
+    if (!(flags & DNS_FLAG_QR) || rd16(m + 4) != 1)
+        return;
+
+    SYS_ARCH_PROTECT(lev);
+    /* The address is in network order, so its bytes read a.b.c.d. */
+    k_memcpy(&server, e->server, 4);
+    if (e->state != DNS_ENTRY_PENDING || !e->pcb || e->port != port ||
+        e->txid != id || server != src)
+        goto out;
+    if ((off = dns_match_question(m, len, e->name)) == 0)
+        goto out;
+
+    /* The answer lives as long as the shortest TTL on its CNAME chain. */
+    for (uint16_t i = 0; i < an; i++) {
+        uint16_t type, cls, rdlen;
+        uint32_t rr_ttl;
+        off = dns_skip_name(m, len, off);
+        if (!off || off + 10 > len)
+            break;
+        type = rd16(m + off);
+        cls = rd16(m + off + 2);
+        rr_ttl = rd32(m + off + 4);
+        rdlen = rd16(m + off + 8);
+        off += 10;
+        if (off + rdlen > len)
+            break;
+        if (rr_ttl & 0x80000000u)
+            rr_ttl = 0;
+        if (rr_ttl < ttl)
+            ttl = rr_ttl;
+        if (!have_a && type == DNS_TYPE_A && cls == DNS_CLASS_IN && rdlen == 4) {
+            k_memcpy(ip, m + off, 4);
+            have_a = 1;
+        }
+        off += rdlen;
+    }
+
+    /* RFC 2308: a negative answer lives min(SOA TTL, SOA MINIMUM). */
+    for (uint16_t i = 0; i < ns && !have_a && off; i++) {
+        uint16_t type, rdlen;
+        uint32_t rr_ttl;
+        off = dns_skip_name(m, len, off);
+        if (!off || off + 10 > len)
+            break;
+        type = rd16(m + off);
+        rr_ttl = rd32(m + off + 4);
+        rdlen = rd16(m + off + 8);
+        off += 10;
+        if (off + rdlen > len)
+            break;
+        if (type == DNS_TYPE_SOA && rdlen >= 22) {
+            uint32_t minimum = rd32(m + off + rdlen - 4);
+            neg_ttl = rr_ttl < minimum ? rr_ttl : minimum;
+            if (neg_ttl & 0x80000000u)
+                neg_ttl = 0;
+            break;
+        }
+        off += rdlen;
+    }
+
+    if ((flags & 0xFu) == 0 && have_a)
+        dns_entry_complete(e, DNS_STATUS_OK, ip, ttl, dns_now_ms());
+    else if ((flags & 0xFu) == 0 || (flags & 0xFu) == DNS_RCODE_NXDOMAIN)
+        dns_entry_complete(e, DNS_STATUS_NOTFOUND, NULL,
+                           neg_ttl < DNS_CACHE_NEG_MAX_TTL ? neg_ttl : DNS_CACHE_NEG_MAX_TTL,
+                           dns_now_ms());
+    else
+        dns_entry_complete(e, DNS_STATUS_FAILED, NULL, DNS_CACHE_FAIL_TTL, dns_now_ms());
+out:
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+static void dns_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                        const ip_addr_t *addr, u16_t port)
+{
+    if (arg && port == DNS_PORT && p->tot_len <= DNS_MSG_MAX) {
+        u16_t len = pbuf_copy_partial(p, g_dns_msg, p->tot_len, 0);
+        dns_handle_reply((dns_entry_t *)arg, pcb->local_port, g_dns_msg, len, addr);
+    }
+    pbuf_free(p);
+}
+
+/* --------------------------------------------------------------------- */
+/* Queries                                                               */
+/* --------------------------------------------------------------------- */
+
+/* Retransmit or time out the queries that are due. */
+static void dns_cache_tick(void)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    uint64_t now = dns_now_ms();
+
+    SYS_ARCH_PROTECT(lev);
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        dns_entry_t *e = &g_dns_cache[i];
+        if (e->state == DNS_ENTRY_PENDING && now >= e->resend_ms)
+            dns_entry_transmit(e, now);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+/* Answer `q` from the cache, or queue it on a (possibly new) query. */
+static int dns_query_init(dns_query_t *q, const char *name)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    char key[DNS_NAME_MAX];
+    uint8_t server[4];
+    int have_server;
+    dns_entry_t *e;
+    uint64_t now;
+
+    k_memset(q, 0, sizeof(*q));
+    if (dns_normalize(name, key) != 0)
+        return -1;
+    if (dns_parse_ipv4(key, q->result.ip) == 0) {
+        q->done = 1;
+        return 0;
+    }
+    have_server = dns_pick_server(server) == 0;
+    now = dns_now_ms();
+
+    SYS_ARCH_PROTECT(lev);
+    g_dns_stats.lookups++;
+    e = dns_entry_find(key);
+    if (e && e->state == DNS_ENTRY_DONE && e->expires_ms > now) {
+        e->hits++;
+        if (e->result.status == DNS_STATUS_OK)
+            g_dns_stats.hits++;
+        else
+            g_dns_stats.negative_hits++;
+        q->result = e->result;
+        q->result.ttl = (uint32_t)((e->expires_ms - now + 999u) / 1000u);
+        q->done = 1;
+    } else if (e && e->state == DNS_ENTRY_PENDING) {
+        g_dns_stats.joins++;
+        q->entry = e;
+        q->next = e->waiters;
+        e->waiters = q;
+    } else {
+        g_dns_stats.misses++;
+        if (!e) {
+            e = dns_entry_alloc(now);
+            if (e) {
+                k_strcpy(e->name, key);
+                e->hits = 0;
+            }
+        }
+        if (!e) {
+            q->result.status = DNS_STATUS_FAILED;
+            q->done = 1;
+        } else {
+            e->state = DNS_ENTRY_PENDING;
+            e->tries = 0;
+            q->entry = e;
+            e->waiters = q;
+            if (have_server) {
+                k_memcpy(e->server, server, 4);
+                dns_entry_transmit(e, now);
+            } else {
+                /* No network yet: fail this lookup but cache nothing. */
+                dns_entry_complete(e, DNS_STATUS_FAILED, NULL, 0, now);
+            }
+        }
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return 0;
+}
+
+static int dns_query_done(dns_query_t *q)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    int done;
+
+    SYS_ARCH_PROTECT(lev);
+    done = q->done;
+    SYS_ARCH_UNPROTECT(lev);
+    return done;
+}
+
+/* Take an unfinished `q` off its entry's waiter list. */
+static void dns_query_detach(dns_query_t *q)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    if (!q->done && q->entry) {
+        dns_query_t **pp = &q->entry->waiters;
+        while (*pp && *pp != q)
+            pp = &(*pp)->next;
+        if (*pp)
+            *pp = q->next;
+        q->entry = NULL;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+/* pit_ticks() by which `q`'s entry is due for a resend, or 0 once it is done. */
+static uint64_t dns_query_deadline(dns_query_t *q)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    uint64_t hz = pit_frequency();
+    uint64_t ms = 0;
+
+    SYS_ARCH_PROTECT(lev);
+    if (!q->done && q->entry)
+        ms = q->entry->resend_ms;
+    SYS_ARCH_UNPROTECT(lev);
+    return ms && hz ? (ms * hz + 999u) / 1000u : 0;
+}
+
+/*
+ * Wait until `q` completes, sleeping until the answer lands or the next
+ * resend is due.  A caller with no process to yield (boot-time self tests)
+ * spins on network_poll(); the retry limit bounds the wait.
+ */
+static int dns_query_wait(dns_query_t *q)
+{
+    while (!dns_query_done(q)) {
+        process_t *p = process_current();
+        int driven;
+
+        if (!p || p->is_idle) {
+            if (network_is_initialized())
+                network_poll();
+            dns_cache_tick();
+            continue;
+        }
+        driven = net_socket_drive();
+        dns_cache_tick();
+        if (dns_query_done(q))
+            break;
+        if ((p->signal_pending & ~p->signal_mask) != 0)
+            return -1;
+        if (!driven) {
+            process_yield();
+            continue;
+        }
+        if (wait_queue_prepare_until(&g_dns_wq, dns_query_deadline(q)) != 0)
+            return -1;
+        if (!dns_query_done(q))
+            process_yield();
+        wait_queue_finish(&g_dns_wq);
+    }
+    return 0;
+}
+
+int dns_cache_lookup(const char *name, uint8_t out[4])
+{
+    dns_query_t q;
+
+    if (!out || dns_query_init(&q, name) != 0)
+        return -1;
+    if (dns_query_wait(&q) != 0) {
+        dns_query_detach(&q);
+        return -1;
+    }
+    if (q.result.status != DNS_STATUS_OK)
+        return -1;
+    k_memcpy(out, q.result.ip, 4);
+    return 0;
+}
+
+dns_query_t *dns_query_start(const char *name)
+{
+    dns_query_t *q = (dns_query_t *)kmalloc(sizeof(*q));
+
+    if (!q)
+        return NULL;
+    if (dns_query_init(q, name) != 0) {
+        kfree(q);
+        return NULL;
+    }
+    return q;
+}
+
+int dns_query_poll_mask(dns_query_t *q)
+{
+    if (!q)
+        return VFS_POLLERR;
+    if (!dns_query_done(q))
+        dns_cache_tick();
+    return dns_query_done(q) ? VFS_POLLIN : 0;
+}
+
+int dns_query_result(dns_query_t *q, int nonblock, dns_result_t *out)
+{
+    if (!q || !out)
+        return -1;
+    if (!dns_query_done(q) && (nonblock || dns_query_wait(q) != 0))
+        return -1;
+    *out = q->result;
+    return 0;
+}
+
+void dns_query_release(dns_query_t *q)
+{
+    if (!q)
+        return;
+    dns_query_detach(q);
+    kfree(q);
+}
+
+/* --------------------------------------------------------------------- */
+/* Introspection                                                         */
+/* --------------------------------------------------------------------- */
+
+int dns_cache_snapshot(dns_cache_info_t *out, int max, dns_cache_stats_t *stats)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    uint64_t now = dns_now_ms();
+    int n = 0;
+
+    SYS_ARCH_PROTECT(lev);
+    if (stats)
+        *stats = g_dns_stats;
+    for (int i = 0; out && i < DNS_CACHE_ENTRIES && n < max; i++) {
+        const dns_entry_t *e = &g_dns_cache[i];
+        if (e->state == DNS_ENTRY_FREE ||
+            (e->state == DNS_ENTRY_DONE && e->expires_ms <= now))
+            continue;
+        k_strcpy(out[n].name, e->name);
+        out[n].pending = e->state == DNS_ENTRY_PENDING;
+        out[n].result = e->result;
+        out[n].result.ttl = out[n].pending ? 0 :
+                            (uint32_t)((e->expires_ms - now + 999u) / 1000u);
+        out[n].hits = e->hits;
+        n++;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return n;
+}
@@ -0,0 +1,118 @@
+/*
+ * dns_cache.h - Caching stub resolver for IPv4 A records.
+ *
+ * Answers are kept for the TTL the server gave (capped), and failures are
+ * cached too: NXDOMAIN and empty answers for the SOA minimum, timeouts and
+ * server errors briefly.  Concurrent lookups of a name share one query.
+ * Each query goes out on its own lwIP UDP PCB, bound to a random source
+ * port for its lifetime, to the DHCP-provided server, falling back to the
+ * gateway.  A reply counts only if it arrives on that port from that
+ * server with the query's random ID.
+ *
+ * A lookup is either blocking (dns_cache_lookup) or a dns_query_t that
+ * reports VFS_POLLIN once resolved, which the VFS exposes to processes as
+ * a descriptor (VFS_BACKEND_DNS).  Blocking waiters sleep until the
+ * answer lands or a retransmit is due; without a net-rx worker they drive
+ * network_poll() themselves.
+ */
+
+#ifndef TSUKASA_NET_DNS_CACHE_H
+#define TSUKASA_NET_DNS_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef DNS_CACHE_ENTRIES
+#define DNS_CACHE_ENTRIES     32
+#endif
+#ifndef DNS_CACHE_MAX_TTL
+#define DNS_CACHE_MAX_TTL     3600u     /* seconds; longer TTLs are capped */
+#endif
+#ifndef DNS_CACHE_NEG_TTL
+#define DNS_CACHE_NEG_TTL     60u       /* NXDOMAIN without an SOA */
+#endif
+#ifndef DNS_CACHE_NEG_MAX_TTL
+#define DNS_CACHE_NEG_MAX_TTL 300u
+#endif
+#ifndef DNS_CACHE_FAIL_TTL
+#define DNS_CACHE_FAIL_TTL    5u        /* timeouts and SERVFAIL/REFUSED */
+#endif
+#ifndef DNS_CACHE_RETRY_MS
+#define DNS_CACHE_RETRY_MS    1000u
+#endif
+#ifndef DNS_CACHE_TRIES
+#define DNS_CACHE_TRIES       3
+#endif
+
+#define DNS_NAME_MAX          128
+
+/* Result status; same values as TSUKASA_DNS_*. */
+#define DNS_STATUS_OK         0
+#define DNS_STATUS_NOTFOUND   1         /* NXDOMAIN or no A record */
+#define DNS_STATUS_FAILED     2         /* timeout, server error, no network */
+
+/* Same layout as struct tsukasa_net_dns_result. */
+typedef struct dns_result {
+    int32_t status;
+    uint8_t ip[4];
+    uint32_t ttl;                       /* seconds the answer stays cached */
+} dns_result_t;
+
+typedef struct dns_cache_stats {
+    uint64_t lookups;
+    uint64_t hits;                      /* answered from a positive entry */
+    uint64_t negative_hits;             /* answered from a cached failure */
+    uint64_t misses;                    /* started a query */
+    uint64_t joins;                     /* waited on another lookup's query */
+    uint64_t queries_sent;              /* datagrams, retries included */
+    uint64_t timeouts;
+    uint64_t evictions;
+} dns_cache_stats_t;
+
+/* One row of dns_cache_snapshot(). */
+typedef struct dns_cache_info {
+    char name[DNS_NAME_MAX];
+    int pending;
+    dns_result_t result;                /* ttl is the time left */
+    uint64_t hits;
+} dns_cache_info_t;
+
+typedef struct dns_query dns_query_t;
+
+/**
+ * Resolve `name` (or parse it as a dotted quad), waiting for the answer.
+ *
+ * @return 0 with `out` filled, or -1 if it does not resolve or the wait was
+ *         interrupted by a signal.
+ */
+int dns_cache_lookup(const char *name, uint8_t out[4]);
+
+/**
+ * Start an asynchronous lookup.  A cached name completes at once.
+ *
+ * @return The query, or NULL on a bad name or no memory.
+ */
+dns_query_t *dns_query_start(const char *name);
+
+/** VFS_POLLIN once the query has a result, else 0. */
+int dns_query_poll_mask(dns_query_t *q);
+
+/**
+ * Fetch the result, waiting for it unless `nonblock`.
+ *
+ * @return 0, or -1 if it would block or the wait was interrupted.
+ */
+int dns_query_result(dns_query_t *q, int nonblock, dns_result_t *out);
+
+/** Drop the query; an unfinished lookup keeps running for the cache. */
+void dns_query_release(dns_query_t *q);
+
+/**
+ * Copy up to `max` live entries into `out` and the counters into `stats`
+ * (either may be NULL).
+ *
+ * @return The number of entries copied.
+ */
+int dns_cache_snapshot(dns_cache_info_t *out, int max, dns_cache_stats_t *stats);
+
+#endif /* TSUKASA_NET_DNS_CACHE_H */
@@ -0,0 +1,69 @@
+/*
+ * lwip_profile.h - Build-time lwIP tuning profiles.
+ *
+ * Included at the end of lwipopts.h, so a profile overrides the defaults
+ * set there.  Pick one with `make ARCH=x86_64 NET_PROFILE=throughput`;
+ * the default profile changes nothing.
+ *
+ * throughput: a window of 64 full segments with window scaling, a matching
+ * send buffer, SACK and timestamps, and pools sized so a few such
+ * connections do not run the stack dry.  Measure with /bin/iperf and
+ * /bin/udpgen; /sys/net/stats shows the values in effect.
+ */
+
+#ifndef TSUKASA_LWIP_PROFILE_H
+#define TSUKASA_LWIP_PROFILE_H
+
+#if defined(TSUKASA_NET_PROFILE_THROUGHPUT)
+
+#define TSUKASA_NET_PROFILE_NAME "throughput"
+
+#undef  TCP_MSS
+#define TCP_MSS                 1460
+
+/* Scale 2 lets the 16-bit window field carry up to 256 KiB. */
+#undef  LWIP_WND_SCALE
+#define LWIP_WND_SCALE          1
+#undef  TCP_RCV_SCALE
+#define TCP_RCV_SCALE           2
+#undef  TCP_WND
+#define TCP_WND                 (64 * TCP_MSS)
+
+#undef  TCP_SND_BUF
+#define TCP_SND_BUF             (64 * TCP_MSS)
+#undef  TCP_SND_QUEUELEN
+#define TCP_SND_QUEUELEN        ((4 * TCP_SND_BUF + (TCP_MSS - 1)) / TCP_MSS)
+#undef  TCP_OVERSIZE
+#define TCP_OVERSIZE            TCP_MSS
+
+#undef  LWIP_TCP_SACK_OUT
+#define LWIP_TCP_SACK_OUT       1
+#undef  LWIP_TCP_MAX_SACK_NUM
+#define LWIP_TCP_MAX_SACK_NUM   4
+#undef  LWIP_TCP_TIMESTAMPS
+#define LWIP_TCP_TIMESTAMPS     1
+#undef  TCP_QUEUE_OOSEQ
+#define TCP_QUEUE_OOSEQ         1
+
+#undef  MEMP_NUM_TCP_SEG
+#define MEMP_NUM_TCP_SEG        (2 * TCP_SND_QUEUELEN)
+#undef  MEMP_NUM_PBUF
+#define MEMP_NUM_PBUF           256
+#undef  PBUF_POOL_SIZE
+#define PBUF_POOL_SIZE          512
+#undef  MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB        32
+#undef  MEMP_NUM_TCP_PCB_LISTEN
+#define MEMP_NUM_TCP_PCB_LISTEN 16
+#undef  MEMP_NUM_UDP_PCB
+#define MEMP_NUM_UDP_PCB        16
+#undef  MEM_SIZE
+#define MEM_SIZE                (512 * 1024)
+
+#else
+
+#define TSUKASA_NET_PROFILE_NAME "default"
+
+#endif /* TSUKASA_NET_PROFILE_THROUGHPUT */
+
+#endif /* TSUKASA_LWIP_PROFILE_H */
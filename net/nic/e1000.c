@@ -1,5 +1,11 @@
 /*
  * e1000.c - Intel 82540/82545 class NIC driver (QEMU e1000 path).
+ *
+ * TX: frames go out by copy or scatter-gather, with IPv4/TCP/UDP checksums
+ * filled in by the hardware through context descriptors.  Completions are
+ * reaped in bulk; when the ring is full, frames wait in a software backlog
+ * (with the TX-done interrupt armed) instead of being dropped.  Inside a
+ * nic_batch_begin()/end() pair the TDT and RDT doorbells are written once.
  */
 
 #include "e1000.h"
@@ -8,7 +14,7 @@
 
 #include "../../dev/pci.h"
 #include "../../drv/irq.h"
-#include "../../drv/pic.h"
+#include "../../include/kutils.h"
 #include "../../mm/vmm_x64.h"
 
 #include <stddef.h>
@@ -21,7 +27,9 @@
 #define E1000_REG_CTRL   0x0000
 #define E1000_REG_STATUS 0x0008
 #define E1000_REG_ICR    0x00C0
+#define E1000_REG_ITR    0x00C4
 #define E1000_REG_IMS    0x00D0
+#define E1000_REG_IMC    0x00D8
 
 #define E1000_REG_RCTL   0x0100
 #define E1000_REG_RDBAL  0x2800
@@ -54,8 +62,44 @@
 #define E1000_RCTL_SECRC     (1u << 26)
 #define E1000_RCTL_BSIZE_2048 0
 
-#define E1000_TX_RING_SIZE 32
-#define E1000_RX_RING_SIZE 32
+#define E1000_IMS_DEFAULT 0x1F6DCu
+
+/* Interrupt throttling: ITR counts 256 ns units between interrupts. */
+#ifndef E1000_MAX_IRQ_PER_SEC
+#define E1000_MAX_IRQ_PER_SEC 8000u
+#endif
+#define E1000_ITR_VALUE (1000000000u / (E1000_MAX_IRQ_PER_SEC * 256u))
+
+/* Ring sizes are build-time tunables; descriptor rings must be 128-byte multiples. */
+#ifndef E1000_TX_RING_SIZE
+#define E1000_TX_RING_SIZE 256
+#endif
+#ifndef E1000_RX_RING_SIZE
+#define E1000_RX_RING_SIZE 256
+#endif
+#if (E1000_TX_RING_SIZE % 8) != 0 || E1000_TX_RING_SIZE > 4096 || \
+    (E1000_RX_RING_SIZE % 8) != 0 || E1000_RX_RING_SIZE > 4096
+#error "e1000 ring sizes must be multiples of 8, at most 4096"
+#endif
+
+/* Frames held in software while the TX ring is full. */
+#ifndef E1000_TX_BACKLOG
+#define E1000_TX_BACKLOG 64
+#endif
+
+#define E1000_ICR_TXDW       (1u << 0)
+
+#define E1000_TXD_CMD_EOP    0x01u
+#define E1000_TXD_CMD_IFCS   0x02u
+#define E1000_TXD_CMD_RS     0x08u
+#define E1000_TXD_CMD_DEXT   0x20u
+#define E1000_TXD_DTYP_D     0x10u     /* extended data descriptor, in the cso byte */
+#define E1000_TXD_STAT_DD    0x01u
+#define E1000_TXD_POPTS_IXSM 0x01u
+#define E1000_TXD_POPTS_TXSM 0x02u
+
+#define E1000_CTX_TUCMD_TCP  0x01u
+#define E1000_CTX_TUCMD_IP   0x02u
 
 typedef struct e1000_tx_desc {
     uint64_t buffer_addr;
@@ -67,6 +111,20 @@ typedef struct e1000_tx_desc {
     uint16_t special;
 } __attribute__((packed)) e1000_tx_desc_t;
 
+/* Checksum context descriptor: occupies a TX ring slot. */
+typedef struct e1000_ctx_desc {
+    uint8_t ipcss;
+    uint8_t ipcso;
+    uint16_t ipcse;
+    uint8_t tucss;
+    uint8_t tucso;
+    uint16_t tucse;
+    uint32_t cmd_and_length;
+    uint8_t status;
+    uint8_t hdr_len;
+    uint16_t mss;
+} __attribute__((packed)) e1000_ctx_desc_t;
+
 typedef struct e1000_rx_desc {
     uint64_t buffer_addr;
     uint16_t length;
@@ -76,21 +134,57 @@ typedef struct e1000_rx_desc {
     uint16_t special;
 } __attribute__((packed)) e1000_rx_desc_t;
 
+/* Offsets the hardware checksums at; also the key for reusing a loaded context. */
+typedef struct e1000_csum_ctx {
+    uint8_t ipcss;
+    uint8_t ipcso;
+    uint16_t ipcse;
+    uint8_t tucss;
+    uint8_t tucso;
+    uint8_t tcp;
+} e1000_csum_ctx_t;
+
+/* A frame on its way to the ring, possibly parked in the backlog. */
+typedef struct e1000_tx_frame {
+    nic_tx_seg_t segs[NIC_TX_SG_MAX];
+    int nsegs;
+    void *token;
+    uint8_t popts;
+    e1000_csum_ctx_t ctx;
+    uint16_t seed;          /* pseudo-header sum for the TCP/UDP checksum field */
+} e1000_tx_frame_t;
+
 typedef struct e1000_state {
     int initialized;
     volatile uint32_t *mmio;
     uint8_t mac[6];
     uint8_t irq_line;
     uint16_t tx_tail;
+    uint16_t tx_clean;      /* oldest descriptor not yet reaped */
     uint16_t rx_tail;
+    uint32_t ims;
+    int batch_depth;
+    int tdt_dirty;
+    int rdt_dirty;
+    int ctx_valid;
+    e1000_csum_ctx_t ctx;   /* context the hardware holds */
+    uint16_t bl_head;
+    uint16_t bl_count;
 } e1000_state_t;
 
 static e1000_state_t g_e1000;
 
-static e1000_tx_desc_t g_tx_desc[E1000_TX_RING_SIZE] __attribute__((aligned(16)));
-static e1000_rx_desc_t g_rx_desc[E1000_RX_RING_SIZE] __attribute__((aligned(16)));
+static e1000_tx_desc_t g_tx_desc[E1000_TX_RING_SIZE] __attribute__((aligned(128)));
+static e1000_rx_desc_t g_rx_desc[E1000_RX_RING_SIZE] __attribute__((aligned(128)));
 static uint8_t g_tx_buf[E1000_TX_RING_SIZE][2048] __attribute__((aligned(16)));
-static uint8_t g_rx_buf[E1000_RX_RING_SIZE][2048] __attribute__((aligned(16)));
+static void *g_tx_token[E1000_TX_RING_SIZE];   /* set on a frame's last descriptor */
+static e1000_tx_frame_t g_tx_backlog[E1000_TX_BACKLOG];
+/* Copies of by-copy frames parked in the backlog, by backlog slot. */
+static uint8_t g_tx_backlog_buf[E1000_TX_BACKLOG][2048] __attribute__((aligned(16)));
+/* Ring buffers plus NIC_RX_LOAN_SPARE spares swapped in for lent frames. */
+static uint8_t g_rx_buf[E1000_RX_RING_SIZE + NIC_RX_LOAN_SPARE][NIC_RX_BUF_SIZE] __attribute__((aligned(16)));
+static uint16_t g_rx_buf_of_desc[E1000_RX_RING_SIZE];
+static nic_rx_spares_t g_rx_spares;
 
 static uint8_t g_supported_ids[] = {
     0x0E, /* 0x100E */
@@ -103,21 +197,6 @@ static uint64_t virt_to_phys_ptr(const void *ptr)
     return vmm_virt_to_phys((uintptr_t)ptr);
 }
 
-static void mem_copy(void *dst, const void *src, size_t n)
-{
-    uint8_t *d = (uint8_t *)dst;
-    const uint8_t *s = (const uint8_t *)src;
-    for (size_t i = 0; i < n; i++)
-        d[i] = s[i];
-}
-
-static void mem_zero(void *dst, size_t n)
-{
-    uint8_t *d = (uint8_t *)dst;
-    for (size_t i = 0; i < n; i++)
-        d[i] = 0;
-}
-
 static inline uint32_t e1000_read(uint32_t reg)
 {
     return g_e1000.mmio[reg / 4];
@@ -150,8 +229,24 @@ static void e1000_irq_cb(uint8_t irq, void *ctx)
     if (!g_e1000.initialized)
         return;
     (void)e1000_read(E1000_REG_ICR);
-    nic_note_irq();
-    (void)nic_poll_rx();
+    nic_rx_irq();
+}
+
+static void e1000_irq_disable(void)
+{
+    if (g_e1000.initialized)
+        e1000_write(E1000_REG_IMC, 0xFFFFFFFFu);
+}
+
+/* Unmask; a cause latched while masked fires at once, but report it too. */
+static int e1000_irq_enable(void)
+{
+    uint16_t idx;
+    if (!g_e1000.initialized)
+        return 0;
+    e1000_write(E1000_REG_IMS, g_e1000.ims);
+    idx = (uint16_t)((g_e1000.rx_tail + 1) % E1000_RX_RING_SIZE);
+    return (g_rx_desc[idx].status & 0x1u) ? 1 : 0;
 }
 
 static int e1000_get_mac(uint8_t mac_out[6])
@@ -170,28 +265,356 @@ static int e1000_link_up(void)
     return (e1000_read(E1000_REG_STATUS) & E1000_STATUS_LU) ? 1 : 0;
 }
 
-static int e1000_send_packet(const void *data, size_t len)
+/* --- doorbells ------------------------------------------------------------ */
+
+static void e1000_tx_doorbell(void)
 {
-    e1000_tx_desc_t *desc;
-    uint16_t next;
-    if (!g_e1000.initialized || !data || len == 0 || len > 1518)
+    if (g_e1000.batch_depth > 0)
+        g_e1000.tdt_dirty = 1;
+    else
+        e1000_write(E1000_REG_TDT, g_e1000.tx_tail);
+}
+
+static void e1000_rx_doorbell(void)
+{
+    if (g_e1000.batch_depth > 0)
+        g_e1000.rdt_dirty = 1;
+    else
+        e1000_write(E1000_REG_RDT, g_e1000.rx_tail);
+}
+
+static void e1000_batch_begin(void)
+{
+    g_e1000.batch_depth++;
+}
+
+static void e1000_batch_end(void)
+{
+    if (g_e1000.batch_depth == 0 || --g_e1000.batch_depth > 0)
+        return;
+    if (g_e1000.tdt_dirty) {
+        g_e1000.tdt_dirty = 0;
+        e1000_write(E1000_REG_TDT, g_e1000.tx_tail);
+    }
+    if (g_e1000.rdt_dirty) {
+        g_e1000.rdt_dirty = 0;
+        e1000_write(E1000_REG_RDT, g_e1000.rx_tail);
+    }
+}
+
+/* --- transmit ------------------------------------------------------------- */
+
+static uint16_t e1000_tx_free(void)
+{
+    uint16_t used = (uint16_t)((g_e1000.tx_tail + E1000_TX_RING_SIZE - g_e1000.tx_clean) %
+                               E1000_TX_RING_SIZE);
+    return (uint16_t)(E1000_TX_RING_SIZE - 1 - used);
+}
+
+static int e1000_csum_ctx_equal(const e1000_csum_ctx_t *a, const e1000_csum_ctx_t *b)
+{
+    return a->ipcss == b->ipcss && a->ipcso == b->ipcso && a->ipcse == b->ipcse &&
+           a->tucss == b->tucss && a->tucso == b->tucso && a->tcp == b->tcp;
+}
+
+/* Descriptors `f` needs, counting a context load if its offsets differ. */
+static uint16_t e1000_tx_frame_slots(const e1000_tx_frame_t *f)
+{
+    uint16_t n = (uint16_t)f->nsegs;
+    if (f->popts && !(g_e1000.ctx_valid && e1000_csum_ctx_equal(&g_e1000.ctx, &f->ctx)))
+        n++;
+    return n;
+}
+
+static uint32_t csum_add16(uint32_t sum, const uint8_t *p)
+{
+    return sum + (((uint32_t)p[0] << 8) | p[1]);
+}
+
+/*
+ * Work out checksum offload for a frame whose headers start at `frame`:
+ * IPv4 header checksum always, TCP/UDP too unless it is a fragment.
+ * Returns -1 when the headers run past `len` bytes.
+ */
+static int e1000_tx_csum_parse(const uint8_t *frame, size_t len, e1000_tx_frame_t *f)
+{
+    uint32_t ihl;
+    uint32_t l4;
+    uint32_t csum_at;
+    uint32_t sum = 0;
+    uint8_t proto;
+
+    f->popts = 0;
+    if (len < 14 + 20 || frame[12] != 0x08 || frame[13] != 0x00 || (frame[14] >> 4) != 4)
+        return 0;
+    ihl = (uint32_t)(frame[14] & 0x0Fu) * 4u;
+    if (ihl < 20 || 14 + ihl > len)
         return -1;
 
-    desc = &g_tx_desc[g_e1000.tx_tail];
-    if ((desc->status & 0x1u) == 0)
+    f->ctx.ipcss = 14;
+    f->ctx.ipcso = 14 + 10;
+    f->ctx.ipcse = (uint16_t)(14 + ihl - 1);
+    f->ctx.tucss = 0;
+    f->ctx.tucso = 0;
+    f->ctx.tcp = 0;
+    f->popts = E1000_TXD_POPTS_IXSM;
+
+    proto = frame[23];
+    if ((((uint32_t)frame[20] << 8) | frame[21]) & 0x3FFFu)
+        return 0;
+    if (proto != 6 && proto != 17)
+        return 0;
+    l4 = 14 + ihl;
+    csum_at = l4 + (proto == 6 ? 16u : 6u);
+    if (csum_at + 2 > len)
         return -1;
 
-    mem_copy(g_tx_buf[g_e1000.tx_tail], data, len);
+    for (int i = 0; i < 8; i += 2)
+        sum = csum_add16(sum, frame + 26 + i);
+    sum += proto;
+    sum += ((((uint32_t)frame[16] << 8) | frame[17])) - ihl;
+    while (sum >> 16)
+        sum = (sum & 0xFFFFu) + (sum >> 16);
+
+    f->seed = (uint16_t)sum;
+    f->ctx.tucss = (uint8_t)l4;
+    f->ctx.tucso = (uint8_t)csum_at;
+    f->ctx.tcp = proto == 6;
+    f->popts |= E1000_TXD_POPTS_TXSM;
+    return 0;
+}
+
+/* Clear the IP checksum and seed the TCP/UDP one, as the hardware expects. */
+static void e1000_tx_csum_apply(const e1000_tx_frame_t *f, uint8_t *frame)
+{
+    if (!(f->popts & E1000_TXD_POPTS_IXSM))
+        return;
+    frame[f->ctx.ipcso] = 0;
+    frame[f->ctx.ipcso + 1] = 0;
+    if (f->popts & E1000_TXD_POPTS_TXSM) {
+        frame[f->ctx.tucso] = (uint8_t)(f->seed >> 8);
+        frame[f->ctx.tucso + 1] = (uint8_t)f->seed;
+    }
+}
+
+static void e1000_tx_load_context(const e1000_csum_ctx_t *ctx)
+{
+    e1000_ctx_desc_t *cd = (e1000_ctx_desc_t *)&g_tx_desc[g_e1000.tx_tail];
+    uint32_t tucmd = E1000_TXD_CMD_DEXT | E1000_TXD_CMD_RS | E1000_CTX_TUCMD_IP;
+
+    if (ctx->tcp)
+        tucmd |= E1000_CTX_TUCMD_TCP;
+    cd->ipcss = ctx->ipcss;
+    cd->ipcso = ctx->ipcso;
+    cd->ipcse = ctx->ipcse;
+    cd->tucss = ctx->tucss;
+    cd->tucso = ctx->tucso;
+    cd->tucse = 0;
+    cd->cmd_and_length = tucmd << 24;
+    cd->status = 0;
+    cd->hdr_len = 0;
+    cd->mss = 0;
+    g_tx_token[g_e1000.tx_tail] = NULL;
+    g_e1000.tx_tail = (uint16_t)((g_e1000.tx_tail + 1) % E1000_TX_RING_SIZE);
+    g_e1000.ctx = *ctx;
+    g_e1000.ctx_valid = 1;
+}
+
+static void e1000_tx_post(uint64_t addr, size_t len, int last, uint8_t popts)
+{
+    e1000_tx_desc_t *desc = &g_tx_desc[g_e1000.tx_tail];
+    uint8_t cmd = (uint8_t)(E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS | (last ? E1000_TXD_CMD_EOP : 0));
+
+    desc->buffer_addr = addr;
     desc->length = (uint16_t)len;
-    desc->cmd = 0x0B; /* EOP | IFCS | RS */
+    if (popts) {
+        desc->cso = E1000_TXD_DTYP_D;
+        desc->cmd = (uint8_t)(cmd | E1000_TXD_CMD_DEXT);
+        desc->css = popts;
+    } else {
+        desc->cso = 0;
+        desc->cmd = cmd;
+        desc->css = 0;
+    }
     desc->status = 0;
+    desc->special = 0;
+    g_tx_token[g_e1000.tx_tail] = NULL;
+    g_e1000.tx_tail = (uint16_t)((g_e1000.tx_tail + 1) % E1000_TX_RING_SIZE);
+}
+
+/* Put `f` on the ring; the caller checked e1000_tx_frame_slots() fit. */
+static void e1000_tx_post_frame(const e1000_tx_frame_t *f)
+{
+    uint16_t last;
+
+    if (f->popts && !(g_e1000.ctx_valid && e1000_csum_ctx_equal(&g_e1000.ctx, &f->ctx)))
+        e1000_tx_load_context(&f->ctx);
+    for (int i = 0; i < f->nsegs; i++)
+        e1000_tx_post(virt_to_phys_ptr(f->segs[i].data), f->segs[i].len,
+                      i + 1 == f->nsegs, f->popts);
+    last = (uint16_t)((g_e1000.tx_tail + E1000_TX_RING_SIZE - 1) % E1000_TX_RING_SIZE);
+    g_tx_token[last] = f->token;
+}
 
-    next = (uint16_t)((g_e1000.tx_tail + 1) % E1000_TX_RING_SIZE);
-    g_e1000.tx_tail = next;
-    e1000_write(E1000_REG_TDT, next);
+/* Ring buffer for the data descriptor of a by-copy frame posted now. */
+static uint8_t *e1000_tx_copy_slot(const e1000_tx_frame_t *f)
+{
+    uint16_t slots = e1000_tx_frame_slots(f);
+    return g_tx_buf[(g_e1000.tx_tail + slots - 1) % E1000_TX_RING_SIZE];
+}
+
+/* Backlogged by-copy frames move into their ring slot's buffer on the way out. */
+static void e1000_tx_post_backlogged(e1000_tx_frame_t *f, uint16_t slot)
+{
+    if (f->segs[0].data == g_tx_backlog_buf[slot]) {
+        uint8_t *dst = e1000_tx_copy_slot(f);
+        k_memcpy(dst, g_tx_backlog_buf[slot], f->segs[0].len);
+        f->segs[0].data = dst;
+    }
+    e1000_tx_post_frame(f);
+}
+
+static void e1000_tx_drain_backlog(void)
+{
+    int posted = 0;
+
+    while (g_e1000.bl_count > 0) {
+        uint16_t slot = g_e1000.bl_head;
+        e1000_tx_frame_t *f = &g_tx_backlog[slot];
+
+        if (e1000_tx_free() < e1000_tx_frame_slots(f))
+            break;
+        e1000_tx_post_backlogged(f, slot);
+        g_e1000.bl_head = (uint16_t)((slot + 1) % E1000_TX_BACKLOG);
+        g_e1000.bl_count--;
+        posted = 1;
+    }
+    if (g_e1000.bl_count == 0 && (g_e1000.ims & E1000_ICR_TXDW)) {
+        g_e1000.ims &= ~E1000_ICR_TXDW;
+        e1000_write(E1000_REG_IMC, E1000_ICR_TXDW);
+    }
+    if (posted)
+        e1000_tx_doorbell();
+}
+
+/*
+ * Every descriptor asks for status write-back (RS), so DD walks the ring
+ * in order and frames spanning several descriptors reap cleanly.  Freed
+ * room goes to the backlog first.
+ */
+static void e1000_tx_reap(void)
+{
+    if (!g_e1000.initialized)
+        return;
+    while (g_e1000.tx_clean != g_e1000.tx_tail) {
+        uint16_t i = g_e1000.tx_clean;
+        void *token;
+
+        if ((g_tx_desc[i].status & E1000_TXD_STAT_DD) == 0)
+            break;
+        token = g_tx_token[i];
+        g_tx_token[i] = NULL;
+        g_e1000.tx_clean = (uint16_t)((i + 1) % E1000_TX_RING_SIZE);
+        nic_tx_complete(token);
+    }
+    e1000_tx_drain_backlog();
+}
+
+/* Whether `f` can go on the ring now without overtaking parked frames. */
+static int e1000_tx_fits(const e1000_tx_frame_t *f)
+{
+    return g_e1000.bl_count == 0 && e1000_tx_free() >= e1000_tx_frame_slots(f);
+}
+
+static void e1000_tx_send_now(const e1000_tx_frame_t *f)
+{
+    e1000_tx_post_frame(f);
+    e1000_tx_doorbell();
+}
+
+/* Park `f` until reaping frees room; a TX-done interrupt is armed meanwhile. */
+static int e1000_tx_park(const e1000_tx_frame_t *f)
+{
+    uint16_t slot;
+
+    if (g_e1000.bl_count >= E1000_TX_BACKLOG)
+        return -1;
+    slot = (uint16_t)((g_e1000.bl_head + g_e1000.bl_count) % E1000_TX_BACKLOG);
+    g_tx_backlog[slot] = *f;
+    g_e1000.bl_count++;
+    if (!(g_e1000.ims & E1000_ICR_TXDW)) {
+        g_e1000.ims |= E1000_ICR_TXDW;
+        e1000_write(E1000_REG_IMS, E1000_ICR_TXDW);
+    }
     return 0;
 }
 
+static int e1000_send_packet(const void *data, size_t len)
+{
+    e1000_tx_frame_t f;
+    uint8_t *dst;
+
+    if (!g_e1000.initialized || !data || len == 0 || len > 1518)
+        return -1;
+
+    f.nsegs = 1;
+    f.token = NULL;
+    f.segs[0].len = len;
+    if (e1000_tx_csum_parse((const uint8_t *)data, len, &f) != 0)
+        f.popts = 0;
+    if (!e1000_tx_fits(&f))
+        e1000_tx_reap();
+
+    if (e1000_tx_fits(&f)) {
+        dst = e1000_tx_copy_slot(&f);
+        k_memcpy(dst, data, len);
+        e1000_tx_csum_apply(&f, dst);
+        f.segs[0].data = dst;
+        e1000_tx_send_now(&f);
+        return 0;
+    }
+    if (g_e1000.bl_count >= E1000_TX_BACKLOG)
+        return -1;
+    dst = g_tx_backlog_buf[(g_e1000.bl_head + g_e1000.bl_count) % E1000_TX_BACKLOG];
+    k_memcpy(dst, data, len);
+    e1000_tx_csum_apply(&f, dst);
+    f.segs[0].data = dst;
+    return e1000_tx_park(&f);
+}
+
+/* One descriptor per segment; EOP on the last one.  Headers must be in segment 0. */
+static int e1000_send_sg(const nic_tx_seg_t *segs, int nsegs, void *token)
+{
+    e1000_tx_frame_t f;
+    size_t total = 0;
+
+    if (!g_e1000.initialized || !segs || nsegs <= 0 || nsegs > NIC_TX_SG_MAX)
+        return -1;
+    for (int i = 0; i < nsegs; i++) {
+        total += segs[i].len;
+        f.segs[i] = segs[i];
+    }
+    if (total == 0 || total > 1518)
+        return -1;
+    f.nsegs = nsegs;
+    f.token = token;
+    if (e1000_tx_csum_parse((const uint8_t *)segs[0].data, segs[0].len, &f) != 0)
+        return -1;
+    if (!e1000_tx_fits(&f))
+        e1000_tx_reap();
+    if (!e1000_tx_fits(&f) && g_e1000.bl_count >= E1000_TX_BACKLOG)
+        return -1;
+
+    e1000_tx_csum_apply(&f, (uint8_t *)(uintptr_t)segs[0].data);
+    if (e1000_tx_fits(&f)) {
+        e1000_tx_send_now(&f);
+        return 0;
+    }
+    return e1000_tx_park(&f);
+}
+
+/* --- receive ------------------------------------------------------------- */
+
 static int e1000_receive_packet(void *buffer, size_t max_len)
 {
     uint16_t idx;
@@ -208,15 +631,57 @@ static int e1000_receive_packet(void *buffer, size_t max_len)
     len = desc->length;
     if (len > max_len)
         len = (uint16_t)max_len;
-    mem_copy(buffer, g_rx_buf[idx], len);
+    k_memcpy(buffer, g_rx_buf[g_rx_buf_of_desc[idx]], len);
 
     desc->status = 0;
     desc->length = 0;
     g_e1000.rx_tail = idx;
-    e1000_write(E1000_REG_RDT, idx);
+    e1000_rx_doorbell();
     return (int)len;
 }
 
+/*
+ * Lend the frame's buffer and point the descriptor at a spare before
+ * handing it back to the hardware, so the frame is never copied.
+ */
+static int e1000_rx_loan(nic_rx_loan_t *out)
+{
+    uint16_t idx;
+    uint16_t buf;
+    e1000_rx_desc_t *desc;
+    int spare;
+
+    if (!g_e1000.initialized || !out)
+        return 0;
+
+    idx = (uint16_t)((g_e1000.rx_tail + 1) % E1000_RX_RING_SIZE);
+    desc = &g_rx_desc[idx];
+    if ((desc->status & 0x1u) == 0)
+        return 0;
+    spare = nic_rx_spares_get(&g_rx_spares);
+    if (spare < 0)
+        return -1;
+
+    buf = g_rx_buf_of_desc[idx];
+    out->data = g_rx_buf[buf];
+    out->len = desc->length;
+    out->cookie = buf;
+
+    g_rx_buf_of_desc[idx] = (uint16_t)spare;
+    desc->buffer_addr = virt_to_phys_ptr(g_rx_buf[spare]);
+    desc->status = 0;
+    desc->length = 0;
+    g_e1000.rx_tail = idx;
+    e1000_rx_doorbell();
+    return (int)out->len;
+}
+
+static void e1000_rx_return(uint32_t cookie)
+{
+    if (cookie < sizeof(g_rx_buf) / sizeof(g_rx_buf[0]))
+        nic_rx_spares_put(&g_rx_spares, (uint16_t)cookie);
+}
+
 static int e1000_attach(const pci_device_info_t *dev)
 {
     uintptr_t mmio_virt = 0;
@@ -259,14 +724,18 @@ static int e1000_attach(const pci_device_info_t *dev)
     g_e1000.mac[4] = (uint8_t)(rah & 0xFFu);
     g_e1000.mac[5] = (uint8_t)((rah >> 8) & 0xFFu);
 
-    mem_zero(g_tx_desc, sizeof(g_tx_desc));
-    mem_zero(g_rx_desc, sizeof(g_rx_desc));
+    k_memset(g_tx_desc, 0, sizeof(g_tx_desc));
+    k_memset(g_rx_desc, 0, sizeof(g_rx_desc));
     for (int i = 0; i < E1000_TX_RING_SIZE; i++) {
         g_tx_desc[i].buffer_addr = virt_to_phys_ptr(g_tx_buf[i]);
-        g_tx_desc[i].status = 0x1;
+        g_tx_desc[i].status = E1000_TXD_STAT_DD;
+        g_tx_token[i] = NULL;
     }
-    for (int i = 0; i < E1000_RX_RING_SIZE; i++)
+    for (int i = 0; i < E1000_RX_RING_SIZE; i++) {
+        g_rx_buf_of_desc[i] = (uint16_t)i;
         g_rx_desc[i].buffer_addr = virt_to_phys_ptr(g_rx_buf[i]);
+    }
+    nic_rx_spares_init(&g_rx_spares, E1000_RX_RING_SIZE, NIC_RX_LOAN_SPARE);
 
     e1000_write(E1000_REG_TDBAL, (uint32_t)(virt_to_phys_ptr(g_tx_desc) & 0xFFFFFFFFu));
     e1000_write(E1000_REG_TDBAH, (uint32_t)(virt_to_phys_ptr(g_tx_desc) >> 32));
@@ -274,6 +743,13 @@ static int e1000_attach(const pci_device_info_t *dev)
     e1000_write(E1000_REG_TDH, 0);
     e1000_write(E1000_REG_TDT, 0);
     g_e1000.tx_tail = 0;
+    g_e1000.tx_clean = 0;
+    g_e1000.bl_head = 0;
+    g_e1000.bl_count = 0;
+    g_e1000.ctx_valid = 0;
+    g_e1000.batch_depth = 0;
+    g_e1000.tdt_dirty = 0;
+    g_e1000.rdt_dirty = 0;
 
     e1000_write(E1000_REG_RDBAL, (uint32_t)(virt_to_phys_ptr(g_rx_desc) & 0xFFFFFFFFu));
     e1000_write(E1000_REG_RDBAH, (uint32_t)(virt_to_phys_ptr(g_rx_desc) >> 32));
@@ -286,7 +762,9 @@ static int e1000_attach(const pci_device_info_t *dev)
     e1000_write(E1000_REG_TIPG, 0x0060200A);
     e1000_write(E1000_REG_RCTL, E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC | E1000_RCTL_BSIZE_2048);
     e1000_write(E1000_REG_CTRL, e1000_read(E1000_REG_CTRL) | E1000_CTRL_SLU);
-    e1000_write(E1000_REG_IMS, 0x1F6DCu);
+    e1000_write(E1000_REG_ITR, E1000_ITR_VALUE);
+    g_e1000.ims = E1000_IMS_DEFAULT;
+    e1000_write(E1000_REG_IMS, g_e1000.ims);
     (void)e1000_read(E1000_REG_ICR);
 
     g_e1000.initialized = 1;
@@ -295,20 +773,26 @@ static int e1000_attach(const pci_device_info_t *dev)
     nic_dev.model_name = "intel 8254x";
     nic_dev.irq_line = dev->irq_line;
     nic_dev.mtu = 1500;
+    nic_dev.features = NIC_F_TX_CSUM;
     nic_dev.ops.tx = e1000_send_packet;
     nic_dev.ops.rx_poll = e1000_receive_packet;
     nic_dev.ops.get_mac = e1000_get_mac;
     nic_dev.ops.link_up = e1000_link_up;
     nic_dev.ops.irq_ack = NULL;
+    nic_dev.ops.rx_loan = e1000_rx_loan;
+    nic_dev.ops.rx_return = e1000_rx_return;
+    nic_dev.ops.tx_sg = e1000_send_sg;
+    nic_dev.ops.tx_reap = e1000_tx_reap;
+    nic_dev.ops.irq_disable = e1000_irq_disable;
+    nic_dev.ops.irq_enable = e1000_irq_enable;
+    nic_dev.ops.batch_begin = e1000_batch_begin;
+    nic_dev.ops.batch_end = e1000_batch_end;
     nic_dev.priv = NULL;
 
     if (nic_register_active(&nic_dev) != 0)
         return -1;
 
-    if (dev->irq_line < 16) {
-        irq_register_handler(dev->irq_line, e1000_irq_cb, NULL);
-        pic_unmask_irq(dev->irq_line);
-    }
+    (void)pci_irq_attach(dev, PCI_IRQ_ANY, e1000_irq_cb, NULL, NIC_IRQ_CPU);
     return 0;
 }
 
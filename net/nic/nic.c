@@ -5,8 +5,12 @@
 #include "nic.h"
 
 #include "../../dev/pci.h"
+#include "../../drv/pit.h"
 #include "../../include/kprintf.h"
+#include "../../include/kutils.h"
 #include "../../include/spinlock.h"
+#include "../../include/trace.h"
+#include "../../proc/process.h"
 #include "e1000.h"
 #include "virtio_net.h"
 
@@ -18,6 +22,13 @@ static int g_active_valid;
 static nic_stats_t g_stats;
 static nic_rx_callback_t g_rx_cb;
 static void *g_rx_cb_ctx;
+static nic_rx_loan_callback_t g_rx_loan_cb;
+static void *g_rx_loan_cb_ctx;
+static nic_tx_done_callback_t g_tx_done_cb;
+static wait_queue_t g_rx_wq;
+static volatile int g_rx_scheduled;
+static int g_rx_worker;
+static int g_rx_budget = NIC_RX_BUDGET;
 static int g_nic_inited;
 
 int nic_register_active(const nic_device_t *dev)
@@ -52,8 +63,10 @@ void nic_init(void)
     g_active_valid = 0;
     g_rx_cb = NULL;
     g_rx_cb_ctx = NULL;
-    for (size_t i = 0; i < sizeof(g_stats); i++)
-        ((uint8_t *)&g_stats)[i] = 0;
+    g_rx_loan_cb = NULL;
+    g_rx_loan_cb_ctx = NULL;
+    g_tx_done_cb = NULL;
+    k_memset(&g_stats, 0, sizeof(g_stats));
 
     (void)virtio_net_register_pci_driver();
     (void)e1000_register_pci_driver();
@@ -95,6 +108,7 @@ int nic_send(const void *data, size_t len)
         return -1;
 
     rc = g_active_dev.ops.tx(data, len);
+    TRACE(TRACE_EV_NIC_SEND, len, rc);
     if (rc == 0) {
         g_stats.tx_packets++;
         g_stats.tx_bytes += len;
@@ -102,17 +116,97 @@ int nic_send(const void *data, size_t len)
     return rc;
 }
 
-int nic_poll_rx(void)
+int nic_send_sg(const nic_tx_seg_t *segs, int nsegs, void *token)
+{
+    size_t len = 0;
+    int rc;
+    if (!g_active_valid || !g_active_dev.ops.tx_sg || !segs ||
+        nsegs <= 0 || nsegs > NIC_TX_SG_MAX)
+        return -1;
+
+    for (int i = 0; i < nsegs; i++)
+        len += segs[i].len;
+    rc = g_active_dev.ops.tx_sg(segs, nsegs, token);
+    TRACE(TRACE_EV_NIC_SEND, len, rc);
+    if (rc == 0) {
+        g_stats.tx_packets++;
+        g_stats.tx_bytes += len;
+        g_stats.tx_zero_copy++;
+    }
+    return rc;
+}
+
+int nic_tx_sg_supported(void)
+{
+    return (g_active_valid && g_active_dev.ops.tx_sg) ? 1 : 0;
+}
+
+int nic_has_feature(uint32_t feature)
+{
+    return (g_active_valid && (g_active_dev.features & feature) == feature) ? 1 : 0;
+}
+
+void nic_batch_begin(void)
+{
+    if (g_active_valid && g_active_dev.ops.batch_begin)
+        g_active_dev.ops.batch_begin();
+}
+
+void nic_batch_end(void)
+{
+    if (g_active_valid && g_active_dev.ops.batch_end)
+        g_active_dev.ops.batch_end();
+}
+
+void nic_set_tx_done_callback(nic_tx_done_callback_t cb)
+{
+    g_tx_done_cb = cb;
+}
+
+void nic_tx_complete(void *token)
+{
+    if (g_tx_done_cb && token)
+        g_tx_done_cb(token);
+}
+
+/* Hand up to `budget` frames to the callbacks; returns bytes, sets *frames. */
+static int nic_rx_pass(int budget, int *frames)
 {
     uint8_t frame[2048];
     int total = 0;
     int loops = 0;
+    *frames = 0;
     if (!g_active_valid || !g_active_dev.ops.rx_poll)
         return 0;
 
+    if (g_active_dev.ops.tx_reap)
+        g_active_dev.ops.tx_reap();
     g_stats.rx_poll_calls++;
+    /* Replies sent while handling this pass share one doorbell. */
+    nic_batch_begin();
     for (;;) {
-        int got = g_active_dev.ops.rx_poll(frame, sizeof(frame));
+        int got;
+
+        if (g_rx_loan_cb && g_active_dev.ops.rx_loan) {
+            nic_rx_loan_t loan;
+            got = g_active_dev.ops.rx_loan(&loan);
+            if (got == 0)
+                break;
+            if (got > 0) {
+                loops++;
+                g_stats.rx_packets++;
+                g_stats.rx_bytes += (uint64_t)got;
+                g_stats.rx_zero_copy++;
+                g_rx_loan_cb(&loan, g_rx_loan_cb_ctx);
+                total += got;
+                if (loops >= budget)
+                    break;
+                continue;
+            }
+            /* Out of spares: copy this one out and recycle it in place. */
+        }
+
+        got = g_active_dev.ops.rx_poll(frame, sizeof(frame));
         if (got <= 0)
             break;
         loops++;
@@ -124,18 +218,173 @@ int nic_poll_rx(void)
             g_stats.rx_dropped++;
         }
         total += got;
-        if (loops >= 64)
+        if (loops >= budget)
             break;
     }
+    nic_batch_end();
+    if (loops > 0)
+        TRACE(TRACE_EV_NIC_POLL_RX, loops, total);
+    *frames = loops;
     return total;
 }
 
+int nic_poll_rx(void)
+{
+    int frames;
+    return nic_rx_pass(g_rx_budget, &frames);
+}
+
+int nic_poll_rx_budget(int budget)
+{
+    int frames;
+    if (budget <= 0)
+        budget = g_rx_budget;
+    (void)nic_rx_pass(budget, &frames);
+    if (frames >= budget)
+        g_stats.rx_budget_hits++;
+    return frames;
+}
+
+void nic_rx_irq(void)
+{
+    nic_note_irq();
+    if (!g_rx_worker) {
+        (void)nic_poll_rx();
+        return;
+    }
+    if (g_active_valid && g_active_dev.ops.irq_disable)
+        g_active_dev.ops.irq_disable();
+    g_rx_scheduled = 1;
+    wait_queue_wake_all(&g_rx_wq);
+}
+
+int nic_rx_wait(uint64_t deadline)
+{
+    while (!g_rx_scheduled) {
+        int pending;
+
+        if (deadline && pit_ticks() >= deadline)
+            return 1;
+        if (wait_queue_prepare_until(&g_rx_wq, deadline) != 0)
+            return -1;
+        /*
+         * prepare() parks us and leaves interrupts off until finish(), so
+         * nic_rx_irq() runs either before this read (and we see the flag)
+         * or after the yield (and wakes us); never in between.  finish()
+         * also undoes a wake that lands while we are still on the CPU.
+         */
+        pending = g_rx_scheduled;
+        if (!pending)
+            process_yield();
+        wait_queue_finish(&g_rx_wq);
+    }
+    g_stats.rx_worker_runs++;
+    return 0;
+}
+
+int nic_rx_rearm(void)
+{
+    g_rx_scheduled = 0;
+    if (g_active_valid && g_active_dev.ops.irq_enable && g_active_dev.ops.irq_enable()) {
+        g_rx_scheduled = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int nic_rx_worker_active(void)
+{
+    return g_rx_worker;
+}
+
+void nic_set_rx_worker(int active)
+{
+    g_rx_worker = active ? 1 : 0;
+    if (!g_rx_worker && g_active_valid && g_active_dev.ops.irq_enable)
+        (void)g_active_dev.ops.irq_enable();
+}
+
+int nic_rx_budget(void)
+{
+    return g_rx_budget;
+}
+
+void nic_set_rx_budget(int budget)
+{
+    if (budget < 1)
+        budget = 1;
+    if (budget > NIC_RX_BUDGET_MAX)
+        budget = NIC_RX_BUDGET_MAX;
+    g_rx_budget = budget;
+}
+
 void nic_set_rx_callback(nic_rx_callback_t cb, void *ctx)
 {
     g_rx_cb = cb;
     g_rx_cb_ctx = ctx;
 }
 
+void nic_set_rx_loan_callback(nic_rx_loan_callback_t cb, void *ctx)
+{
+    g_rx_loan_cb = cb;
+    g_rx_loan_cb_ctx = ctx;
+}
+
+void nic_rx_return(uint32_t cookie)
+{
+    if (g_active_valid && g_active_dev.ops.rx_return)
+        g_active_dev.ops.rx_return(cookie);
+}
+
+static inline uint64_t irq_save_disable(void)
+{
+    uint64_t flags = 0;
+    __asm__ volatile ("pushfq; popq %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint64_t flags)
+{
+    if (flags & (1ULL << 9))
+        __asm__ volatile ("sti" : : : "memory");
+    else
+        __asm__ volatile ("cli" : : : "memory");
+}
+
+void nic_rx_spares_init(nic_rx_spares_t *s, uint16_t first, uint16_t count)
+{
+    if (count > NIC_RX_LOAN_SPARE)
+        count = NIC_RX_LOAN_SPARE;
+    s->lock = SPINLOCK_INIT;
+    s->count = count;
+    for (uint16_t i = 0; i < count; i++)
+        s->idx[i] = (uint16_t)(first + i);
+}
+
+int nic_rx_spares_get(nic_rx_spares_t *s)
+{
+    uint64_t flags = irq_save_disable();
+    int idx = -1;
+
+    spin_lock(&s->lock);
+    if (s->count > 0)
+        idx = s->idx[--s->count];
+    spin_unlock(&s->lock);
+    irq_restore(flags);
+    return idx;
+}
+
+void nic_rx_spares_put(nic_rx_spares_t *s, uint16_t idx)
+{
+    uint64_t flags = irq_save_disable();
+
+    spin_lock(&s->lock);
+    if (s->count < NIC_RX_LOAN_SPARE)
+        s->idx[s->count++] = idx;
+    spin_unlock(&s->lock);
+    irq_restore(flags);
+}
+
 void nic_get_stats(nic_stats_t *out)
 {
     if (!out)
@@ -158,7 +407,41 @@ int nic_get_mac(uint8_t mac_out[6]) { (void)mac_out; return -1; }
 int nic_link_up(void) { return 0; }
 int nic_send(const void *data, size_t len) { (void)data; (void)len; return -1; }
 int nic_poll_rx(void) { return 0; }
+void nic_rx_irq(void) {}
+int nic_poll_rx_budget(int budget) { (void)budget; return 0; }
+int nic_rx_wait(uint64_t deadline) { (void)deadline; return -1; }
+int nic_rx_rearm(void) { return 0; }
+int nic_rx_worker_active(void) { return 0; }
+void nic_set_rx_worker(int active) { (void)active; }
+int nic_rx_budget(void) { return NIC_RX_BUDGET; }
+void nic_set_rx_budget(int budget) { (void)budget; }
+int nic_send_sg(const nic_tx_seg_t *segs, int nsegs, void *token) { (void)segs; (void)nsegs; (void)token; return -1; }
+int nic_tx_sg_supported(void) { return 0; }
+int nic_has_feature(uint32_t feature) { (void)feature; return 0; }
+void nic_batch_begin(void) {}
+void nic_batch_end(void) {}
+void nic_set_tx_done_callback(nic_tx_done_callback_t cb) { (void)cb; }
+void nic_tx_complete(void *token) { (void)token; }
 void nic_set_rx_callback(nic_rx_callback_t cb, void *ctx) { (void)cb; (void)ctx; }
+void nic_set_rx_loan_callback(nic_rx_loan_callback_t cb, void *ctx) { (void)cb; (void)ctx; }
+void nic_rx_return(uint32_t cookie) { (void)cookie; }
+void nic_rx_spares_init(nic_rx_spares_t *s, uint16_t first, uint16_t count) { (void)s; (void)first; (void)count; }
+int nic_rx_spares_get(nic_rx_spares_t *s) { (void)s; return -1; }
+void nic_rx_spares_put(nic_rx_spares_t *s, uint16_t idx) { (void)s; (void)idx; }
 void nic_get_stats(nic_stats_t *out) { (void)out; }
 
+void nic_stack_tuning(nic_stack_tuning_t *out)
+{
+    if (!out)
+        return;
+    out->profile = "none";
+    out->tcp_mss = 0;
+    out->tcp_wnd = 0;
+    out->tcp_snd_buf = 0;
+    out->tcp_wnd_scale = 0;
+    out->tcp_sack = 0;
+    out->pbuf_pool_size = 0;
+    out->tcp_pcbs = 0;
+}
+
 #endif /* __x86_64__ */
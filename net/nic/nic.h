@@ -8,6 +8,25 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "../../include/spinlock.h"
+
+#define NIC_RX_BUF_SIZE    2048
+#define NIC_RX_LOAN_SPARE  64       /* buffers a lending driver keeps beyond its ring */
+#define NIC_TX_SG_MAX      8        /* segments per scatter-gather frame */
+#define NIC_TX_MIN_FRAME   60       /* shorter frames need padding, so go by copy */
+
+#ifndef NIC_RX_BUDGET
+#define NIC_RX_BUDGET      64       /* frames per RX worker pass before yielding */
+#endif
+#define NIC_RX_BUDGET_MAX  256
+
+#ifndef NIC_IRQ_CPU
+#define NIC_IRQ_CPU        0        /* CPU that NIC MSI/IOAPIC interrupts are steered to */
+#endif
+
+/* nic_device_t.features */
+#define NIC_F_TX_CSUM      0x1u     /* fills IPv4/TCP/UDP checksums on transmit */
+
 typedef struct nic_stats {
     uint64_t tx_packets;
     uint64_t tx_bytes;
@@ -16,27 +35,93 @@ typedef struct nic_stats {
     uint64_t rx_dropped;
     uint64_t irq_count;
     uint64_t rx_poll_calls;
+    uint64_t rx_zero_copy;      /* frames handed up in a loaned ring buffer */
+    uint64_t tx_zero_copy;      /* frames sent straight from the caller's segments */
+    uint64_t rx_worker_runs;    /* RX worker passes */
+    uint64_t rx_budget_hits;    /* passes that used the whole budget */
 } nic_stats_t;
 
+/*
+ * A received frame lent out in place.  The driver has already put a spare
+ * buffer on the descriptor, so the ring keeps running; the borrower hands
+ * `cookie` back through nic_rx_return() when it is done with `data`.
+ */
+typedef struct nic_rx_loan {
+    uint8_t *data;
+    size_t len;
+    uint32_t cookie;
+} nic_rx_loan_t;
+
+/* One piece of a scatter-gather frame. */
+typedef struct nic_tx_seg {
+    const void *data;
+    size_t len;
+} nic_tx_seg_t;
+
 typedef struct nic_device_ops {
     int (*tx)(const void *data, size_t len);
     int (*rx_poll)(void *buffer, size_t max_len);
     int (*get_mac)(uint8_t mac_out[6]);
     int (*link_up)(void);
     void (*irq_ack)(void);
+    /*
+     * Optional buffer loan.  rx_loan() returns the frame length, 0 when
+     * nothing is pending, or -1 when the pending frame cannot be lent
+     * (no spare left, or it spans several buffers); the caller then
+     * copies it out with rx_poll().  rx_return()
+     * may be called from any context.
+     */
+    int (*rx_loan)(nic_rx_loan_t *out);
+    void (*rx_return)(uint32_t cookie);
+    /*
+     * Optional scatter-gather transmit: one descriptor per segment, no
+     * copy.  The segments must stay untouched until the driver reports
+     * the frame done through nic_tx_complete(token) from tx_reap(), which
+     * nic_poll_rx() and the driver's own tx paths call.
+     */
+    int (*tx_sg)(const nic_tx_seg_t *segs, int nsegs, void *token);
+    void (*tx_reap)(void);
+    /*
+     * Optional RX interrupt masking for the deferred worker.  irq_enable()
+     * returns nonzero if frames arrived while masked, so the worker keeps
+     * polling instead of waiting for an interrupt that may never come.
+     */
+    void (*irq_disable)(void);
+    int (*irq_enable)(void);
+    /*
+     * Optional doorbell coalescing: between batch_begin() and the matching
+     * batch_end() the driver may hold back tail-register writes and issue
+     * one at the end.  Calls nest.
+     */
+    void (*batch_begin)(void);
+    void (*batch_end)(void);
 } nic_device_ops_t;
 
+/* Spare-buffer indices of a lending driver; safe from IRQ context. */
+typedef struct nic_rx_spares {
+    spinlock_t lock;
+    uint16_t count;
+    uint16_t idx[NIC_RX_LOAN_SPARE];
+} nic_rx_spares_t;
+
 typedef struct nic_device {
     const char *driver_name;
     const char *model_name;
     uint8_t irq_line;
     uint16_t mtu;
+    uint32_t features;          /* NIC_F_* */
     nic_device_ops_t ops;
     void *priv;
 } nic_device_t;
 
 typedef void (*nic_rx_callback_t)(const uint8_t *frame, size_t len, void *ctx);
 
+/* Takes ownership of the loan; must end in nic_rx_return(loan->cookie). */
+typedef void (*nic_rx_loan_callback_t)(const nic_rx_loan_t *loan, void *ctx);
+
+/* A frame sent with nic_send_sg() has left the NIC; its segments are free. */
+typedef void (*nic_tx_done_callback_t)(void *token);
+
 void nic_init(void);
 int nic_register_active(const nic_device_t *dev);
 int nic_ready(void);
@@ -47,8 +132,70 @@ int nic_link_up(void);
 int nic_send(const void *data, size_t len);
 int nic_poll_rx(void);
 
+/*
+ * Deferred RX.  Drivers call nic_rx_irq() from their interrupt handler.
+ * Once a worker has claimed RX with nic_set_rx_worker(1), that masks the
+ * NIC's interrupts and wakes the worker, which loops:
+ *
+ *     nic_rx_wait(deadline);  n = nic_poll_rx_budget(budget);
+ *     if (n < budget && !nic_rx_rearm()) -> wait again, else yield and repeat
+ *
+ * nic_rx_wait() returns 0 once RX is pending, 1 when pit_ticks() reaches
+ * `deadline` first (0 = no deadline), or -1 if the caller cannot sleep.
+ * Without a worker, nic_rx_irq() polls inline as before.
+ */
+void nic_rx_irq(void);
+int nic_poll_rx_budget(int budget);
+int nic_rx_wait(uint64_t deadline);
+int nic_rx_rearm(void);
+int nic_rx_worker_active(void);
+void nic_set_rx_worker(int active);
+int nic_rx_budget(void);
+void nic_set_rx_budget(int budget);
+
+/**
+ * Send a frame gathered from `segs` without copying it.  On success the
+ * segments belong to the driver until the done callback gets `token`; on
+ * failure (-1: unsupported, too many segments, ring full) nothing is held.
+ * A NIC_F_TX_CSUM driver may rewrite the checksum fields in the headers,
+ * which must then lie within the first segment.
+ */
+int nic_send_sg(const nic_tx_seg_t *segs, int nsegs, void *token);
+int nic_tx_sg_supported(void);
+int nic_has_feature(uint32_t feature);
+void nic_batch_begin(void);
+void nic_batch_end(void);
+void nic_set_tx_done_callback(nic_tx_done_callback_t cb);
+void nic_tx_complete(void *token);
+
 void nic_set_rx_callback(nic_rx_callback_t cb, void *ctx);
+
+/**
+ * Receive by loan instead of by copy when the active driver supports it.
+ * Frames that cannot be lent still go to the copy callback.
+ */
+void nic_set_rx_loan_callback(nic_rx_loan_callback_t cb, void *ctx);
+void nic_rx_return(uint32_t cookie);
+
+void nic_rx_spares_init(nic_rx_spares_t *s, uint16_t first, uint16_t count);
+int nic_rx_spares_get(nic_rx_spares_t *s);
+void nic_rx_spares_put(nic_rx_spares_t *s, uint16_t idx);
 void nic_get_stats(nic_stats_t *out);
 void nic_note_irq(void);
 
+/* lwIP build options in effect (see net/lwip_profile.h), for /sys/net/stats. */
+typedef struct nic_stack_tuning {
+    const char *profile;
+    uint32_t tcp_mss;
+    uint32_t tcp_wnd;
+    uint32_t tcp_snd_buf;
+    uint32_t tcp_wnd_scale;     /* receive window shift; 0 without scaling */
+    uint32_t tcp_sack;
+    uint32_t pbuf_pool_size;
+    uint32_t tcp_pcbs;
+} nic_stack_tuning_t;
+
+/** Implemented by nic_netif.c, which sees lwipopts.h. */
+void nic_stack_tuning(nic_stack_tuning_t *out);
+
 #endif /* TSUKASA_NET_NIC_H */
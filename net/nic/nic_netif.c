@@ -1,14 +1,78 @@
 /*
  * nic_netif.c - lwIP netif bridge to unified NIC abstraction.
+ *
+ * When the NIC lends its ring buffers, received frames go up the stack as
+ * PBUF_REF custom pbufs over the driver's memory, and the buffer returns
+ * to the driver from pbuf_free().  Otherwise frames are copied into pool
+ * pbufs as before.
+ *
+ * On transmit, a chain goes out one descriptor per pbuf when the NIC can
+ * gather: the chain is referenced until the driver reaps the completion,
+ * so TCP segments reach the wire without being copied.  lwIP does not
+ * retransmit a segment whose pbuf is still referenced.
+ *
+ * Received frames are fed to lwIP from the "net-rx" kernel process rather
+ * than from the NIC interrupt: the IRQ masks the NIC and wakes it, and it
+ * polls in budgeted passes, yielding between them, until the ring drains.
+ * The same process fires lwIP's timeouts every NIC_NETIF_TIMER_MS, so TCP
+ * retransmits, ARP and DHCP keep running while callers sleep.
  */
 
 #include "nic_netif.h"
 
 #include "nic.h"
 
+#include "../../drv/pit.h"
+#include "../../proc/process.h"
+
 #include "lwip/etharp.h"
 #include "lwip/pbuf.h"
 #include "lwip/stats.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+
+#ifndef NIC_NETIF_TIMER_MS
+#define NIC_NETIF_TIMER_MS 50u
+#endif
+
+/* A profile only takes effect when lwipopts.h pulls it in last. */
+#if defined(TSUKASA_NET_PROFILE_THROUGHPUT) && !defined(TSUKASA_LWIP_PROFILE_H)
+#error "NET_PROFILE=throughput needs lwipopts.h to include lwip_profile.h at its end"
+#endif
+#ifndef TSUKASA_NET_PROFILE_NAME
+#define TSUKASA_NET_PROFILE_NAME "default"
+#endif
+
+static void nic_tx_done(void *token)
+{
+    pbuf_free((struct pbuf *)token);
+}
+
+/* Hand the chain to the NIC in place; -1 if it has to be copied instead. */
+static int nic_output_sg(struct pbuf *p)
+{
+    nic_tx_seg_t segs[NIC_TX_SG_MAX];
+    int n = 0;
+
+    if (!nic_tx_sg_supported() || p->tot_len < NIC_TX_MIN_FRAME)
+        return -1;
+    for (struct pbuf *q = p; q; q = q->next) {
+        if (q->len == 0)
+            continue;
+        if (n == NIC_TX_SG_MAX)
+            return -1;
+        segs[n].data = q->payload;
+        segs[n].len = q->len;
+        n++;
+    }
+
+    pbuf_ref(p);
+    if (nic_send_sg(segs, n, p) != 0) {
+        pbuf_free(p);
+        return -1;
+    }
+    return 0;
+}
 
 static err_t nic_low_level_output(struct netif *netif, struct pbuf *p)
 {
@@ -17,7 +81,9 @@ static err_t nic_low_level_output(struct netif *netif, struct pbuf *p)
     if (!p)
         return ERR_ARG;
 
-    if (!p->next) {
+    if (nic_output_sg(p) == 0) {
+        rc = 0;
+    } else if (!p->next) {
         rc = nic_send(p->payload, p->len);
     } else {
         uint8_t frame[2048];
@@ -59,6 +125,130 @@ static void nic_rx_to_lwip(const uint8_t *frame, size_t len, void *ctx)
     LINK_STATS_INC(link.recv);
 }
 
+#if LWIP_SUPPORT_CUSTOM_PBUF
+
+typedef struct nic_rx_pbuf {
+    struct pbuf_custom pc;
+    uint32_t cookie;
+    uint16_t slot;
+} nic_rx_pbuf_t;
+
+/* One wrapper per loan a driver can have out at once. */
+static nic_rx_pbuf_t g_rx_pbufs[NIC_RX_LOAN_SPARE];
+static nic_rx_spares_t g_rx_pbuf_free;
+
+static void nic_rx_pbuf_free(struct pbuf *p)
+{
+    nic_rx_pbuf_t *rp = (nic_rx_pbuf_t *)p;
+
+    nic_rx_return(rp->cookie);
+    nic_rx_spares_put(&g_rx_pbuf_free, rp->slot);
+}
+
+static void nic_rx_loan_to_lwip(const nic_rx_loan_t *loan, void *ctx)
+{
+    struct netif *netif = (struct netif *)ctx;
+    nic_rx_pbuf_t *rp;
+    struct pbuf *p;
+    int slot;
+
+    if (!netif || loan->len == 0 || loan->len > NIC_RX_BUF_SIZE) {
+        nic_rx_return(loan->cookie);
+        return;
+    }
+    slot = nic_rx_spares_get(&g_rx_pbuf_free);
+    if (slot < 0) {
+        nic_rx_to_lwip(loan->data, loan->len, ctx);
+        nic_rx_return(loan->cookie);
+        return;
+    }
+
+    rp = &g_rx_pbufs[slot];
+    rp->cookie = loan->cookie;
+    rp->pc.custom_free_function = nic_rx_pbuf_free;
+    p = pbuf_alloced_custom(PBUF_RAW, (u16_t)loan->len, PBUF_REF, &rp->pc,
+                            loan->data, (u16_t)loan->len);
+    if (!p) {
+        nic_rx_return(loan->cookie);
+        nic_rx_spares_put(&g_rx_pbuf_free, (uint16_t)slot);
+        LINK_STATS_INC(link.drop);
+        return;
+    }
+
+    if (netif->input(p, netif) != ERR_OK) {
+        pbuf_free(p);
+        LINK_STATS_INC(link.drop);
+        return;
+    }
+    LINK_STATS_INC(link.recv);
+}
+
+static void nic_netif_enable_loans(struct netif *netif)
+{
+    for (uint16_t i = 0; i < NIC_RX_LOAN_SPARE; i++)
+        g_rx_pbufs[i].slot = i;
+    nic_rx_spares_init(&g_rx_pbuf_free, 0, NIC_RX_LOAN_SPARE);
+    nic_set_rx_loan_callback(nic_rx_loan_to_lwip, netif);
+}
+
+#else
+
+static void nic_netif_enable_loans(struct netif *netif)
+{
+    (void)netif;
+}
+
+#endif /* LWIP_SUPPORT_CUSTOM_PBUF */
+
+static uint64_t nic_timer_ticks(void)
+{
+    uint64_t ticks = (uint64_t)pit_frequency() * NIC_NETIF_TIMER_MS / 1000u;
+    return ticks ? ticks : 1;
+}
+
+static void nic_rx_worker_entry(void)
+{
+    uint64_t next_timer = 0;
+
+    for (;;) {
+        SYS_ARCH_DECL_PROTECT(lev);
+        int budget = nic_rx_budget();
+        int done;
+        int rc;
+
+        rc = nic_rx_wait(next_timer);
+        if (pit_ticks() >= next_timer) {
+            SYS_ARCH_PROTECT(lev);
+            sys_check_timeouts();
+            SYS_ARCH_UNPROTECT(lev);
+            next_timer = pit_ticks() + nic_timer_ticks();
+        }
+        if (rc > 0)
+            continue;
+        if (rc < 0) {
+            process_yield();
+            continue;
+        }
+        SYS_ARCH_PROTECT(lev);
+        done = nic_poll_rx_budget(budget);
+        SYS_ARCH_UNPROTECT(lev);
+        if (done < budget && !nic_rx_rearm())
+            continue;
+        process_yield();
+    }
+}
+
+static void nic_netif_start_rx_worker(void)
+{
+    static int started;
+    if (started)
+        return;
+    if (!process_spawn_kernel("net-rx", nic_rx_worker_entry))
+        return;
+    started = 1;
+    nic_set_rx_worker(1);
+}
+
 err_t nic_netif_init(struct netif *netif)
 {
     if (!netif || !nic_ready())
@@ -77,11 +267,43 @@ err_t nic_netif_init(struct netif *netif)
     netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
     if (nic_link_up())
         netif->flags |= NETIF_FLAG_LINK_UP;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+    /* The NIC fills these in on transmit; lwIP still verifies received ones. */
+    if (nic_has_feature(NIC_F_TX_CSUM))
+        NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_ENABLE_ALL &
+                                ~(NETIF_CHECKSUM_GEN_IP | NETIF_CHECKSUM_GEN_UDP |
+                                  NETIF_CHECKSUM_GEN_TCP));
+#endif
 
     nic_set_rx_callback(nic_rx_to_lwip, netif);
+    nic_set_tx_done_callback(nic_tx_done);
+    nic_netif_enable_loans(netif);
+    nic_netif_start_rx_worker();
     return ERR_OK;
 }
 
+void nic_stack_tuning(nic_stack_tuning_t *out)
+{
+    if (!out)
+        return;
+    out->profile = TSUKASA_NET_PROFILE_NAME;
+    out->tcp_mss = TCP_MSS;
+    out->tcp_wnd = TCP_WND;
+    out->tcp_snd_buf = TCP_SND_BUF;
+#if LWIP_WND_SCALE
+    out->tcp_wnd_scale = TCP_RCV_SCALE;
+#else
+    out->tcp_wnd_scale = 0;
+#endif
+#if LWIP_TCP_SACK_OUT
+    out->tcp_sack = LWIP_TCP_MAX_SACK_NUM;
+#else
+    out->tcp_sack = 0;
+#endif
+    out->pbuf_pool_size = PBUF_POOL_SIZE;
+    out->tcp_pcbs = MEMP_NUM_TCP_PCB;
+}
+
 void nic_netif_poll(struct netif *netif)
 {
     (void)netif;
@@ -1,5 +1,16 @@
 /*
- * virtio_net.c - Legacy PCI virtio-net (QEMU-first path).
+ * virtio_net.c - PCI virtio-net (QEMU-first path).
+ *
+ * Drives the virtio 1.0 PCI transport (common/notify/ISR/device config
+ * windows found through vendor capabilities and mapped from the BARs)
+ * and falls back to the legacy I/O-port interface on devices without it.
+ * Everything above the transport - rings, RX loans, scatter-gather TX,
+ * interrupt suppression - is shared.
+ *
+ * Negotiated when offered: VERSION_1, MAC, STATUS, MRG_RXBUF (12-byte
+ * header, frames spread over several RX buffers are reassembled on the
+ * copy path) and EVENT_IDX (doorbells and interrupts only when the other
+ * side asks for them).
  */
 
 #include "virtio_net.h"
@@ -8,8 +19,9 @@
 
 #include "../../dev/pci.h"
 #include "../../drv/irq.h"
-#include "../../drv/pic.h"
 #include "../../include/io.h"
+#include "../../include/kprintf.h"
+#include "../../include/kutils.h"
 #include "../../mm/vmm_x64.h"
 
 #include <stddef.h>
@@ -21,6 +33,7 @@
 #define VIRTIO_DEVICE_NET_LEGACY      0x1000
 #define VIRTIO_DEVICE_NET_MODERN_PCI  0x1041
 
+/* Legacy I/O-port registers. */
 #define VIRTIO_PCI_HOST_FEATURES  0x00
 #define VIRTIO_PCI_GUEST_FEATURES 0x04
 #define VIRTIO_PCI_QUEUE_PFN      0x08
@@ -31,9 +44,59 @@
 #define VIRTIO_PCI_ISR            0x13
 #define VIRTIO_PCI_CONFIG         0x14
 
+/* virtio 1.0 vendor capability types. */
+#define VIRTIO_PCI_CAP_COMMON_CFG 1
+#define VIRTIO_PCI_CAP_NOTIFY_CFG 2
+#define VIRTIO_PCI_CAP_ISR_CFG    3
+#define VIRTIO_PCI_CAP_DEVICE_CFG 4
+
+/* struct virtio_pci_common_cfg offsets. */
+#define VIRTIO_COMMON_DFSELECT    0x00
+#define VIRTIO_COMMON_DF          0x04
+#define VIRTIO_COMMON_GFSELECT    0x08
+#define VIRTIO_COMMON_GF          0x0C
+#define VIRTIO_COMMON_MSIX_CONFIG 0x10
+#define VIRTIO_COMMON_STATUS      0x14
+#define VIRTIO_COMMON_Q_SELECT    0x16
+#define VIRTIO_COMMON_Q_SIZE      0x18
+#define VIRTIO_COMMON_Q_MSIX      0x1A
+#define VIRTIO_COMMON_Q_ENABLE    0x1C
+#define VIRTIO_COMMON_Q_NOFF      0x1E
+#define VIRTIO_COMMON_Q_DESCLO    0x20
+#define VIRTIO_COMMON_Q_DESCHI    0x24
+#define VIRTIO_COMMON_Q_AVAILLO   0x28
+#define VIRTIO_COMMON_Q_AVAILHI   0x2C
+#define VIRTIO_COMMON_Q_USEDLO    0x30
+#define VIRTIO_COMMON_Q_USEDHI    0x34
+#define VIRTIO_MSI_NO_VECTOR      0xFFFF
+
+#define VIRTIO_STATUS_ACK         0x01
+#define VIRTIO_STATUS_DRIVER      0x02
+#define VIRTIO_STATUS_DRIVER_OK   0x04
+#define VIRTIO_STATUS_FEATURES_OK 0x08
+#define VIRTIO_STATUS_FAILED      0x80
+
+#define VIRTIO_NET_F_MAC          (1ULL << 5)
+#define VIRTIO_NET_F_MRG_RXBUF    (1ULL << 15)
+#define VIRTIO_NET_F_STATUS       (1ULL << 16)
+#define VIRTIO_F_NOTIFY_ON_EMPTY  (1ULL << 24)
+#define VIRTIO_RING_F_EVENT_IDX   (1ULL << 29)
+#define VIRTIO_F_VERSION_1        (1ULL << 32)
+
+#define VIRTIO_NET_WANTED_FEATURES (VIRTIO_NET_F_MAC | VIRTIO_NET_F_MRG_RXBUF | \
+                                    VIRTIO_NET_F_STATUS | VIRTIO_RING_F_EVENT_IDX)
+
+#define VIRTIO_NET_S_LINK_UP      1
+
 #define VRING_DESC_F_NEXT  1
 #define VRING_DESC_F_WRITE 2
 
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+#define VRING_USED_F_NO_NOTIFY     1
+
+#define VIRTIO_RXQ 0
+#define VIRTIO_TXQ 1
+
 struct virtq_desc {
     uint64_t addr;
     uint32_t len;
@@ -65,8 +128,10 @@ struct virtqueue {
     uint16_t q_size;
     uint16_t last_used_idx;
     uint16_t last_avail_idx;
+    volatile uint16_t *notify;      /* modern doorbell; NULL on legacy */
 };
 
+/* The legacy header without MRG_RXBUF is the first 10 bytes. */
 struct virtio_net_hdr {
     uint8_t flags;
     uint8_t gso_type;
@@ -74,44 +139,194 @@ struct virtio_net_hdr {
     uint16_t gso_size;
     uint16_t csum_start;
     uint16_t csum_offset;
+    uint16_t num_buffers;
 } __attribute__((packed));
 
+#define VIRTIO_NET_HDR_LEGACY_LEN 10
+
 typedef struct virtio_net_state {
     int initialized;
+    int modern;
+    uint64_t features;
+    uint16_t hdr_len;
     uint16_t io_base;
     uint8_t mac[6];
     uint8_t irq_line;
+    uint32_t irq_mode;            /* PCI_IRQ_*; with MSI-X the ISR register is not read */
+
+    /* virtio 1.0 windows */
+    volatile uint8_t *common;
+    volatile uint8_t *notify_base;
+    uint32_t notify_mult;
+    volatile uint8_t *isr;
+    volatile uint8_t *devcfg;
 
     struct virtqueue rx_vq;
     struct virtqueue tx_vq;
+    uint16_t tx_free_head;      /* free TX descriptors, linked through next */
+    uint16_t tx_num_free;
 } virtio_net_state_t;
 
 static virtio_net_state_t g_virtio;
 
 static uint8_t g_rx_ring_mem[16384] __attribute__((aligned(4096)));
 static uint8_t g_tx_ring_mem[16384] __attribute__((aligned(4096)));
-static uint8_t g_rx_buffers[256][2048] __attribute__((aligned(16)));
+/* Ring buffers plus NIC_RX_LOAN_SPARE spares swapped in for lent frames. */
+static uint8_t g_rx_buffers[256 + NIC_RX_LOAN_SPARE][NIC_RX_BUF_SIZE] __attribute__((aligned(16)));
+static uint16_t g_rx_buf_of_desc[256];
+static nic_rx_spares_t g_rx_spares;
+/* Indexed by the head descriptor of each in-flight TX chain. */
 static uint8_t g_tx_buffers[256][2048] __attribute__((aligned(16)));
 static struct virtio_net_hdr g_tx_hdr[256] __attribute__((aligned(16)));
+static void *g_tx_token[256];
 
 static uint64_t virt_to_phys_ptr(const void *ptr)
 {
     return vmm_virt_to_phys((uintptr_t)ptr);
 }
 
-static void mem_zero(void *ptr, size_t n)
+static inline uint8_t mmio_read8(volatile uint8_t *base, uint32_t off)
+{
+    return *(volatile uint8_t *)(base + off);
+}
+
+static inline uint16_t mmio_read16(volatile uint8_t *base, uint32_t off)
+{
+    return *(volatile uint16_t *)(base + off);
+}
+
+static inline uint32_t mmio_read32(volatile uint8_t *base, uint32_t off)
+{
+    return *(volatile uint32_t *)(base + off);
+}
+
+static inline void mmio_write8(volatile uint8_t *base, uint32_t off, uint8_t v)
 {
-    uint8_t *p = (uint8_t *)ptr;
-    for (size_t i = 0; i < n; i++)
-        p[i] = 0;
+    *(volatile uint8_t *)(base + off) = v;
 }
 
-static void mem_copy(void *dst, const void *src, size_t n)
+static inline void mmio_write16(volatile uint8_t *base, uint32_t off, uint16_t v)
 {
-    uint8_t *d = (uint8_t *)dst;
-    const uint8_t *s = (const uint8_t *)src;
-    for (size_t i = 0; i < n; i++)
-        d[i] = s[i];
+    *(volatile uint16_t *)(base + off) = v;
+}
+
+static inline void mmio_write32(volatile uint8_t *base, uint32_t off, uint32_t v)
+{
+    *(volatile uint32_t *)(base + off) = v;
+}
+
+static int virtio_has(uint64_t feature)
+{
+    return (g_virtio.features & feature) ? 1 : 0;
+}
+
+/* --- transport ------------------------------------------------------------ */
+
+static uint8_t virtio_get_status(void)
+{
+    if (g_virtio.modern)
+        return mmio_read8(g_virtio.common, VIRTIO_COMMON_STATUS);
+    return io_inb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_STATUS));
+}
+
+static void virtio_set_status(uint8_t status)
+{
+    if (g_virtio.modern)
+        mmio_write8(g_virtio.common, VIRTIO_COMMON_STATUS, status);
+    else
+        io_outb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_STATUS), status);
+}
+
+static uint8_t virtio_read_isr(void)
+{
+    if (g_virtio.modern)
+        return mmio_read8(g_virtio.isr, 0);
+    return io_inb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_ISR));
+}
+
+static uint8_t virtio_cfg_read8(uint32_t off)
+{
+    if (g_virtio.modern)
+        return mmio_read8(g_virtio.devcfg, off);
+    return io_inb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_CONFIG + off));
+}
+
+static void virtio_notify(struct virtqueue *vq, uint16_t qidx)
+{
+    if (vq->notify)
+        *vq->notify = qidx;
+    else
+        io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_NOTIFY), qidx);
+}
+
+/* Offer what we want of the device's features; 0 once both sides agree. */
+static int virtio_negotiate(void)
+{
+    uint64_t host;
+
+    if (g_virtio.modern) {
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_DFSELECT, 0);
+        host = mmio_read32(g_virtio.common, VIRTIO_COMMON_DF);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_DFSELECT, 1);
+        host |= (uint64_t)mmio_read32(g_virtio.common, VIRTIO_COMMON_DF) << 32;
+        if (!(host & VIRTIO_F_VERSION_1))
+            return -1;
+
+        g_virtio.features = host & (VIRTIO_NET_WANTED_FEATURES | VIRTIO_F_VERSION_1);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_GFSELECT, 0);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_GF, (uint32_t)g_virtio.features);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_GFSELECT, 1);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_GF, (uint32_t)(g_virtio.features >> 32));
+
+        virtio_set_status(VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_FEATURES_OK);
+        if ((virtio_get_status() & VIRTIO_STATUS_FEATURES_OK) == 0)
+            return -1;
+    } else {
+        host = io_inl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_HOST_FEATURES));
+        g_virtio.features = host & (VIRTIO_NET_WANTED_FEATURES | VIRTIO_F_NOTIFY_ON_EMPTY);
+        io_outl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_GUEST_FEATURES), (uint32_t)g_virtio.features);
+    }
+
+    g_virtio.hdr_len = (virtio_has(VIRTIO_F_VERSION_1) || virtio_has(VIRTIO_NET_F_MRG_RXBUF))
+                       ? (uint16_t)sizeof(struct virtio_net_hdr)
+                       : (uint16_t)VIRTIO_NET_HDR_LEGACY_LEN;
+    return 0;
+}
+
+/* Map the first window of each capability type the driver needs. */
+static int virtio_modern_probe(const pci_device_info_t *dev)
+{
+    uint8_t cap = 0;
+
+    while ((cap = pci_find_capability(dev, PCI_CAP_ID_VENDOR, cap)) != 0) {
+        uint8_t type = pci_cached_read8(dev, (uint8_t)(cap + 3));
+        uint8_t bar = pci_cached_read8(dev, (uint8_t)(cap + 4));
+        uint32_t off = pci_cached_read32(dev, (uint8_t)(cap + 8));
+        uint32_t len = pci_cached_read32(dev, (uint8_t)(cap + 12));
+        volatile uint8_t **slot;
+        uint64_t phys;
+        uintptr_t virt = 0;
+
+        switch (type) {
+        case VIRTIO_PCI_CAP_COMMON_CFG: slot = &g_virtio.common; break;
+        case VIRTIO_PCI_CAP_NOTIFY_CFG: slot = &g_virtio.notify_base; break;
+        case VIRTIO_PCI_CAP_ISR_CFG:    slot = &g_virtio.isr; break;
+        case VIRTIO_PCI_CAP_DEVICE_CFG: slot = &g_virtio.devcfg; break;
+        default: continue;
+        }
+        if (*slot || len == 0)
+            continue;
+        phys = pci_bar_phys(dev, bar);
+        if (!phys || vmm_map_io_region(phys + off, len, &virt) != 0 || !virt)
+            continue;
+        *slot = (volatile uint8_t *)virt;
+        if (type == VIRTIO_PCI_CAP_NOTIFY_CFG)
+            g_virtio.notify_mult = pci_cached_read32(dev, (uint8_t)(cap + 16));
+    }
+
+    if (!g_virtio.common || !g_virtio.notify_base || !g_virtio.isr || !g_virtio.devcfg)
+        return -1;
+    return 0;
 }
 
 static void virtqueue_init(struct virtqueue *vq, uint8_t *mem, uint16_t qsize, size_t mem_size)
@@ -121,10 +336,11 @@ static void virtqueue_init(struct virtqueue *vq, uint8_t *mem, uint16_t qsize, s
     if (!vq || !mem || qsize == 0)
         return;
 
-    mem_zero(mem, mem_size);
+    k_memset(mem, 0, mem_size);
     vq->q_size = qsize;
     vq->last_used_idx = 0;
     vq->last_avail_idx = 0;
+    vq->notify = NULL;
 
     vq->desc = (struct virtq_desc *)mem;
     vq->avail = (struct virtq_avail *)(mem + qsize * sizeof(struct virtq_desc));
@@ -134,6 +350,85 @@ static void virtqueue_init(struct virtqueue *vq, uint8_t *mem, uint16_t qsize, s
     vq->used = (struct virtq_used *)used_start;
 }
 
+/* Size queue `qidx`, lay its ring out in `mem` and hand it to the device. */
+static int virtio_setup_queue(uint16_t qidx, struct virtqueue *vq, uint8_t *mem, size_t mem_size)
+{
+    uint16_t qsize;
+
+    if (g_virtio.modern) {
+        mmio_write16(g_virtio.common, VIRTIO_COMMON_Q_SELECT, qidx);
+        qsize = mmio_read16(g_virtio.common, VIRTIO_COMMON_Q_SIZE);
+    } else {
+        io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_SEL), qidx);
+        qsize = io_inw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_SIZE));
+    }
+    if (qsize == 0)
+        return -1;
+    if (qsize > 256)
+        qsize = 256;
+    virtqueue_init(vq, mem, qsize, mem_size);
+
+    if (g_virtio.modern) {
+        uint64_t desc = virt_to_phys_ptr(vq->desc);
+        uint64_t avail = virt_to_phys_ptr(vq->avail);
+        uint64_t used = virt_to_phys_ptr(vq->used);
+        uint16_t noff;
+
+        mmio_write16(g_virtio.common, VIRTIO_COMMON_Q_SIZE, qsize);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_Q_DESCLO, (uint32_t)desc);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_Q_DESCHI, (uint32_t)(desc >> 32));
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_Q_AVAILLO, (uint32_t)avail);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_Q_AVAILHI, (uint32_t)(avail >> 32));
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_Q_USEDLO, (uint32_t)used);
+        mmio_write32(g_virtio.common, VIRTIO_COMMON_Q_USEDHI, (uint32_t)(used >> 32));
+        /* Only RX interrupts; TX completions are reaped by polling. */
+        mmio_write16(g_virtio.common, VIRTIO_COMMON_Q_MSIX,
+                     (g_virtio.irq_mode == PCI_IRQ_MSIX && qidx == VIRTIO_RXQ) ? 0 : VIRTIO_MSI_NO_VECTOR);
+        noff = mmio_read16(g_virtio.common, VIRTIO_COMMON_Q_NOFF);
+        vq->notify = (volatile uint16_t *)(g_virtio.notify_base + (uint32_t)noff * g_virtio.notify_mult);
+        mmio_write16(g_virtio.common, VIRTIO_COMMON_Q_ENABLE, 1);
+    } else {
+        io_outl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_PFN),
+                (uint32_t)(virt_to_phys_ptr(mem) >> 12));
+    }
+    return 0;
+}
+
+/* --- ring helpers --------------------------------------------------------- */
+
+/* EVENT_IDX fields trail the avail and used rings. */
+static inline volatile uint16_t *vq_used_event(struct virtqueue *vq)
+{
+    return (volatile uint16_t *)((uintptr_t)vq->avail + 4u + 2u * vq->q_size);
+}
+
+static inline volatile uint16_t *vq_avail_event(struct virtqueue *vq)
+{
+    return (volatile uint16_t *)((uintptr_t)vq->used + 4u + 8u * vq->q_size);
+}
+
+static int vring_need_event(uint16_t event, uint16_t new_idx, uint16_t old_idx)
+{
+    return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old_idx);
+}
+
+/* After publishing avail entries from `old_idx` on: does the device want a doorbell? */
+static int virtio_kick_needed(struct virtqueue *vq, uint16_t old_idx)
+{
+    __asm__ volatile ("mfence" ::: "memory");
+    if (virtio_has(VIRTIO_RING_F_EVENT_IDX))
+        return vring_need_event(*vq_avail_event(vq), vq->avail->idx, old_idx);
+    return (vq->used->flags & VRING_USED_F_NO_NOTIFY) ? 0 : 1;
+}
+
+/* Ask for no interrupts from `vq` until re-enabled. */
+static void virtio_suppress_irq(struct virtqueue *vq)
+{
+    vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+    if (virtio_has(VIRTIO_RING_F_EVENT_IDX))
+        *vq_used_event(vq) = (uint16_t)(vq->last_used_idx - 1u);
+}
+
 static int virtio_match(const pci_device_info_t *dev)
 {
     if (!dev)
@@ -152,14 +447,37 @@ static void virtio_irq_cb(uint8_t irq, void *ctx)
     (void)ctx;
     if (!g_virtio.initialized)
         return;
-    (void)io_inb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_ISR));
-    nic_note_irq();
-    (void)nic_poll_rx();
+    if (g_virtio.irq_mode != PCI_IRQ_MSIX)
+        (void)virtio_read_isr();
+    nic_rx_irq();
+}
+
+static void virtio_irq_disable(void)
+{
+    if (g_virtio.initialized)
+        virtio_suppress_irq(&g_virtio.rx_vq);
+}
+
+/* Re-check after re-enabling: the device does not interrupt for buffers used before. */
+static int virtio_irq_enable(void)
+{
+    struct virtqueue *rxq = &g_virtio.rx_vq;
+    if (!g_virtio.initialized)
+        return 0;
+    rxq->avail->flags = 0;
+    if (virtio_has(VIRTIO_RING_F_EVENT_IDX))
+        *vq_used_event(rxq) = rxq->last_used_idx;
+    __asm__ volatile ("mfence" ::: "memory");
+    return rxq->last_used_idx != rxq->used->idx ? 1 : 0;
 }
 
 static int virtio_link_up(void)
 {
-    return g_virtio.initialized ? 1 : 0;
+    if (!g_virtio.initialized)
+        return 0;
+    if (virtio_has(VIRTIO_NET_F_STATUS))
+        return (virtio_cfg_read8(6) & VIRTIO_NET_S_LINK_UP) ? 1 : 0;
+    return 1;
 }
 
 static int virtio_get_mac(uint8_t mac_out[6])
@@ -171,174 +489,395 @@ static int virtio_get_mac(uint8_t mac_out[6])
     return 0;
 }
 
+/* --- transmit ------------------------------------------------------------- */
+
+/* Put finished TX chains back on the free list and report their tokens. */
+static void virtio_tx_reap(void)
+{
+    struct virtqueue *txq = &g_virtio.tx_vq;
+
+    if (!g_virtio.initialized)
+        return;
+    while (txq->last_used_idx != txq->used->idx) {
+        uint16_t head = (uint16_t)txq->used->ring[txq->last_used_idx % txq->q_size].id;
+        uint16_t d = head;
+        void *token = g_tx_token[head];
+
+        g_tx_token[head] = NULL;
+        g_virtio.tx_num_free++;
+        while (txq->desc[d].flags & VRING_DESC_F_NEXT) {
+            d = txq->desc[d].next;
+            g_virtio.tx_num_free++;
+        }
+        txq->desc[d].next = g_virtio.tx_free_head;
+        g_virtio.tx_free_head = head;
+        txq->last_used_idx++;
+        nic_tx_complete(token);
+    }
+    virtio_suppress_irq(txq);
+}
+
+/* Take a chain of `count` free descriptors, linked head to tail. */
+static int virtio_tx_take(uint16_t count, uint16_t *head_out)
+{
+    struct virtqueue *txq = &g_virtio.tx_vq;
+    uint16_t d;
+
+    if (g_virtio.tx_num_free < count)
+        virtio_tx_reap();
+    if (g_virtio.tx_num_free < count)
+        return -1;
+
+    d = g_virtio.tx_free_head;
+    *head_out = d;
+    for (uint16_t i = 0; i < count; i++) {
+        txq->desc[d].flags = (i + 1 < count) ? VRING_DESC_F_NEXT : 0;
+        if (i + 1 < count)
+            d = txq->desc[d].next;
+    }
+    g_virtio.tx_free_head = txq->desc[d].next;
+    g_virtio.tx_num_free = (uint16_t)(g_virtio.tx_num_free - count);
+    return 0;
+}
+
+/* Fill the header descriptor of chain `head` and return the next one. */
+static uint16_t virtio_tx_header(uint16_t head)
+{
+    struct virtqueue *txq = &g_virtio.tx_vq;
+
+    k_memset(&g_tx_hdr[head], 0, sizeof(struct virtio_net_hdr));
+    txq->desc[head].addr = virt_to_phys_ptr(&g_tx_hdr[head]);
+    txq->desc[head].len = g_virtio.hdr_len;
+    return txq->desc[head].next;
+}
+
+static void virtio_tx_kick(uint16_t head)
+{
+    struct virtqueue *txq = &g_virtio.tx_vq;
+    uint16_t old = txq->avail->idx;
+
+    txq->avail->ring[old % txq->q_size] = head;
+    __asm__ volatile ("mfence" ::: "memory");
+    txq->avail->idx = (uint16_t)(old + 1);
+    txq->last_avail_idx++;
+    if (virtio_kick_needed(txq, old))
+        virtio_notify(txq, VIRTIO_TXQ);
+}
+
 static int virtio_send_packet(const void *data, size_t length)
 {
     struct virtqueue *txq = &g_virtio.tx_vq;
     uint16_t head;
-    uint16_t d0;
     uint16_t d1;
     size_t wire_len = length < 60 ? 60 : length;
 
     if (!g_virtio.initialized || !data || length == 0 || length > 1514)
         return -1;
-
-    if ((uint16_t)(txq->avail->idx - txq->used->idx) >= (uint16_t)(txq->q_size - 2))
+    if (virtio_tx_take(2, &head) != 0)
         return -1;
 
-    head = (uint16_t)(txq->last_avail_idx % (txq->q_size / 2));
-    d0 = (uint16_t)(head * 2);
-    d1 = (uint16_t)(d0 + 1);
-
-    mem_zero(&g_tx_hdr[head], sizeof(struct virtio_net_hdr));
-    txq->desc[d0].addr = virt_to_phys_ptr(&g_tx_hdr[head]);
-    txq->desc[d0].len = sizeof(struct virtio_net_hdr);
-    txq->desc[d0].flags = VRING_DESC_F_NEXT;
-    txq->desc[d0].next = d1;
-
-    mem_copy(g_tx_buffers[head], data, length);
-    for (size_t i = length; i < wire_len; i++)
-        g_tx_buffers[head][i] = 0;
+    d1 = virtio_tx_header(head);
+    k_memcpy(g_tx_buffers[head], data, length);
+    if (wire_len > length)
+        k_memset(g_tx_buffers[head] + length, 0, wire_len - length);
 
     txq->desc[d1].addr = virt_to_phys_ptr(g_tx_buffers[head]);
     txq->desc[d1].len = (uint32_t)wire_len;
-    txq->desc[d1].flags = 0;
-    txq->desc[d1].next = 0;
+    g_tx_token[head] = NULL;
+    virtio_tx_kick(head);
+    return 0;
+}
 
-    txq->avail->ring[txq->avail->idx % txq->q_size] = d0;
-    __asm__ volatile ("mfence" ::: "memory");
-    txq->avail->idx++;
-    txq->last_avail_idx++;
-    __asm__ volatile ("mfence" ::: "memory");
-    io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_NOTIFY), 1);
+/* Chain the segments behind the header descriptor as they are. */
+static int virtio_send_sg(const nic_tx_seg_t *segs, int nsegs, void *token)
+{
+    struct virtqueue *txq = &g_virtio.tx_vq;
+    uint16_t head;
+    uint16_t d;
+    size_t total = 0;
+
+    if (!g_virtio.initialized || !segs || nsegs <= 0)
+        return -1;
+    for (int i = 0; i < nsegs; i++)
+        total += segs[i].len;
+    if (total < 60 || total > 1514)
+        return -1;
+    if (virtio_tx_take((uint16_t)(nsegs + 1), &head) != 0)
+        return -1;
+
+    d = virtio_tx_header(head);
+    for (int i = 0; i < nsegs; i++) {
+        txq->desc[d].addr = virt_to_phys_ptr(segs[i].data);
+        txq->desc[d].len = (uint32_t)segs[i].len;
+        d = txq->desc[d].next;
+    }
+    g_tx_token[head] = token;
+    virtio_tx_kick(head);
     return 0;
 }
 
-static int virtio_receive_packet(void *buffer, size_t buffer_size)
+/* --- receive -------------------------------------------------------------- */
+
+/* Take the next used RX descriptor; 0 if the ring is empty. */
+static int virtio_rx_next(uint32_t *d_idx, uint32_t *len)
 {
     struct virtqueue *rxq = &g_virtio.rx_vq;
     uint16_t used_idx;
+
+    if (rxq->last_used_idx == rxq->used->idx)
+        return 0;
+    used_idx = (uint16_t)(rxq->last_used_idx % rxq->q_size);
+    *d_idx = rxq->used->ring[used_idx].id;
+    *len = rxq->used->ring[used_idx].len;
+    rxq->last_used_idx++;
+    return 1;
+}
+
+/* Give descriptor `d_idx` back to the device. */
+static void virtio_rx_repost(uint32_t d_idx)
+{
+    struct virtqueue *rxq = &g_virtio.rx_vq;
+    uint16_t old = rxq->avail->idx;
+
+    rxq->avail->ring[old % rxq->q_size] = (uint16_t)d_idx;
+    __asm__ volatile ("mfence" ::: "memory");
+    rxq->avail->idx = (uint16_t)(old + 1);
+    if (virtio_kick_needed(rxq, old))
+        virtio_notify(rxq, VIRTIO_RXQ);
+}
+
+/* Buffers the frame at the head of the used ring spans (MRG_RXBUF). */
+static uint16_t virtio_rx_peek_buffers(void)
+{
+    struct virtqueue *rxq = &g_virtio.rx_vq;
+    const struct virtio_net_hdr *hdr;
+    uint32_t d_idx;
+
+    if (!virtio_has(VIRTIO_NET_F_MRG_RXBUF) || rxq->last_used_idx == rxq->used->idx)
+        return 1;
+    d_idx = rxq->used->ring[rxq->last_used_idx % rxq->q_size].id;
+    hdr = (const struct virtio_net_hdr *)g_rx_buffers[g_rx_buf_of_desc[d_idx]];
+    return hdr->num_buffers ? hdr->num_buffers : 1;
+}
+
+static int virtio_receive_packet(void *buffer, size_t buffer_size)
+{
     uint32_t d_idx;
     uint32_t len;
     uint32_t payload_len;
+    uint16_t nbufs;
     uint8_t *src;
-    uint8_t *dst = (uint8_t *)buffer;
 
     if (!g_virtio.initialized || !buffer || buffer_size == 0)
         return 0;
-    if (rxq->last_used_idx == rxq->used->idx)
+    nbufs = virtio_rx_peek_buffers();
+    if (!virtio_rx_next(&d_idx, &len))
         return 0;
 
-    used_idx = (uint16_t)(rxq->last_used_idx % rxq->q_size);
-    d_idx = rxq->used->ring[used_idx].id;
-    len = rxq->used->ring[used_idx].len;
-    rxq->last_used_idx++;
-
-    if (len <= sizeof(struct virtio_net_hdr)) {
-        rxq->avail->ring[rxq->avail->idx % rxq->q_size] = (uint16_t)d_idx;
-        rxq->avail->idx++;
-        io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_NOTIFY), 0);
+    if (len <= g_virtio.hdr_len) {
+        virtio_rx_repost(d_idx);
         return 0;
     }
 
-    payload_len = len - (uint32_t)sizeof(struct virtio_net_hdr);
+    payload_len = len - g_virtio.hdr_len;
     if (payload_len > buffer_size)
         payload_len = (uint32_t)buffer_size;
 
-    src = g_rx_buffers[d_idx] + sizeof(struct virtio_net_hdr);
-    for (uint32_t i = 0; i < payload_len; i++)
-        dst[i] = src[i];
-
-    rxq->avail->ring[rxq->avail->idx % rxq->q_size] = (uint16_t)d_idx;
-    __asm__ volatile ("mfence" ::: "memory");
-    rxq->avail->idx++;
-    __asm__ volatile ("mfence" ::: "memory");
-    io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_NOTIFY), 0);
+    src = g_rx_buffers[g_rx_buf_of_desc[d_idx]] + g_virtio.hdr_len;
+    k_memcpy(buffer, src, payload_len);
+    virtio_rx_repost(d_idx);
+
+    /* Follow-on buffers of a merged frame carry no header. */
+    for (uint16_t i = 1; i < nbufs; i++) {
+        uint32_t take;
+        if (!virtio_rx_next(&d_idx, &len))
+            break;
+        take = len;
+        if (take > buffer_size - payload_len)
+            take = (uint32_t)(buffer_size - payload_len);
+        k_memcpy((uint8_t *)buffer + payload_len, g_rx_buffers[g_rx_buf_of_desc[d_idx]], take);
+        payload_len += take;
+        virtio_rx_repost(d_idx);
+    }
     return (int)payload_len;
 }
 
+/*
+ * Lend the frame's buffer and put a spare on its descriptor instead, so
+ * the frame is never copied and the ring stays full while it is out.
+ * Merged frames are left for the copy path.
+ */
+static int virtio_rx_loan(nic_rx_loan_t *out)
+{
+    struct virtqueue *rxq = &g_virtio.rx_vq;
+
+    if (!g_virtio.initialized || !out)
+        return 0;
+
+    for (;;) {
+        uint32_t d_idx;
+        uint32_t len;
+        uint16_t buf;
+        int spare;
+
+        if (rxq->last_used_idx == rxq->used->idx)
+            return 0;
+        if (virtio_rx_peek_buffers() > 1)
+            return -1;
+        spare = nic_rx_spares_get(&g_rx_spares);
+        if (spare < 0)
+            return -1;
+        if (!virtio_rx_next(&d_idx, &len)) {
+            nic_rx_spares_put(&g_rx_spares, (uint16_t)spare);
+            return 0;
+        }
+
+        if (len <= g_virtio.hdr_len) {
+            nic_rx_spares_put(&g_rx_spares, (uint16_t)spare);
+            virtio_rx_repost(d_idx);
+            continue;
+        }
+
+        buf = g_rx_buf_of_desc[d_idx];
+        g_rx_buf_of_desc[d_idx] = (uint16_t)spare;
+        rxq->desc[d_idx].addr = virt_to_phys_ptr(g_rx_buffers[spare]);
+        virtio_rx_repost(d_idx);
+
+        out->data = g_rx_buffers[buf] + g_virtio.hdr_len;
+        out->len = len - g_virtio.hdr_len;
+        out->cookie = buf;
+        return (int)out->len;
+    }
+}
+
+static void virtio_rx_return(uint32_t cookie)
+{
+    if (cookie < sizeof(g_rx_buffers) / sizeof(g_rx_buffers[0]))
+        nic_rx_spares_put(&g_rx_spares, (uint16_t)cookie);
+}
+
+/* --- attach --------------------------------------------------------------- */
+
+static void virtio_reset(void)
+{
+    virtio_set_status(0);
+    for (int i = 0; i < 100000 && virtio_get_status() != 0; i++)
+        __asm__ volatile ("pause");
+    virtio_set_status(VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+}
+
+/* Pick the transport: the 1.0 capability windows if present, else legacy I/O. */
+static int virtio_select_transport(const pci_device_info_t *dev)
+{
+    uint32_t bar0 = dev->bars[0];
+
+    if (virtio_modern_probe(dev) == 0) {
+        g_virtio.modern = 1;
+        pci_enable_mmio(dev);
+        return 0;
+    }
+    if (dev->device_id != VIRTIO_DEVICE_NET_LEGACY || (bar0 & 1u) == 0)
+        return -1;
+    g_virtio.modern = 0;
+    g_virtio.io_base = (uint16_t)(bar0 & ~3u);
+    pci_enable_io(dev);
+    return 0;
+}
+
 static int virtio_attach(const pci_device_info_t *dev)
 {
-    uint32_t bar0;
-    uint32_t host_features;
     uint16_t rx_qsize;
     uint16_t tx_qsize;
+    uint8_t status_ok = VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK;
     nic_device_t nic_dev;
 
     if (!dev || g_virtio.initialized)
         return -1;
 
-    bar0 = dev->bars[0];
-    if ((bar0 & 1u) == 0)
+    if (virtio_select_transport(dev) != 0)
         return -1;
-
-    pci_enable_io(dev);
     pci_enable_bus_mastering(dev);
-
-    g_virtio.io_base = (uint16_t)(bar0 & ~3u);
     g_virtio.irq_line = dev->irq_line;
 
-    io_outb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_STATUS), 0);
-    io_outb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_STATUS), 0x01 | 0x02);
-
-    host_features = io_inl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_HOST_FEATURES));
-    io_outl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_GUEST_FEATURES), host_features & 0x01000020u);
-
-    io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_SEL), 0);
-    rx_qsize = io_inw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_SIZE));
-    if (rx_qsize == 0)
+    virtio_reset();
+    if (virtio_negotiate() != 0) {
+        virtio_set_status(VIRTIO_STATUS_FAILED);
         return -1;
-    if (rx_qsize > 256)
-        rx_qsize = 256;
-    virtqueue_init(&g_virtio.rx_vq, g_rx_ring_mem, rx_qsize, sizeof(g_rx_ring_mem));
-    io_outl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_PFN),
-            (uint32_t)(virt_to_phys_ptr(g_rx_ring_mem) >> 12));
-
+    }
+    if (g_virtio.modern)
+        status_ok |= VIRTIO_STATUS_FEATURES_OK;
+
+    /*
+     * Hook the interrupt before the queues so an MSI-X vector can be bound
+     * to the RX queue.  The legacy layout shifts device config when MSI-X
+     * is on, so that transport stays on INTx.
+     */
+    g_virtio.irq_mode = pci_irq_attach(dev, g_virtio.modern ? PCI_IRQ_ANY : PCI_IRQ_ANY & ~PCI_IRQ_MSIX,
+                                       virtio_irq_cb, NULL, NIC_IRQ_CPU);
+    if (g_virtio.modern && g_virtio.irq_mode == PCI_IRQ_MSIX)
+        mmio_write16(g_virtio.common, VIRTIO_COMMON_MSIX_CONFIG, VIRTIO_MSI_NO_VECTOR);
+
+    if (virtio_setup_queue(VIRTIO_RXQ, &g_virtio.rx_vq, g_rx_ring_mem, sizeof(g_rx_ring_mem)) != 0)
+        return -1;
+    rx_qsize = g_virtio.rx_vq.q_size;
     for (uint16_t i = 0; i < rx_qsize; i++) {
+        g_rx_buf_of_desc[i] = i;
         g_virtio.rx_vq.desc[i].addr = virt_to_phys_ptr(g_rx_buffers[i]);
-        g_virtio.rx_vq.desc[i].len = 2048;
+        g_virtio.rx_vq.desc[i].len = NIC_RX_BUF_SIZE;
         g_virtio.rx_vq.desc[i].flags = VRING_DESC_F_WRITE;
         g_virtio.rx_vq.desc[i].next = 0;
         g_virtio.rx_vq.avail->ring[i] = i;
     }
     g_virtio.rx_vq.avail->idx = rx_qsize;
     g_virtio.rx_vq.last_avail_idx = rx_qsize;
+    nic_rx_spares_init(&g_rx_spares, rx_qsize, NIC_RX_LOAN_SPARE);
 
-    io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_SEL), 1);
-    tx_qsize = io_inw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_SIZE));
-    if (tx_qsize == 0)
+    if (virtio_setup_queue(VIRTIO_TXQ, &g_virtio.tx_vq, g_tx_ring_mem, sizeof(g_tx_ring_mem)) != 0)
         return -1;
-    if (tx_qsize > 256)
-        tx_qsize = 256;
-    virtqueue_init(&g_virtio.tx_vq, g_tx_ring_mem, tx_qsize, sizeof(g_tx_ring_mem));
-    io_outl((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_PFN),
-            (uint32_t)(virt_to_phys_ptr(g_tx_ring_mem) >> 12));
+    tx_qsize = g_virtio.tx_vq.q_size;
+    for (uint16_t i = 0; i < tx_qsize; i++) {
+        g_virtio.tx_vq.desc[i].next = (uint16_t)(i + 1);
+        g_tx_token[i] = NULL;
+    }
+    g_virtio.tx_free_head = 0;
+    g_virtio.tx_num_free = tx_qsize;
+    /* TX completions are reaped from the send and RX paths; no interrupt needed. */
+    virtio_suppress_irq(&g_virtio.tx_vq);
 
     for (int i = 0; i < 6; i++)
-        g_virtio.mac[i] = io_inb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_CONFIG + i));
+        g_virtio.mac[i] = virtio_cfg_read8((uint32_t)i);
 
-    io_outb((uint16_t)(g_virtio.io_base + VIRTIO_PCI_STATUS), 0x01 | 0x02 | 0x04);
-    io_outw((uint16_t)(g_virtio.io_base + VIRTIO_PCI_QUEUE_NOTIFY), 0);
+    virtio_set_status(status_ok);
+    virtio_notify(&g_virtio.rx_vq, VIRTIO_RXQ);
 
     g_virtio.initialized = 1;
+    kprintf("[net] virtio-net %s transport features=0x%08x%08x hdr=%u\n",
+            g_virtio.modern ? "1.0" : "legacy",
+            (uint32_t)(g_virtio.features >> 32), (uint32_t)g_virtio.features,
+            (unsigned)g_virtio.hdr_len);
 
     nic_dev.driver_name = "virtio-net";
-    nic_dev.model_name = "virtio legacy pci";
+    nic_dev.model_name = g_virtio.modern ? "virtio 1.0 pci" : "virtio legacy pci";
     nic_dev.irq_line = dev->irq_line;
     nic_dev.mtu = 1500;
+    nic_dev.features = 0;
     nic_dev.ops.tx = virtio_send_packet;
     nic_dev.ops.rx_poll = virtio_receive_packet;
     nic_dev.ops.get_mac = virtio_get_mac;
     nic_dev.ops.link_up = virtio_link_up;
     nic_dev.ops.irq_ack = NULL;
+    nic_dev.ops.rx_loan = virtio_rx_loan;
+    nic_dev.ops.rx_return = virtio_rx_return;
+    nic_dev.ops.tx_sg = virtio_send_sg;
+    nic_dev.ops.tx_reap = virtio_tx_reap;
+    nic_dev.ops.irq_disable = virtio_irq_disable;
+    nic_dev.ops.irq_enable = virtio_irq_enable;
+    nic_dev.ops.batch_begin = NULL;
+    nic_dev.ops.batch_end = NULL;
     nic_dev.priv = NULL;
 
     if (nic_register_active(&nic_dev) != 0)
         return -1;
-
-    if (dev->irq_line < 16) {
-        irq_register_handler(dev->irq_line, virtio_irq_cb, NULL);
-        pic_unmask_irq(dev->irq_line);
-    }
     return 0;
 }
 
@@ -0,0 +1,701 @@
+/*
+ * socket.c - TCP/UDP sockets on the lwIP raw API.
+ *
+ * Every socket wraps one PCB.  lwIP callbacks (run from the net-rx worker,
+ * or from network_poll() when there is none) only queue data, flip state
+ * bits and wake the socket's waiters; the process side copies data out
+ * and re-opens the receive window as it reads, so an unread socket
+ * throttles its peer instead of buffering without bound.  All lwIP core
+ * calls and socket state changes happen under SYS_ARCH_PROTECT, the same
+ * guard the stack's own port layer relies on.
+ */
+
+#include "socket.h"
+#include "network.h"
+#include "nic/nic.h"
+
+#include "../fs/vfs.h"
+#include "../include/kutils.h"
+#include "../mm/heap.h"
+#include "../proc/process.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum net_sock_state {
+    NET_SOCK_IDLE = 0,
+    NET_SOCK_CONNECTING,
+    NET_SOCK_CONNECTED,
+    NET_SOCK_LISTENING,
+    NET_SOCK_CLOSED             /* reset, failed or PCB otherwise gone */
+} net_sock_state_t;
+
+typedef struct net_dgram {
+    struct pbuf *p;
+    net_sockaddr_t from;
+} net_dgram_t;
+
+struct net_socket {
+    int type;
+    net_sock_state_t state;
+    int err;                    /* lwIP error that closed the socket */
+    union {
+        struct tcp_pcb *tcp;
+        struct udp_pcb *udp;
+    } pcb;
+
+    /* Stream receive queue: one pbuf chain, consumed from the front. */
+    struct pbuf *rx;
+    int rx_eof;
+
+    /* Listener: established connections not yet accepted. */
+    net_socket_t *accept_head;
+    net_socket_t *accept_tail;
+    net_socket_t *accept_next;
+    int accept_count;
+    int backlog;
+
+    /* Datagram receive ring. */
+    net_dgram_t dgram[NET_SOCK_UDP_QUEUE];
+    uint32_t dgram_head;
+    uint32_t dgram_count;
+    net_sockaddr_t peer;
+    int has_peer;
+
+    wait_queue_t wq;            /* blocking calls on this socket */
+};
+
+/* --------------------------------------------------------------------- */
+/* Helpers                                                               */
+/* --------------------------------------------------------------------- */
+
+static void addr_to_lwip(const net_sockaddr_t *in, ip_addr_t *out)
+{
+    IP_ADDR4(out, in->ip[0], in->ip[1], in->ip[2], in->ip[3]);
+}
+
+static void addr_from_lwip(const ip_addr_t *in, uint16_t port, net_sockaddr_t *out)
+{
+    uint32_t v = in ? ip4_addr_get_u32(ip_2_ip4(in)) : 0;
+
+    /* Stored in network order, so the bytes already read a.b.c.d. */
+    k_memcpy(out->ip, &v, sizeof(out->ip));
+    out->port = port;
+}
+
+static net_socket_t *sock_alloc(int type)
+{
+    net_socket_t *s = (net_socket_t *)kmalloc(sizeof(*s));
+    if (!s)
+        return NULL;
+    k_memset(s, 0, sizeof(*s));
+    s->type = type;
+    return s;
+}
+
+/* The calling process has a signal to take, or cannot sleep at all. */
+static int sock_interrupted(void)
+{
+    process_t *p = process_current();
+    return !p || p->is_idle || (p->signal_pending & ~p->signal_mask) != 0;
+}
+
+/* State changed under a callback: wake blocking calls and pollers. */
+static void sock_notify(net_socket_t *s)
+{
+    wait_queue_wake_all(&s->wq);
+    vfs_poll_notify();
+}
+
+/*
+ * Wait until the socket reports one of `events` (or an error/hangup).
+ * With the net-rx worker running, the lwIP callbacks wake `s->wq`;
+ * otherwise each pass runs network_poll() itself and yields.
+ */
+static int sock_wait(net_socket_t *s, int events)
+{
+    events |= VFS_POLLERR | VFS_POLLHUP;
+    for (;;) {
+        int driven = net_socket_drive();
+
+        if (net_socket_poll_mask(s) & events)
+            return 0;
+        if (sock_interrupted())
+            return -1;
+        if (!driven) {
+            process_yield();
+            continue;
+        }
+        if (wait_queue_prepare(&s->wq) != 0)
+            return -1;
+        /* Parked before the re-check, so a callback after it wakes us. */
+        if (!(net_socket_poll_mask(s) & events))
+            process_yield();
+        wait_queue_finish(&s->wq);
+    }
+}
+
+/* --------------------------------------------------------------------- */
+/* lwIP callbacks                                                        */
+/* --------------------------------------------------------------------- */
+
+static err_t tcp_recv_cb(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    net_socket_t *s = (net_socket_t *)arg;
+
+    if (!p) {
+        if (s) {
+            s->rx_eof = 1;
+            sock_notify(s);
+        }
+        return ERR_OK;
+    }
+    if (!s || err != ERR_OK) {
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    /* pbuf chains count in 16 bits; lwIP re-delivers refused data later. */
+    if (s->rx && (uint32_t)s->rx->tot_len + p->tot_len > 0xFFFFu)
+        return ERR_MEM;
+    if (s->rx)
+        pbuf_cat(s->rx, p);
+    else
+        s->rx = p;
+    sock_notify(s);
+    return ERR_OK;
+}
+
+static err_t tcp_sent_cb(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    net_socket_t *s = (net_socket_t *)arg;
+
+    (void)pcb;
+    (void)len;
+    if (s)
+        sock_notify(s);
+    return ERR_OK;
+}
+
+static void tcp_err_cb(void *arg, err_t err)
+{
+    net_socket_t *s = (net_socket_t *)arg;
+
+    /* The PCB is already freed. */
+    if (!s)
+        return;
+    s->pcb.tcp = NULL;
+    s->err = err;
+    s->state = NET_SOCK_CLOSED;
+    sock_notify(s);
+}
+
+static err_t tcp_connected_cb(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    net_socket_t *s = (net_socket_t *)arg;
+
+    (void)pcb;
+    if (s && err == ERR_OK) {
+        s->state = NET_SOCK_CONNECTED;
+        sock_notify(s);
+    }
+    return ERR_OK;
+}
+
+static void tcp_attach(net_socket_t *s, struct tcp_pcb *pcb)
+{
+    s->pcb.tcp = pcb;
+    tcp_arg(pcb, s);
+    tcp_recv(pcb, tcp_recv_cb);
+    tcp_sent(pcb, tcp_sent_cb);
+    tcp_err(pcb, tcp_err_cb);
+}
+
+static err_t tcp_accept_cb(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    net_socket_t *s = (net_socket_t *)arg;
+    net_socket_t *child;
+
+    if (err != ERR_OK || !newpcb)
+        return ERR_VAL;
+    if (!s || s->accept_count >= s->backlog || !(child = sock_alloc(NET_SOCK_STREAM))) {
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+    child->state = NET_SOCK_CONNECTED;
+    tcp_attach(child, newpcb);
+
+    if (s->accept_tail)
+        s->accept_tail->accept_next = child;
+    else
+        s->accept_head = child;
+    s->accept_tail = child;
+    s->accept_count++;
+    sock_notify(s);
+    return ERR_OK;
+}
+
+static void udp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                        const ip_addr_t *addr, u16_t port)
+{
+    net_socket_t *s = (net_socket_t *)arg;
+    net_dgram_t *d;
+
+    (void)pcb;
+    if (!s || s->dgram_count >= NET_SOCK_UDP_QUEUE) {
+        pbuf_free(p);
+        return;
+    }
+    d = &s->dgram[(s->dgram_head + s->dgram_count) % NET_SOCK_UDP_QUEUE];
+    d->p = p;
+    addr_from_lwip(addr, port, &d->from);
+    s->dgram_count++;
+    sock_notify(s);
+}
+
+/* --------------------------------------------------------------------- */
+/* Lifetime                                                              */
+/* --------------------------------------------------------------------- */
+
+/* Stop callbacks reaching `s` and let lwIP finish the PCB on its own. */
+static void tcp_release_pcb(struct tcp_pcb *pcb, int listening)
+{
+    tcp_arg(pcb, NULL);
+    if (listening) {
+        tcp_accept(pcb, NULL);
+    } else {
+        tcp_recv(pcb, NULL);
+        tcp_sent(pcb, NULL);
+        tcp_err(pcb, NULL);
+    }
+    if (tcp_close(pcb) != ERR_OK)
+        tcp_abort(pcb);
+}
+
+static void sock_free_locked(net_socket_t *s)
+{
+    if (s->type == NET_SOCK_STREAM) {
+        if (s->pcb.tcp)
+            tcp_release_pcb(s->pcb.tcp, s->state == NET_SOCK_LISTENING);
+        if (s->rx)
+            pbuf_free(s->rx);
+        while (s->accept_head) {
+            net_socket_t *child = s->accept_head;
+            s->accept_head = child->accept_next;
+            sock_free_locked(child);
+        }
+    } else {
+        if (s->pcb.udp) {
+            udp_recv(s->pcb.udp, NULL, NULL);
+            udp_remove(s->pcb.udp);
+        }
+        while (s->dgram_count > 0) {
+            pbuf_free(s->dgram[s->dgram_head].p);
+            s->dgram_head = (s->dgram_head + 1) % NET_SOCK_UDP_QUEUE;
+            s->dgram_count--;
+        }
+    }
+    kfree(s);
+}
+
+net_socket_t *net_socket_create(int type)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    net_socket_t *s;
+
+    if (type != NET_SOCK_STREAM && type != NET_SOCK_DGRAM)
+        return NULL;
+    if (!network_is_initialized())
+        return NULL;
+    s = sock_alloc(type);
+    if (!s)
+        return NULL;
+
+    SYS_ARCH_PROTECT(lev);
+    if (type == NET_SOCK_STREAM) {
+        struct tcp_pcb *pcb = tcp_new();
+        if (pcb)
+            tcp_attach(s, pcb);
+    } else {
+        s->pcb.udp = udp_new();
+        if (s->pcb.udp)
+            udp_recv(s->pcb.udp, udp_recv_cb, s);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+
+    if (!s->pcb.tcp && !s->pcb.udp) {
+        kfree(s);
+        return NULL;
+    }
+    return s;
+}
+
+void net_socket_close(net_socket_t *s)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    if (!s)
+        return;
+    SYS_ARCH_PROTECT(lev);
+    sock_free_locked(s);
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+/* --------------------------------------------------------------------- */
+/* Addressing                                                            */
+/* --------------------------------------------------------------------- */
+
+int net_socket_bind(net_socket_t *s, const net_sockaddr_t *addr)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    ip_addr_t ip;
+    err_t rc = ERR_VAL;
+
+    if (!s || !addr)
+        return -1;
+    addr_to_lwip(addr, &ip);
+
+    SYS_ARCH_PROTECT(lev);
+    if (s->type == NET_SOCK_STREAM) {
+        if (s->pcb.tcp && s->state == NET_SOCK_IDLE)
+            rc = tcp_bind(s->pcb.tcp, &ip, addr->port);
+    } else if (s->pcb.udp) {
+        rc = udp_bind(s->pcb.udp, &ip, addr->port);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return rc == ERR_OK ? 0 : -1;
+}
+
+int net_socket_listen(net_socket_t *s, int backlog)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    struct tcp_pcb *lpcb = NULL;
+    err_t rc = ERR_VAL;
+
+    if (!s || s->type != NET_SOCK_STREAM)
+        return -1;
+    if (backlog < 1)
+        backlog = 1;
+    if (backlog > NET_SOCK_MAX_BACKLOG)
+        backlog = NET_SOCK_MAX_BACKLOG;
+
+    SYS_ARCH_PROTECT(lev);
+    if (s->state == NET_SOCK_LISTENING) {
+        s->backlog = backlog;
+        rc = ERR_OK;
+    } else if (s->pcb.tcp && s->state == NET_SOCK_IDLE) {
+        /* The listen PCB replaces the original, which lwIP frees. */
+        lpcb = tcp_listen_with_backlog_and_err(s->pcb.tcp, (u8_t)backlog, &rc);
+        if (lpcb) {
+            s->pcb.tcp = lpcb;
+            s->state = NET_SOCK_LISTENING;
+            s->backlog = backlog;
+            tcp_arg(lpcb, s);
+            tcp_accept(lpcb, tcp_accept_cb);
+        }
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return rc == ERR_OK ? 0 : -1;
+}
+
+net_socket_t *net_socket_accept(net_socket_t *s, int nonblock, net_sockaddr_t *peer)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    net_socket_t *child;
+
+    if (!s || s->state != NET_SOCK_LISTENING)
+        return NULL;
+
+    for (;;) {
+        SYS_ARCH_PROTECT(lev);
+        child = s->accept_head;
+        if (child) {
+            s->accept_head = child->accept_next;
+            if (!s->accept_head)
+                s->accept_tail = NULL;
+            s->accept_count--;
+            child->accept_next = NULL;
+            if (peer) {
+                if (child->pcb.tcp)
+                    addr_from_lwip(&child->pcb.tcp->remote_ip, child->pcb.tcp->remote_port, peer);
+                else
+                    k_memset(peer, 0, sizeof(*peer));
+            }
+        }
+        SYS_ARCH_UNPROTECT(lev);
+
+        if (child)
+            return child;
+        if (nonblock || sock_wait(s, VFS_POLLIN) != 0)
+            return NULL;
+    }
+}
+
+int net_socket_connect(net_socket_t *s, const net_sockaddr_t *addr, int nonblock)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    ip_addr_t ip;
+    err_t rc = ERR_VAL;
+
+    if (!s || !addr)
+        return -1;
+    addr_to_lwip(addr, &ip);
+
+    SYS_ARCH_PROTECT(lev);
+    if (s->type == NET_SOCK_DGRAM) {
+        if (s->pcb.udp)
+            rc = udp_connect(s->pcb.udp, &ip, addr->port);
+        if (rc == ERR_OK) {
+            s->peer = *addr;
+            s->has_peer = 1;
+        }
+    } else if (s->pcb.tcp && s->state == NET_SOCK_IDLE) {
+        rc = tcp_connect(s->pcb.tcp, &ip, addr->port, tcp_connected_cb);
+        if (rc == ERR_OK)
+            s->state = NET_SOCK_CONNECTING;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+
+    if (rc != ERR_OK)
+        return -1;
+    if (s->type == NET_SOCK_DGRAM || nonblock)
+        return 0;
+    if (sock_wait(s, VFS_POLLOUT) != 0)
+        return -1;
+    return s->state == NET_SOCK_CONNECTED ? 0 : -1;
+}
+
+/* --------------------------------------------------------------------- */
+/* Data                                                                  */
+/* --------------------------------------------------------------------- */
+
+static size_t tcp_send(net_socket_t *s, const uint8_t *src, size_t len, int nonblock)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    size_t wr = 0;
+
+    while (wr < len) {
+        int broken;
+
+        SYS_ARCH_PROTECT(lev);
+        broken = (!s->pcb.tcp || s->state != NET_SOCK_CONNECTED);
+        if (!broken) {
+            struct tcp_pcb *pcb = s->pcb.tcp;
+            size_t chunk = len - wr;
+
+            if (chunk > tcp_sndbuf(pcb))
+                chunk = tcp_sndbuf(pcb);
+            if (tcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN)
+                chunk = 0;
+            if (chunk > 0 &&
+                tcp_write(pcb, src + wr, (u16_t)chunk,
+                          TCP_WRITE_FLAG_COPY | (wr + chunk < len ? TCP_WRITE_FLAG_MORE : 0)) == ERR_OK)
+                wr += chunk;
+            tcp_output(pcb);
+        }
+        SYS_ARCH_UNPROTECT(lev);
+
+        if (broken || wr == len)
+            break;
+        if (nonblock || sock_wait(s, VFS_POLLOUT) != 0)
+            break;
+    }
+    return wr ? wr : (size_t)-1;
+}
+
+static size_t udp_send_one(net_socket_t *s, const void *src, size_t len, const net_sockaddr_t *to)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    struct pbuf *p;
+    ip_addr_t ip;
+    err_t rc = ERR_VAL;
+
+    if (!to && !s->has_peer)
+        return (size_t)-1;
+    if (len > 0xFFFFu - 28u)
+        return (size_t)-1;
+    if (to)
+        addr_to_lwip(to, &ip);
+
+    SYS_ARCH_PROTECT(lev);
+    p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM);
+    if (p && s->pcb.udp) {
+        pbuf_take(p, src, (u16_t)len);
+        rc = to ? udp_sendto(s->pcb.udp, p, &ip, to->port) : udp_send(s->pcb.udp, p);
+    }
+    if (p)
+        pbuf_free(p);
+    SYS_ARCH_UNPROTECT(lev);
+    return rc == ERR_OK ? len : (size_t)-1;
+}
+
+size_t net_socket_send(net_socket_t *s, const void *buf, size_t len,
+                       const net_sockaddr_t *to, int nonblock)
+{
+    if (!s || (!buf && len))
+        return (size_t)-1;
+    if (s->type == NET_SOCK_DGRAM)
+        return udp_send_one(s, buf, len, to);
+    if (len == 0)
+        return 0;
+    return tcp_send(s, (const uint8_t *)buf, len, nonblock);
+}
+
+static size_t tcp_recv_some(net_socket_t *s, uint8_t *dst, size_t len,
+                            net_sockaddr_t *from, int nonblock)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    for (;;) {
+        size_t got = 0;
+        int eof;
+
+        SYS_ARCH_PROTECT(lev);
+        while (s->rx && got < len) {
+            size_t chunk = len - got;
+            if (chunk > s->rx->tot_len)
+                chunk = s->rx->tot_len;
+            pbuf_copy_partial(s->rx, dst + got, (u16_t)chunk, 0);
+            s->rx = pbuf_free_header(s->rx, (u16_t)chunk);
+            got += chunk;
+        }
+        if (got > 0 && s->pcb.tcp)
+            tcp_recved(s->pcb.tcp, (u16_t)(got > 0xFFFFu ? 0xFFFFu : got));
+        eof = s->rx_eof || !s->pcb.tcp;
+        if (from && s->pcb.tcp)
+            addr_from_lwip(&s->pcb.tcp->remote_ip, s->pcb.tcp->remote_port, from);
+        SYS_ARCH_UNPROTECT(lev);
+
+        if (got > 0)
+            return got;
+        if (eof)
+            return s->err != ERR_OK && s->err != ERR_CLSD ? (size_t)-1 : 0;
+        if (s->state != NET_SOCK_CONNECTED && s->state != NET_SOCK_CONNECTING)
+            return (size_t)-1;
+        if (nonblock || sock_wait(s, VFS_POLLIN) != 0)
+            return (size_t)-1;
+    }
+}
+
+static size_t udp_recv_one(net_socket_t *s, uint8_t *dst, size_t len,
+                           net_sockaddr_t *from, int nonblock)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    for (;;) {
+        struct pbuf *p = NULL;
+        size_t got = 0;
+
+        SYS_ARCH_PROTECT(lev);
+        if (s->dgram_count > 0) {
+            net_dgram_t *d = &s->dgram[s->dgram_head];
+            p = d->p;
+            if (from)
+                *from = d->from;
+            d->p = NULL;
+            s->dgram_head = (s->dgram_head + 1) % NET_SOCK_UDP_QUEUE;
+            s->dgram_count--;
+            got = p->tot_len < len ? p->tot_len : len;
+            pbuf_copy_partial(p, dst, (u16_t)got, 0);
+            pbuf_free(p);
+        }
+        SYS_ARCH_UNPROTECT(lev);
+
+        if (p)
+            return got;
+        if (!s->pcb.udp || nonblock || sock_wait(s, VFS_POLLIN) != 0)
+            return (size_t)-1;
+    }
+}
+
+size_t net_socket_recv(net_socket_t *s, void *buf, size_t len,
+                       net_sockaddr_t *from, int nonblock)
+{
+    if (!s || (!buf && len))
+        return (size_t)-1;
+    if (s->type == NET_SOCK_DGRAM)
+        return udp_recv_one(s, (uint8_t *)buf, len, from, nonblock);
+    if (len == 0)
+        return 0;
+    return tcp_recv_some(s, (uint8_t *)buf, len, from, nonblock);
+}
+
+/* --------------------------------------------------------------------- */
+/* Readiness                                                             */
+/* --------------------------------------------------------------------- */
+
+int net_socket_poll_mask(net_socket_t *s)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    int mask = 0;
+
+    if (!s)
+        return VFS_POLLERR;
+
+    SYS_ARCH_PROTECT(lev);
+    if (s->type == NET_SOCK_DGRAM) {
+        if (s->dgram_count > 0)
+            mask |= VFS_POLLIN;
+        if (s->pcb.udp)
+            mask |= VFS_POLLOUT;
+        else
+            mask |= VFS_POLLERR;
+    } else {
+        switch (s->state) {
+        case NET_SOCK_LISTENING:
+            if (s->accept_head)
+                mask |= VFS_POLLIN;
+            break;
+        case NET_SOCK_CONNECTED:
+            if (s->rx || s->rx_eof)
+                mask |= VFS_POLLIN;
+            if (s->pcb.tcp && tcp_sndbuf(s->pcb.tcp) > 0 &&
+                tcp_sndqueuelen(s->pcb.tcp) < TCP_SND_QUEUELEN)
+                mask |= VFS_POLLOUT;
+            break;
+        case NET_SOCK_CLOSED:
+            if (s->rx)
+                mask |= VFS_POLLIN;
+            mask |= VFS_POLLHUP;
+            if (s->err != ERR_OK && s->err != ERR_CLSD)
+                mask |= VFS_POLLERR;
+            break;
+        default:
+            break;
+        }
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return mask;
+}
+
+size_t net_socket_pending(net_socket_t *s)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    size_t n;
+
+    if (!s)
+        return 0;
+    SYS_ARCH_PROTECT(lev);
+    if (s->type == NET_SOCK_DGRAM)
+        n = s->dgram_count;
+    else if (s->state == NET_SOCK_LISTENING)
+        n = (size_t)s->accept_count;
+    else
+        n = s->rx ? s->rx->tot_len : 0;
+    SYS_ARCH_UNPROTECT(lev);
+    return n;
+}
+
+int net_socket_drive(void)
+{
+    if (nic_rx_worker_active())
+        return 1;
+    if (network_is_initialized())
+        network_poll();
+    return 0;
+}
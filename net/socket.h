@@ -0,0 +1,98 @@
+/*
+ * socket.h - TCP/UDP sockets on the lwIP raw API.
+ *
+ * Each socket owns one lwIP PCB and is exposed to processes as a VFS
+ * descriptor (VFS_BACKEND_SOCKET): read/write move stream data or whole
+ * datagrams, vfs_poll reports readiness and vfs_close releases the PCB.
+ * The calls below are the socket-only operations the syscall layer adds
+ * on top (bind, listen, accept, connect, addressed datagrams).
+ *
+ * Blocking calls sleep on the socket's wait queue, which the lwIP
+ * callbacks wake; they give up with -1 when a signal is pending.  Only
+ * when no net-rx worker runs the stack do they drive network_poll()
+ * themselves and yield between passes.
+ */
+
+#ifndef TSUKASA_NET_SOCKET_H
+#define TSUKASA_NET_SOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NET_SOCK_STREAM 1
+#define NET_SOCK_DGRAM  2
+
+#define NET_SOCK_MAX_BACKLOG  32
+#define NET_SOCK_UDP_QUEUE    32    /* datagrams held per UDP socket */
+
+typedef struct net_socket net_socket_t;
+
+/* Same layout as struct tsukasa_sockaddr. */
+typedef struct net_sockaddr {
+    uint8_t ip[4];
+    uint16_t port;
+} net_sockaddr_t;
+
+/** Allocate an unbound socket; NULL on bad type or no memory. */
+net_socket_t *net_socket_create(int type);
+
+/** Release the PCB and any queued data.  The socket must not be used after. */
+void net_socket_close(net_socket_t *s);
+
+/** Bind to a local address; 0.0.0.0 and port 0 pick any. */
+int net_socket_bind(net_socket_t *s, const net_sockaddr_t *addr);
+
+/** Turn a bound stream socket into a listener. */
+int net_socket_listen(net_socket_t *s, int backlog);
+
+/**
+ * Take the next established connection off a listener.
+ *
+ * @param peer Filled with the remote address; may be NULL.
+ * @return The new socket, or NULL on error or if it would block.
+ */
+net_socket_t *net_socket_accept(net_socket_t *s, int nonblock, net_sockaddr_t *peer);
+
+/**
+ * Connect a stream socket, or set the default peer of a datagram socket.
+ * A non-blocking stream connect returns 0 once the SYN is queued; POLLOUT
+ * then reports the handshake finished and POLLERR that it failed.
+ */
+int net_socket_connect(net_socket_t *s, const net_sockaddr_t *addr, int nonblock);
+
+/**
+ * Send from `buf`.  Stream sockets queue as much as the send window takes;
+ * datagram sockets send one datagram to `to` (or the connected peer when
+ * `to` is NULL).
+ *
+ * @return Bytes accepted, or (size_t)-1 on error or if it would block.
+ */
+size_t net_socket_send(net_socket_t *s, const void *buf, size_t len,
+                       const net_sockaddr_t *to, int nonblock);
+
+/**
+ * Receive into `buf`.  A datagram longer than `len` is truncated.
+ *
+ * @param from Filled with the sender (datagrams) or peer; may be NULL.
+ * @return Bytes received, 0 at end of stream, or (size_t)-1 on error or if
+ *         it would block.
+ */
+size_t net_socket_recv(net_socket_t *s, void *buf, size_t len,
+                       net_sockaddr_t *from, int nonblock);
+
+/** VFS_POLL* bits the socket is currently ready for. */
+int net_socket_poll_mask(net_socket_t *s);
+
+/** Bytes (stream) or datagrams queued for reading. */
+size_t net_socket_pending(net_socket_t *s);
+
+/**
+ * Run one pass of the network stack on behalf of a waiting poller, unless
+ * the net-rx worker already feeds it frames and fires its timeouts.
+ *
+ * @return 1 if the worker drives the stack and the caller may sleep until
+ *         woken, 0 if the caller must keep driving and yield between passes.
+ */
+int net_socket_drive(void);
+
+#endif /* TSUKASA_NET_SOCKET_H */
@@ -8,14 +8,19 @@
 #include <stdint.h>
 
 #include "../arch/x86_64/cpu/gdt.h"
+#include "../drv/pit.h"
 #include "../include/paging.h"
 #include "../include/kprintf.h"
 #include "../include/spinlock.h"
+#include "../include/trace.h"
+#include "../include/tsc.h"
 #include "../fs/vfs.h"
 #include "../loader/exec.h"
+#include "../ipc/ioring.h"
 #include "../ipc/shm.h"
 #include "../mm/heap.h"
 #include "../mm/pmm.h"
+#include "../mm/vm_anon.h"
 #include "../mm/vmm_x64.h"
 #include "../gfx/gui_srv.h"
 #include "../gfx/wm.h"
@@ -51,8 +56,12 @@ static spinlock_t g_sched_lock = SPINLOCK_INIT;
 static uint32_t g_next_pid = 1;
 static volatile uint64_t g_sched_ticks;
 static int g_ctx_warned;
+static sched_stats_t g_sched_stats;
+static uint32_t g_rq_window_max;
 
 static int g_inited;
+/* Set while fds are closed under g_sched_lock, so wake-ups must not relock. */
+static int g_sched_teardown;
 
 static inline uint64_t irq_save_disable(void)
 {
@@ -113,6 +122,8 @@ static void process_init_sched_state(process_t *p, process_t *parent)
     p->priority = parent ? parent->priority : PROCESS_DEFAULT_PRIORITY;
     p->time_slice = PROCESS_DEFAULT_TIMESLICE;
     p->sched_ticks = 0;
+    for (size_t i = 0; i < sizeof(p->sched); i++)
+        ((uint8_t *)&p->sched)[i] = 0;
     p->created_time = g_sched_ticks;
     p->next_queue = NULL;
     p->prev_queue = NULL;
@@ -155,14 +166,19 @@ static process_t *alloc_process_slot_locked(void)
 static void runq_push_locked(process_t *p)
 {
     uint32_t pri;
-    if (!p)
+    if (!p || p->on_runq)
         return;
     pri = p->priority;
     if (pri >= PROCESS_PRIORITY_LEVELS)
         pri = PROCESS_PRIORITY_LEVELS - 1;
+    p->on_runq = 1;
     p->rq_next = NULL;
     p->next_queue = NULL;
     p->prev_queue = g_runq_tail[pri];
+    if (!p->sched.ready_since)
+        p->sched.ready_since = tsc_read();
+    if (++g_sched_stats.runq_len > g_sched_stats.runq_max)
+        g_sched_stats.runq_max = g_sched_stats.runq_len;
     if (!g_runq_head[pri]) {
         g_runq_head[pri] = p;
         g_runq_tail[pri] = p;
@@ -187,6 +203,8 @@ static process_t *runq_pop_locked(void)
         p->rq_next = NULL;
         p->next_queue = NULL;
         p->prev_queue = NULL;
+        p->on_runq = 0;
+        g_sched_stats.runq_len--;
         return p;
     }
     return NULL;
@@ -207,7 +225,7 @@ static void runq_remove_locked(process_t *target)
     process_t *prev = NULL;
     process_t *cur;
 
-    if (!target)
+    if (!target || !target->on_runq)
         return;
     pri = target->priority;
     if (pri >= PROCESS_PRIORITY_LEVELS)
@@ -229,6 +247,8 @@ static void runq_remove_locked(process_t *target)
             cur->rq_next = NULL;
             cur->next_queue = NULL;
             cur->prev_queue = NULL;
+            cur->on_runq = 0;
+            g_sched_stats.runq_len--;
             return;
         }
         prev = cur;
@@ -236,6 +256,77 @@ static void runq_remove_locked(process_t *target)
     }
 }
 
+/* BLOCKED -> READY on a wake-up; latency is measured until it next runs. */
+static void wake_process_locked(process_t *p)
+{
+    p->state = PROCESS_READY;
+    p->main_thread.state = THREAD_READY;
+    p->sched.wakeups++;
+    p->sched.woken = 1;
+    p->sched.ready_since = 0;
+    g_sched_stats.wakeups++;
+    runq_push_locked(p);
+}
+
+static int sched_latency_bucket(uint64_t cycles)
+{
+    int b = 0;
+    cycles >>= 10;
+    while (cycles > 1 && b < PROCESS_SCHED_LAT_BUCKETS - 1) {
+        cycles >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/* `next` is about to get the CPU: close its ready interval. */
+static void sched_account_run_locked(process_t *next)
+{
+    uint64_t delta;
+
+    if (!next->sched.ready_since)
+        return;
+    delta = tsc_read() - next->sched.ready_since;
+    next->sched.ready_since = 0;
+    next->sched.run_delay_cycles += delta;
+    if (delta > next->sched.run_delay_max)
+        next->sched.run_delay_max = delta;
+    if (next->sched.woken) {
+        int b = sched_latency_bucket(delta);
+        next->sched.woken = 0;
+        next->sched.latency_hist[b]++;
+        g_sched_stats.latency_hist[b]++;
+    }
+}
+
+/* Per-tick run-queue and priority occupancy sampling. */
+static void sched_account_tick_locked(process_t *cur)
+{
+    sched_stats_t *st = &g_sched_stats;
+
+    st->ticks++;
+    st->runq_len_sum += st->runq_len;
+    if (st->runq_len > g_rq_window_max)
+        g_rq_window_max = st->runq_len;
+    if (st->ticks % PROCESS_SCHED_RQ_WINDOW == 0) {
+        uint32_t slot = st->runq_history_len;
+        if (slot >= PROCESS_SCHED_RQ_HISTORY) {
+            for (uint32_t i = 1; i < PROCESS_SCHED_RQ_HISTORY; i++)
+                st->runq_history[i - 1] = st->runq_history[i];
+            slot = PROCESS_SCHED_RQ_HISTORY - 1;
+        } else {
+            st->runq_history_len++;
+        }
+        st->runq_history[slot] = (uint16_t)(g_rq_window_max > 0xFFFFu ? 0xFFFFu : g_rq_window_max);
+        g_rq_window_max = st->runq_len;
+    }
+
+    if (!cur || cur->is_idle)
+        st->idle_ticks++;
+    else
+        st->priority_ticks[cur->priority < PROCESS_PRIORITY_LEVELS ? cur->priority : PROCESS_PRIORITY_LEVELS - 1]++;
+}
+
 static void parent_link_child_locked(process_t *parent, process_t *child)
 {
     if (!parent || !child)
@@ -281,14 +372,58 @@ static void parent_unlink_child_locked(process_t *parent, process_t *child)
     }
 }
 
+static uint32_t g_timed_waiters;    /* parked with a wait_deadline */
+
+static void wait_queue_detach_locked(process_t *p)
+{
+    if (!p || !p->wait_queue)
+        return;
+    if (p->wait_queue->waiters > 0)
+        p->wait_queue->waiters--;
+    p->wait_queue = NULL;
+    if (p->wait_deadline) {
+        p->wait_deadline = 0;
+        if (g_timed_waiters > 0)
+            g_timed_waiters--;
+    }
+}
+
+/* Wake timed waiters whose deadline has passed; runs on every tick. */
+static void wait_queue_expire_locked(void)
+{
+    uint64_t now;
+
+    if (g_timed_waiters == 0)
+        return;
+    now = pit_ticks();
+    for (int i = 0; i < PROCESS_MAX_COUNT && g_timed_waiters > 0; i++) {
+        process_t *p = &g_processes[i];
+        if (!p->used || !p->wait_deadline || now < p->wait_deadline)
+            continue;
+        wait_queue_detach_locked(p);
+        if (p->state == PROCESS_BLOCKED)
+            wake_process_locked(p);
+    }
+}
+
+static void vfs_cleanup_locked(process_t *p)
+{
+    g_sched_teardown = 1;
+    vfs_process_cleanup(p);
+    g_sched_teardown = 0;
+}
+
 static void free_process_resources_locked(process_t *p)
 {
     if (!p)
         return;
 
+    wait_queue_detach_locked(p);
     gui_srv_process_cleanup((int)p->pid);
-    vfs_process_cleanup(p);
+    ioring_process_cleanup((int)p->pid);
+    vfs_cleanup_locked(p);
     shm_process_cleanup(p);
+    vm_anon_process_cleanup(p);
     vm_space_destroy(&p->vm_space);
 
     if (p->kernel_stack) {
@@ -312,6 +447,7 @@ static void reset_process_slot_locked(process_t *p)
     p->used = 0;
     p->state = PROCESS_DEAD;
     p->shm_attachment_count = 0;
+    p->on_runq = 0;
     p->rq_next = NULL;
     p->next_queue = NULL;
     p->prev_queue = NULL;
@@ -451,11 +587,8 @@ static void wake_parent_if_waiting_locked(process_t *child)
     parent = find_by_pid_locked((int)child->ppid);
     if (!parent)
         return;
-    if (parent->state == PROCESS_BLOCKED) {
-        parent->state = PROCESS_READY;
-        parent->main_thread.state = THREAD_READY;
-        runq_push_locked(parent);
-    }
+    if (parent->state == PROCESS_BLOCKED)
+        wake_process_locked(parent);
 }
 
 static void mark_zombie_locked(process_t *p, int wait_status)
@@ -465,8 +598,10 @@ static void mark_zombie_locked(process_t *p, int wait_status)
     if (p->state == PROCESS_ZOMBIE || p->state == PROCESS_DEAD)
         return;
 
-    vfs_process_cleanup(p);
+    wait_queue_detach_locked(p);
+    vfs_cleanup_locked(p);
     shm_process_cleanup(p);
+    vm_anon_process_cleanup(p);
 
     p->wait_status = wait_status;
     p->exit_code = WAIT_EXIT_CODE(wait_status);
@@ -617,6 +752,9 @@ void process_init(void)
     }
     g_sched_ticks = 0;
     g_next_pid = 1;
+    for (size_t i = 0; i < sizeof(g_sched_stats); i++)
+        ((uint8_t *)&g_sched_stats)[i] = 0;
+    g_rq_window_max = 0;
 
     bootstrap = alloc_process_slot_locked();
     if (!bootstrap) {
@@ -672,6 +810,12 @@ int process_current_pid(void)
     return p ? (int)p->pid : -1;
 }
 
+uint32_t process_current_image_gen(void)
+{
+    process_t *p = process_current();
+    return p ? p->image_gen : 0;
+}
+
 int process_get_pgid(int pid)
 {
     process_t *p;
@@ -718,12 +862,15 @@ int process_exec(int pid, process_entry_t entry, const char *name)
     }
 
     shm_process_cleanup(p);
+    vm_anon_process_cleanup(p);
     p->vm_space.shm_cursor = (uintptr_t)VM_SPACE_SHM_BASE + (((uintptr_t)p->pid % 64) * 0x01000000ULL);
     p->vm_space.mapped_pages = 0;
     p->vm_space.shm_pages = 0;
     p->shm_attachment_count = 0;
 
     p->entry = entry;
+    /* Per-image user library state (proc_local slots) must not survive. */
+    p->image_gen++;
     p->signal_pending = 0;
     p->signal_mask = 0;
     for (int i = 0; i < PROCESS_MAX_SIGNALS; i++)
@@ -881,11 +1028,8 @@ int process_kill(int pid, int sig)
         mark_zombie_locked(p, WAIT_STATUS_SIGNAL(sig));
     } else {
         p->signal_pending |= (1ULL << (uint32_t)sig);
-        if (p->state == PROCESS_BLOCKED) {
-            p->state = PROCESS_READY;
-            p->main_thread.state = THREAD_READY;
-            runq_push_locked(p);
-        }
+        if (p->state == PROCESS_BLOCKED)
+            wake_process_locked(p);
     }
 
     spin_unlock(&g_sched_lock);
@@ -912,11 +1056,8 @@ int process_kill_pgid(int pgid, int sig)
             mark_zombie_locked(p, WAIT_STATUS_SIGNAL(sig));
         else {
             p->signal_pending |= (1ULL << (uint32_t)sig);
-            if (p->state == PROCESS_BLOCKED) {
-                p->state = PROCESS_READY;
-                p->main_thread.state = THREAD_READY;
-                runq_push_locked(p);
-            }
+            if (p->state == PROCESS_BLOCKED)
+                wake_process_locked(p);
         }
         count++;
     }
@@ -1127,13 +1268,16 @@ uint64_t process_schedule_tick(uint64_t current_rsp)
     process_t *next;
     uintptr_t signal_handler = 0;
     int delivered_sig = 0;
+    int yielded = 1;
     uint64_t next_rsp;
     uint64_t flags = irq_save_disable();
 
     spin_lock(&g_sched_lock);
     g_sched_ticks++;
+    wait_queue_expire_locked();
 
     cur = g_current[0];
+    sched_account_tick_locked(cur);
     if (cur) {
         cur->kernel_rsp = current_rsp;
         cur->ticks++;
@@ -1148,9 +1292,15 @@ uint64_t process_schedule_tick(uint64_t current_rsp)
 
         if (cur->state == PROCESS_RUNNING) {
             int best_pri = runq_best_priority_locked();
+            /* A slice already at 0 here was given up by process_yield(). */
+            yielded = (cur->time_slice == 0);
             if (!cur->is_idle && cur->time_slice > 0) {
                 cur->time_slice--;
                 cur->main_thread.time_slice = cur->time_slice;
+                if (cur->time_slice == 0) {
+                    cur->sched.slice_expiries++;
+                    g_sched_stats.slice_expiries++;
+                }
             }
             if (!cur->is_idle &&
                 cur->time_slice > 0 &&
@@ -1186,7 +1336,20 @@ uint64_t process_schedule_tick(uint64_t current_rsp)
     if (next) {
         next->state = PROCESS_RUNNING;
         next->main_thread.state = THREAD_RUNNING;
+        sched_account_run_locked(next);
+    }
+    if (cur && next != cur) {
+        g_sched_stats.context_switches++;
+        if (yielded) {
+            cur->sched.voluntary_switches++;
+            g_sched_stats.voluntary_switches++;
+        } else {
+            cur->sched.involuntary_switches++;
+            g_sched_stats.involuntary_switches++;
+        }
     }
+    if (next != cur)
+        TRACE(TRACE_EV_SCHED_SWITCH, cur ? cur->pid : 0, next ? next->pid : 0);
     g_current[0] = next;
     if (next && next->kernel_stack) {
         if (validate_or_repair_context_locked(next) != 0) {
@@ -1226,6 +1389,112 @@ void process_yield(void)
     __asm__ volatile ("int $32");
 }
 
+int wait_queue_prepare(wait_queue_t *wq)
+{
+    return wait_queue_prepare_until(wq, 0);
+}
+
+int wait_queue_prepare_until(wait_queue_t *wq, uint64_t deadline)
+{
+    process_t *cur;
+    uint64_t flags;
+
+    if (!wq)
+        return -1;
+
+    flags = irq_save_disable();
+    spin_lock(&g_sched_lock);
+    cur = g_current[0];
+    if (!cur || cur->is_idle || (cur->signal_pending & ~cur->signal_mask) != 0) {
+        spin_unlock(&g_sched_lock);
+        irq_restore(flags);
+        return -1;
+    }
+    wait_queue_detach_locked(cur);
+    cur->wait_queue = wq;
+    wq->waiters++;
+    if (deadline) {
+        cur->wait_deadline = deadline;
+        g_timed_waiters++;
+    }
+    cur->state = PROCESS_BLOCKED;
+    cur->main_thread.state = THREAD_BLOCKED;
+    /*
+     * Interrupts stay off until wait_queue_finish(): no IRQ-context waker
+     * and no timer tick can run between the caller's re-check and its yield
+     * (int $32 is not masked by IF, and the switch back restores IF=0).
+     */
+    cur->wait_irq_flags = flags;
+    spin_unlock(&g_sched_lock);
+    return 0;
+}
+
+void wait_queue_finish(wait_queue_t *wq)
+{
+    process_t *cur;
+    uint64_t flags = 0;
+
+    spin_lock(&g_sched_lock);
+    cur = g_current[0];
+    if (cur) {
+        flags = cur->wait_irq_flags;
+        if (cur->wait_queue == wq)
+            wait_queue_detach_locked(cur);
+        /*
+         * BLOCKED: the condition held on re-check and we never slept.
+         * READY: a waker on another CPU got in after we parked and queued
+         * us while we still ran.  Either way we are on the CPU now.
+         */
+        if (cur->state == PROCESS_BLOCKED || cur->state == PROCESS_READY) {
+            runq_remove_locked(cur);
+            cur->state = PROCESS_RUNNING;
+            cur->main_thread.state = THREAD_RUNNING;
+            cur->sched.ready_since = 0;
+            cur->sched.woken = 0;
+        }
+    }
+    spin_unlock(&g_sched_lock);
+    irq_restore(flags);
+}
+
+static int wait_queue_wake_locked(wait_queue_t *wq)
+{
+    int woken = 0;
+
+    if (wq->waiters == 0)
+        return 0;
+    for (int i = 0; i < PROCESS_MAX_COUNT; i++) {
+        process_t *p = &g_processes[i];
+        if (!p->used || p->wait_queue != wq)
+            continue;
+        wait_queue_detach_locked(p);
+        /* A signal or child exit may already have made it runnable. */
+        if (p->state == PROCESS_BLOCKED) {
+            wake_process_locked(p);
+            woken++;
+        }
+    }
+    return woken;
+}
+
+int wait_queue_wake_all(wait_queue_t *wq)
+{
+    uint64_t flags;
+    int woken;
+
+    if (!wq || wq->waiters == 0)
+        return 0;
+    if (g_sched_teardown)
+        return wait_queue_wake_locked(wq);
+
+    flags = irq_save_disable();
+    spin_lock(&g_sched_lock);
+    woken = wait_queue_wake_locked(wq);
+    spin_unlock(&g_sched_lock);
+    irq_restore(flags);
+    return woken;
+}
+
 uint64_t process_ticks(void)
 {
     return g_sched_ticks;
@@ -1313,6 +1582,92 @@ int process_get_info(int pid, process_snapshot_t *out)
     return 0;
 }
 
+int process_get_sched_stats(int pid, process_sched_stats_t *out)
+{
+    process_t *p;
+    uint64_t flags;
+
+    if (pid <= 0 || !out)
+        return -1;
+
+    flags = irq_save_disable();
+    spin_lock(&g_sched_lock);
+    p = find_by_pid_locked(pid);
+    if (!p || !p->used || p->state == PROCESS_DEAD) {
+        spin_unlock(&g_sched_lock);
+        irq_restore(flags);
+        return -1;
+    }
+    *out = p->sched;
+    spin_unlock(&g_sched_lock);
+    irq_restore(flags);
+    return 0;
+}
+
+void sched_get_stats(sched_stats_t *out)
+{
+    uint64_t flags;
+
+    if (!out)
+        return;
+    flags = irq_save_disable();
+    spin_lock(&g_sched_lock);
+    *out = g_sched_stats;
+    spin_unlock(&g_sched_lock);
+    irq_restore(flags);
+}
+
+uint64_t sched_latency_bucket_ns(int b)
+{
+    uint64_t hz = pit_tsc_hz();
+    uint64_t cycles;
+
+    if (b < 0 || b >= PROCESS_SCHED_LAT_BUCKETS || hz == 0)
+        return 0;
+    cycles = (b == 0) ? 0 : (1024ULL << b);
+    return cycles * 1000u / (hz / 1000000u ? hz / 1000000u : 1u);
+}
+
+static size_t hist_put_str(char *buf, size_t cap, size_t len, const char *s)
+{
+    while (*s && len + 1 < cap)
+        buf[len++] = *s++;
+    return len;
+}
+
+static size_t hist_put_u64(char *buf, size_t cap, size_t len, uint64_t v)
+{
+    char tmp[24];
+    int i = 0;
+
+    do {
+        tmp[i++] = (char)('0' + (v % 10u));
+        v /= 10u;
+    } while (v > 0);
+    while (i > 0 && len + 1 < cap)
+        buf[len++] = tmp[--i];
+    return len;
+}
+
+size_t sched_format_latency_hist(const uint32_t *hist, char *buf, size_t cap)
+{
+    size_t len = 0;
+
+    if (!buf || cap == 0)
+        return 0;
+    for (int b = 0; hist && b < PROCESS_SCHED_LAT_BUCKETS; b++) {
+        if (hist[b] == 0)
+            continue;
+        len = hist_put_str(buf, cap, len, "latency_ge_ns.");
+        len = hist_put_u64(buf, cap, len, sched_latency_bucket_ns(b));
+        len = hist_put_str(buf, cap, len, ": ");
+        len = hist_put_u64(buf, cap, len, hist[b]);
+        len = hist_put_str(buf, cap, len, "\n");
+    }
+    buf[len] = '\0';
+    return len;
+}
+
 void process_get_memory_totals(size_t *proc_count_out,
                                size_t *mapped_pages_out,
                                size_t *shm_pages_out,
@@ -19,10 +19,13 @@
 #define PROCESS_MAX_SIGNALS    64
 #define PROCESS_MAX_CHILDREN   32
 #define PROCESS_CWD_MAX        256
-#define PROCESS_MAX_OPEN_FILES 32
+#define PROCESS_MAX_OPEN_FILES 256
 #define PROCESS_PRIORITY_LEVELS 256
 #define PROCESS_DEFAULT_PRIORITY 128
 #define PROCESS_DEFAULT_TIMESLICE 4
+#define PROCESS_SCHED_LAT_BUCKETS 20    /* log2 buckets of TSC cycles, from 1024 */
+#define PROCESS_SCHED_RQ_HISTORY  64    /* run-queue samples kept */
+#define PROCESS_SCHED_RQ_WINDOW   16    /* ticks folded into one sample */
 
 #define PROCESS_WAIT_WNOHANG   0x1
 
@@ -75,6 +78,18 @@ typedef enum thread_state {
 typedef struct process process_t;
 typedef struct thread thread_t;
 
+/*
+ * Wait queue: processes park on it with wait_queue_prepare(), re-check their
+ * condition, then yield; wait_queue_wake_all() makes every parked process
+ * runnable again.  Membership is a pointer in process_t, so a queue is just
+ * a waiter count and may be embedded in any kernel object.
+ */
+typedef struct wait_queue {
+    volatile uint32_t waiters;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT { 0u }
+
 typedef struct fd_entry {
     int fd;
     int flags;
@@ -98,6 +113,42 @@ struct thread {
     thread_t *prev_queue;
 };
 
+/*
+ * Scheduler accounting for one process.  Wake-up latency is the time from a
+ * blocked process being made runnable to it getting the CPU; run delay also
+ * includes waits after preemption.  Times are raw TSC cycles.
+ */
+typedef struct process_sched_stats {
+    uint64_t wakeups;
+    uint64_t voluntary_switches;    /* blocked or yielded */
+    uint64_t involuntary_switches;  /* preempted */
+    uint64_t slice_expiries;
+    uint64_t run_delay_cycles;
+    uint64_t run_delay_max;
+    uint64_t ready_since;           /* TSC when queued; 0 when not queued */
+    int woken;                      /* queued by a wake-up, not preemption */
+    uint32_t latency_hist[PROCESS_SCHED_LAT_BUCKETS];
+} process_sched_stats_t;
+
+/* System-wide scheduler counters. */
+typedef struct sched_stats {
+    uint64_t ticks;
+    uint64_t idle_ticks;
+    uint64_t context_switches;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t slice_expiries;
+    uint64_t wakeups;
+    uint32_t runq_len;
+    uint32_t runq_max;
+    uint64_t runq_len_sum;          /* summed once per tick */
+    uint32_t latency_hist[PROCESS_SCHED_LAT_BUCKETS];
+    /* Max run-queue length per PROCESS_SCHED_RQ_WINDOW ticks, oldest first. */
+    uint16_t runq_history[PROCESS_SCHED_RQ_HISTORY];
+    uint32_t runq_history_len;
+    uint64_t priority_ticks[PROCESS_PRIORITY_LEVELS];   /* non-idle ticks per priority */
+} sched_stats_t;
+
 typedef struct process_snapshot {
     uint32_t pid;
     uint32_t ppid;
@@ -148,6 +199,8 @@ struct process {
 
     uint64_t signal_mask;
     uint64_t signal_pending;
+    wait_queue_t *wait_queue;
+    uint64_t wait_deadline;         /* pit_ticks() that ends the wait; 0 = none */
     uintptr_t signal_handlers[PROCESS_MAX_SIGNALS];
     signal_action_s sig_actions[PROCESS_MAX_SIGNALS];
 
@@ -167,6 +220,7 @@ struct process {
     uint32_t priority;
     uint32_t time_slice;
     uint64_t sched_ticks;
+    process_sched_stats_t sched;
     process_t *next_queue;
     process_t *prev_queue;
     process_t *parent;
@@ -174,6 +228,9 @@ struct process {
     uint32_t child_count;
 
     process_t *rq_next;
+    int on_runq;                    /* linked on a run queue */
+    uint64_t wait_irq_flags;        /* saved by wait_queue_prepare() */
+    uint32_t image_gen;             /* bumped each time process_exec() replaces the image */
     process_t *parent_next_child;
     process_t *children_head;
 };
@@ -191,6 +248,8 @@ void process_init(void);
 
 process_t *process_current(void);
 int process_current_pid(void);
+/* Changes whenever exec replaces the caller's image; 0 without a process. */
+uint32_t process_current_image_gen(void);
 int process_get_pgid(int pid);
 
 process_t *process_spawn_kernel(const char *name, process_entry_t entry);
@@ -216,6 +275,39 @@ int process_signal_send(int pid, int sig);
 
 uint64_t process_schedule_tick(uint64_t current_rsp);
 void process_yield(void);
+
+/**
+ * Park the current process on `wq` (state becomes BLOCKED, nothing yields
+ * yet) and disable interrupts on this CPU.  The caller re-checks its wake
+ * condition and calls process_yield() only if it still has to wait, then
+ * wait_queue_finish() in either case, which restores interrupts.  The
+ * re-check must not sleep.
+ *
+ * @return 0 when parked, -1 if there is no current process or an unmasked
+ *         signal is pending (the wait should be abandoned).
+ */
+int wait_queue_prepare(wait_queue_t *wq);
+
+/**
+ * wait_queue_prepare() with a timeout: the timer tick also makes the
+ * caller runnable once pit_ticks() reaches `deadline` (0 = no deadline).
+ * The caller tells a timeout from a wake-up by re-checking its condition.
+ */
+int wait_queue_prepare_until(wait_queue_t *wq, uint64_t deadline);
+
+/**
+ * Leave `wq` after a wait and mark the caller running, undoing a wake-up
+ * that arrived while it never slept.  Restores the interrupt state saved
+ * by wait_queue_prepare().
+ */
+void wait_queue_finish(wait_queue_t *wq);
+
+/**
+ * Make every process parked on `wq` runnable.
+ *
+ * @return Number of processes woken.
+ */
+int wait_queue_wake_all(wait_queue_t *wq);
 uint64_t process_ticks(void);
 
 void process_start_scheduler(void) __attribute__((noreturn));
@@ -229,6 +321,22 @@ void process_run_phase8_selftests(void);
 void process_dump_memory_state(void);
 int process_snapshot(process_snapshot_t *out, int max);
 int process_get_info(int pid, process_snapshot_t *out);
+int process_get_sched_stats(int pid, process_sched_stats_t *out);
+void sched_get_stats(sched_stats_t *out);
+
+/** Lower bound of latency histogram bucket `b` in nanoseconds (0 if unknown). */
+uint64_t sched_latency_bucket_ns(int b);
+
+#define SCHED_LATENCY_HIST_TEXT_MAX 1024    /* fits every bucket's line */
+
+/**
+ * Format a wake-up latency histogram as "latency_ge_ns.<ns>: <count>"
+ * lines, one per non-empty bucket, for /proc/<pid>/sched and /sys/sched.
+ *
+ * @return Length written to `buf` (always NUL-terminated when cap > 0).
+ */
+size_t sched_format_latency_hist(const uint32_t *hist, char *buf, size_t cap);
+
 void process_get_memory_totals(size_t *proc_count_out,
                                size_t *mapped_pages_out,
                                size_t *shm_pages_out,
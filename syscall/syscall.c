@@ -10,13 +10,22 @@
 #ifdef __x86_64__
 
 #include "../fs/vfs.h"
+#include "../drv/pit.h"
 #include "../drv/rtc.h"
+#include "../include/bench.h"
 #include "../include/kprintf.h"
+#include "../include/profile.h"
+#include "../include/trace.h"
+#include "../include/tsc.h"
+#include "../ipc/ioring.h"
 #include "../ipc/shm.h"
 #include "../loader/exec.h"
 #include "../mm/heap.h"
 #include "../mm/pmm.h"
+#include "../mm/vm_anon.h"
+#include "../net/dns_cache.h"
 #include "../net/network.h"
+#include "../net/socket.h"
 #include "../proc/process.h"
 #include "../proc/signal.h"
 #include "../tty/tty.h"
@@ -458,78 +467,6 @@ static void theme_ensure_loaded(void)
     g_theme_loaded = 1;
 }
 
-static uintptr_t handle_fs(uintptr_t cmd,
-                           uintptr_t arg2,
-                           uintptr_t arg3,
-                           uintptr_t arg4,
-                           uintptr_t arg5)
-{
-    switch (cmd) {
-    case FS_CMD_OPEN:
-        return (uintptr_t)vfs_open_flags((const char *)(uintptr_t)arg2, (int)arg3);
-    case FS_CMD_READ:
-        return (uintptr_t)vfs_read((int)arg2, (void *)(uintptr_t)arg3, (size_t)arg4);
-    case FS_CMD_WRITE:
-        return (uintptr_t)vfs_write((int)arg2, (const void *)(uintptr_t)arg3, (size_t)arg4);
-    case FS_CMD_CLOSE:
-        vfs_close((int)arg2);
-        return 0;
-    case FS_CMD_SEEK:
-        return (uintptr_t)vfs_seek((int)arg2, (size_t)arg3, (int)arg4);
-    case FS_CMD_SIZE:
-        return (uintptr_t)vfs_size((int)arg2);
-    case FS_CMD_CREATE:
-        return (uintptr_t)vfs_create((const char *)(uintptr_t)arg2);
-    case FS_CMD_LIST:
-        return (uintptr_t)vfs_list((const char *)(uintptr_t)arg2,
-                                   (char (*)[VFS_NAME_MAX])(uintptr_t)arg3,
-                                   (int)arg4);
-    case FS_CMD_TELL:
-        return (uintptr_t)vfs_tell((int)arg2);
-    case FS_CMD_STAT:
-        return (uintptr_t)vfs_stat((const char *)(uintptr_t)arg2,
-                                   (vfs_stat_t *)(uintptr_t)arg3);
-    case FS_CMD_FSTAT:
-        return (uintptr_t)vfs_fstat((int)arg2, (vfs_stat_t *)(uintptr_t)arg3);
-    case FS_CMD_DUP:
-        return (uintptr_t)vfs_dup((int)arg2);
-    case FS_CMD_DUP2:
-        return (uintptr_t)vfs_dup2((int)arg2, (int)arg3);
-    case FS_CMD_PIPE:
-        return (uintptr_t)vfs_pipe((int *)(uintptr_t)arg2);
-    case FS_CMD_FCNTL:
-        return (uintptr_t)vfs_fcntl((int)arg2, (int)arg3, (int)arg4);
-    case FS_CMD_GETCWD:
-        return (uintptr_t)vfs_getcwd((char *)(uintptr_t)arg2, (size_t)arg3);
-    case FS_CMD_CHDIR:
-        return (uintptr_t)vfs_chdir((const char *)(uintptr_t)arg2);
-    case FS_CMD_IOCTL:
-        return (uintptr_t)vfs_ioctl((int)arg2,
-                                    (unsigned long)arg3,
-                                    (void *)(uintptr_t)arg4);
-    case FS_CMD_MMAP:
-    {
-        vfs_mmap_request_t *req = (vfs_mmap_request_t *)(uintptr_t)arg2;
-        if (!req)
-            return (uintptr_t)-1;
-        return (uintptr_t)vfs_mmap(req->addr,
-                                   req->length,
-                                   req->prot,
-                                   req->flags,
-                                   req->fd,
-                                   req->offset);
-    }
-    case FS_CMD_MUNMAP:
-        return (uintptr_t)vfs_munmap((void *)(uintptr_t)arg2, (size_t)arg3);
-    case FS_CMD_POLL:
-        return (uintptr_t)vfs_poll((vfs_pollfd_t *)(uintptr_t)arg2,
-                                   (size_t)arg3,
-                                   (int)arg4);
-    default:
-        return (uintptr_t)-1;
-    }
-}
-
 #else
 
 #include "../ipc/shm.h"
@@ -569,519 +506,1172 @@ uintptr_t syscall_handler(uintptr_t num,
     }
 }
 
+size_t syscall_get_stats(syscall_stat_t *out, size_t max)
+{
+    (void)out;
+    (void)max;
+    return 0;
+}
+
 #endif
 
 #ifdef __x86_64__
 
-static uintptr_t handle_gui(uintptr_t cmd,
-                            uintptr_t arg2,
-                            uintptr_t arg3,
-                            uintptr_t arg4,
-                            uintptr_t arg5)
+/*
+ * Dispatch tables.
+ *
+ * Every syscall and every SYS_GUI / SYS_FS / SYS_SYSTEM sub-command is a
+ * slot in a flat table indexed directly by its number.  A slot carries the
+ * handler, a name for /sys/syscalls and a mask of arguments that must be
+ * non-NULL pointers; the dispatcher rejects those calls before the handler
+ * runs.  Handlers take the four arguments that follow the command number.
+ * Sub-commands are also reachable from submission rings (ipc/ioring.c)
+ * unless marked SC_NO_RING.
+ */
+
+typedef uintptr_t (*syscall_fn_t)(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d);
+
+/* Argument-validation flags: the Nth handler argument must be non-NULL. */
+#define SC_PTR_A    0x1u
+#define SC_PTR_B    0x2u
+#define SC_PTR_C    0x4u
+#define SC_PTR_D    0x8u
+#define SC_NO_RING  0x10u   /* not allowed in a submission ring */
+
+#define SC_PTR_ALL  (SC_PTR_A | SC_PTR_B | SC_PTR_C | SC_PTR_D)
+
+typedef struct syscall_entry {
+    syscall_fn_t fn;
+    const char *name;
+    uint32_t checks;
+} syscall_entry_t;
+
+typedef struct syscall_counter {
+    uint64_t calls;
+    uint64_t rejected;
+    uint64_t cycles;
+} syscall_counter_t;
+
+typedef struct syscall_table {
+    const char *group;
+    const syscall_entry_t *entries;
+    syscall_counter_t *counters;
+    uint32_t size;
+    uintptr_t err;                  /* returned for unknown or rejected calls */
+} syscall_table_t;
+
+#define SC_LO32(v) ((int32_t)(uint32_t)((v) & 0xFFFFFFFFu))
+#define SC_HI32(v) ((int32_t)(uint32_t)(((v) >> 32) & 0xFFFFFFFFu))
+
+/* --- SYS_FS ------------------------------------------------------------- */
+
+static uintptr_t sc_fs_open(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
 {
-    int pid = process_current_pid();
-    int32_t x, y, w, h;
-
-    switch (cmd) {
-    case GUI_CMD_WINDOW_CREATE:
-        x = (int32_t)(uint32_t)(arg3 & 0xFFFFFFFFu);
-        y = (int32_t)(uint32_t)((arg3 >> 32) & 0xFFFFFFFFu);
-        w = (int32_t)(uint32_t)(arg4 & 0xFFFFFFFFu);
-        h = (int32_t)(uint32_t)((arg4 >> 32) & 0xFFFFFFFFu);
-        return (uintptr_t)gui_srv_window_create(pid,
-                                                (const char *)(uintptr_t)arg2,
-                                                x, y, w, h);
-    case GUI_CMD_WINDOW_DESTROY:
-        return (uintptr_t)gui_srv_window_destroy(pid, (int)arg2);
-    case GUI_CMD_WINDOW_SET_TITLE:
-        return (uintptr_t)gui_srv_window_set_title(pid, (int)arg2, (const char *)(uintptr_t)arg3);
-    case GUI_CMD_WINDOW_SET_RESIZABLE:
-        return (uintptr_t)gui_srv_window_set_resizable(pid, (int)arg2, (int)arg3);
-    case GUI_CMD_DRAW_RECT:
-        x = (int32_t)(uint32_t)(arg3 & 0xFFFFFFFFu);
-        y = (int32_t)(uint32_t)((arg3 >> 32) & 0xFFFFFFFFu);
-        w = (int32_t)(uint32_t)(arg4 & 0xFFFFFFFFu);
-        h = (int32_t)(uint32_t)((arg4 >> 32) & 0xFFFFFFFFu);
-        return (uintptr_t)gui_srv_draw_rect(pid, (int)arg2, x, y, w, h, (uint32_t)arg5);
-    case GUI_CMD_DRAW_ROUNDED_RECT_FILLED:
-        x = (int32_t)(uint32_t)(arg3 & 0xFFFFFFFFu);
-        y = (int32_t)(uint32_t)((arg3 >> 32) & 0xFFFFFFFFu);
-        w = (int32_t)(uint32_t)(arg4 & 0xFFFFFFFFu);
-        h = (int32_t)(uint32_t)((arg4 >> 32) & 0xFFFFFFFFu);
-        return (uintptr_t)gui_srv_draw_rounded_rect(pid,
-                                                    (int)arg2,
-                                                    x, y, w, h,
-                                                    (int32_t)(uint32_t)(arg5 & 0xFFFFFFFFu),
-                                                    (uint32_t)((arg5 >> 32) & 0xFFFFFFFFu));
-    case GUI_CMD_DRAW_STRING:
-        x = (int32_t)(uint32_t)(arg3 & 0xFFFFFFFFu);
-        y = (int32_t)(uint32_t)((arg3 >> 32) & 0xFFFFFFFFu);
-        return (uintptr_t)gui_srv_draw_text(pid,
-                                            (int)arg2,
-                                            x, y,
-                                            (const char *)(uintptr_t)arg4,
-                                            (uint32_t)arg5);
-    case GUI_CMD_DRAW_IMAGE:
-        x = (int32_t)(uint32_t)(arg3 & 0xFFFFFFFFu);
-        y = (int32_t)(uint32_t)((arg3 >> 32) & 0xFFFFFFFFu);
-        w = (int32_t)(uint32_t)(arg4 & 0xFFFFFFFFu);
-        h = (int32_t)(uint32_t)((arg4 >> 32) & 0xFFFFFFFFu);
-        return (uintptr_t)gui_srv_draw_image(pid,
-                                             (int)arg2,
-                                             x, y, w, h,
-                                             (const uint32_t *)(uintptr_t)arg5);
-    case GUI_CMD_MARK_DIRTY:
-        x = (int32_t)(uint32_t)(arg3 & 0xFFFFFFFFu);
-        y = (int32_t)(uint32_t)((arg3 >> 32) & 0xFFFFFFFFu);
-        w = (int32_t)(uint32_t)(arg4 & 0xFFFFFFFFu);
-        h = (int32_t)(uint32_t)((arg4 >> 32) & 0xFFFFFFFFu);
-        return (uintptr_t)gui_srv_mark_dirty(pid, (int)arg2, x, y, w, h);
-    case GUI_CMD_GET_EVENT:
-        return (uintptr_t)gui_srv_get_event(pid, (int)arg2, (struct tsukasa_gui_event *)(uintptr_t)arg3);
-    case GUI_CMD_GET_STRING_WIDTH:
-        return (uintptr_t)gui_srv_get_string_width((const char *)(uintptr_t)arg2);
-    case GUI_CMD_GET_FONT_HEIGHT:
-        return (uintptr_t)gui_srv_get_font_height();
-    case GUI_CMD_GET_SCREEN_SIZE:
-        return (uintptr_t)gui_srv_get_screen_size((uint64_t *)(uintptr_t)arg2,
-                                                  (uint64_t *)(uintptr_t)arg3);
-    default:
-        return (uintptr_t)GUI_ERR_INVALID;
-    }
+    (void)c; (void)d;
+    return (uintptr_t)vfs_open_flags((const char *)a, (int)b);
 }
 
-static uintptr_t handle_system(uintptr_t cmd,
-                               uintptr_t arg2,
-                               uintptr_t arg3,
-                               uintptr_t arg4,
-                               uintptr_t arg5)
+static uintptr_t sc_fs_read(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
 {
-    (void)arg5;
-    switch (cmd) {
-    case SYSTEM_CMD_YIELD:
-        process_yield();
-        return 0;
+    (void)d;
+    return (uintptr_t)vfs_read((int)a, (void *)b, (size_t)c);
+}
 
-    case SYSTEM_CMD_SPAWN:
-    {
-        const char *path = (const char *)(uintptr_t)arg2;
-        exec_entry_t entry = NULL;
-        process_t *child;
-        if (!path)
-            return (uintptr_t)-1;
-        if (exec_resolve_builtin(path, &entry) != 0 || !entry)
-            return (uintptr_t)-1;
-        child = process_spawn_kernel(path, entry);
-        if (child)
-            process_set_cmdline((int)child->pid, path);
-        return child ? (uintptr_t)child->pid : (uintptr_t)-1;
-    }
+static uintptr_t sc_fs_write(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_write((int)a, (const void *)b, (size_t)c);
+}
 
-    case SYSTEM_CMD_SPAWN_EX:
-    {
-        const struct tsukasa_spawn_request *req =
-            (const struct tsukasa_spawn_request *)(uintptr_t)arg2;
-        exec_entry_t entry = NULL;
-        process_t *child;
-        int parent_pid = process_current_pid();
-        if (!req || !req->path)
-            return (uintptr_t)-1;
-        if (exec_resolve_builtin(req->path, &entry) != 0 || !entry)
-            return (uintptr_t)-1;
-        child = process_spawn_kernel(req->path, entry);
-        if (!child)
-            return (uintptr_t)-1;
+static uintptr_t sc_fs_close(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    vfs_close((int)a);
+    return 0;
+}
 
-        process_set_cmdline((int)child->pid, req->args ? req->args : req->path);
-        if (req->tty_id >= 0)
-            process_set_tty((int)child->pid, req->tty_id);
-
-        if (parent_pid > 0) {
-            if (req->stdin_fd >= 0)
-                process_clone_fd((int)child->pid, 0, parent_pid, req->stdin_fd);
-            if (req->stdout_fd >= 0)
-                process_clone_fd((int)child->pid, 1, parent_pid, req->stdout_fd);
-            if (req->stderr_fd >= 0)
-                process_clone_fd((int)child->pid, 2, parent_pid, req->stderr_fd);
-        }
-        return (uintptr_t)child->pid;
-    }
+static uintptr_t sc_fs_seek(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_seek((int)a, (size_t)b, (int)c);
+}
 
-    case SYSTEM_CMD_EXEC:
-    {
-        int pid = (int)arg2;
-        const char *path = (const char *)(uintptr_t)arg3;
-        exec_entry_t entry = NULL;
-        if (!path)
-            return (uintptr_t)-1;
-        if (exec_resolve_builtin(path, &entry) != 0 || !entry)
-            return (uintptr_t)-1;
-        process_set_cmdline(pid, path);
-        return (uintptr_t)process_exec(pid, entry, path);
-    }
+static uintptr_t sc_fs_size(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_size((int)a);
+}
 
-    case SYSTEM_CMD_GET_CMDLINE:
-        return (uintptr_t)process_get_cmdline(process_current_pid(),
-                                              (char *)(uintptr_t)arg2,
-                                              (size_t)arg3);
-
-    case SYSTEM_CMD_WAITPID:
-    {
-        int caller = process_current_pid();
-        int target = (int)arg2;
-        int *status = (int *)(uintptr_t)arg3;
-        int options = (int)arg4;
-        return (uintptr_t)process_waitpid(caller, target, options, status);
-    }
+static uintptr_t sc_fs_create(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_create((const char *)a);
+}
 
-    case SYSTEM_CMD_KILL:
-        return (uintptr_t)process_kill((int)arg2, (int)arg3);
-
-    case SYSTEM_CMD_SIGACTION:
-    {
-        int sig = (int)arg2;
-        const struct tsukasa_sigaction *act = (const struct tsukasa_sigaction *)(uintptr_t)arg3;
-        struct tsukasa_sigaction *old = (struct tsukasa_sigaction *)(uintptr_t)arg4;
-        int pid = process_current_pid();
-        if (old) {
-            uint64_t pending = 0;
-            process_signal_pending(pid, &pending);
-            old->sa_handler = PROCESS_SIG_DFL;
-            old->sa_mask = pending;
-            old->sa_flags = 0;
-        }
-        if (act) {
-            if (process_signal_register(pid, sig,
-                    (process_signal_handler_t)(uintptr_t)act->sa_handler) != 0)
-                return (uintptr_t)-1;
-            if (process_signal_mask(pid, SIG_SETMASK, act->sa_mask, NULL) != 0)
-                return (uintptr_t)-1;
-        }
-        return 0;
-    }
+static uintptr_t sc_fs_list(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_list((const char *)a, (char (*)[VFS_NAME_MAX])b, (int)c);
+}
 
-    case SYSTEM_CMD_SIGPROCMASK:
-    {
-        uint64_t set = 0;
-        if (arg3)
-            set = *(const uint64_t *)(uintptr_t)arg3;
-        return (uintptr_t)process_signal_mask(process_current_pid(),
-                                              (int)arg2,
-                                              set,
-                                              (uint64_t *)(uintptr_t)arg4);
-    }
+static uintptr_t sc_fs_tell(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_tell((int)a);
+}
 
-    case SYSTEM_CMD_SIGPENDING:
-        return (uintptr_t)process_signal_pending(process_current_pid(),
-                                                 (uint64_t *)(uintptr_t)arg2);
-
-    case SYSTEM_CMD_TTY_CREATE:
-        return (uintptr_t)tty_create();
-    case SYSTEM_CMD_TTY_SET_FG:
-        return (uintptr_t)tty_set_foreground_pgid((int)arg2, (int)arg3);
-    case SYSTEM_CMD_TTY_GET_FG:
-        return (uintptr_t)tty_get_foreground_pgid((int)arg2);
-    case SYSTEM_CMD_TTY_KILL_FG:
-        return (uintptr_t)tty_kill_foreground((int)arg2, (int)arg3);
-
-    case SYSTEM_CMD_SHM_CREATE:
-        return (uintptr_t)shm_create((size_t)arg2);
-    case SYSTEM_CMD_SHM_ATTACH:
-        return (uintptr_t)shm_attach((int)arg2);
-    case SYSTEM_CMD_SHM_DETACH:
-        return (uintptr_t)shm_detach((void *)(uintptr_t)arg2);
-    case SYSTEM_CMD_SHM_DESTROY:
-        return (uintptr_t)shm_destroy((int)arg2);
-    case SYSTEM_CMD_MEM_STATS:
-    {
-        struct tsukasa_mem_stats *out = (struct tsukasa_mem_stats *)(uintptr_t)arg2;
-        heap_stats_t heap_stats = {0};
-        struct shm_stats shm_stats = {0};
-        size_t proc_count = 0;
-        size_t proc_maps = 0;
-        size_t proc_shm_pages = 0;
-        size_t proc_shm_attachments = 0;
-
-        if (!out)
-            return (uintptr_t)-1;
+static uintptr_t sc_fs_stat(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)vfs_stat((const char *)a, (vfs_stat_t *)b);
+}
 
-        heap_get_stats(&heap_stats);
-        shm_get_stats(&shm_stats);
-        process_get_memory_totals(&proc_count,
-                                  &proc_maps,
-                                  &proc_shm_pages,
-                                  &proc_shm_attachments);
-
-        out->total_pages = pmm_total_page_count();
-        out->used_pages = pmm_used_page_count();
-        out->free_pages = pmm_free_page_count();
-        out->heap_pool_bytes = heap_stats.pool_bytes;
-        out->heap_used_bytes = heap_stats.allocated_bytes;
-        out->heap_peak_bytes = heap_stats.peak_allocated_bytes;
-        out->process_count = proc_count;
-        out->process_mapped_pages = proc_maps;
-        out->process_shm_pages = proc_shm_pages;
-        out->process_shm_attachments = proc_shm_attachments;
-        out->shm_regions = shm_stats.region_count;
-        out->shm_attachments = shm_stats.attachment_count;
-        out->shm_reserved_pages = shm_stats.reserved_pages;
-        return 0;
-    }
-    case SYSTEM_CMD_MEM_DUMP:
-    {
-        struct tsukasa_mem_stats stats = {0};
-        heap_stats_t heap_stats = {0};
-        struct shm_stats shm_stats = {0};
-        size_t proc_count = 0;
-        size_t proc_maps = 0;
-        size_t proc_shm_pages = 0;
-        size_t proc_shm_attachments = 0;
-
-        heap_get_stats(&heap_stats);
-        shm_get_stats(&shm_stats);
-        process_get_memory_totals(&proc_count,
-                                  &proc_maps,
-                                  &proc_shm_pages,
-                                  &proc_shm_attachments);
-
-        stats.total_pages = pmm_total_page_count();
-        stats.used_pages = pmm_used_page_count();
-        stats.free_pages = pmm_free_page_count();
-        stats.heap_pool_bytes = heap_stats.pool_bytes;
-        stats.heap_used_bytes = heap_stats.allocated_bytes;
-        stats.heap_peak_bytes = heap_stats.peak_allocated_bytes;
-        stats.process_count = proc_count;
-        stats.process_mapped_pages = proc_maps;
-        stats.process_shm_pages = proc_shm_pages;
-        stats.process_shm_attachments = proc_shm_attachments;
-        stats.shm_regions = shm_stats.region_count;
-        stats.shm_attachments = shm_stats.attachment_count;
-        stats.shm_reserved_pages = shm_stats.reserved_pages;
-
-        kprintf("[mem] pages total=%u used=%u free=%u\n",
-                (uint32_t)stats.total_pages,
-                (uint32_t)stats.used_pages,
-                (uint32_t)stats.free_pages);
-        kprintf("[mem] heap pool=%u used=%u peak=%u\n",
-                (uint32_t)stats.heap_pool_bytes,
-                (uint32_t)stats.heap_used_bytes,
-                (uint32_t)stats.heap_peak_bytes);
-        kprintf("[mem] proc count=%u maps=%u shm_pages=%u shm_atts=%u\n",
-                (uint32_t)stats.process_count,
-                (uint32_t)stats.process_mapped_pages,
-                (uint32_t)stats.process_shm_pages,
-                (uint32_t)stats.process_shm_attachments);
-        process_dump_memory_state();
-        shm_dump_state();
-        return 0;
+static uintptr_t sc_fs_fstat(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)vfs_fstat((int)a, (vfs_stat_t *)b);
+}
+
+static uintptr_t sc_fs_dup(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_dup((int)a);
+}
+
+static uintptr_t sc_fs_dup2(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)vfs_dup2((int)a, (int)b);
+}
+
+static uintptr_t sc_fs_pipe(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_pipe((int *)a);
+}
+
+static uintptr_t sc_fs_fcntl(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_fcntl((int)a, (int)b, (int)c);
+}
+
+static uintptr_t sc_fs_getcwd(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)vfs_getcwd((char *)a, (size_t)b);
+}
+
+static uintptr_t sc_fs_chdir(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_chdir((const char *)a);
+}
+
+static uintptr_t sc_fs_ioctl(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_ioctl((int)a, (unsigned long)b, (void *)c);
+}
+
+static uintptr_t sc_fs_mmap(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const vfs_mmap_request_t *req = (const vfs_mmap_request_t *)a;
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vfs_mmap(req->addr, req->length, req->prot,
+                               req->flags, req->fd, req->offset);
+}
+
+static uintptr_t sc_fs_munmap(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)vfs_munmap((void *)a, (size_t)b);
+}
+
+static uintptr_t sc_fs_poll(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_poll((vfs_pollfd_t *)a, (size_t)b, (int)c);
+}
+
+static uintptr_t sc_fs_splice(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)vfs_splice((int)a, (int)b, (size_t)c);
+}
+
+static const syscall_entry_t g_fs_entries[FS_CMD_SPLICE + 1] = {
+    [FS_CMD_OPEN]   = { sc_fs_open,   "open",   SC_PTR_A },
+    [FS_CMD_READ]   = { sc_fs_read,   "read",   0 },
+    [FS_CMD_WRITE]  = { sc_fs_write,  "write",  0 },
+    [FS_CMD_CLOSE]  = { sc_fs_close,  "close",  0 },
+    [FS_CMD_SEEK]   = { sc_fs_seek,   "seek",   0 },
+    [FS_CMD_SIZE]   = { sc_fs_size,   "size",   0 },
+    [FS_CMD_CREATE] = { sc_fs_create, "create", SC_PTR_A },
+    [FS_CMD_LIST]   = { sc_fs_list,   "list",   SC_PTR_A | SC_PTR_B },
+    [FS_CMD_TELL]   = { sc_fs_tell,   "tell",   0 },
+    [FS_CMD_STAT]   = { sc_fs_stat,   "stat",   SC_PTR_A | SC_PTR_B },
+    [FS_CMD_FSTAT]  = { sc_fs_fstat,  "fstat",  SC_PTR_B },
+    [FS_CMD_DUP]    = { sc_fs_dup,    "dup",    0 },
+    [FS_CMD_DUP2]   = { sc_fs_dup2,   "dup2",   0 },
+    [FS_CMD_PIPE]   = { sc_fs_pipe,   "pipe",   SC_PTR_A },
+    [FS_CMD_FCNTL]  = { sc_fs_fcntl,  "fcntl",  0 },
+    [FS_CMD_GETCWD] = { sc_fs_getcwd, "getcwd", SC_PTR_A },
+    [FS_CMD_CHDIR]  = { sc_fs_chdir,  "chdir",  SC_PTR_A },
+    [FS_CMD_IOCTL]  = { sc_fs_ioctl,  "ioctl",  0 },
+    [FS_CMD_MMAP]   = { sc_fs_mmap,   "mmap",   SC_PTR_A },
+    [FS_CMD_MUNMAP] = { sc_fs_munmap, "munmap", 0 },
+    [FS_CMD_POLL]   = { sc_fs_poll,   "poll",   0 },
+    [FS_CMD_SPLICE] = { sc_fs_splice, "splice", 0 },
+};
+
+/* --- SYS_GUI ------------------------------------------------------------ *
+ * Rectangles arrive packed: x | y << 32 in one argument, w | h << 32 in
+ * the next.
+ */
+
+static uintptr_t sc_gui_window_create(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)gui_srv_window_create(process_current_pid(), (const char *)a,
+                                            SC_LO32(b), SC_HI32(b),
+                                            SC_LO32(c), SC_HI32(c));
+}
+
+static uintptr_t sc_gui_window_destroy(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)gui_srv_window_destroy(process_current_pid(), (int)a);
+}
+
+static uintptr_t sc_gui_window_set_title(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)gui_srv_window_set_title(process_current_pid(), (int)a,
+                                               (const char *)b);
+}
+
+static uintptr_t sc_gui_window_set_resizable(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)gui_srv_window_set_resizable(process_current_pid(), (int)a, (int)b);
+}
+
+static uintptr_t sc_gui_draw_rect(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    return (uintptr_t)gui_srv_draw_rect(process_current_pid(), (int)a,
+                                        SC_LO32(b), SC_HI32(b),
+                                        SC_LO32(c), SC_HI32(c), (uint32_t)d);
+}
+
+static uintptr_t sc_gui_draw_rounded_rect(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    return (uintptr_t)gui_srv_draw_rounded_rect(process_current_pid(), (int)a,
+                                                SC_LO32(b), SC_HI32(b),
+                                                SC_LO32(c), SC_HI32(c),
+                                                SC_LO32(d), (uint32_t)SC_HI32(d));
+}
+
+static uintptr_t sc_gui_draw_string(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    return (uintptr_t)gui_srv_draw_text(process_current_pid(), (int)a,
+                                        SC_LO32(b), SC_HI32(b),
+                                        (const char *)c, (uint32_t)d);
+}
+
+static uintptr_t sc_gui_draw_image(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    return (uintptr_t)gui_srv_draw_image(process_current_pid(), (int)a,
+                                         SC_LO32(b), SC_HI32(b),
+                                         SC_LO32(c), SC_HI32(c),
+                                         (const uint32_t *)d);
+}
+
+static uintptr_t sc_gui_mark_dirty(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)gui_srv_mark_dirty(process_current_pid(), (int)a,
+                                         SC_LO32(b), SC_HI32(b),
+                                         SC_LO32(c), SC_HI32(c));
+}
+
+static uintptr_t sc_gui_scroll_rect(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    return (uintptr_t)gui_srv_scroll_rect(process_current_pid(), (int)a,
+                                          SC_LO32(b), SC_HI32(b),
+                                          SC_LO32(c), SC_HI32(c), SC_LO32(d));
+}
+
+static uintptr_t sc_gui_get_event(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)gui_srv_get_event(process_current_pid(), (int)a,
+                                        (struct tsukasa_gui_event *)b);
+}
+
+static uintptr_t sc_gui_get_string_width(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)gui_srv_get_string_width((const char *)a);
+}
+
+static uintptr_t sc_gui_get_font_height(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)gui_srv_get_font_height();
+}
+
+static uintptr_t sc_gui_get_screen_size(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)gui_srv_get_screen_size((uint64_t *)a, (uint64_t *)b);
+}
+
+static const syscall_entry_t g_gui_entries[GUI_CMD_GET_SCREEN_SIZE + 1] = {
+    [GUI_CMD_WINDOW_CREATE]            = { sc_gui_window_create,       "window_create",      0 },
+    [GUI_CMD_DRAW_RECT]                = { sc_gui_draw_rect,           "draw_rect",          0 },
+    [GUI_CMD_DRAW_STRING]              = { sc_gui_draw_string,         "draw_string",        SC_PTR_C },
+    [GUI_CMD_MARK_DIRTY]               = { sc_gui_mark_dirty,          "mark_dirty",         0 },
+    [GUI_CMD_GET_EVENT]                = { sc_gui_get_event,           "get_event",          SC_PTR_B },
+    [GUI_CMD_DRAW_ROUNDED_RECT_FILLED] = { sc_gui_draw_rounded_rect,   "draw_rounded_rect",  0 },
+    [GUI_CMD_DRAW_IMAGE]               = { sc_gui_draw_image,          "draw_image",         SC_PTR_D },
+    [GUI_CMD_GET_STRING_WIDTH]         = { sc_gui_get_string_width,    "get_string_width",   0 },
+    [GUI_CMD_GET_FONT_HEIGHT]          = { sc_gui_get_font_height,     "get_font_height",    0 },
+    [GUI_CMD_WINDOW_SET_RESIZABLE]     = { sc_gui_window_set_resizable, "window_set_resizable", 0 },
+    [GUI_CMD_WINDOW_SET_TITLE]         = { sc_gui_window_set_title,    "window_set_title",   SC_PTR_B },
+    [GUI_CMD_WINDOW_DESTROY]           = { sc_gui_window_destroy,      "window_destroy",     0 },
+    [GUI_CMD_SCROLL_RECT]              = { sc_gui_scroll_rect,         "scroll_rect",        0 },
+    [GUI_CMD_GET_SCREEN_SIZE]          = { sc_gui_get_screen_size,     "get_screen_size",    SC_PTR_A | SC_PTR_B },
+};
+
+/* --- SYS_SYSTEM: processes and signals ----------------------------------- */
+
+static uintptr_t sc_sys_yield(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    process_yield();
+    return 0;
+}
+
+static uintptr_t sc_sys_spawn(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const char *path = (const char *)a;
+    exec_entry_t entry = NULL;
+    process_t *child;
+    (void)b; (void)c; (void)d;
+
+    if (exec_resolve_builtin(path, &entry) != 0 || !entry)
+        return (uintptr_t)-1;
+    child = process_spawn_kernel(path, entry);
+    if (child)
+        process_set_cmdline((int)child->pid, path);
+    return child ? (uintptr_t)child->pid : (uintptr_t)-1;
+}
+
+static uintptr_t sc_sys_spawn_ex(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const struct tsukasa_spawn_request *req = (const struct tsukasa_spawn_request *)a;
+    exec_entry_t entry = NULL;
+    process_t *child;
+    int parent_pid = process_current_pid();
+    (void)b; (void)c; (void)d;
+
+    if (!req->path)
+        return (uintptr_t)-1;
+    if (exec_resolve_builtin(req->path, &entry) != 0 || !entry)
+        return (uintptr_t)-1;
+    child = process_spawn_kernel(req->path, entry);
+    if (!child)
+        return (uintptr_t)-1;
+
+    process_set_cmdline((int)child->pid, req->args ? req->args : req->path);
+    if (req->tty_id >= 0)
+        process_set_tty((int)child->pid, req->tty_id);
+
+    if (parent_pid > 0) {
+        if (req->stdin_fd >= 0)
+            process_clone_fd((int)child->pid, 0, parent_pid, req->stdin_fd);
+        if (req->stdout_fd >= 0)
+            process_clone_fd((int)child->pid, 1, parent_pid, req->stdout_fd);
+        if (req->stderr_fd >= 0)
+            process_clone_fd((int)child->pid, 2, parent_pid, req->stderr_fd);
     }
+    return (uintptr_t)child->pid;
+}
 
-    case SYSTEM_CMD_NET_INIT:
-        return (uintptr_t)network_initialize_stack();
-    case SYSTEM_CMD_NET_IS_INIT:
-        return (uintptr_t)network_is_initialized();
-    case SYSTEM_CMD_NET_HAS_IP:
-        return (uintptr_t)network_has_ipv4();
-    case SYSTEM_CMD_NET_GET_LINK:
-        return (uintptr_t)network_get_link_info((net_link_info_t *)(uintptr_t)arg2);
-    case SYSTEM_CMD_NET_GET_MAC:
-    {
-        net_link_info_t info;
-        struct tsukasa_net_mac *out = (struct tsukasa_net_mac *)(uintptr_t)arg2;
-        if (!out)
-            return (uintptr_t)-1;
-        if (network_get_link_info(&info) != 0)
-            return (uintptr_t)-1;
-        for (int i = 0; i < 6; i++)
-            out->bytes[i] = info.mac.bytes[i];
-        return 0;
+static uintptr_t sc_sys_exec(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    int pid = (int)a;
+    const char *path = (const char *)b;
+    exec_entry_t entry = NULL;
+    (void)c; (void)d;
+
+    if (exec_resolve_builtin(path, &entry) != 0 || !entry)
+        return (uintptr_t)-1;
+    process_set_cmdline(pid, path);
+    return (uintptr_t)process_exec(pid, entry, path);
+}
+
+static uintptr_t sc_sys_get_cmdline(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)process_get_cmdline(process_current_pid(), (char *)a, (size_t)b);
+}
+
+static uintptr_t sc_sys_waitpid(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)d;
+    return (uintptr_t)process_waitpid(process_current_pid(), (int)a, (int)c, (int *)b);
+}
+
+static uintptr_t sc_sys_kill(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)process_kill((int)a, (int)b);
+}
+
+static uintptr_t sc_sys_sigaction(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    int sig = (int)a;
+    const struct tsukasa_sigaction *act = (const struct tsukasa_sigaction *)b;
+    struct tsukasa_sigaction *old = (struct tsukasa_sigaction *)c;
+    int pid = process_current_pid();
+    (void)d;
+
+    if (old) {
+        uint64_t pending = 0;
+        process_signal_pending(pid, &pending);
+        old->sa_handler = PROCESS_SIG_DFL;
+        old->sa_mask = pending;
+        old->sa_flags = 0;
     }
-    case SYSTEM_CMD_NET_GET_IP:
-    {
-        net_link_info_t info;
-        struct tsukasa_net_ipv4 *out = (struct tsukasa_net_ipv4 *)(uintptr_t)arg2;
-        if (!out)
+    if (act) {
+        if (process_signal_register(pid, sig,
+                (process_signal_handler_t)(uintptr_t)act->sa_handler) != 0)
             return (uintptr_t)-1;
-        if (network_get_link_info(&info) != 0)
+        if (process_signal_mask(pid, SIG_SETMASK, act->sa_mask, NULL) != 0)
             return (uintptr_t)-1;
-        for (int i = 0; i < 4; i++)
-            out->bytes[i] = info.ip.bytes[i];
-        return 0;
     }
-    case SYSTEM_CMD_NET_GET_GATEWAY:
-    {
-        net_link_info_t info;
-        struct tsukasa_net_ipv4 *out = (struct tsukasa_net_ipv4 *)(uintptr_t)arg2;
-        if (!out)
-            return (uintptr_t)-1;
-        if (network_get_link_info(&info) != 0)
-            return (uintptr_t)-1;
-        for (int i = 0; i < 4; i++)
-            out->bytes[i] = info.gateway.bytes[i];
-        return 0;
+    return 0;
+}
+
+static uintptr_t sc_sys_sigprocmask(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    uint64_t set = 0;
+    (void)d;
+
+    if (b)
+        set = *(const uint64_t *)b;
+    return (uintptr_t)process_signal_mask(process_current_pid(), (int)a, set,
+                                          (uint64_t *)c);
+}
+
+static uintptr_t sc_sys_sigpending(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)process_signal_pending(process_current_pid(), (uint64_t *)a);
+}
+
+/* --- SYS_SYSTEM: tty, shm and memory ------------------------------------- */
+
+static uintptr_t sc_sys_tty_create(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)tty_create();
+}
+
+static uintptr_t sc_sys_tty_set_fg(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)tty_set_foreground_pgid((int)a, (int)b);
+}
+
+static uintptr_t sc_sys_tty_get_fg(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)tty_get_foreground_pgid((int)a);
+}
+
+static uintptr_t sc_sys_tty_kill_fg(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)tty_kill_foreground((int)a, (int)b);
+}
+
+static uintptr_t sc_shm_create(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)shm_create((size_t)a);
+}
+
+static uintptr_t sc_shm_attach(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)shm_attach((int)a);
+}
+
+static uintptr_t sc_shm_detach(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)shm_detach((void *)a);
+}
+
+static uintptr_t sc_shm_destroy(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)shm_destroy((int)a);
+}
+
+static void collect_mem_stats(struct tsukasa_mem_stats *out, struct vm_anon_stats *anon_out)
+{
+    heap_stats_t heap_stats = {0};
+    struct shm_stats shm_stats = {0};
+    struct vm_anon_stats anon_stats = {0};
+    size_t proc_count = 0;
+    size_t proc_maps = 0;
+    size_t proc_shm_pages = 0;
+    size_t proc_shm_attachments = 0;
+
+    heap_get_stats(&heap_stats);
+    shm_get_stats(&shm_stats);
+    vm_anon_get_stats(&anon_stats);
+    process_get_memory_totals(&proc_count,
+                              &proc_maps,
+                              &proc_shm_pages,
+                              &proc_shm_attachments);
+
+    out->total_pages = pmm_total_page_count();
+    out->used_pages = pmm_used_page_count();
+    out->free_pages = pmm_free_page_count();
+    out->heap_pool_bytes = heap_stats.pool_bytes;
+    out->heap_used_bytes = heap_stats.allocated_bytes;
+    out->heap_peak_bytes = heap_stats.peak_allocated_bytes;
+    out->process_count = proc_count;
+    out->process_mapped_pages = proc_maps;
+    out->process_shm_pages = proc_shm_pages;
+    out->process_shm_attachments = proc_shm_attachments;
+    out->shm_regions = shm_stats.region_count;
+    out->shm_attachments = shm_stats.attachment_count;
+    out->shm_reserved_pages = shm_stats.reserved_pages;
+    out->anon_maps = anon_stats.map_count;
+    out->anon_pages = anon_stats.mapped_pages;
+    if (anon_out)
+        *anon_out = anon_stats;
+}
+
+static uintptr_t sc_sys_mem_stats(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    collect_mem_stats((struct tsukasa_mem_stats *)a, NULL);
+    return 0;
+}
+
+static uintptr_t sc_sys_mem_dump(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    struct tsukasa_mem_stats stats = {0};
+    struct vm_anon_stats anon_stats = {0};
+    (void)a; (void)b; (void)c; (void)d;
+
+    collect_mem_stats(&stats, &anon_stats);
+    kprintf("[mem] pages total=%u used=%u free=%u\n",
+            (uint32_t)stats.total_pages,
+            (uint32_t)stats.used_pages,
+            (uint32_t)stats.free_pages);
+    kprintf("[mem] heap pool=%u used=%u peak=%u\n",
+            (uint32_t)stats.heap_pool_bytes,
+            (uint32_t)stats.heap_used_bytes,
+            (uint32_t)stats.heap_peak_bytes);
+    kprintf("[mem] proc count=%u maps=%u shm_pages=%u shm_atts=%u\n",
+            (uint32_t)stats.process_count,
+            (uint32_t)stats.process_mapped_pages,
+            (uint32_t)stats.process_shm_pages,
+            (uint32_t)stats.process_shm_attachments);
+    kprintf("[mem] anon maps=%u pages=%u peak=%u\n",
+            (uint32_t)stats.anon_maps,
+            (uint32_t)stats.anon_pages,
+            (uint32_t)anon_stats.peak_pages);
+    process_dump_memory_state();
+    shm_dump_state();
+    return 0;
+}
+
+static uintptr_t sc_sys_mem_map_anon(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)vm_anon_map((size_t)a);
+}
+
+static uintptr_t sc_sys_mem_unmap_anon(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)vm_anon_unmap((void *)a, (size_t)b);
+}
+
+/* --- SYS_SYSTEM: diagnostics --------------------------------------------- */
+
+/* TSC against its PIT calibration; the PIT tick count if there is none. */
+static uintptr_t sc_sys_clock_us(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    uint64_t hz = pit_tsc_hz();
+    uint64_t now;
+    (void)a; (void)b; (void)c; (void)d;
+
+    if (hz) {
+        now = tsc_read();
+        return (uintptr_t)((now / hz) * 1000000u + (now % hz) * 1000000u / hz);
     }
-    case SYSTEM_CMD_NET_GET_DNS:
-    {
-        net_link_info_t info;
-        struct tsukasa_net_ipv4 *out = (struct tsukasa_net_ipv4 *)(uintptr_t)arg2;
-        if (!out)
-            return (uintptr_t)-1;
-        if (network_get_link_info(&info) != 0)
-            return (uintptr_t)-1;
-        for (int i = 0; i < 4; i++)
-            out->bytes[i] = info.dns.bytes[i];
+    hz = pit_frequency();
+    return hz ? (uintptr_t)(pit_ticks() * 1000000u / hz) : 0;
+}
+
+static uintptr_t sc_sys_trace_ctl(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    uint32_t old = g_trace_mask;
+    (void)c; (void)d;
+
+    if (b & TRACE_CTL_RESET)
+        trace_reset();
+    if (b & TRACE_CTL_SET_MASK)
+        old = trace_set_mask((uint32_t)a);
+    return (uintptr_t)old;
+}
+
+static uintptr_t sc_sys_profile_ctl(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    if (a == 0) {
+        profile_stop();
         return 0;
     }
-    case SYSTEM_CMD_NET_GET_STATS:
-        return (uintptr_t)network_get_stats((net_runtime_stats_t *)(uintptr_t)arg2);
-    case SYSTEM_CMD_NET_DHCP:
-        return (uintptr_t)network_dhcp_acquire();
-    case SYSTEM_CMD_NET_DNS_LOOKUP:
-    {
-        const struct tsukasa_net_dns_req *req = (const struct tsukasa_net_dns_req *)(uintptr_t)arg2;
-        if (!req || !req->name || !req->out_ip)
-            return (uintptr_t)-1;
-        return (uintptr_t)network_dns_lookup(req->name, (net_ipv4_addr_t *)req->out_ip);
-    }
-    case SYSTEM_CMD_NET_PING:
-    {
-        const struct tsukasa_net_ping_req *req = (const struct tsukasa_net_ping_req *)(uintptr_t)arg2;
-        if (!req)
+    return (uintptr_t)profile_start((uint32_t)a);
+}
+
+static uintptr_t sc_sys_bench_run(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    return (uintptr_t)bench_run((const char *)a, (char *)b, (size_t)c,
+                                (d & BENCH_RUN_LIST) ? BENCH_FLAG_LIST : 0u);
+}
+
+static uintptr_t sc_sys_time_get(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    rtc_time_t now;
+    struct tsukasa_time *out = (struct tsukasa_time *)a;
+    (void)b; (void)c; (void)d;
+
+    rtc_read(&now);
+    out->sec = now.sec;
+    out->min = now.min;
+    out->hour = now.hour;
+    out->day = now.day;
+    out->month = now.month;
+    out->year = now.year;
+    return 0;
+}
+
+/* --- SYS_SYSTEM: network ------------------------------------------------- */
+
+static uintptr_t sc_net_init(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)network_initialize_stack();
+}
+
+static uintptr_t sc_net_is_init(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)network_is_initialized();
+}
+
+static uintptr_t sc_net_has_ip(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)network_has_ipv4();
+}
+
+static uintptr_t sc_net_get_link(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)network_get_link_info((net_link_info_t *)a);
+}
+
+static uintptr_t sc_net_get_mac(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    net_link_info_t info;
+    struct tsukasa_net_mac *out = (struct tsukasa_net_mac *)a;
+    (void)b; (void)c; (void)d;
+
+    if (network_get_link_info(&info) != 0)
+        return (uintptr_t)-1;
+    for (int i = 0; i < 6; i++)
+        out->bytes[i] = info.mac.bytes[i];
+    return 0;
+}
+
+/* Shared by the GET_IP / GET_GATEWAY / GET_DNS commands. */
+static uintptr_t net_copy_ipv4(struct tsukasa_net_ipv4 *out, int which)
+{
+    net_link_info_t info;
+    const net_ipv4_addr_t *src;
+
+    if (network_get_link_info(&info) != 0)
+        return (uintptr_t)-1;
+    src = which == 0 ? &info.ip : which == 1 ? &info.gateway : &info.dns;
+    for (int i = 0; i < 4; i++)
+        out->bytes[i] = src->bytes[i];
+    return 0;
+}
+
+static uintptr_t sc_net_get_ip(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return net_copy_ipv4((struct tsukasa_net_ipv4 *)a, 0);
+}
+
+static uintptr_t sc_net_get_gateway(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return net_copy_ipv4((struct tsukasa_net_ipv4 *)a, 1);
+}
+
+static uintptr_t sc_net_get_dns(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return net_copy_ipv4((struct tsukasa_net_ipv4 *)a, 2);
+}
+
+static uintptr_t sc_net_get_stats(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)network_get_stats((net_runtime_stats_t *)a);
+}
+
+static uintptr_t sc_net_dhcp(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)network_dhcp_acquire();
+}
+
+static uintptr_t sc_net_dns_lookup(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const struct tsukasa_net_dns_req *req = (const struct tsukasa_net_dns_req *)a;
+    (void)b; (void)c; (void)d;
+
+    if (!req->name || !req->out_ip)
+        return (uintptr_t)-1;
+    return (uintptr_t)dns_cache_lookup(req->name, req->out_ip->bytes);
+}
+
+static uintptr_t sc_net_dns_start(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    dns_query_t *q = dns_query_start((const char *)a);
+    int fd;
+    (void)c; (void)d;
+
+    if (!q)
+        return (uintptr_t)-1;
+    fd = vfs_dns_open(q, (b & TSUKASA_DNS_NONBLOCK) ? VFS_O_NONBLOCK : 0);
+    if (fd < 0)
+        dns_query_release(q);
+    return (uintptr_t)fd;
+}
+
+static uintptr_t sc_net_ping(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const struct tsukasa_net_ping_req *req = (const struct tsukasa_net_ping_req *)a;
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)network_ping((const net_ipv4_addr_t *)&req->ip, req->timeout_ms);
+}
+
+static uintptr_t sc_net_tcp_connect(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)network_tcp_connect((const net_tcp_connect_req_t *)a);
+}
+
+static uintptr_t sc_net_tcp_send(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)network_tcp_send((const void *)a, (size_t)b);
+}
+
+static uintptr_t sc_net_tcp_recv(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const struct tsukasa_net_tcp_recv_req *req = (const struct tsukasa_net_tcp_recv_req *)a;
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)network_tcp_recv(req->buffer, req->max_len, req->wait);
+}
+
+static uintptr_t sc_net_tcp_close(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    return (uintptr_t)network_tcp_close();
+}
+
+static uintptr_t sc_net_udp_send(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)network_udp_send((const net_udp_send_req_t *)a);
+}
+
+static uintptr_t sc_net_poll(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    network_poll();
+    return 0;
+}
+
+/* --- SYS_SYSTEM: socket descriptors -------------------------------------- *
+ * struct tsukasa_sockaddr has the layout of net_sockaddr_t.  Data moves
+ * through plain fs read/write on the descriptor; sendto/recvfrom add the
+ * datagram address.
+ */
+
+static uintptr_t sc_net_socket(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    net_socket_t *s;
+    int fd;
+    (void)c; (void)d;
+
+    s = net_socket_create((int)a == TSUKASA_SOCK_DGRAM ? NET_SOCK_DGRAM :
+                          (int)a == TSUKASA_SOCK_STREAM ? NET_SOCK_STREAM : 0);
+    if (!s)
+        return (uintptr_t)-1;
+    fd = vfs_socket_open(s, (b & TSUKASA_SOCK_NONBLOCK) ? VFS_O_NONBLOCK : 0);
+    if (fd < 0)
+        net_socket_close(s);
+    return (uintptr_t)fd;
+}
+
+static uintptr_t sc_net_bind(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)net_socket_bind(vfs_socket_get((int)a, NULL), (const net_sockaddr_t *)b);
+}
+
+static uintptr_t sc_net_listen(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)net_socket_listen(vfs_socket_get((int)a, NULL), (int)b);
+}
+
+static uintptr_t sc_net_accept(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    int flags = 0;
+    net_socket_t *s = vfs_socket_get((int)a, &flags);
+    net_socket_t *child;
+    int fd;
+    (void)c; (void)d;
+
+    if (!s)
+        return (uintptr_t)-1;
+    child = net_socket_accept(s, (flags & VFS_O_NONBLOCK) != 0, (net_sockaddr_t *)b);
+    if (!child)
+        return (uintptr_t)-1;
+    fd = vfs_socket_open(child, 0);
+    if (fd < 0)
+        net_socket_close(child);
+    return (uintptr_t)fd;
+}
+
+static uintptr_t sc_net_connect(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    int flags = 0;
+    net_socket_t *s = vfs_socket_get((int)a, &flags);
+    (void)c; (void)d;
+    return (uintptr_t)net_socket_connect(s, (const net_sockaddr_t *)b, (flags & VFS_O_NONBLOCK) != 0);
+}
+
+static uintptr_t sc_net_sendto(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    int flags = 0;
+    net_socket_t *s = vfs_socket_get((int)a, &flags);
+    const struct tsukasa_net_msg *msg = (const struct tsukasa_net_msg *)b;
+    (void)c; (void)d;
+    return (uintptr_t)net_socket_send(s, msg->buffer, msg->length,
+                                      msg->has_addr ? (const net_sockaddr_t *)&msg->addr : NULL,
+                                      (flags & VFS_O_NONBLOCK) != 0);
+}
+
+static uintptr_t sc_net_recvfrom(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    int flags = 0;
+    net_socket_t *s = vfs_socket_get((int)a, &flags);
+    struct tsukasa_net_msg *msg = (struct tsukasa_net_msg *)b;
+    (void)c; (void)d;
+    return (uintptr_t)net_socket_recv(s, msg->buffer, msg->length,
+                                      (net_sockaddr_t *)&msg->addr,
+                                      (flags & VFS_O_NONBLOCK) != 0);
+}
+
+/* --- SYS_SYSTEM: desktop theme ------------------------------------------- */
+
+static uintptr_t sc_theme_set_accent(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    uint32_t accent = (uint32_t)a;
+    (void)b; (void)c; (void)d;
+
+    theme_ensure_loaded();
+    if (!validate_theme_color(accent))
+        return (uintptr_t)-1;
+    g_theme_state.accent_color = accent;
+    if (theme_apply_state(&g_theme_state) != 0)
+        return (uintptr_t)-1;
+    (void)theme_persist_state(&g_theme_state);
+    return 0;
+}
+
+static uintptr_t sc_theme_set_bg_mode(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    uint32_t mode = (uint32_t)a;
+    uint32_t aux = (uint32_t)b;
+    int has_aux = (c != 0);
+    (void)d;
+
+    theme_ensure_loaded();
+    if (!validate_bg_mode(mode))
+        return (uintptr_t)-1;
+
+    if (mode == TSUKASA_THEME_BG_SOLID && has_aux) {
+        if (!validate_theme_color(aux))
             return (uintptr_t)-1;
-        return (uintptr_t)network_ping((const net_ipv4_addr_t *)&req->ip, req->timeout_ms);
-    }
-    case SYSTEM_CMD_NET_TCP_CONNECT:
-        return (uintptr_t)network_tcp_connect((const net_tcp_connect_req_t *)(uintptr_t)arg2);
-    case SYSTEM_CMD_NET_TCP_SEND:
-        return (uintptr_t)network_tcp_send((const void *)(uintptr_t)arg2, (size_t)arg3);
-    case SYSTEM_CMD_NET_TCP_RECV:
-    {
-        const struct tsukasa_net_tcp_recv_req *req =
-            (const struct tsukasa_net_tcp_recv_req *)(uintptr_t)arg2;
-        if (!req)
+        g_theme_state.solid_color = aux;
+    } else if (mode == TSUKASA_THEME_BG_WALLPAPER && has_aux) {
+        if (!validate_wallpaper_style(aux))
             return (uintptr_t)-1;
-        return (uintptr_t)network_tcp_recv(req->buffer, req->max_len, req->wait);
+        g_theme_state.wallpaper_style = aux;
     }
-    case SYSTEM_CMD_NET_TCP_CLOSE:
-        return (uintptr_t)network_tcp_close();
-    case SYSTEM_CMD_NET_UDP_SEND:
-        return (uintptr_t)network_udp_send((const net_udp_send_req_t *)(uintptr_t)arg2);
-    case SYSTEM_CMD_NET_POLL:
-        network_poll();
-        return 0;
 
-    case SYSTEM_CMD_THEME_SET_ACCENT:
-    {
-        uint32_t accent = (uint32_t)arg2;
-        theme_ensure_loaded();
-        if (!validate_theme_color(accent))
-            return (uintptr_t)-1;
-        g_theme_state.accent_color = accent;
-        if (theme_apply_state(&g_theme_state) != 0)
-            return (uintptr_t)-1;
+    g_theme_state.background_mode = mode;
+    if (mode == TSUKASA_THEME_BG_WALLPAPER &&
+        g_theme_state.wallpaper_path[0] == '\0') {
+        g_theme_state.background_mode = TSUKASA_THEME_BG_GRADIENT;
+        (void)theme_apply_state(&g_theme_state);
         (void)theme_persist_state(&g_theme_state);
-        return 0;
+        return (uintptr_t)-1;
     }
-    case SYSTEM_CMD_THEME_SET_BG_MODE:
-    {
-        uint32_t mode = (uint32_t)arg2;
-        uint32_t aux = (uint32_t)arg3;
-        int has_aux = (arg4 != 0);
-        theme_ensure_loaded();
-        if (!validate_bg_mode(mode))
-            return (uintptr_t)-1;
 
-        if (mode == TSUKASA_THEME_BG_SOLID && has_aux) {
-            if (!validate_theme_color(aux))
-                return (uintptr_t)-1;
-            g_theme_state.solid_color = aux;
-        } else if (mode == TSUKASA_THEME_BG_WALLPAPER && has_aux) {
-            if (!validate_wallpaper_style(aux))
-                return (uintptr_t)-1;
-            g_theme_state.wallpaper_style = aux;
-        }
-
-        g_theme_state.background_mode = mode;
-        if (mode == TSUKASA_THEME_BG_WALLPAPER &&
-            g_theme_state.wallpaper_path[0] == '\0') {
+    if (theme_apply_state(&g_theme_state) != 0) {
+        if (mode == TSUKASA_THEME_BG_WALLPAPER) {
             g_theme_state.background_mode = TSUKASA_THEME_BG_GRADIENT;
+            g_theme_state.wallpaper_path[0] = '\0';
             (void)theme_apply_state(&g_theme_state);
-            (void)theme_persist_state(&g_theme_state);
-            return (uintptr_t)-1;
         }
+        (void)theme_persist_state(&g_theme_state);
+        return (uintptr_t)-1;
+    }
 
-        if (theme_apply_state(&g_theme_state) != 0) {
-            if (mode == TSUKASA_THEME_BG_WALLPAPER) {
-                g_theme_state.background_mode = TSUKASA_THEME_BG_GRADIENT;
-                g_theme_state.wallpaper_path[0] = '\0';
-                (void)theme_apply_state(&g_theme_state);
-            }
-            (void)theme_persist_state(&g_theme_state);
+    (void)theme_persist_state(&g_theme_state);
+    return 0;
+}
+
+static uintptr_t sc_theme_set_wallpaper(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const char *path = (const char *)a;
+    int has_style = (c != 0);
+    (void)d;
+
+    theme_ensure_loaded();
+    if (validate_wallpaper_path(path, 0) != 0)
+        return (uintptr_t)-1;
+
+    if (has_style) {
+        uint32_t style = (uint32_t)b;
+        if (!validate_wallpaper_style(style))
             return (uintptr_t)-1;
-        }
+        g_theme_state.wallpaper_style = style;
+    }
 
+    copy_small_string(g_theme_state.wallpaper_path,
+                      sizeof(g_theme_state.wallpaper_path),
+                      path);
+    g_theme_state.background_mode = TSUKASA_THEME_BG_WALLPAPER;
+    if (theme_apply_state(&g_theme_state) != 0) {
+        g_theme_state.background_mode = TSUKASA_THEME_BG_GRADIENT;
+        g_theme_state.wallpaper_path[0] = '\0';
+        (void)theme_apply_state(&g_theme_state);
         (void)theme_persist_state(&g_theme_state);
-        return 0;
+        return (uintptr_t)-1;
     }
-    case SYSTEM_CMD_THEME_SET_WALLPAPER:
-    {
-        const char *path = (const char *)(uintptr_t)arg2;
-        int has_style = (arg4 != 0);
-        theme_ensure_loaded();
-        if (validate_wallpaper_path(path, 0) != 0)
-            return (uintptr_t)-1;
+    (void)theme_persist_state(&g_theme_state);
+    return 0;
+}
 
-        if (has_style) {
-            uint32_t style = (uint32_t)arg3;
-            if (!validate_wallpaper_style(style))
-                return (uintptr_t)-1;
-            g_theme_state.wallpaper_style = style;
-        }
+static uintptr_t sc_theme_get_state(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    theme_ensure_loaded();
+    *(struct tsukasa_theme_state *)a = g_theme_state;
+    return 0;
+}
 
-        copy_small_string(g_theme_state.wallpaper_path,
-                          sizeof(g_theme_state.wallpaper_path),
-                          path);
-        g_theme_state.background_mode = TSUKASA_THEME_BG_WALLPAPER;
-        if (theme_apply_state(&g_theme_state) != 0) {
-            g_theme_state.background_mode = TSUKASA_THEME_BG_GRADIENT;
-            g_theme_state.wallpaper_path[0] = '\0';
-            (void)theme_apply_state(&g_theme_state);
-            (void)theme_persist_state(&g_theme_state);
-            return (uintptr_t)-1;
-        }
-        (void)theme_persist_state(&g_theme_state);
+/* --- SYS_SYSTEM: submission rings --------------------------------------- */
+
+static uintptr_t sc_sys_ioring_setup(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)ioring_setup((uint32_t)a, (struct tsukasa_ioring_params *)b);
+}
+
+static uintptr_t sc_sys_ioring_enter(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)c; (void)d;
+    return (uintptr_t)ioring_enter((int)a, (uint32_t)b);
+}
+
+static uintptr_t sc_sys_ioring_destroy(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    return (uintptr_t)ioring_destroy((int)a);
+}
+
+static const syscall_entry_t g_system_entries[SYSTEM_CMD_THEME_GET_STATE + 1] = {
+    [SYSTEM_CMD_YIELD]           = { sc_sys_yield,          "yield",          0 },
+    [SYSTEM_CMD_SPAWN]           = { sc_sys_spawn,          "spawn",          SC_PTR_A },
+    [SYSTEM_CMD_EXEC]            = { sc_sys_exec,           "exec",           SC_PTR_B | SC_NO_RING },
+    [SYSTEM_CMD_WAITPID]         = { sc_sys_waitpid,        "waitpid",        0 },
+    [SYSTEM_CMD_KILL]            = { sc_sys_kill,           "kill",           0 },
+    [SYSTEM_CMD_SIGACTION]       = { sc_sys_sigaction,      "sigaction",      0 },
+    [SYSTEM_CMD_SIGPROCMASK]     = { sc_sys_sigprocmask,    "sigprocmask",    0 },
+    [SYSTEM_CMD_SIGPENDING]      = { sc_sys_sigpending,     "sigpending",     0 },
+    [SYSTEM_CMD_TTY_CREATE]      = { sc_sys_tty_create,     "tty_create",     0 },
+    [SYSTEM_CMD_TTY_SET_FG]      = { sc_sys_tty_set_fg,     "tty_set_fg",     0 },
+    [SYSTEM_CMD_TTY_GET_FG]      = { sc_sys_tty_get_fg,     "tty_get_fg",     0 },
+    [SYSTEM_CMD_TTY_KILL_FG]     = { sc_sys_tty_kill_fg,    "tty_kill_fg",    0 },
+    [SYSTEM_CMD_SHM_CREATE]      = { sc_shm_create,         "shm_create",     0 },
+    [SYSTEM_CMD_SHM_ATTACH]      = { sc_shm_attach,         "shm_attach",     0 },
+    [SYSTEM_CMD_SHM_DETACH]      = { sc_shm_detach,         "shm_detach",     0 },
+    [SYSTEM_CMD_SHM_DESTROY]     = { sc_shm_destroy,        "shm_destroy",    0 },
+    [SYSTEM_CMD_MEM_STATS]       = { sc_sys_mem_stats,      "mem_stats",      SC_PTR_A },
+    [SYSTEM_CMD_MEM_DUMP]        = { sc_sys_mem_dump,       "mem_dump",       0 },
+    [SYSTEM_CMD_NET_INIT]        = { sc_net_init,           "net_init",       0 },
+    [SYSTEM_CMD_NET_IS_INIT]     = { sc_net_is_init,        "net_is_init",    0 },
+    [SYSTEM_CMD_NET_HAS_IP]      = { sc_net_has_ip,         "net_has_ip",     0 },
+    [SYSTEM_CMD_NET_GET_LINK]    = { sc_net_get_link,       "net_get_link",   0 },
+    [SYSTEM_CMD_NET_GET_STATS]   = { sc_net_get_stats,      "net_get_stats",  0 },
+    [SYSTEM_CMD_NET_DHCP]        = { sc_net_dhcp,           "net_dhcp",       0 },
+    [SYSTEM_CMD_NET_DNS_LOOKUP]  = { sc_net_dns_lookup,     "net_dns_lookup", SC_PTR_A },
+    [SYSTEM_CMD_NET_PING]        = { sc_net_ping,           "net_ping",       SC_PTR_A },
+    [SYSTEM_CMD_NET_TCP_CONNECT] = { sc_net_tcp_connect,    "net_tcp_connect", 0 },
+    [SYSTEM_CMD_NET_TCP_SEND]    = { sc_net_tcp_send,       "net_tcp_send",   0 },
+    [SYSTEM_CMD_NET_TCP_RECV]    = { sc_net_tcp_recv,       "net_tcp_recv",   SC_PTR_A },
+    [SYSTEM_CMD_NET_TCP_CLOSE]   = { sc_net_tcp_close,      "net_tcp_close",  0 },
+    [SYSTEM_CMD_NET_UDP_SEND]    = { sc_net_udp_send,       "net_udp_send",   0 },
+    [SYSTEM_CMD_NET_POLL]        = { sc_net_poll,           "net_poll",       0 },
+    [SYSTEM_CMD_NET_GET_MAC]     = { sc_net_get_mac,        "net_get_mac",    SC_PTR_A },
+    [SYSTEM_CMD_NET_GET_IP]      = { sc_net_get_ip,         "net_get_ip",     SC_PTR_A },
+    [SYSTEM_CMD_NET_GET_GATEWAY] = { sc_net_get_gateway,    "net_get_gateway", SC_PTR_A },
+    [SYSTEM_CMD_NET_GET_DNS]     = { sc_net_get_dns,        "net_get_dns",    SC_PTR_A },
+    [SYSTEM_CMD_GET_CMDLINE]     = { sc_sys_get_cmdline,    "get_cmdline",    0 },
+    [SYSTEM_CMD_SPAWN_EX]        = { sc_sys_spawn_ex,       "spawn_ex",       SC_PTR_A },
+    [SYSTEM_CMD_TIME_GET]        = { sc_sys_time_get,       "time_get",       SC_PTR_A },
+    [SYSTEM_CMD_MEM_MAP_ANON]    = { sc_sys_mem_map_anon,   "mem_map_anon",   0 },
+    [SYSTEM_CMD_MEM_UNMAP_ANON]  = { sc_sys_mem_unmap_anon, "mem_unmap_anon", 0 },
+    [SYSTEM_CMD_TRACE_CTL]       = { sc_sys_trace_ctl,      "trace_ctl",      0 },
+    [SYSTEM_CMD_PROFILE_CTL]     = { sc_sys_profile_ctl,    "profile_ctl",    0 },
+    [SYSTEM_CMD_BENCH_RUN]       = { sc_sys_bench_run,      "bench_run",      0 },
+    [SYSTEM_CMD_IORING_SETUP]    = { sc_sys_ioring_setup,   "ioring_setup",   SC_PTR_B | SC_NO_RING },
+    [SYSTEM_CMD_IORING_ENTER]    = { sc_sys_ioring_enter,   "ioring_enter",   SC_NO_RING },
+    [SYSTEM_CMD_IORING_DESTROY]  = { sc_sys_ioring_destroy, "ioring_destroy", SC_NO_RING },
+    [SYSTEM_CMD_NET_SOCKET]      = { sc_net_socket,         "net_socket",     0 },
+    [SYSTEM_CMD_NET_BIND]        = { sc_net_bind,           "net_bind",       SC_PTR_B },
+    [SYSTEM_CMD_NET_LISTEN]      = { sc_net_listen,         "net_listen",     0 },
+    [SYSTEM_CMD_NET_ACCEPT]      = { sc_net_accept,         "net_accept",     0 },
+    [SYSTEM_CMD_NET_CONNECT]     = { sc_net_connect,        "net_connect",    SC_PTR_B },
+    [SYSTEM_CMD_NET_SENDTO]      = { sc_net_sendto,         "net_sendto",     SC_PTR_B },
+    [SYSTEM_CMD_NET_RECVFROM]    = { sc_net_recvfrom,       "net_recvfrom",   SC_PTR_B },
+    [SYSTEM_CMD_CLOCK_US]        = { sc_sys_clock_us,       "clock_us",       0 },
+    [SYSTEM_CMD_NET_DNS_START]   = { sc_net_dns_start,      "net_dns_start",  SC_PTR_A },
+    [SYSTEM_CMD_THEME_SET_ACCENT]    = { sc_theme_set_accent,    "theme_set_accent",    0 },
+    [SYSTEM_CMD_THEME_SET_BG_MODE]   = { sc_theme_set_bg_mode,   "theme_set_bg_mode",   0 },
+    [SYSTEM_CMD_THEME_SET_WALLPAPER] = { sc_theme_set_wallpaper, "theme_set_wallpaper", 0 },
+    [SYSTEM_CMD_THEME_GET_STATE]     = { sc_theme_get_state,     "theme_get_state",     SC_PTR_A },
+};
+
+/* --- Direct syscalls (argument 1 onwards) -------------------------------- */
+
+static uintptr_t sc_yield(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)a; (void)b; (void)c; (void)d;
+    process_yield();
+    return 0;
+}
+
+static uintptr_t sc_exit(uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    (void)b; (void)c; (void)d;
+    process_exit((int)a);
+    return 0;
+}
+
+/* SYS_GUI, SYS_FS and SYS_SYSTEM are routed to g_sub_tables instead. */
+static const syscall_entry_t g_sys_entries[SYS_SYSTEM + 1] = {
+    [SYS_YIELD]       = { sc_yield,       "yield",       0 },
+    [SYS_EXIT]        = { sc_exit,        "exit",        0 },
+    [SYS_SHM_CREATE]  = { sc_shm_create,  "shm_create",  0 },
+    [SYS_SHM_ATTACH]  = { sc_shm_attach,  "shm_attach",  0 },
+    [SYS_SHM_DETACH]  = { sc_shm_detach,  "shm_detach",  0 },
+    [SYS_SHM_DESTROY] = { sc_shm_destroy, "shm_destroy", 0 },
+};
+
+#define SC_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static syscall_counter_t g_sys_counters[SC_COUNT(g_sys_entries)];
+static syscall_counter_t g_gui_counters[SC_COUNT(g_gui_entries)];
+static syscall_counter_t g_fs_counters[SC_COUNT(g_fs_entries)];
+static syscall_counter_t g_system_counters[SC_COUNT(g_system_entries)];
+
+static const syscall_table_t g_syscall_tables[] = {
+    { "sys",    g_sys_entries,    g_sys_counters,    SC_COUNT(g_sys_entries),    (uintptr_t)-1 },
+    { "gui",    g_gui_entries,    g_gui_counters,    SC_COUNT(g_gui_entries),    (uintptr_t)GUI_ERR_INVALID },
+    { "fs",     g_fs_entries,     g_fs_counters,     SC_COUNT(g_fs_entries),     (uintptr_t)-1 },
+    { "system", g_system_entries, g_system_counters, SC_COUNT(g_system_entries), (uintptr_t)-1 },
+};
+
+static const syscall_table_t *const g_sub_tables[SYS_SYSTEM + 1] = {
+    [SYS_GUI]    = &g_syscall_tables[1],
+    [SYS_FS]     = &g_syscall_tables[2],
+    [SYS_SYSTEM] = &g_syscall_tables[3],
+};
+
+static int syscall_args_ok(uint32_t checks, uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    if ((checks & SC_PTR_A) && !a)
         return 0;
-    }
-    case SYSTEM_CMD_THEME_GET_STATE:
-    {
-        struct tsukasa_theme_state *out =
-            (struct tsukasa_theme_state *)(uintptr_t)arg2;
-        theme_ensure_loaded();
-        if (!out)
-            return (uintptr_t)-1;
-        *out = g_theme_state;
+    if ((checks & SC_PTR_B) && !b)
         return 0;
-    }
-
-    case SYSTEM_CMD_TIME_GET:
-    {
-        rtc_time_t now;
-        struct tsukasa_time *out = (struct tsukasa_time *)(uintptr_t)arg2;
-        if (!out)
-            return (uintptr_t)-1;
-        rtc_read(&now);
-        out->sec = now.sec;
-        out->min = now.min;
-        out->hour = now.hour;
-        out->day = now.day;
-        out->month = now.month;
-        out->year = now.year;
+    if ((checks & SC_PTR_C) && !c)
         return 0;
-    }
+    if ((checks & SC_PTR_D) && !d)
+        return 0;
+    return 1;
+}
 
-    default:
-        return (uintptr_t)-1;
+/*
+ * Syscalls run with interrupts off on one CPU, so the counters need no
+ * atomics.  The call is counted before the handler runs (SYS_EXIT never
+ * returns); cycles are wall time, including any time spent blocked.
+ */
+static uintptr_t syscall_table_call(const syscall_table_t *t, uintptr_t nr,
+                                    uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d)
+{
+    const syscall_entry_t *e;
+    syscall_counter_t *ctr;
+    uint64_t start;
+    uintptr_t ret;
+
+    if (nr >= t->size || !t->entries[nr].fn)
+        return t->err;
+    e = &t->entries[nr];
+    ctr = &t->counters[nr];
+    ctr->calls++;
+    if ((e->checks & SC_PTR_ALL) && !syscall_args_ok(e->checks, a, b, c, d)) {
+        ctr->rejected++;
+        return t->err;
     }
+    start = tsc_read();
+    ret = e->fn(a, b, c, d);
+    ctr->cycles += tsc_read() - start;
+    return ret;
 }
 
 uintptr_t syscall_handler(uintptr_t num,
@@ -1091,30 +1681,51 @@ uintptr_t syscall_handler(uintptr_t num,
                           uintptr_t arg4,
                           uintptr_t arg5)
 {
-    switch (num) {
-    case SYS_YIELD:
-        process_yield();
-        return 0;
-    case SYS_EXIT:
-        process_exit((int)arg1);
-        return 0;
-    case SYS_SHM_CREATE:
-        return (uintptr_t)shm_create((size_t)arg1);
-    case SYS_SHM_ATTACH:
-        return (uintptr_t)shm_attach((int)arg1);
-    case SYS_SHM_DETACH:
-        return (uintptr_t)shm_detach((void *)(uintptr_t)arg1);
-    case SYS_SHM_DESTROY:
-        return (uintptr_t)shm_destroy((int)arg1);
-    case SYS_GUI:
-        return handle_gui(arg1, arg2, arg3, arg4, arg5);
-    case SYS_FS:
-        return handle_fs(arg1, arg2, arg3, arg4, arg5);
-    case SYS_SYSTEM:
-        return handle_system(arg1, arg2, arg3, arg4, arg5);
-    default:
+    uintptr_t ret;
+
+    TRACE(TRACE_EV_SYSCALL_ENTRY, num, arg1);
+    if (num < SC_COUNT(g_sub_tables) && g_sub_tables[num])
+        ret = syscall_table_call(g_sub_tables[num], arg1, arg2, arg3, arg4, arg5);
+    else
+        ret = syscall_table_call(&g_syscall_tables[0], num, arg1, arg2, arg3, arg4);
+    TRACE(TRACE_EV_SYSCALL_EXIT, num, ret);
+    return ret;
+}
+
+uintptr_t syscall_submit(uint32_t nr, uint32_t cmd, const uint64_t args[4])
+{
+    const syscall_table_t *t;
+
+    if (nr >= SC_COUNT(g_sub_tables) || !g_sub_tables[nr])
         return (uintptr_t)-1;
+    t = g_sub_tables[nr];
+    if (cmd < t->size && (t->entries[cmd].checks & SC_NO_RING))
+        return t->err;
+    return syscall_table_call(t, cmd, args[0], args[1], args[2], args[3]);
+}
+
+size_t syscall_get_stats(syscall_stat_t *out, size_t max)
+{
+    size_t n = 0;
+
+    for (size_t t = 0; t < SC_COUNT(g_syscall_tables); t++) {
+        const syscall_table_t *tab = &g_syscall_tables[t];
+        for (uint32_t i = 0; i < tab->size; i++) {
+            const syscall_counter_t *ctr = &tab->counters[i];
+            if (!tab->entries[i].fn || ctr->calls == 0)
+                continue;
+            if (out && n < max) {
+                out[n].group = tab->group;
+                out[n].name = tab->entries[i].name;
+                out[n].nr = i;
+                out[n].calls = ctr->calls;
+                out[n].rejected = ctr->rejected;
+                out[n].cycles = ctr->cycles;
+            }
+            n++;
+        }
     }
+    return n;
 }
 
 #endif /* __x86_64__ */
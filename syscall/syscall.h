@@ -5,6 +5,7 @@
 #ifndef TSUKASA_SYSCALL_H
 #define TSUKASA_SYSCALL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /*
@@ -44,6 +45,7 @@
 #define FS_CMD_MMAP        19
 #define FS_CMD_MUNMAP      20
 #define FS_CMD_POLL        21
+#define FS_CMD_SPLICE      22
 
 #define TSUKASA_O_RDONLY   0x0001
 #define TSUKASA_O_WRONLY   0x0002
@@ -55,6 +57,8 @@
 
 #define TSUKASA_F_GETFL    1
 #define TSUKASA_F_SETFL    2
+#define TSUKASA_F_SETPIPE_SZ 3
+#define TSUKASA_F_GETPIPE_SZ 4
 
 #define TSUKASA_POLLIN     0x0001
 #define TSUKASA_POLLOUT    0x0004
@@ -65,6 +69,7 @@
 #define TSUKASA_PROT_WRITE 0x2
 #define TSUKASA_MAP_SHARED 0x01
 #define TSUKASA_MAP_PRIVATE 0x02
+#define TSUKASA_MAP_ANONYMOUS 0x20
 
 #define TSUKASA_FBIOGET_VSCREENINFO 0x4600
 #define TSUKASA_FBIOGET_FSCREENINFO 0x4602
@@ -130,6 +135,7 @@ struct tsukasa_fb_fix_screeninfo {
 #define GUI_CMD_SET_FONT                 16
 #define GUI_CMD_WINDOW_DESTROY           17
 #define GUI_CMD_DRAW_STRING_SCALED_SLOPED 18
+#define GUI_CMD_SCROLL_RECT              19
 #define GUI_CMD_GET_SCREEN_SIZE          50
 
 /* GUI command return codes (stable ABI). */
@@ -205,6 +211,45 @@ struct tsukasa_gui_event {
 #define SYSTEM_CMD_GET_CMDLINE     37
 #define SYSTEM_CMD_SPAWN_EX        38
 #define SYSTEM_CMD_TIME_GET        39
+#define SYSTEM_CMD_MEM_MAP_ANON    40
+#define SYSTEM_CMD_MEM_UNMAP_ANON  41
+#define SYSTEM_CMD_TRACE_CTL       42
+#define SYSTEM_CMD_PROFILE_CTL     43  /* arg2 = Hz, 0 stops; returns Hz achieved */
+#define SYSTEM_CMD_BENCH_RUN       44  /* arg2 = filter, arg3/4 = CSV buf/cap, arg5 = flags */
+#define SYSTEM_CMD_IORING_SETUP    45  /* arg2 = entries, arg3 = struct tsukasa_ioring_params * */
+#define SYSTEM_CMD_IORING_ENTER    46  /* arg2 = ring id, arg3 = max SQEs; returns SQEs consumed */
+#define SYSTEM_CMD_IORING_DESTROY  47  /* arg2 = ring id */
+#define SYSTEM_CMD_NET_SOCKET      48  /* arg2 = TSUKASA_SOCK_*, arg3 = TSUKASA_SOCK_NONBLOCK; returns fd */
+#define SYSTEM_CMD_NET_BIND        49  /* arg2 = fd, arg3 = const struct tsukasa_sockaddr * */
+#define SYSTEM_CMD_NET_LISTEN      50  /* arg2 = fd, arg3 = backlog */
+#define SYSTEM_CMD_NET_ACCEPT      51  /* arg2 = fd, arg3 = struct tsukasa_sockaddr * or 0; returns fd */
+#define SYSTEM_CMD_NET_CONNECT     52  /* arg2 = fd, arg3 = const struct tsukasa_sockaddr * */
+#define SYSTEM_CMD_NET_SENDTO      53  /* arg2 = fd, arg3 = struct tsukasa_net_msg *; returns bytes */
+#define SYSTEM_CMD_NET_RECVFROM    54  /* arg2 = fd, arg3 = struct tsukasa_net_msg *; returns bytes */
+#define SYSTEM_CMD_CLOCK_US        55  /* returns microseconds since boot (monotonic) */
+#define SYSTEM_CMD_NET_DNS_START   56  /* arg2 = name, arg3 = TSUKASA_DNS_NONBLOCK; returns fd */
+
+/* SYSTEM_CMD_TRACE_CTL flags (arg3); arg2 is the event mask. */
+#define TRACE_CTL_SET_MASK  0x1u
+#define TRACE_CTL_RESET     0x2u
+
+/* SYSTEM_CMD_BENCH_RUN flags (arg5). */
+#define BENCH_RUN_LIST      0x1u
+
+/* SYSTEM_CMD_IORING_* submission ring; see ipc/ioring.h. */
+#define TSUKASA_IORING_MAX_ENTRIES  256
+#define TSUKASA_IORING_SQE_NO_CQE   0x1u    /* post no completion */
+
+/* SYSTEM_CMD_NET_SOCKET types (arg2) and flags (arg3). */
+#define TSUKASA_SOCK_STREAM    1
+#define TSUKASA_SOCK_DGRAM     2
+#define TSUKASA_SOCK_NONBLOCK  0x1u
+
+/* SYSTEM_CMD_NET_DNS_START flags (arg3) and result status. */
+#define TSUKASA_DNS_NONBLOCK   0x1u
+#define TSUKASA_DNS_OK         0
+#define TSUKASA_DNS_NOTFOUND   1    /* NXDOMAIN or no A record */
+#define TSUKASA_DNS_FAILED     2    /* timeout, server error, no network */
 
 /* Reserved v2 desktop customization command range. */
 #define SYSTEM_CMD_THEME_SET_ACCENT    100
@@ -244,6 +289,9 @@ struct tsukasa_mem_stats {
     uint64_t shm_regions;
     uint64_t shm_attachments;
     uint64_t shm_reserved_pages;
+
+    uint64_t anon_maps;
+    uint64_t anon_pages;
 };
 
 struct tsukasa_net_ipv4 {
@@ -304,6 +352,26 @@ struct tsukasa_net_tcp_recv_req {
     int wait;
 };
 
+struct tsukasa_sockaddr {
+    struct tsukasa_net_ipv4 ip;
+    uint16_t port;
+};
+
+/* SYSTEM_CMD_NET_SENDTO/RECVFROM; `addr` is the destination or sender. */
+struct tsukasa_net_msg {
+    void *buffer;
+    uint32_t length;
+    int has_addr;                   /* sendto: use addr instead of the peer */
+    struct tsukasa_sockaddr addr;
+};
+
+/* Read from a SYSTEM_CMD_NET_DNS_START descriptor once it polls readable. */
+struct tsukasa_net_dns_result {
+    int32_t status;                 /* TSUKASA_DNS_* */
+    struct tsukasa_net_ipv4 ip;
+    uint32_t ttl;                   /* seconds the answer stays cached */
+};
+
 struct tsukasa_spawn_request {
     const char *path;
     const char *args;
@@ -331,6 +399,55 @@ struct tsukasa_theme_state {
     char wallpaper_path[128];
 };
 
+/*
+ * Submission ring layout, shared between a process and the kernel.  The
+ * region starts with struct tsukasa_ioring; sq_off and cq_off give the byte
+ * offsets of the SQE and CQE arrays.  The process fills SQEs and advances
+ * sq_tail, the kernel consumes them on SYSTEM_CMD_IORING_ENTER and appends
+ * CQEs at cq_tail, and the process reaps CQEs by advancing cq_head.
+ */
+struct tsukasa_ioring_sqe {
+    uint8_t nr;                     /* SYS_GUI, SYS_FS or SYS_SYSTEM */
+    uint8_t flags;                  /* TSUKASA_IORING_SQE_* */
+    uint16_t cmd;                   /* sub-command of nr */
+    uint32_t reserved;
+    uint64_t user_data;             /* echoed in the CQE */
+    uint64_t args[4];               /* arg2..arg5 of the equivalent syscall */
+};
+
+struct tsukasa_ioring_cqe {
+    uint64_t user_data;
+    int64_t res;                    /* the syscall's return value */
+};
+
+struct tsukasa_ioring {
+    volatile uint32_t sq_head;      /* kernel-owned */
+    volatile uint32_t sq_tail;      /* process-owned */
+    volatile uint32_t cq_head;      /* process-owned */
+    volatile uint32_t cq_tail;      /* kernel-owned */
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_off;
+    uint32_t cq_off;
+};
+
+struct tsukasa_ioring_params {
+    int id;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    struct tsukasa_ioring *ring;    /* mapping in the calling process */
+};
+
+/* Per-command counters, as reported by /sys/syscalls. */
+typedef struct syscall_stat {
+    const char *group;              /* "sys", "gui", "fs" or "system" */
+    const char *name;
+    uint32_t nr;                    /* syscall or sub-command number */
+    uint64_t calls;
+    uint64_t rejected;              /* failed argument validation */
+    uint64_t cycles;                /* TSC cycles spent in the handler */
+} syscall_stat_t;
+
 uintptr_t syscall_handler(uintptr_t num,
                           uintptr_t arg1,
                           uintptr_t arg2,
@@ -338,4 +455,17 @@ uintptr_t syscall_handler(uintptr_t num,
                           uintptr_t arg4,
                           uintptr_t arg5);
 
+/**
+ * Copy the counters of every command called at least once into `out`.
+ *
+ * @return Number of such commands, which may exceed `max`.
+ */
+size_t syscall_get_stats(syscall_stat_t *out, size_t max);
+
+/**
+ * Run one SYS_GUI / SYS_FS / SYS_SYSTEM command on behalf of a submission
+ * ring, with the same validation and accounting as the trap path.
+ */
+uintptr_t syscall_submit(uint32_t nr, uint32_t cmd, const uint64_t args[4]);
+
 #endif /* TSUKASA_SYSCALL_H */
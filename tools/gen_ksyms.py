@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Generate the kernel symbol table (see include/ksyms.h) from `nm -n -S`.
+
+usage: nm -n -S --defined-only tsukasa_x64.elf | gen_ksyms.py > ksyms_gen.c
+"""
+
+import sys
+
+
+def main():
+    syms = []
+    for line in sys.stdin:
+        parts = line.split()
+        if len(parts) == 4:
+            addr, size, kind, name = parts
+            size = int(size, 16)
+        elif len(parts) == 3:
+            addr, kind, name = parts
+            size = 0
+        else:
+            continue
+        if kind not in "TtWw":
+            continue
+        addr = int(addr, 16)
+        # Aliases at one address: keep the first global name.
+        if syms and syms[-1][0] == addr:
+            if syms[-1][2][0].islower() and kind.isupper():
+                syms[-1] = (addr, size or syms[-1][1], kind, name)
+            continue
+        syms.append((addr, size, kind, name))
+
+    out = sys.stdout
+    out.write("/* Generated by tools/gen_ksyms.py; do not edit. */\n\n")
+    out.write('#include "include/ksyms.h"\n\n')
+    out.write("const uint32_t g_ksyms_count = %d;\n\n" % len(syms))
+    out.write("const ksym_t g_ksyms[%d] = {\n" % max(len(syms), 1))
+    for i, (addr, size, _, name) in enumerate(syms):
+        if size == 0 and i + 1 < len(syms):
+            size = syms[i + 1][0] - addr
+        out.write('    { 0x%xUL, %du, "%s" },\n' % (addr, size & 0xFFFFFFFF, name))
+    out.write("};\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Decode a /sys/trace dump (see include/trace.h) into text.
+
+usage: trace_decode.py DUMP [--raw]
+
+Records from all CPUs are merged by TSC.  Times are printed in
+microseconds since the first record when the dump carries a calibrated
+TSC frequency, otherwise in raw cycles (or always, with --raw).
+"""
+
+import struct
+import sys
+
+MAGIC = 0x31435254
+HEADER = struct.Struct("<IHHQIIII")
+RECORD = struct.Struct("<QHHIQQ")
+
+# Keep in sync with enum trace_event.
+EVENTS = {
+    1: "irq_entry",
+    2: "irq_exit",
+    3: "sched_switch",
+    4: "syscall_entry",
+    5: "syscall_exit",
+    6: "vfs_read_entry",
+    7: "vfs_read_exit",
+    8: "vfs_write_entry",
+    9: "vfs_write_exit",
+    10: "nic_send",
+    11: "nic_poll_rx",
+    12: "wm_redraw_begin",
+    13: "wm_redraw_end",
+}
+
+
+def format_args(event, a0, a1):
+    if event in (1, 2):
+        return "vector=%d" % a0
+    if event == 3:
+        return "prev=%d next=%d" % (a0, a1)
+    if event == 4:
+        return "nr=%d arg1=0x%x" % (a0, a1)
+    if event == 5:
+        ret = a1 - (1 << 64) if a1 >= 1 << 63 else a1
+        return "nr=%d ret=%d" % (a0, ret)
+    if event in (6, 8):
+        return "fd=%d count=%d" % (a0, a1)
+    if event in (7, 9):
+        return "fd=%d bytes=%d" % (a0, a1)
+    if event == 10:
+        rc = a1 - (1 << 64) if a1 >= 1 << 63 else a1
+        return "len=%d rc=%d" % (a0, rc)
+    if event == 11:
+        return "frames=%d bytes=%d" % (a0, a1)
+    if event == 12:
+        x, y, w, h = [(a0 >> s) & 0xFFFF for s in (0, 16, 32, 48)]
+        return "rect=%d,%d %dx%d" % (x, y, w, h)
+    if event == 13:
+        return "windows=%d" % a0
+    return "a0=0x%x a1=0x%x" % (a0, a1)
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 2
+    raw = "--raw" in argv[2:]
+    with open(argv[1], "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.stderr.write("trace_decode: short file\n")
+        return 1
+    magic, version, rec_size, tsc_hz, count, dropped, mask, _ = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 1 or rec_size != RECORD.size:
+        sys.stderr.write("trace_decode: not a version 1 trace dump\n")
+        return 1
+
+    records = []
+    off = HEADER.size
+    for _ in range(count):
+        if off + RECORD.size > len(data):
+            break
+        records.append(RECORD.unpack_from(data, off))
+        off += RECORD.size
+    records.sort(key=lambda r: r[0])
+
+    print("# records=%d dropped=%d mask=0x%x tsc_hz=%d" % (len(records), dropped, mask, tsc_hz))
+    if not records:
+        return 0
+    t0 = records[0][0]
+    for tsc, event, cpu, pid, a0, a1 in records:
+        delta = tsc - t0
+        if tsc_hz and not raw:
+            stamp = "%14.3f" % (delta * 1e6 / tsc_hz)
+        else:
+            stamp = "%14d" % delta
+        name = EVENTS.get(event, "event%d" % event)
+        print("%s cpu%d pid%-4d %-16s %s" % (stamp, cpu, pid, name, format_args(event, a0, a1)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
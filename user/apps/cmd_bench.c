@@ -0,0 +1,127 @@
+#include "../include/app_runtime.h"
+#include "../include/fcntl.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+#include "../include/unistd.h"
+#include "../include/syscall_nums.h"
+#include "../lib/syscall.h"
+
+#define BENCH_CSV_CAP     (16 * 1024)
+#define BENCH_DEFAULT_OUT "/tmp/bench.csv"
+
+/* The libc printf has no field widths; pad by hand. */
+static void print_padded(const char *text, int len, int width, int left)
+{
+    if (!left)
+        for (int i = len; i < width; i++)
+            putchar(' ');
+    for (int i = 0; i < len; i++)
+        putchar(text[i]);
+    if (left)
+        for (int i = len; i < width; i++)
+            putchar(' ');
+}
+
+/* Split one CSV line into at most `max` fields; returns the field count. */
+static int bench_split(const char *line, const char **f, int *flen, int max)
+{
+    int nf = 0;
+
+    f[0] = line;
+    for (const char *p = line;; p++) {
+        if (*p == ',' || *p == '\n' || *p == '\0') {
+            flen[nf] = (int)(p - f[nf]);
+            nf++;
+            if (*p != ',' || nf == max)
+                break;
+            f[nf] = p + 1;
+        }
+    }
+    return nf;
+}
+
+/* Print "suite/case  status  median  p99  MB/s" for each CSV data row. */
+static void bench_print_table(const char *csv)
+{
+    const char *line = strchr(csv, '\n');
+
+    print_padded("case", 4, 28, 1);
+    print_padded("status", 6, 8, 1);
+    print_padded("median_ns", 9, 12, 0);
+    print_padded("p99_ns", 6, 12, 0);
+    print_padded("MB/s", 4, 8, 0);
+    putchar('\n');
+
+    while (line && line[1]) {
+        const char *f[10];
+        int flen[10];
+
+        line++;
+        if (bench_split(line, f, flen, 10) == 10) {
+            print_padded(f[0], flen[0], 0, 1);
+            putchar('/');
+            print_padded(f[1], flen[1], 27 - flen[0], 1);
+            print_padded(f[2], flen[2], 8, 1);
+            print_padded(f[5], flen[5], 12, 0);
+            print_padded(f[6], flen[6], 12, 0);
+            print_padded(f[9], flen[9], 8, 0);
+            putchar('\n');
+        }
+        line = strchr(line, '\n');
+    }
+}
+
+static int cmd_bench_main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    const char *out_path = BENCH_DEFAULT_OUT;
+    unsigned int flags = 0;
+    char *csv;
+    int len;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-l") == 0) {
+            flags |= BENCH_RUN_LIST;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            dprintf(2, "usage: bench [-l] [-o file.csv] [suite|suite/case]\n");
+            return 1;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    csv = (char *)malloc(BENCH_CSV_CAP);
+    if (!csv) {
+        dprintf(2, "bench: out of memory\n");
+        return 1;
+    }
+    len = system_bench_run(filter, csv, BENCH_CSV_CAP, flags);
+    if (len < 0) {
+        dprintf(2, "bench: kernel harness failed\n");
+        free(csv);
+        return 1;
+    }
+
+    if (flags & BENCH_RUN_LIST) {
+        write(1, csv, (size_t)len);
+    } else {
+        int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0);
+        bench_print_table(csv);
+        if (fd < 0 || write(fd, csv, (size_t)len) != len)
+            dprintf(2, "bench: cannot write %s\n", out_path);
+        else
+            printf("wrote %s\n", out_path);
+        if (fd >= 0)
+            close(fd);
+    }
+    free(csv);
+    return 0;
+}
+
+void app_cmd_bench_entry(void)
+{
+    _exit(app_run_main(cmd_bench_main));
+}
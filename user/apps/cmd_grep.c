@@ -25,30 +25,55 @@ static int contains(const char *line, const char *needle)
 
 static int cmd_grep_main(int argc, char **argv)
 {
-    char buf[4096];
-    char *p;
+    char *buf = 0;
+    size_t cap = 0;
     size_t len = 0;
     ssize_t n;
+    int eof = 0;
     const char *pattern = (argc > 1) ? argv[1] : "";
 
-    while (len + 1 < sizeof(buf)) {
-        n = read(0, buf + len, sizeof(buf) - len - 1);
-        if (n <= 0)
+    /* Stream line by line; the buffer only grows to the longest line. */
+    while (!eof || len > 0) {
+        char *nl;
+        size_t start = 0;
+
+        if (!eof) {
+            if (len + 1 >= cap) {
+                size_t ncap = cap ? cap * 2 : 4096;
+                char *nbuf = (char *)realloc(buf, ncap);
+                if (!nbuf) {
+                    dprintf(2, "grep: out of memory\n");
+                    free(buf);
+                    return 1;
+                }
+                buf = nbuf;
+                cap = ncap;
+            }
+            n = read(0, buf + len, cap - len - 1);
+            if (n <= 0)
+                eof = 1;
+            else
+                len += (size_t)n;
+        }
+        if (!buf)
             break;
-        len += (size_t)n;
-    }
-    buf[len] = '\0';
+        buf[len] = '\0';
 
-    p = buf;
-    while (*p) {
-        char *line = p;
-        while (*p && *p != '\n')
-            p++;
-        if (*p == '\n')
-            *p++ = '\0';
-        if (contains(line, pattern))
-            dprintf(1, "%s\n", line);
+        while ((nl = strchr(buf + start, '\n')) != 0) {
+            *nl = '\0';
+            if (contains(buf + start, pattern))
+                printf("%s\n", buf + start);
+            start = (size_t)(nl - buf) + 1;
+        }
+        if (eof && start < len) {
+            if (contains(buf + start, pattern))
+                printf("%s\n", buf + start);
+            start = len;
+        }
+        memmove(buf, buf + start, len - start);
+        len -= start;
     }
+    free(buf);
     return 0;
 }
 
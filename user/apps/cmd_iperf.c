@@ -0,0 +1,209 @@
+#include "../include/app_runtime.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+#include "../include/syscall_nums.h"
+#include "../include/unistd.h"
+
+#include "../lib/syscall.h"
+
+#include <stdint.h>
+
+/*
+ * TCP throughput in the iperf 2 format (the protocol lwIP's lwiperf
+ * speaks): the client streams zero-filled buffers, so its leading client
+ * header has no flags set and the server just counts bytes.  Peers are
+ * `iperf -s` / `iperf -c` on the host, over QEMU user-net or a tap.
+ */
+
+#define IPERF_PORT      5001
+#define IPERF_BUF_MAX   (64u * 1024u)
+#define IPERF_DEF_LEN   (8u * 1024u)
+#define IPERF_DEF_SECS  10
+
+static uint8_t g_iperf_buf[IPERF_BUF_MAX];
+
+static void iperf_usage(void)
+{
+    dprintf(2, "usage: iperf -s [-p port]\n"
+               "       iperf -c host [-p port] [-t secs] [-l len]\n");
+}
+
+/* Dotted quad, else a DNS lookup. */
+static int iperf_parse_host(const char *arg, struct tsukasa_net_ipv4 *out)
+{
+    const char *p = arg;
+    for (int i = 0; i < 4; i++) {
+        char *end = 0;
+        long v = strtol(p, &end, 10);
+        if (!end || end == p || v < 0 || v > 255)
+            return net_dns_lookup(arg, out);
+        out->bytes[i] = (uint8_t)v;
+        if (i < 3 && *end != '.')
+            return net_dns_lookup(arg, out);
+        p = end + 1;
+        if (i == 3 && *end != '\0')
+            return net_dns_lookup(arg, out);
+    }
+    return 0;
+}
+
+/* "<from>-<to> sec  <bytes> KBytes  <rate> Mbits/sec" */
+static void iperf_report(uint64_t from_us, uint64_t to_us, uint64_t bytes)
+{
+    uint64_t span = to_us > from_us ? to_us - from_us : 1;
+    uint64_t deci_mbps = bytes * 8u * 10u / span;
+
+    printf("%u.%u-%u.%u sec  %u KBytes  %u.%u Mbits/sec\n",
+           (unsigned)(from_us / 1000000u), (unsigned)(from_us / 100000u % 10u),
+           (unsigned)(to_us / 1000000u), (unsigned)(to_us / 100000u % 10u),
+           (unsigned)(bytes / 1024u),
+           (unsigned)(deci_mbps / 10u), (unsigned)(deci_mbps % 10u));
+}
+
+static int iperf_server(uint16_t port)
+{
+    struct tsukasa_sockaddr addr;
+    int lfd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.port = port;
+    lfd = net_socket(TSUKASA_SOCK_STREAM, 0);
+    if (lfd < 0 || net_bind(lfd, &addr) != 0 || net_listen(lfd, 1) != 0) {
+        dprintf(2, "iperf: cannot listen on port %u\n", (unsigned)port);
+        if (lfd >= 0)
+            close(lfd);
+        return 1;
+    }
+    printf("Server listening on TCP port %u\n", (unsigned)port);
+
+    for (;;) {
+        struct tsukasa_sockaddr peer;
+        uint64_t start, mark, now;
+        uint64_t total = 0;
+        uint64_t interval = 0;
+        int fd = net_accept(lfd, &peer);
+
+        if (fd < 0)
+            break;
+        printf("connected with %u.%u.%u.%u port %u\n",
+               (unsigned)peer.ip.bytes[0], (unsigned)peer.ip.bytes[1],
+               (unsigned)peer.ip.bytes[2], (unsigned)peer.ip.bytes[3], (unsigned)peer.port);
+
+        start = system_clock_us();
+        mark = start;
+        for (;;) {
+            ssize_t got = read(fd, g_iperf_buf, IPERF_BUF_MAX);
+            if (got <= 0)
+                break;
+            total += (uint64_t)got;
+            interval += (uint64_t)got;
+            now = system_clock_us();
+            if (now - mark >= 1000000u) {
+                iperf_report(mark - start, now - start, interval);
+                mark = now;
+                interval = 0;
+            }
+        }
+        now = system_clock_us();
+        iperf_report(0, now - start, total);
+        close(fd);
+    }
+    close(lfd);
+    return 0;
+}
+
+static int iperf_client(const struct tsukasa_net_ipv4 *ip, uint16_t port, unsigned secs, size_t len)
+{
+    struct tsukasa_sockaddr addr;
+    uint64_t start, mark, now, deadline;
+    uint64_t total = 0;
+    uint64_t interval = 0;
+    int fd;
+
+    addr.ip = *ip;
+    addr.port = port;
+    fd = net_socket(TSUKASA_SOCK_STREAM, 0);
+    if (fd < 0 || net_connect(fd, &addr) != 0) {
+        dprintf(2, "iperf: connect to %u.%u.%u.%u:%u failed\n",
+                (unsigned)ip->bytes[0], (unsigned)ip->bytes[1],
+                (unsigned)ip->bytes[2], (unsigned)ip->bytes[3], (unsigned)port);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+    printf("Client connecting to %u.%u.%u.%u, TCP port %u, %u byte writes\n",
+           (unsigned)ip->bytes[0], (unsigned)ip->bytes[1],
+           (unsigned)ip->bytes[2], (unsigned)ip->bytes[3], (unsigned)port, (unsigned)len);
+
+    memset(g_iperf_buf, 0, len);
+    start = system_clock_us();
+    mark = start;
+    deadline = start + (uint64_t)secs * 1000000u;
+    for (now = start; now < deadline; ) {
+        ssize_t put = write(fd, g_iperf_buf, len);
+        if (put < 0) {
+            dprintf(2, "iperf: send failed\n");
+            break;
+        }
+        total += (uint64_t)put;
+        interval += (uint64_t)put;
+        now = system_clock_us();
+        if (now - mark >= 1000000u) {
+            iperf_report(mark - start, now - start, interval);
+            mark = now;
+            interval = 0;
+        }
+    }
+    close(fd);
+    iperf_report(0, system_clock_us() - start, total);
+    return 0;
+}
+
+static int cmd_iperf_main(int argc, char **argv)
+{
+    struct tsukasa_net_ipv4 ip;
+    const char *host = 0;
+    int server = 0;
+    uint16_t port = IPERF_PORT;
+    unsigned secs = IPERF_DEF_SECS;
+    size_t len = IPERF_DEF_LEN;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0) {
+            server = 1;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            secs = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            len = (size_t)atoi(argv[++i]);
+        } else {
+            iperf_usage();
+            return 1;
+        }
+    }
+    if (server == (host != 0) || port == 0 || secs == 0 || len == 0 || len > IPERF_BUF_MAX) {
+        iperf_usage();
+        return 1;
+    }
+
+    if (net_init() != 0 || !net_has_ip()) {
+        dprintf(2, "iperf: network not ready\n");
+        return 1;
+    }
+    if (server)
+        return iperf_server(port);
+    if (iperf_parse_host(host, &ip) != 0) {
+        dprintf(2, "iperf: cannot resolve %s\n", host);
+        return 1;
+    }
+    return iperf_client(&ip, port, secs, len);
+}
+
+void app_cmd_iperf_entry(void)
+{
+    _exit(app_run_main(cmd_iperf_main));
+}
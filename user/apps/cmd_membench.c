@@ -0,0 +1,116 @@
+#include "../include/app_runtime.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+
+#include "../../include/memops.h"
+#include "../../include/tsc.h"
+
+#include <stdint.h>
+
+#define MEMBENCH_MAX_SIZE   (1024u * 1024u)
+#define MEMBENCH_BUDGET     (4u * 1024u * 1024u)   /* bytes moved per cell */
+
+static const size_t k_sizes[] = { 8, 64, 256, 1024, 4096, 65536, MEMBENCH_MAX_SIZE };
+
+/* (dst, src) misalignment pairs. */
+static const int k_align[][2] = { { 0, 0 }, { 1, 3 } };
+
+/* The libc printf has no field widths; pad by hand. */
+static void print_padded(const char *text, int width, int left)
+{
+    int len = (int)strlen(text);
+    if (!left)
+        for (int i = len; i < width; i++)
+            putchar(' ');
+    fputs(text, stdout);
+    if (left)
+        for (int i = len; i < width; i++)
+            putchar(' ');
+}
+
+static void print_col_u(uint64_t v)
+{
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%u", (unsigned)v);
+    putchar(' ');
+    print_padded(tmp, 8, 0);
+}
+
+/* Bytes per 1000 cycles for one operation/size/alignment cell. */
+static uint64_t membench_cell(const memops_ops_t *ops, int op,
+                              uint8_t *dst, const uint8_t *src, size_t size)
+{
+    uint32_t iters = MEMBENCH_BUDGET / (uint32_t)size;
+    uint64_t t0;
+    uint64_t cycles;
+
+    if (iters == 0)
+        iters = 1;
+    t0 = tsc_read();
+    for (uint32_t i = 0; i < iters; i++) {
+        if (op == 0)
+            ops->copy(dst, src, size);
+        else
+            ops->set(dst, (int)i, size);
+    }
+    cycles = tsc_read() - t0;
+    if (cycles == 0)
+        cycles = 1;
+    return ((uint64_t)iters * size * 1000u) / cycles;
+}
+
+static int cmd_membench_main(int argc, char **argv)
+{
+    uint8_t *dst = (uint8_t *)malloc(MEMBENCH_MAX_SIZE + 64);
+    uint8_t *src = (uint8_t *)malloc(MEMBENCH_MAX_SIZE + 64);
+    (void)argc;
+    (void)argv;
+
+    if (!dst || !src) {
+        dprintf(2, "membench: out of memory\n");
+        free(dst);
+        free(src);
+        return 1;
+    }
+    memset(src, 0x5A, MEMBENCH_MAX_SIZE + 64);
+
+    printf("memops default=%s; throughput in bytes per 1000 TSC cycles\n",
+           memops_impl_name(memops_impl_active()));
+    for (int op = 0; op < 2; op++) {
+        putchar('\n');
+        print_padded(op == 0 ? "copy" : "set", 7, 1);
+        print_padded("align", 5, 1);
+        for (size_t s = 0; s < sizeof(k_sizes) / sizeof(k_sizes[0]); s++)
+            print_col_u(k_sizes[s]);
+        putchar('\n');
+        for (int impl = 0; impl < MEMOPS_IMPL_COUNT; impl++) {
+            const memops_ops_t *ops = memops_impl_ops(impl);
+            if (!ops)
+                continue;
+            for (size_t a = 0; a < sizeof(k_align) / sizeof(k_align[0]); a++) {
+                uint64_t res[sizeof(k_sizes) / sizeof(k_sizes[0])];
+                for (size_t s = 0; s < sizeof(k_sizes) / sizeof(k_sizes[0]); s++)
+                    res[s] = membench_cell(ops, op, dst + k_align[a][0], src + k_align[a][1], k_sizes[s]);
+                {
+                    char tag[16];
+                    snprintf(tag, sizeof(tag), "%d/%d", k_align[a][0], k_align[a][1]);
+                    print_padded(memops_impl_name(impl), 7, 1);
+                    print_padded(tag, 5, 1);
+                }
+                for (size_t s = 0; s < sizeof(k_sizes) / sizeof(k_sizes[0]); s++)
+                    print_col_u(res[s]);
+                putchar('\n');
+            }
+        }
+    }
+
+    free(dst);
+    free(src);
+    return 0;
+}
+
+void app_cmd_membench_entry(void)
+{
+    _exit(app_run_main(cmd_membench_main));
+}
@@ -0,0 +1,54 @@
+#include "../include/app_runtime.h"
+#include "../include/fcntl.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+#include "../include/unistd.h"
+#include "../lib/syscall.h"
+
+static int profile_show(void)
+{
+    char buf[512];
+    ssize_t n;
+    int fd = open("/sys/profile", O_RDONLY, 0);
+
+    if (fd < 0) {
+        dprintf(2, "profile: cannot open /sys/profile\n");
+        return 1;
+    }
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        write(1, buf, (size_t)n);
+    close(fd);
+    return 0;
+}
+
+static int cmd_profile_main(int argc, char **argv)
+{
+    if (argc < 2 || strcmp(argv[1], "show") == 0)
+        return profile_show();
+
+    if (strcmp(argv[1], "start") == 0) {
+        unsigned int hz = (argc > 2) ? (unsigned int)atoi(argv[2]) : 0;
+        unsigned int got = system_profile_ctl(hz);
+        if (!got) {
+            dprintf(2, "profile: no timer source available\n");
+            return 1;
+        }
+        printf("profiling at %u Hz\n", got);
+        return 0;
+    }
+    if (strcmp(argv[1], "stop") == 0) {
+        system_profile_ctl(0);
+        return profile_show();
+    }
+
+    dprintf(2, "usage: profile [show]\n"
+               "       profile start [hz]\n"
+               "       profile stop\n");
+    return 1;
+}
+
+void app_cmd_profile_entry(void)
+{
+    _exit(app_run_main(cmd_profile_main));
+}
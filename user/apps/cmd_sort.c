@@ -13,40 +13,68 @@ static int cmp_lines(const void *a, const void *b)
 
 static int cmd_sort_main(int argc, char **argv)
 {
-    char buf[4096];
-    const char *lines[256];
+    char *buf = 0;
+    const char **lines = 0;
+    size_t cap = 0;
     size_t len = 0;
+    size_t line_cap = 0;
+    size_t line_count = 0;
     ssize_t n;
-    int line_count = 0;
     (void)argc;
     (void)argv;
 
-    while (len + 1 < sizeof(buf)) {
-        n = read(0, buf + len, sizeof(buf) - len - 1);
+    for (;;) {
+        if (len + 1 >= cap) {
+            size_t ncap = cap ? cap * 2 : 4096;
+            char *nbuf = (char *)realloc(buf, ncap);
+            if (!nbuf) {
+                dprintf(2, "sort: out of memory\n");
+                free(buf);
+                return 1;
+            }
+            buf = nbuf;
+            cap = ncap;
+        }
+        n = read(0, buf + len, cap - len - 1);
         if (n <= 0)
             break;
         len += (size_t)n;
     }
-    buf[len] = '\0';
-    if (len == 0)
+    if (len == 0) {
+        free(buf);
         return 0;
+    }
+    buf[len] = '\0';
 
     {
         char *p = buf;
-        lines[line_count++] = p;
-        while (*p && line_count < (int)(sizeof(lines) / sizeof(lines[0]))) {
-            if (*p == '\n') {
-                *p = '\0';
-                if (p[1])
-                    lines[line_count++] = p + 1;
+        while (*p) {
+            char *line = p;
+            while (*p && *p != '\n')
+                p++;
+            if (*p == '\n')
+                *p++ = '\0';
+            if (line_count == line_cap) {
+                size_t ncap = line_cap ? line_cap * 2 : 256;
+                const char **nl = (const char **)realloc((void *)lines, ncap * sizeof(lines[0]));
+                if (!nl) {
+                    dprintf(2, "sort: out of memory\n");
+                    free((void *)lines);
+                    free(buf);
+                    return 1;
+                }
+                lines = nl;
+                line_cap = ncap;
             }
-            p++;
+            lines[line_count++] = line;
         }
     }
 
-    qsort((void *)lines, (size_t)line_count, sizeof(lines[0]), cmp_lines);
-    for (int i = 0; i < line_count; i++)
-        dprintf(1, "%s\n", lines[i]);
+    qsort((void *)lines, line_count, sizeof(lines[0]), cmp_lines);
+    for (size_t i = 0; i < line_count; i++)
+        printf("%s\n", lines[i]);
+    free((void *)lines);
+    free(buf);
     return 0;
 }
 
@@ -0,0 +1,101 @@
+#include "../include/app_runtime.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+#include "../include/syscall_nums.h"
+#include "../lib/syscall.h"
+
+#include "../../include/trace.h"
+
+#include <stdint.h>
+
+typedef struct trace_group {
+    const char *name;
+    uint32_t mask;
+} trace_group_t;
+
+static const trace_group_t k_groups[] = {
+    { "irq",     TRACE_BIT(TRACE_EV_IRQ_ENTRY) | TRACE_BIT(TRACE_EV_IRQ_EXIT) },
+    { "sched",   TRACE_BIT(TRACE_EV_SCHED_SWITCH) },
+    { "syscall", TRACE_BIT(TRACE_EV_SYSCALL_ENTRY) | TRACE_BIT(TRACE_EV_SYSCALL_EXIT) },
+    { "vfs",     TRACE_BIT(TRACE_EV_VFS_READ_ENTRY) | TRACE_BIT(TRACE_EV_VFS_READ_EXIT) |
+                 TRACE_BIT(TRACE_EV_VFS_WRITE_ENTRY) | TRACE_BIT(TRACE_EV_VFS_WRITE_EXIT) },
+    { "nic",     TRACE_BIT(TRACE_EV_NIC_SEND) | TRACE_BIT(TRACE_EV_NIC_POLL_RX) },
+    { "wm",      TRACE_BIT(TRACE_EV_WM_REDRAW_BEGIN) | TRACE_BIT(TRACE_EV_WM_REDRAW_END) },
+    { "all",     TRACE_MASK_ALL },
+};
+
+static void trace_usage(void)
+{
+    dprintf(2, "usage: trace status\n"
+               "       trace on [group|mask]...   groups: irq sched syscall vfs nic wm all\n"
+               "       trace off\n"
+               "       trace clear\n");
+}
+
+/* Group name or numeric mask; returns 0 if unrecognised. */
+static uint32_t trace_parse_mask(const char *arg)
+{
+    char *end = 0;
+    long v;
+
+    for (size_t i = 0; i < sizeof(k_groups) / sizeof(k_groups[0]); i++) {
+        if (strcmp(arg, k_groups[i].name) == 0)
+            return k_groups[i].mask;
+    }
+    v = strtol(arg, &end, 0);
+    if (!end || *end != '\0' || end == arg)
+        return 0;
+    return (uint32_t)v & TRACE_MASK_ALL;
+}
+
+static void trace_print_status(uint32_t mask)
+{
+    printf("mask=0x%x", (unsigned)mask);
+    for (size_t i = 0; i + 1 < sizeof(k_groups) / sizeof(k_groups[0]); i++) {
+        if (mask & k_groups[i].mask)
+            printf(" %s", k_groups[i].name);
+    }
+    printf("\nread /sys/trace for the binary dump\n");
+}
+
+static int cmd_trace_main(int argc, char **argv)
+{
+    uint32_t mask = 0;
+
+    if (argc < 2 || strcmp(argv[1], "status") == 0) {
+        trace_print_status(system_trace_ctl(0, 0));
+        return 0;
+    }
+    if (strcmp(argv[1], "off") == 0) {
+        system_trace_ctl(0, TRACE_CTL_SET_MASK);
+        return 0;
+    }
+    if (strcmp(argv[1], "clear") == 0) {
+        system_trace_ctl(0, TRACE_CTL_RESET);
+        return 0;
+    }
+    if (strcmp(argv[1], "on") != 0) {
+        trace_usage();
+        return 1;
+    }
+
+    if (argc == 2)
+        mask = TRACE_MASK_ALL;
+    for (int i = 2; i < argc; i++) {
+        uint32_t m = trace_parse_mask(argv[i]);
+        if (!m) {
+            dprintf(2, "trace: unknown event group '%s'\n", argv[i]);
+            return 1;
+        }
+        mask |= m;
+    }
+    system_trace_ctl(mask, TRACE_CTL_SET_MASK | TRACE_CTL_RESET);
+    trace_print_status(mask);
+    return 0;
+}
+
+void app_cmd_trace_entry(void)
+{
+    _exit(app_run_main(cmd_trace_main));
+}
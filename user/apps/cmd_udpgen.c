@@ -0,0 +1,245 @@
+#include "../include/app_runtime.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+#include "../include/syscall_nums.h"
+#include "../include/unistd.h"
+
+#include "../lib/syscall.h"
+
+#include <stdint.h>
+
+/*
+ * UDP packet-rate generator and sink.  The sender stamps a sequence number
+ * into the first four bytes of each datagram and paces to a target rate;
+ * the receiver counts packets and sequence gaps, so together they measure
+ * the small-packet path that iperf's bulk TCP stream does not exercise.
+ */
+
+#define UDPGEN_BUF_MAX   1472u
+#define UDPGEN_DEF_LEN   64u
+#define UDPGEN_DEF_SECS  10
+
+static uint8_t g_udpgen_buf[UDPGEN_BUF_MAX];
+
+static void udpgen_usage(void)
+{
+    dprintf(2, "usage: udpgen send host port [-t secs] [-l len] [-r pps]\n"
+               "       udpgen recv port [-t secs]\n");
+}
+
+/* Dotted quad, else a DNS lookup. */
+static int udpgen_parse_host(const char *arg, struct tsukasa_net_ipv4 *out)
+{
+    const char *p = arg;
+    for (int i = 0; i < 4; i++) {
+        char *end = 0;
+        long v = strtol(p, &end, 10);
+        if (!end || end == p || v < 0 || v > 255)
+            return net_dns_lookup(arg, out);
+        out->bytes[i] = (uint8_t)v;
+        if (i < 3 && *end != '.')
+            return net_dns_lookup(arg, out);
+        p = end + 1;
+        if (i == 3 && *end != '\0')
+            return net_dns_lookup(arg, out);
+    }
+    return 0;
+}
+
+static void udpgen_report(uint64_t from_us, uint64_t to_us, uint64_t pkts, uint64_t bytes, uint64_t lost)
+{
+    uint64_t span = to_us > from_us ? to_us - from_us : 1;
+
+    printf("%u-%u sec  %u pkts  %u pps  %u KBytes  %u lost\n",
+           (unsigned)(from_us / 1000000u), (unsigned)(to_us / 1000000u),
+           (unsigned)pkts, (unsigned)(pkts * 1000000u / span),
+           (unsigned)(bytes / 1024u), (unsigned)lost);
+}
+
+static int udpgen_send(const struct tsukasa_net_ipv4 *ip, uint16_t port,
+                       unsigned secs, size_t len, unsigned pps)
+{
+    struct tsukasa_sockaddr to;
+    uint64_t start, mark, now, deadline;
+    uint64_t sent = 0, interval = 0, failed = 0;
+    uint32_t seq = 0;
+    int fd;
+
+    to.ip = *ip;
+    to.port = port;
+    fd = net_socket(TSUKASA_SOCK_DGRAM, 0);
+    if (fd < 0) {
+        dprintf(2, "udpgen: socket failed\n");
+        return 1;
+    }
+    printf("sending %u byte datagrams to %u.%u.%u.%u:%u, %u pps\n",
+           (unsigned)len, (unsigned)ip->bytes[0], (unsigned)ip->bytes[1],
+           (unsigned)ip->bytes[2], (unsigned)ip->bytes[3], (unsigned)port, pps);
+
+    memset(g_udpgen_buf, 0, len);
+    start = system_clock_us();
+    mark = start;
+    deadline = start + (uint64_t)secs * 1000000u;
+    for (now = start; now < deadline; now = system_clock_us()) {
+        /* Rate 0 means as fast as the stack takes them. */
+        if (pps && seq * 1000000ull / pps > now - start) {
+            yield();
+            continue;
+        }
+        g_udpgen_buf[0] = (uint8_t)(seq >> 24);
+        g_udpgen_buf[1] = (uint8_t)(seq >> 16);
+        g_udpgen_buf[2] = (uint8_t)(seq >> 8);
+        g_udpgen_buf[3] = (uint8_t)seq;
+        if (net_sendto(fd, g_udpgen_buf, len, &to) < 0)
+            failed++;
+        else
+            interval++;
+        seq++;
+        if (now - mark >= 1000000u) {
+            udpgen_report(mark - start, now - start, interval, interval * len, 0);
+            sent += interval;
+            mark = now;
+            interval = 0;
+        }
+    }
+    sent += interval;
+    close(fd);
+    udpgen_report(0, system_clock_us() - start, sent, sent * len, 0);
+    if (failed)
+        printf("%u sends failed\n", (unsigned)failed);
+    return 0;
+}
+
+static int udpgen_recv(uint16_t port, unsigned secs)
+{
+    struct tsukasa_sockaddr addr;
+    struct tsukasa_pollfd pfd;
+    uint64_t start = 0, mark = 0, now, deadline = 0;
+    uint64_t pkts = 0, bytes = 0, lost = 0;
+    uint64_t i_pkts = 0, i_bytes = 0, i_lost = 0;
+    uint32_t next = 0;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.port = port;
+    fd = net_socket(TSUKASA_SOCK_DGRAM, 0);
+    if (fd < 0 || net_bind(fd, &addr) != 0) {
+        dprintf(2, "udpgen: cannot bind port %u\n", (unsigned)port);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+    printf("listening on UDP port %u\n", (unsigned)port);
+
+    /* The clock starts at the first datagram. */
+    for (;;) {
+        struct tsukasa_sockaddr from;
+        long got;
+        uint32_t seq;
+
+        now = system_clock_us();
+        if (pkts && now >= deadline)
+            break;
+        if (pkts && now - mark >= 1000000u) {
+            udpgen_report(mark - start, now - start, i_pkts, i_bytes, i_lost);
+            mark = now;
+            i_pkts = i_bytes = i_lost = 0;
+        }
+
+        pfd.fd = fd;
+        pfd.events = TSUKASA_POLLIN;
+        pfd.revents = 0;
+        if (fs_poll(&pfd, 1, 1000) <= 0 || !(pfd.revents & TSUKASA_POLLIN))
+            continue;
+        got = net_recvfrom(fd, g_udpgen_buf, UDPGEN_BUF_MAX, &from);
+        if (got < 4)
+            continue;
+
+        seq = ((uint32_t)g_udpgen_buf[0] << 24) | ((uint32_t)g_udpgen_buf[1] << 16) |
+              ((uint32_t)g_udpgen_buf[2] << 8) | (uint32_t)g_udpgen_buf[3];
+        if (!pkts) {
+            start = system_clock_us();
+            mark = start;
+            deadline = start + (uint64_t)secs * 1000000u;
+            next = seq;
+        }
+        /* Reordered or duplicate datagrams are counted but not credited as gaps. */
+        if (seq > next) {
+            lost += seq - next;
+            i_lost += seq - next;
+        }
+        if (seq >= next)
+            next = seq + 1u;
+        pkts++;
+        i_pkts++;
+        bytes += (uint64_t)got;
+        i_bytes += (uint64_t)got;
+    }
+    close(fd);
+    udpgen_report(0, now - start, pkts, bytes, lost);
+    return 0;
+}
+
+static int cmd_udpgen_main(int argc, char **argv)
+{
+    struct tsukasa_net_ipv4 ip;
+    const char *host = 0;
+    int sending;
+    int argi;
+    uint16_t port;
+    unsigned secs = UDPGEN_DEF_SECS;
+    unsigned pps = 0;
+    size_t len = UDPGEN_DEF_LEN;
+
+    if (argc < 3) {
+        udpgen_usage();
+        return 1;
+    }
+    if (strcmp(argv[1], "send") == 0 && argc >= 4) {
+        sending = 1;
+        host = argv[2];
+        port = (uint16_t)atoi(argv[3]);
+        argi = 4;
+    } else if (strcmp(argv[1], "recv") == 0) {
+        sending = 0;
+        port = (uint16_t)atoi(argv[2]);
+        argi = 3;
+    } else {
+        udpgen_usage();
+        return 1;
+    }
+    for (int i = argi; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            secs = (unsigned)atoi(argv[++i]);
+        } else if (sending && strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            len = (size_t)atoi(argv[++i]);
+        } else if (sending && strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            pps = (unsigned)atoi(argv[++i]);
+        } else {
+            udpgen_usage();
+            return 1;
+        }
+    }
+    if (port == 0 || secs == 0 || len < 4 || len > UDPGEN_BUF_MAX) {
+        udpgen_usage();
+        return 1;
+    }
+
+    if (net_init() != 0 || !net_has_ip()) {
+        dprintf(2, "udpgen: network not ready\n");
+        return 1;
+    }
+    if (!sending)
+        return udpgen_recv(port, secs);
+    if (udpgen_parse_host(host, &ip) != 0) {
+        dprintf(2, "udpgen: cannot resolve %s\n", host);
+        return 1;
+    }
+    return udpgen_send(&ip, port, secs, len, pps);
+}
+
+void app_cmd_udpgen_entry(void)
+{
+    _exit(app_run_main(cmd_udpgen_main));
+}
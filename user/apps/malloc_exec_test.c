@@ -0,0 +1,142 @@
+#include "../include/app_runtime.h"
+#include "../include/fcntl.h"
+#include "../include/signal.h"
+#include "../include/stdio.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
+#include "../include/unistd.h"
+
+int spawn(const char *path);
+int exec_process(int pid, const char *path);
+int kill_process(int pid, int sig);
+
+/*
+ * malloc across exec.  The helper allocates (leaving a bump region and
+ * free-list entries behind), reports ready and idles; the test then execs
+ * it into the checker, whose allocations must come from fresh arena memory
+ * rather than the pointers the old image's heap left in its slot.
+ */
+
+#define MALLOC_EXEC_HELPER_PATH "/bin/malloc-exec-helper"
+#define MALLOC_EXEC_CHECK_PATH  "/bin/malloc-exec-check"
+#define MALLOC_EXEC_READY_FILE  "/tmp/malloc_exec_ready.txt"
+#define MALLOC_EXEC_RESULT_FILE "/tmp/malloc_exec_result.txt"
+#define MALLOC_EXEC_WAIT_YIELDS 100000
+
+static int write_flag_file(const char *path, const char *text)
+{
+    size_t len = strlen(text);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0);
+
+    if (fd < 0)
+        return -1;
+    if (write(fd, text, len) != (ssize_t)len) {
+        close(fd);
+        return -1;
+    }
+    return close(fd);
+}
+
+static int read_flag_file(const char *path, char *buf, size_t cap)
+{
+    int fd = open(path, O_RDONLY, 0);
+    int n;
+
+    if (fd < 0)
+        return -1;
+    n = (int)read(fd, buf, cap - 1);
+    close(fd);
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+    return 0;
+}
+
+static int malloc_exec_test_main(int argc, char **argv)
+{
+    char flag[16];
+    int child_pid;
+    int wait_status = 0;
+    int ready = 0;
+    (void)argc;
+    (void)argv;
+
+    /* No unlink: overwrite anything a previous run left behind. */
+    if (write_flag_file(MALLOC_EXEC_READY_FILE, "wait\n") != 0 ||
+        write_flag_file(MALLOC_EXEC_RESULT_FILE, "none\n") != 0) {
+        dprintf(2, "malloc-exec-test: FAIL (/tmp)\n");
+        return 1;
+    }
+
+    child_pid = spawn(MALLOC_EXEC_HELPER_PATH);
+    if (child_pid <= 0) {
+        dprintf(2, "malloc-exec-test: FAIL (spawn)\n");
+        return 1;
+    }
+    for (int i = 0; i < MALLOC_EXEC_WAIT_YIELDS && !ready; i++) {
+        ready = (read_flag_file(MALLOC_EXEC_READY_FILE, flag, sizeof(flag)) == 0 &&
+                 strcmp(flag, "ready\n") == 0);
+        if (!ready)
+            yield();
+    }
+    if (!ready || exec_process(child_pid, MALLOC_EXEC_CHECK_PATH) != 0) {
+        dprintf(2, "malloc-exec-test: FAIL (%s)\n", ready ? "exec" : "helper not ready");
+        kill_process(child_pid, SIGKILL);
+        waitpid(child_pid, &wait_status, 0);
+        return 1;
+    }
+    waitpid(child_pid, &wait_status, 0);
+
+    if (read_flag_file(MALLOC_EXEC_RESULT_FILE, flag, sizeof(flag)) != 0 ||
+        strcmp(flag, "ok\n") != 0) {
+        dprintf(2, "malloc-exec-test: FAIL\n");
+        return 1;
+    }
+    dprintf(1, "malloc-exec-test: PASS\n");
+    return 0;
+}
+
+void app_malloc_exec_test_entry(void)
+{
+    _exit(app_run_main(malloc_exec_test_main));
+}
+
+/* Old image: populate the bins and bump region, then wait to be replaced. */
+void app_malloc_exec_helper_entry(void)
+{
+    void *blocks[32];
+
+    for (int i = 0; i < 32; i++) {
+        blocks[i] = malloc((size_t)(16 + i * 48));
+        if (blocks[i])
+            memset(blocks[i], 0xA5, (size_t)(16 + i * 48));
+    }
+    for (int i = 0; i < 32; i += 2)
+        free(blocks[i]);
+    free(malloc(8192));
+
+    if (write_flag_file(MALLOC_EXEC_READY_FILE, "ready\n") != 0)
+        _exit(1);
+    for (;;)
+        yield();
+}
+
+/* New image, same pid: every allocation must be usable memory. */
+void app_malloc_exec_check_entry(void)
+{
+    void *blocks[32];
+
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 32; i++) {
+            blocks[i] = malloc((size_t)(16 + i * 48));
+            if (!blocks[i])
+                _exit(1);
+            memset(blocks[i], 0x5A, (size_t)(16 + i * 48));
+        }
+        for (int i = 0; i < 32; i++)
+            free(blocks[i]);
+    }
+    if (write_flag_file(MALLOC_EXEC_RESULT_FILE, "ok\n") != 0)
+        _exit(1);
+    _exit(0);
+}
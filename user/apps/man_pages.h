@@ -91,6 +91,58 @@ static const man_page_t g_man_pages[] = {
         "USAGE\n"
         "  telnet\n"
     },
+    {
+        "iperf",
+        "IPERF(1)\n"
+        "  iperf - TCP throughput test, iperf 2 compatible\n"
+        "USAGE\n"
+        "  iperf -s [-p port]\n"
+        "  iperf -c host [-p port] [-t secs] [-l len]\n"
+    },
+    {
+        "udpgen",
+        "UDPGEN(1)\n"
+        "  udpgen - UDP packet-rate generator and loss counter\n"
+        "USAGE\n"
+        "  udpgen send host port [-t secs] [-l len] [-r pps]\n"
+        "  udpgen recv port [-t secs]\n"
+    },
+    {
+        "membench",
+        "MEMBENCH(1)\n"
+        "  membench - compare memcpy/memset implementations by size and alignment\n"
+        "USAGE\n"
+        "  membench\n"
+    },
+    {
+        "trace",
+        "TRACE(1)\n"
+        "  trace - enable kernel tracepoints and clear the trace ring\n"
+        "USAGE\n"
+        "  trace [status]\n"
+        "  trace on [irq|sched|syscall|vfs|nic|wm|all|MASK]...\n"
+        "  trace off\n"
+        "  trace clear\n"
+        "  cat /sys/trace > file, then decode with tools/trace_decode.py\n"
+    },
+    {
+        "profile",
+        "PROFILE(1)\n"
+        "  profile - sample kernel RIPs and show the hottest functions\n"
+        "USAGE\n"
+        "  profile start [hz]   (default 1000, LAPIC timer; PIT tick fallback)\n"
+        "  profile stop\n"
+        "  profile [show]       (same as cat /sys/profile)\n"
+    },
+    {
+        "bench",
+        "BENCH(1)\n"
+        "  bench - run in-kernel microbenchmarks (median/p99 per iteration)\n"
+        "USAGE\n"
+        "  bench [-o file.csv] [suite|suite/case]\n"
+        "  bench -l             (list cases)\n"
+        "  Results are also written as CSV, by default to /tmp/bench.csv.\n"
+    },
 };
 
 static inline int man_page_count(void)
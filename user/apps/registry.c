@@ -15,9 +15,18 @@ void app_cmd_cat_entry(void);
 void app_cmd_net_entry(void);
 void app_cmd_ping_entry(void);
 void app_cmd_telnet_entry(void);
+void app_cmd_iperf_entry(void);
+void app_cmd_udpgen_entry(void);
 void app_cmd_abi_test_entry(void);
+void app_cmd_membench_entry(void);
+void app_cmd_trace_entry(void);
+void app_cmd_profile_entry(void);
+void app_cmd_bench_entry(void);
 void app_gui_phase2_runtime_test_entry(void);
 void app_gui_phase2_isolation_helper_entry(void);
+void app_malloc_exec_test_entry(void);
+void app_malloc_exec_helper_entry(void);
+void app_malloc_exec_check_entry(void);
 void app_shell_init_entry(void);
 
 /* GUI entrypoints. */
@@ -47,9 +56,18 @@ void user_apps_register_all(void)
     exec_register_builtin("/bin/net", app_cmd_net_entry);
     exec_register_builtin("/bin/ping", app_cmd_ping_entry);
     exec_register_builtin("/bin/telnet", app_cmd_telnet_entry);
+    exec_register_builtin("/bin/iperf", app_cmd_iperf_entry);
+    exec_register_builtin("/bin/udpgen", app_cmd_udpgen_entry);
     exec_register_builtin("/bin/abi-test", app_cmd_abi_test_entry);
+    exec_register_builtin("/bin/membench", app_cmd_membench_entry);
+    exec_register_builtin("/bin/trace", app_cmd_trace_entry);
+    exec_register_builtin("/bin/profile", app_cmd_profile_entry);
+    exec_register_builtin("/bin/bench", app_cmd_bench_entry);
     exec_register_builtin("/bin/gui-phase2-runtime-test", app_gui_phase2_runtime_test_entry);
     exec_register_builtin("/bin/gui-phase2-isolation-helper", app_gui_phase2_isolation_helper_entry);
+    exec_register_builtin("/bin/malloc-exec-test", app_malloc_exec_test_entry);
+    exec_register_builtin("/bin/malloc-exec-helper", app_malloc_exec_helper_entry);
+    exec_register_builtin("/bin/malloc-exec-check", app_malloc_exec_check_entry);
     exec_register_builtin("/bin/shinit", app_shell_init_entry);
 
     exec_register_builtin("/apps/terminal", app_terminal_gui_entry);
@@ -1,16 +1,18 @@
 #include "../include/app_runtime.h"
 #include "../include/stdio.h"
 #include "../include/stdlib.h"
+#include "../include/syscall_nums.h"
+#include "../include/unistd.h"
 
 #include "../lib/syscall.h"
 
 static int cmd_telnet_main(int argc, char **argv)
 {
-    struct tsukasa_net_ipv4 ip;
-    struct tsukasa_net_tcp_connect_req conn;
+    struct tsukasa_sockaddr addr;
     char rx[128];
     static const char probe[] = "HEAD / HTTP/1.0\r\nHost: example.com\r\n\r\n";
-    int got;
+    ssize_t got;
+    int fd;
     (void)argc;
     (void)argv;
 
@@ -18,25 +20,30 @@ static int cmd_telnet_main(int argc, char **argv)
         dprintf(2, "telnet: net init failed\n");
         return 1;
     }
-    if (net_dns_lookup("example.com", &ip) != 0) {
+    if (net_dns_lookup("example.com", &addr.ip) != 0) {
         dprintf(2, "telnet: dns lookup failed\n");
         return 1;
     }
 
-    conn.ip = ip;
-    conn.port = 80;
-    if (net_tcp_connect(&conn) != 0) {
+    fd = net_socket(TSUKASA_SOCK_STREAM, 0);
+    if (fd < 0) {
+        dprintf(2, "telnet: socket failed\n");
+        return 1;
+    }
+    addr.port = 80;
+    if (net_connect(fd, &addr) != 0) {
+        close(fd);
         dprintf(2, "telnet: connect failed\n");
         return 1;
     }
-    if (net_tcp_send(probe, sizeof(probe) - 1) < 0) {
-        net_tcp_close();
+    if (write(fd, probe, sizeof(probe) - 1) < 0) {
+        close(fd);
         dprintf(2, "telnet: send failed\n");
         return 1;
     }
 
-    got = net_tcp_recv(rx, sizeof(rx) - 1, 1);
-    net_tcp_close();
+    got = read(fd, rx, sizeof(rx) - 1);
+    close(fd);
     if (got <= 0) {
         dprintf(2, "telnet: recv failed\n");
         return 1;
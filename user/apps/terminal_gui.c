@@ -1,3 +1,4 @@
+#include "../include/fcntl.h"
 #include "../include/libui.h"
 #include "../include/shell.h"
 #include "../include/stdio.h"
@@ -7,16 +8,44 @@
 
 #define TERM_W 640
 #define TERM_H 420
-#define TERM_OUT_CAP 4096
 #define TERM_CMD_CAP 256
 #define TERM_HISTORY_MAX 64
 #define TERM_LINE_H 10
+#define TERM_TEXT_X 8
+#define TERM_TEXT_Y 8
+#define TERM_COLS ((TERM_W - 2 * TERM_TEXT_X) / 8)
+#define TERM_SCROLLBACK 512
+#define TERM_PROMPT_Y (TERM_H - 14)
+#define TERM_ROWS ((TERM_PROMPT_Y - TERM_TEXT_Y - 2) / TERM_LINE_H)    /* <= 64 */
+#define TERM_TAB 8
+#define TERM_FG 0xFF33FF88u
+#define TERM_CMD_FG 0xFFFFFFFFu
+#define TERM_BG 0xFF000000u
 
+/* One row of character cells; NUL-terminated so it can be drawn directly. */
+typedef struct term_line {
+    char cells[TERM_COLS + 1];
+    int len;
+    int dirty;
+} term_line_t;
+
+/*
+ * Screen model: a ring of the last TERM_SCROLLBACK lines, addressed by an
+ * absolute line number, plus a copy of what each screen row currently shows.
+ * Redraws shift the existing pixels when the view scrolls and then repaint
+ * only the cells that differ from that copy.
+ */
 typedef struct terminal_state {
     ui_window_t win;
     int running;
-    char out[TERM_OUT_CAP];
-    int out_len;
+    term_line_t lines[TERM_SCROLLBACK];
+    uint64_t total;             /* lines ever started; newest is total - 1 */
+    int view;                   /* lines scrolled back from the bottom */
+    char shown[TERM_ROWS][TERM_COLS + 1];
+    uint64_t shown_top;         /* absolute line at screen row 0 when drawn */
+    uint64_t row_dirty;         /* screen rows that must be compared */
+    int full_redraw;
+    char shown_prompt[TERM_COLS + 1];
     char cmd[TERM_CMD_CAP];
     int cmd_len;
     char history[TERM_HISTORY_MAX][TERM_CMD_CAP];
@@ -24,21 +53,57 @@ typedef struct terminal_state {
     int history_pos;
 } terminal_state_t;
 
+static uint64_t term_oldest(const terminal_state_t *st)
+{
+    return (st->total > TERM_SCROLLBACK) ? st->total - TERM_SCROLLBACK : 0;
+}
+
+static term_line_t *term_line(terminal_state_t *st, uint64_t abs)
+{
+    return &st->lines[abs % TERM_SCROLLBACK];
+}
+
+static void term_new_line(terminal_state_t *st)
+{
+    term_line_t *ln = term_line(st, st->total++);
+    ln->len = 0;
+    ln->cells[0] = '\0';
+    ln->dirty = 1;
+}
+
+static void term_put_char(terminal_state_t *st, char c)
+{
+    term_line_t *ln;
+
+    if (c == '\n') {
+        term_new_line(st);
+        return;
+    }
+    if (c == '\t') {
+        do {
+            term_put_char(st, ' ');
+        } while (term_line(st, st->total - 1)->len % TERM_TAB != 0);
+        return;
+    }
+    if (c < ' ' || c > '~')
+        return;
+
+    ln = term_line(st, st->total - 1);
+    if (ln->len >= TERM_COLS) {
+        term_new_line(st);
+        ln = term_line(st, st->total - 1);
+    }
+    ln->cells[ln->len++] = c;
+    ln->cells[ln->len] = '\0';
+    ln->dirty = 1;
+}
+
 static void term_append_raw(terminal_state_t *st, const char *s)
 {
     if (!st || !s)
         return;
-    while (*s) {
-        if (st->out_len + 1 >= TERM_OUT_CAP) {
-            memmove(st->out, st->out + TERM_OUT_CAP / 3, TERM_OUT_CAP - TERM_OUT_CAP / 3);
-            st->out_len = TERM_OUT_CAP - TERM_OUT_CAP / 3 - 1;
-            if (st->out_len < 0)
-                st->out_len = 0;
-            st->out[st->out_len] = '\0';
-        }
-        st->out[st->out_len++] = *s++;
-    }
-    st->out[st->out_len] = '\0';
+    while (*s)
+        term_put_char(st, *s++);
 }
 
 static void term_append_line(terminal_state_t *st, const char *s)
@@ -47,57 +112,141 @@ static void term_append_line(terminal_state_t *st, const char *s)
     term_append_raw(st, "\n");
 }
 
-static void term_draw(terminal_state_t *st)
+static uint64_t term_top_line(const terminal_state_t *st)
 {
-    int x = 8;
-    int y = 8;
-    int max_y = TERM_H - 16;
-    int line_count = 1;
-    int skip = 0;
-    int seen = 0;
-
-    ui_draw_rect(st->win, 0, 0, TERM_W, TERM_H, 0xFF000000u);
-
-    for (int i = 0; i < st->out_len; i++) {
-        if (st->out[i] == '\n')
-            line_count++;
-    }
-    skip = line_count - ((max_y - y) / TERM_LINE_H);
-    if (skip < 0)
-        skip = 0;
-
-    x = 8;
-    y = 8;
-    for (int i = 0; i < st->out_len; i++) {
-        char c = st->out[i];
-        if (seen < skip) {
-            if (c == '\n')
-                seen++;
-            continue;
+    uint64_t oldest = term_oldest(st);
+    uint64_t top = oldest;
+    if (st->total >= (uint64_t)TERM_ROWS + (uint64_t)st->view)
+        top = st->total - TERM_ROWS - (uint64_t)st->view;
+    return (top < oldest) ? oldest : top;
+}
+
+/*
+ * Bring one text row from `shown` to `cells`: clear and redraw only the
+ * span between the first and last differing cells.
+ */
+static void term_update_cells(terminal_state_t *st, int y, char *shown,
+                              const char *cells, uint32_t color)
+{
+    int new_len = (int)strlen(cells);
+    int old_len = (int)strlen(shown);
+    int n = (new_len > old_len) ? new_len : old_len;
+    int first = -1;
+    int last = -1;
+    char span[TERM_CMD_CAP];
+
+    for (int i = 0; i < n; i++) {
+        char a = (i < new_len) ? cells[i] : ' ';
+        char b = (i < old_len) ? shown[i] : ' ';
+        if (a != b) {
+            if (first < 0)
+                first = i;
+            last = i + 1;
         }
-        if (c == '\n') {
-            x = 8;
-            y += TERM_LINE_H;
-            if (y + 8 > max_y)
-                break;
-            continue;
+    }
+    if (first < 0)
+        return;
+
+    ui_draw_rect(st->win, TERM_TEXT_X + first * 8, y, (last - first) * 8, 8, TERM_BG);
+    if (first < new_len) {
+        int len = ((last < new_len) ? last : new_len) - first;
+        memcpy(span, cells + first, (size_t)len);
+        span[len] = '\0';
+        ui_draw_string(st->win, TERM_TEXT_X + first * 8, y, span, color);
+    }
+    memcpy(shown, cells, (size_t)new_len + 1);
+}
+
+/* Shift what is on screen so it matches a new top line. */
+static void term_scroll_to(terminal_state_t *st, uint64_t top)
+{
+    int64_t delta = (int64_t)(top - st->shown_top);
+    int shift = (delta < 0) ? (int)-delta : (int)delta;
+
+    if (delta == 0)
+        return;
+    st->shown_top = top;
+
+    if (shift >= TERM_ROWS) {
+        ui_draw_rect(st->win, TERM_TEXT_X, TERM_TEXT_Y, TERM_COLS * 8, TERM_ROWS * TERM_LINE_H, TERM_BG);
+        memset(st->shown, 0, sizeof(st->shown));
+        st->row_dirty = ~0ULL;
+        return;
+    }
+
+    ui_scroll_rect(st->win, TERM_TEXT_X, TERM_TEXT_Y, TERM_COLS * 8, TERM_ROWS * TERM_LINE_H,
+                   (int)(-delta * TERM_LINE_H));
+    if (delta > 0) {
+        memmove(st->shown[0], st->shown[shift], (size_t)(TERM_ROWS - shift) * sizeof(st->shown[0]));
+        for (int r = TERM_ROWS - shift; r < TERM_ROWS; r++) {
+            st->shown[r][0] = '\0';
+            st->row_dirty |= 1ULL << r;
         }
-        char tmp[2];
-        tmp[0] = c;
-        tmp[1] = '\0';
-        ui_draw_string(st->win, x, y, tmp, 0xFF33FF88u);
-        x += 8;
-        if (x + 8 > TERM_W - 8) {
-            x = 8;
-            y += TERM_LINE_H;
-            if (y + 8 > max_y)
-                break;
+        ui_draw_rect(st->win, TERM_TEXT_X, TERM_TEXT_Y + (TERM_ROWS - shift) * TERM_LINE_H,
+                     TERM_COLS * 8, shift * TERM_LINE_H, TERM_BG);
+    } else {
+        memmove(st->shown[shift], st->shown[0], (size_t)(TERM_ROWS - shift) * sizeof(st->shown[0]));
+        for (int r = 0; r < shift; r++) {
+            st->shown[r][0] = '\0';
+            st->row_dirty |= 1ULL << r;
         }
+        ui_draw_rect(st->win, TERM_TEXT_X, TERM_TEXT_Y, TERM_COLS * 8, shift * TERM_LINE_H, TERM_BG);
+    }
+}
+
+static void term_draw(terminal_state_t *st)
+{
+    uint64_t top = term_top_line(st);
+    char prompt[TERM_COLS + 1];
+
+    ui_batch_begin();
+    if (st->full_redraw) {
+        ui_draw_rect(st->win, 0, 0, TERM_W, TERM_H, TERM_BG);
+        memset(st->shown, 0, sizeof(st->shown));
+        st->shown_prompt[0] = '\0';
+        st->shown_top = top;
+        st->row_dirty = ~0ULL;
+        st->full_redraw = 0;
+    } else {
+        term_scroll_to(st, top);
+    }
+
+    for (int r = 0; r < TERM_ROWS; r++) {
+        uint64_t abs = top + (uint64_t)r;
+        term_line_t *ln = (abs < st->total) ? term_line(st, abs) : 0;
+        if (!(st->row_dirty & (1ULL << r)) && (!ln || !ln->dirty))
+            continue;
+        term_update_cells(st, TERM_TEXT_Y + r * TERM_LINE_H, st->shown[r],
+                          ln ? ln->cells : "", TERM_FG);
+        if (ln)
+            ln->dirty = 0;
+    }
+    st->row_dirty = 0;
+
+    /* Prompt row: "> " in the terminal colour, the command in white. */
+    prompt[0] = '>';
+    prompt[1] = ' ';
+    strncpy(prompt + 2, st->cmd, TERM_COLS - 2);
+    prompt[TERM_COLS] = '\0';
+    if (strcmp(prompt, st->shown_prompt) != 0) {
+        ui_draw_rect(st->win, TERM_TEXT_X, TERM_PROMPT_Y, TERM_COLS * 8, 8, TERM_BG);
+        ui_draw_string(st->win, TERM_TEXT_X, TERM_PROMPT_Y, "> ", TERM_FG);
+        ui_draw_string(st->win, TERM_TEXT_X + 16, TERM_PROMPT_Y, prompt + 2, TERM_CMD_FG);
+        memcpy(st->shown_prompt, prompt, sizeof(prompt));
     }
+    ui_batch_end();
+}
 
-    ui_draw_string(st->win, 8, TERM_H - 14, "> ", 0xFF33FF88u);
-    ui_draw_string(st->win, 24, TERM_H - 14, st->cmd, 0xFFFFFFFFu);
-    ui_mark_dirty(st->win, 0, 0, TERM_W, TERM_H);
+static void term_page(terminal_state_t *st, int dir)
+{
+    int max_view = (int)(st->total - term_oldest(st)) - TERM_ROWS;
+    if (max_view < 0)
+        max_view = 0;
+    st->view += dir * (TERM_ROWS / 2);
+    if (st->view > max_view)
+        st->view = max_view;
+    if (st->view < 0)
+        st->view = 0;
 }
 
 static void term_capture_shell(terminal_state_t *st, const char *line)
@@ -109,6 +258,12 @@ static void term_capture_shell(terminal_state_t *st, const char *line)
         term_append_line(st, "shell: failed to allocate output pipe");
         return;
     }
+    /*
+     * Output is drained only after the command finishes, so let the pipe
+     * grow to its maximum and drop (rather than block on) anything beyond.
+     */
+    fcntl(pipefd[1], F_SETPIPE_SZ, 1024 * 1024);
+    fcntl(pipefd[1], F_SETFL, O_NONBLOCK);
     shell_exec_line(line, pipefd[1], pipefd[1]);
     close(pipefd[1]);
 
@@ -164,6 +319,7 @@ static void term_history_down(terminal_state_t *st)
 
 static void term_execute(terminal_state_t *st)
 {
+    st->view = 0;
     if (st->cmd_len <= 0) {
         term_append_line(st, "");
         st->cmd[0] = '\0';
@@ -187,66 +343,81 @@ static void term_execute(terminal_state_t *st)
 
 void app_terminal_gui_entry(void)
 {
-    terminal_state_t st;
+    /* Scrollback makes the state too large for a kernel process stack. */
+    terminal_state_t *st = (terminal_state_t *)calloc(1, sizeof(*st));
     ui_event_t ev;
-    memset(&st, 0, sizeof(st));
 
-    st.win = ui_window_create("Terminal", 90, 70, TERM_W, TERM_H);
-    if ((int64_t)st.win <= 0)
+    if (!st)
         _exit(1);
-    st.running = 1;
-    st.history_pos = 0;
+    st->win = ui_window_create("Terminal", 90, 70, TERM_W, TERM_H);
+    if ((int64_t)st->win <= 0)
+        _exit(1);
+    st->running = 1;
+    st->history_pos = 0;
+    st->full_redraw = 1;
+    term_new_line(st);
 
-    term_append_line(&st, "Tsukasa Terminal (userspace)");
-    term_append_line(&st, "Supports history, pipes, redirection, and rc scripts.");
-    term_capture_shell(&st, "help");
-    term_capture_shell(&st, "cat /etc/tsukasa.rc");
+    term_append_line(st, "Tsukasa Terminal (userspace)");
+    term_append_line(st, "Supports history, pipes, redirection, and rc scripts.");
+    term_capture_shell(st, "help");
+    term_capture_shell(st, "cat /etc/tsukasa.rc");
 
-    term_draw(&st);
-    while (st.running) {
-        if (!ui_get_event(st.win, &ev)) {
+    term_draw(st);
+    while (st->running) {
+        if (!ui_get_event(st->win, &ev)) {
             yield();
             continue;
         }
         if (ev.type == UI_EVENT_CLOSE) {
-            st.running = 0;
+            st->running = 0;
             break;
         }
         if (ev.type == UI_EVENT_PAINT || ev.type == UI_EVENT_RESIZE) {
-            term_draw(&st);
+            term_draw(st);
             continue;
         }
         if (ev.type != UI_EVENT_KEY)
             continue;
 
         if ((uint32_t)ev.keycode == 0x48u || (uint32_t)ev.keycode == 0xE048u) {
-            term_history_up(&st);
-            term_draw(&st);
+            term_history_up(st);
+            term_draw(st);
             continue;
         }
         if ((uint32_t)ev.keycode == 0x50u || (uint32_t)ev.keycode == 0xE050u) {
-            term_history_down(&st);
-            term_draw(&st);
+            term_history_down(st);
+            term_draw(st);
+            continue;
+        }
+
+        if ((uint32_t)ev.keycode == 0x49u || (uint32_t)ev.keycode == 0xE049u) {
+            term_page(st, 1);
+            term_draw(st);
+            continue;
+        }
+        if ((uint32_t)ev.keycode == 0x51u || (uint32_t)ev.keycode == 0xE051u) {
+            term_page(st, -1);
+            term_draw(st);
             continue;
         }
 
         {
             char c = (char)(ev.keycode & 0xFF);
             if (c == '\b') {
-                if (st.cmd_len > 0)
-                    st.cmd[--st.cmd_len] = '\0';
+                if (st->cmd_len > 0)
+                    st->cmd[--st->cmd_len] = '\0';
             } else if (c == '\r' || c == '\n') {
-                term_execute(&st);
+                term_execute(st);
             } else if (c >= ' ' && c <= '~') {
-                if (st.cmd_len + 1 < TERM_CMD_CAP) {
-                    st.cmd[st.cmd_len++] = c;
-                    st.cmd[st.cmd_len] = '\0';
+                if (st->cmd_len + 1 < TERM_CMD_CAP) {
+                    st->cmd[st->cmd_len++] = c;
+                    st->cmd[st->cmd_len] = '\0';
                 }
             }
         }
-        term_draw(&st);
+        term_draw(st);
     }
 
-    ui_window_destroy(st.win);
+    ui_window_destroy(st->win);
     _exit(0);
 }
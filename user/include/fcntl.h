@@ -13,6 +13,8 @@
 
 #define F_GETFL 1
 #define F_SETFL 2
+#define F_SETPIPE_SZ 3
+#define F_GETPIPE_SZ 4
 
 int open(const char *pathname, int flags, ...);
 int fcntl(int fd, int cmd, ...);
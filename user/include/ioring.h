@@ -0,0 +1,78 @@
+/*
+ * ioring.h - Batched syscall submission ring (SYSTEM_CMD_IORING_*).
+ *
+ * Queue SYS_GUI / SYS_FS / SYS_SYSTEM commands with ioring_get_sqe() and
+ * an ioring_prep_*() helper, run them all with one ioring_submit(), then
+ * collect results with ioring_peek_cqe(), which does not enter the kernel.
+ * Buffers referenced by queued SQEs must stay valid until they are
+ * submitted.
+ */
+
+#ifndef USER_IORING_H
+#define USER_IORING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "syscall_nums.h"
+#include "../lib/syscall.h"
+
+typedef struct ioring {
+    int id;
+    struct tsukasa_ioring *hdr;
+    struct tsukasa_ioring_sqe *sqes;
+    struct tsukasa_ioring_cqe *cqes;
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+    uint32_t sq_tail;               /* queued locally, published on submit */
+} ioring_t;
+
+/* Map a ring with at least `entries` SQEs; 0 on success, -1 on error. */
+int ioring_init(ioring_t *r, unsigned int entries);
+void ioring_exit(ioring_t *r);
+
+/* Next free SQE (zeroed), or NULL when the SQ is full: submit first. */
+struct tsukasa_ioring_sqe *ioring_get_sqe(ioring_t *r);
+
+/* SQEs queued but not yet consumed by the kernel. */
+unsigned int ioring_sq_pending(const ioring_t *r);
+
+/* Run everything queued; returns SQEs consumed (fewer if the CQ filled) or -1. */
+int ioring_submit(ioring_t *r);
+
+/* Forget SQEs the kernel has not consumed (after a failed submit); returns how many. */
+unsigned int ioring_sq_discard(ioring_t *r);
+
+/* Pop one completion into *out; 0 on success, -1 if the CQ is empty. */
+int ioring_peek_cqe(ioring_t *r, struct tsukasa_ioring_cqe *out);
+
+static inline void ioring_prep(struct tsukasa_ioring_sqe *sqe, int nr, int cmd,
+                               uint64_t a, uint64_t b, uint64_t c, uint64_t d)
+{
+    sqe->nr = (uint8_t)nr;
+    sqe->cmd = (uint16_t)cmd;
+    sqe->args[0] = a;
+    sqe->args[1] = b;
+    sqe->args[2] = c;
+    sqe->args[3] = d;
+}
+
+static inline void ioring_prep_read(struct tsukasa_ioring_sqe *sqe, int fd, void *buf, size_t len)
+{
+    ioring_prep(sqe, SYS_FS, FS_CMD_READ, (uint64_t)fd, (uint64_t)(uintptr_t)buf, len, 0);
+}
+
+static inline void ioring_prep_write(struct tsukasa_ioring_sqe *sqe, int fd,
+                                     const void *buf, size_t len)
+{
+    ioring_prep(sqe, SYS_FS, FS_CMD_WRITE, (uint64_t)fd, (uint64_t)(uintptr_t)buf, len, 0);
+}
+
+static inline void ioring_prep_poll(struct tsukasa_ioring_sqe *sqe,
+                                    struct tsukasa_pollfd *fds, size_t nfds, int timeout)
+{
+    ioring_prep(sqe, SYS_FS, FS_CMD_POLL, (uint64_t)(uintptr_t)fds, nfds,
+                (uint64_t)(int64_t)timeout, 0);
+}
+
+#endif /* USER_IORING_H */
@@ -55,11 +55,24 @@ void ui_draw_rounded_rect_filled(ui_window_t win, int x, int y, int w, int h, in
 void ui_draw_string(ui_window_t win, int x, int y, const char *str, uint32_t color);
 void ui_draw_image(ui_window_t win, int x, int y, int w, int h, const uint32_t *image_data);
 void ui_mark_dirty(ui_window_t win, int x, int y, int w, int h);
+/* Shift a rect's pixels by dy rows (negative = up); redraw the exposed strip. */
+void ui_scroll_rect(ui_window_t win, int x, int y, int w, int h, int dy);
 int ui_draw_rect_ex(ui_window_t win, int x, int y, int w, int h, uint32_t color);
 int ui_draw_rounded_rect_filled_ex(ui_window_t win, int x, int y, int w, int h, int radius, uint32_t color);
 int ui_draw_string_ex(ui_window_t win, int x, int y, const char *str, uint32_t color);
 int ui_draw_image_ex(ui_window_t win, int x, int y, int w, int h, const uint32_t *image_data);
 int ui_mark_dirty_ex(ui_window_t win, int x, int y, int w, int h);
+int ui_scroll_rect_ex(ui_window_t win, int x, int y, int w, int h, int dy);
+
+/*
+ * Batch a frame: until the matching ui_batch_end() the void draw calls
+ * above are queued and handed to the kernel together, and each window's
+ * damage is posted to the compositor once.  Calls returning a result, and
+ * ui_draw_image(), flush the queue first.  Nests; returns -1 (and draws
+ * unbatched) if no submission ring is available.
+ */
+int ui_batch_begin(void);
+void ui_batch_end(void);
 
 uint32_t ui_get_string_width(const char *str);
 uint32_t ui_get_font_height(void);
@@ -6,6 +6,45 @@
 
 #define EOF (-1)
 
+#define BUFSIZ 1024
+
+/* setvbuf modes. */
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
+/*
+ * Output streams.  stdout is line-buffered when attached to a character
+ * device (TTY) and fully buffered otherwise; stderr is unbuffered.  All
+ * streams are flushed by exit() and when an app's main returns.
+ */
+typedef struct tsukasa_file {
+    int fd;
+    int mode;           /* _IOFBF/_IOLBF/_IONBF, -1 until first use */
+    int error;
+    char *buf;
+    size_t cap;
+    size_t len;
+} FILE;
+
+FILE *__stdio_stream(int fd);
+void __stdio_exit(void);
+
+#define stdout (__stdio_stream(1))
+#define stderr (__stdio_stream(2))
+
+int fputc(int c, FILE *stream);
+int putc(int c, FILE *stream);
+int fputs(const char *s, FILE *stream);
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream);
+int fflush(FILE *stream);
+int setvbuf(FILE *stream, char *buf, int mode, size_t size);
+int fileno(FILE *stream);
+int ferror(FILE *stream);
+
+int fprintf(FILE *stream, const char *fmt, ...);
+int vfprintf(FILE *stream, const char *fmt, va_list ap);
+
 int putchar(int c);
 int puts(const char *s);
 
@@ -8,6 +8,11 @@ int abs(int x);
 long strtol(const char *nptr, char **endptr, int base);
 int atoi(const char *nptr);
 
+void *malloc(size_t size);
+void free(void *ptr);
+void *calloc(size_t nmemb, size_t size);
+void *realloc(void *ptr, size_t size);
+
 void srand(unsigned int seed);
 int rand(void);
 
@@ -9,6 +9,8 @@
 
 #define MAP_SHARED  TSUKASA_MAP_SHARED
 #define MAP_PRIVATE TSUKASA_MAP_PRIVATE
+#define MAP_ANONYMOUS TSUKASA_MAP_ANONYMOUS
+#define MAP_ANON    MAP_ANONYMOUS
 #define MAP_FAILED  ((void *)-1)
 
 void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
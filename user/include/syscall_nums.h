@@ -38,6 +38,7 @@
 #define FS_CMD_MMAP        19
 #define FS_CMD_MUNMAP      20
 #define FS_CMD_POLL        21
+#define FS_CMD_SPLICE      22
 
 #define TSUKASA_O_RDONLY   0x0001
 #define TSUKASA_O_WRONLY   0x0002
@@ -52,9 +53,12 @@
 #define TSUKASA_STAT_TYPE_PIPE 3
 #define TSUKASA_STAT_TYPE_CHAR 4
 #define TSUKASA_STAT_TYPE_BLOCK 5
+#define TSUKASA_STAT_TYPE_SOCKET 6
 
 #define TSUKASA_F_GETFL    1
 #define TSUKASA_F_SETFL    2
+#define TSUKASA_F_SETPIPE_SZ 3
+#define TSUKASA_F_GETPIPE_SZ 4
 
 #define TSUKASA_POLLIN     0x0001
 #define TSUKASA_POLLOUT    0x0004
@@ -65,6 +69,7 @@
 #define TSUKASA_PROT_WRITE 0x2
 #define TSUKASA_MAP_SHARED 0x01
 #define TSUKASA_MAP_PRIVATE 0x02
+#define TSUKASA_MAP_ANONYMOUS 0x20
 
 #define TSUKASA_FBIOGET_VSCREENINFO 0x4600
 #define TSUKASA_FBIOGET_FSCREENINFO 0x4602
@@ -93,6 +98,7 @@
 #define GUI_CMD_SET_FONT                 16
 #define GUI_CMD_WINDOW_DESTROY           17
 #define GUI_CMD_DRAW_STRING_SCALED_SLOPED 18
+#define GUI_CMD_SCROLL_RECT              19
 #define GUI_CMD_GET_SCREEN_SIZE          50
 
 #define GUI_OK             0
@@ -156,6 +162,44 @@
 #define SYSTEM_CMD_GET_CMDLINE     37
 #define SYSTEM_CMD_SPAWN_EX        38
 #define SYSTEM_CMD_TIME_GET        39
+#define SYSTEM_CMD_MEM_MAP_ANON    40
+#define SYSTEM_CMD_MEM_UNMAP_ANON  41
+#define SYSTEM_CMD_TRACE_CTL       42
+#define SYSTEM_CMD_PROFILE_CTL     43  /* arg2 = Hz, 0 stops; returns Hz achieved */
+#define SYSTEM_CMD_BENCH_RUN       44  /* arg2 = filter, arg3/4 = CSV buf/cap, arg5 = flags */
+#define SYSTEM_CMD_IORING_SETUP    45  /* arg2 = entries, arg3 = struct tsukasa_ioring_params * */
+#define SYSTEM_CMD_IORING_ENTER    46  /* arg2 = ring id, arg3 = max SQEs; returns SQEs consumed */
+#define SYSTEM_CMD_IORING_DESTROY  47  /* arg2 = ring id */
+#define SYSTEM_CMD_NET_SOCKET      48  /* arg2 = TSUKASA_SOCK_*, arg3 = TSUKASA_SOCK_NONBLOCK; returns fd */
+#define SYSTEM_CMD_NET_BIND        49  /* arg2 = fd, arg3 = const struct tsukasa_sockaddr * */
+#define SYSTEM_CMD_NET_LISTEN      50  /* arg2 = fd, arg3 = backlog */
+#define SYSTEM_CMD_NET_ACCEPT      51  /* arg2 = fd, arg3 = struct tsukasa_sockaddr * or 0; returns fd */
+#define SYSTEM_CMD_NET_CONNECT     52  /* arg2 = fd, arg3 = const struct tsukasa_sockaddr * */
+#define SYSTEM_CMD_NET_SENDTO      53  /* arg2 = fd, arg3 = struct tsukasa_net_msg *; returns bytes */
+#define SYSTEM_CMD_NET_RECVFROM    54  /* arg2 = fd, arg3 = struct tsukasa_net_msg *; returns bytes */
+#define SYSTEM_CMD_CLOCK_US        55  /* returns microseconds since boot (monotonic) */
+#define SYSTEM_CMD_NET_DNS_START   56  /* arg2 = name, arg3 = TSUKASA_DNS_NONBLOCK; returns fd */
+
+/* SYSTEM_CMD_TRACE_CTL flags (arg3); arg2 is the event mask. */
+#define TRACE_CTL_SET_MASK  0x1u
+#define TRACE_CTL_RESET     0x2u
+
+/* SYSTEM_CMD_BENCH_RUN flags (arg5). */
+#define BENCH_RUN_LIST      0x1u
+
+#define TSUKASA_IORING_MAX_ENTRIES  256
+#define TSUKASA_IORING_SQE_NO_CQE   0x1u    /* post no completion */
+
+/* SYSTEM_CMD_NET_SOCKET types (arg2) and flags (arg3). */
+#define TSUKASA_SOCK_STREAM    1
+#define TSUKASA_SOCK_DGRAM     2
+#define TSUKASA_SOCK_NONBLOCK  0x1u
+
+/* SYSTEM_CMD_NET_DNS_START flags (arg3) and result status. */
+#define TSUKASA_DNS_NONBLOCK   0x1u
+#define TSUKASA_DNS_OK         0
+#define TSUKASA_DNS_NOTFOUND   1    /* NXDOMAIN or no A record */
+#define TSUKASA_DNS_FAILED     2    /* timeout, server error, no network */
 
 #define SYSTEM_CMD_THEME_SET_ACCENT    100
 #define SYSTEM_CMD_THEME_SET_BG_MODE   101
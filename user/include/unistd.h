@@ -20,6 +20,8 @@ off_t lseek(int fd, off_t offset, int whence);
 int dup(int oldfd);
 int dup2(int oldfd, int newfd);
 int pipe(int pipefd[2]);
+/* Kernel-side copy into the pipe fd_out (fd_in: pipe or file); -1 if unsupported. */
+ssize_t splice(int fd_in, int fd_out, size_t len);
 
 int chdir(const char *path);
 char *getcwd(char *buf, size_t size);
@@ -1,6 +1,7 @@
 #include "../include/app_runtime.h"
 
 #include "../lib/syscall.h"
+#include "../include/stdio.h"
 #include "../include/string.h"
 
 static char *trim_ws(char *s)
@@ -61,9 +62,12 @@ int app_run_main(int (*main_fn)(int argc, char **argv))
     char cmdline[256];
     char *argv[32];
     int argc = 0;
+    int rc;
     if (!main_fn)
         return -1;
     if (app_get_cmdline(cmdline, sizeof(cmdline)) == 0)
         argc = app_tokenize(cmdline, argv, 32);
-    return main_fn(argc, argv);
+    rc = main_fn(argc, argv);
+    (void)fflush(0);
+    return rc;
 }
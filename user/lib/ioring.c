@@ -0,0 +1,81 @@
+#include "../include/ioring.h"
+#include "../include/string.h"
+
+int ioring_init(ioring_t *r, unsigned int entries)
+{
+    struct tsukasa_ioring_params p;
+
+    if (!r)
+        return -1;
+    memset(r, 0, sizeof(*r));
+    if (system_ioring_setup(entries, &p) <= 0 || !p.ring)
+        return -1;
+    r->id = p.id;
+    r->hdr = p.ring;
+    r->sqes = (struct tsukasa_ioring_sqe *)((uint8_t *)p.ring + p.ring->sq_off);
+    r->cqes = (struct tsukasa_ioring_cqe *)((uint8_t *)p.ring + p.ring->cq_off);
+    r->sq_mask = p.sq_entries - 1u;
+    r->cq_mask = p.cq_entries - 1u;
+    r->sq_tail = 0;
+    return 0;
+}
+
+void ioring_exit(ioring_t *r)
+{
+    if (!r || !r->hdr)
+        return;
+    system_ioring_destroy(r->id);
+    memset(r, 0, sizeof(*r));
+}
+
+struct tsukasa_ioring_sqe *ioring_get_sqe(ioring_t *r)
+{
+    struct tsukasa_ioring_sqe *sqe;
+    uint32_t head = __atomic_load_n(&r->hdr->sq_head, __ATOMIC_ACQUIRE);
+
+    if (r->sq_tail - head > r->sq_mask)
+        return NULL;
+    sqe = &r->sqes[r->sq_tail & r->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_tail++;
+    return sqe;
+}
+
+unsigned int ioring_sq_pending(const ioring_t *r)
+{
+    return r->sq_tail - __atomic_load_n(&r->hdr->sq_head, __ATOMIC_ACQUIRE);
+}
+
+int ioring_submit(ioring_t *r)
+{
+    unsigned int pending;
+
+    __atomic_store_n(&r->hdr->sq_tail, r->sq_tail, __ATOMIC_RELEASE);
+    pending = ioring_sq_pending(r);
+    if (pending == 0)
+        return 0;
+    return system_ioring_enter(r->id, pending);
+}
+
+unsigned int ioring_sq_discard(ioring_t *r)
+{
+    uint32_t head = __atomic_load_n(&r->hdr->sq_head, __ATOMIC_ACQUIRE);
+    unsigned int dropped = r->sq_tail - head;
+
+    /* The kernel only reads the SQ inside ioring_enter, so this cannot race it. */
+    r->sq_tail = head;
+    __atomic_store_n(&r->hdr->sq_tail, head, __ATOMIC_RELEASE);
+    return dropped;
+}
+
+int ioring_peek_cqe(ioring_t *r, struct tsukasa_ioring_cqe *out)
+{
+    uint32_t head = r->hdr->cq_head;
+    uint32_t tail = __atomic_load_n(&r->hdr->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+        return -1;
+    *out = r->cqes[head & r->cq_mask];
+    __atomic_store_n(&r->hdr->cq_head, head + 1u, __ATOMIC_RELEASE);
+    return 0;
+}
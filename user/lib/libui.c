@@ -1,5 +1,9 @@
 #include "../include/libui.h"
+#include "../include/ioring.h"
+#include "../include/stdlib.h"
+#include "../include/string.h"
 #include "../include/syscall_nums.h"
+#include "proc_local.h"
 
 #ifdef TSUKASA_USERLIB_KERNEL
 extern uintptr_t syscall_handler(uintptr_t num,
@@ -36,10 +40,165 @@ static uint64_t pack_i32(int a, int b)
     return ((uint64_t)(uint32_t)b << 32) | (uint64_t)(uint32_t)a;
 }
 
+/*
+ * Frame batching.  Between ui_batch_begin() and ui_batch_end() the void
+ * draw calls become SQEs on a per-process submission ring and run in one
+ * SYSTEM_CMD_IORING_ENTER; strings are copied into a side buffer so callers
+ * may reuse theirs.  Any call that needs a result flushes the batch first,
+ * so the kernel always sees the calls in program order.
+ */
+#define UI_BATCH_ENTRIES 128
+#define UI_BATCH_TEXT    4096
+
+typedef struct ui_batch {
+    uint32_t gen;
+    int depth;                      /* nested ui_batch_begin() calls */
+    int unavailable;                /* ring setup failed; draw directly */
+    ioring_t ring;
+    char *text;
+    size_t text_used;
+} ui_batch_t;
+
+static ui_batch_t g_ui_batches[PROC_LOCAL_SLOTS];
+static volatile int g_ui_batching;  /* processes inside a batch */
+
+static ui_batch_t *ui_batch_current(int create)
+{
+    uint32_t gen = 0;
+    int idx = proc_local_slot(create, &gen);
+    ui_batch_t *b;
+
+    if (idx < 0)
+        return 0;
+    b = &g_ui_batches[idx];
+    if (b->gen != gen) {
+        /*
+         * Fresh owner.  The previous one's ring was torn down by
+         * ioring_process_cleanup() when it exited; only this state is stale.
+         */
+        memset(b, 0, sizeof(*b));
+        b->gen = gen;
+    }
+    return b;
+}
+
+/*
+ * Submit everything queued.  The side buffer is reused only once no SQE
+ * points into it; if the kernel stops taking SQEs, the stuck ones are
+ * dropped and the rest of the batch is drawn directly.
+ */
+static void ui_batch_flush(ui_batch_t *b)
+{
+    while (ioring_sq_pending(&b->ring) > 0) {
+        if (ioring_submit(&b->ring) <= 0) {
+            ioring_sq_discard(&b->ring);
+            b->unavailable = 1;
+            break;
+        }
+    }
+    if (ioring_sq_pending(&b->ring) == 0)
+        b->text_used = 0;
+}
+
+/* Flush the caller's batch, if it has one, before a direct call. */
+static void ui_batch_sync(void)
+{
+    ui_batch_t *b;
+
+    if (!g_ui_batching)
+        return;
+    b = ui_batch_current(0);
+    if (b && b->depth > 0 && !b->unavailable)
+        ui_batch_flush(b);
+}
+
+static ui_batch_t *ui_batch_active(void)
+{
+    ui_batch_t *b;
+
+    if (!g_ui_batching)
+        return 0;
+    b = ui_batch_current(0);
+    return (b && b->depth > 0 && !b->unavailable) ? b : 0;
+}
+
+static int ui_batch_queue(ui_batch_t *b, int cmd, uint64_t a, uint64_t c, uint64_t d, uint64_t e)
+{
+    struct tsukasa_ioring_sqe *sqe = ioring_get_sqe(&b->ring);
+
+    if (!sqe) {
+        ui_batch_flush(b);
+        if (b->unavailable)
+            return -1;
+        sqe = ioring_get_sqe(&b->ring);
+        if (!sqe)
+            return -1;
+    }
+    ioring_prep(sqe, SYS_GUI, cmd, a, c, d, e);
+    sqe->flags = TSUKASA_IORING_SQE_NO_CQE;
+    return 0;
+}
+
+/* Copy a string into the batch's side buffer; NULL if it cannot fit. */
+static const char *ui_batch_text(ui_batch_t *b, const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *dst;
+
+    if (len > UI_BATCH_TEXT)
+        return 0;
+    if (b->text_used + len > UI_BATCH_TEXT) {
+        ui_batch_flush(b);
+        if (b->unavailable || b->text_used + len > UI_BATCH_TEXT)
+            return 0;
+    }
+    dst = b->text + b->text_used;
+    memcpy(dst, str, len);
+    b->text_used += len;
+    return dst;
+}
+
+static long gui_call(long cmd, long a1, long a2, long a3, long a4)
+{
+    ui_batch_sync();
+    return syscall5(SYS_GUI, cmd, a1, a2, a3, a4);
+}
+
+int ui_batch_begin(void)
+{
+    ui_batch_t *b = ui_batch_current(1);
+
+    if (!b)
+        return -1;
+    if (b->depth == 0 && !b->unavailable && !b->ring.hdr) {
+        b->text = (char *)malloc(UI_BATCH_TEXT);
+        if (!b->text || ioring_init(&b->ring, UI_BATCH_ENTRIES) != 0) {
+            free(b->text);
+            b->text = 0;
+            b->unavailable = 1;
+        }
+    }
+    if (b->depth++ == 0)
+        __atomic_add_fetch(&g_ui_batching, 1, __ATOMIC_RELAXED);
+    return b->unavailable ? -1 : 0;
+}
+
+void ui_batch_end(void)
+{
+    ui_batch_t *b = ui_batch_current(0);
+
+    if (!b || b->depth == 0)
+        return;
+    if (--b->depth > 0)
+        return;
+    if (!b->unavailable)
+        ui_batch_flush(b);
+    __atomic_sub_fetch(&g_ui_batching, 1, __ATOMIC_RELAXED);
+}
+
 ui_window_t ui_window_create(const char *title, int x, int y, int w, int h)
 {
-    return (ui_window_t)syscall5(
-        SYS_GUI,
+    return (ui_window_t)gui_call(
         GUI_CMD_WINDOW_CREATE,
         (long)title,
         (long)pack_i32(x, y),
@@ -50,33 +209,32 @@ ui_window_t ui_window_create(const char *title, int x, int y, int w, int h)
 
 int ui_window_destroy(ui_window_t win)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_WINDOW_DESTROY, (long)win, 0, 0, 0);
+    return (int)gui_call(GUI_CMD_WINDOW_DESTROY, (long)win, 0, 0, 0);
 }
 
 int ui_window_set_title_ex(ui_window_t win, const char *title)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_WINDOW_SET_TITLE, (long)win, (long)title, 0, 0);
+    return (int)gui_call(GUI_CMD_WINDOW_SET_TITLE, (long)win, (long)title, 0, 0);
 }
 
 int ui_window_set_resizable_ex(ui_window_t win, bool resizable)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_WINDOW_SET_RESIZABLE, (long)win, (long)resizable, 0, 0);
+    return (int)gui_call(GUI_CMD_WINDOW_SET_RESIZABLE, (long)win, (long)resizable, 0, 0);
 }
 
 int ui_get_screen_size_ex(uint64_t *out_w, uint64_t *out_h)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_GET_SCREEN_SIZE, (long)out_w, (long)out_h, 0, 0);
+    return (int)gui_call(GUI_CMD_GET_SCREEN_SIZE, (long)out_w, (long)out_h, 0, 0);
 }
 
 int ui_draw_rect_ex(ui_window_t win, int x, int y, int w, int h, uint32_t color)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_DRAW_RECT, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), (long)color);
+    return (int)gui_call(GUI_CMD_DRAW_RECT, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), (long)color);
 }
 
 int ui_draw_rounded_rect_filled_ex(ui_window_t win, int x, int y, int w, int h, int radius, uint32_t color)
 {
-    return (int)syscall5(
-        SYS_GUI,
+    return (int)gui_call(
         GUI_CMD_DRAW_ROUNDED_RECT_FILLED,
         (long)win,
         (long)pack_i32(x, y),
@@ -87,27 +245,32 @@ int ui_draw_rounded_rect_filled_ex(ui_window_t win, int x, int y, int w, int h,
 
 int ui_draw_string_ex(ui_window_t win, int x, int y, const char *str, uint32_t color)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_DRAW_STRING, (long)win, (long)pack_i32(x, y), (long)str, (long)color);
+    return (int)gui_call(GUI_CMD_DRAW_STRING, (long)win, (long)pack_i32(x, y), (long)str, (long)color);
 }
 
 int ui_draw_image_ex(ui_window_t win, int x, int y, int w, int h, const uint32_t *image_data)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_DRAW_IMAGE, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), (long)image_data);
+    return (int)gui_call(GUI_CMD_DRAW_IMAGE, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), (long)image_data);
 }
 
 int ui_mark_dirty_ex(ui_window_t win, int x, int y, int w, int h)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_MARK_DIRTY, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), 0);
+    return (int)gui_call(GUI_CMD_MARK_DIRTY, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), 0);
+}
+
+int ui_scroll_rect_ex(ui_window_t win, int x, int y, int w, int h, int dy)
+{
+    return (int)gui_call(GUI_CMD_SCROLL_RECT, (long)win, (long)pack_i32(x, y), (long)pack_i32(w, h), (long)(uint32_t)dy);
 }
 
 uint32_t ui_get_string_width(const char *str)
 {
-    return (uint32_t)syscall5(SYS_GUI, GUI_CMD_GET_STRING_WIDTH, (long)str, 0, 0, 0);
+    return (uint32_t)gui_call(GUI_CMD_GET_STRING_WIDTH, (long)str, 0, 0, 0);
 }
 
 uint32_t ui_get_font_height(void)
 {
-    return (uint32_t)syscall5(SYS_GUI, GUI_CMD_GET_FONT_HEIGHT, 0, 0, 0, 0);
+    return (uint32_t)gui_call(GUI_CMD_GET_FONT_HEIGHT, 0, 0, 0, 0);
 }
 
 bool ui_get_event(ui_window_t win, ui_event_t *ev)
@@ -117,7 +280,7 @@ bool ui_get_event(ui_window_t win, ui_event_t *ev)
 
 int ui_get_event_ex(ui_window_t win, ui_event_t *ev)
 {
-    return (int)syscall5(SYS_GUI, GUI_CMD_GET_EVENT, (long)win, (long)ev, 0, 0);
+    return (int)gui_call(GUI_CMD_GET_EVENT, (long)win, (long)ev, 0, 0);
 }
 
 void ui_window_set_title(ui_window_t win, const char *title)
@@ -137,16 +300,31 @@ void ui_get_screen_size(uint64_t *out_w, uint64_t *out_h)
 
 void ui_draw_rect(ui_window_t win, int x, int y, int w, int h, uint32_t color)
 {
+    ui_batch_t *b = ui_batch_active();
+
+    if (b && ui_batch_queue(b, GUI_CMD_DRAW_RECT, win, pack_i32(x, y), pack_i32(w, h), color) == 0)
+        return;
     (void)ui_draw_rect_ex(win, x, y, w, h, color);
 }
 
 void ui_draw_rounded_rect_filled(ui_window_t win, int x, int y, int w, int h, int radius, uint32_t color)
 {
+    ui_batch_t *b = ui_batch_active();
+
+    if (b && ui_batch_queue(b, GUI_CMD_DRAW_ROUNDED_RECT_FILLED, win, pack_i32(x, y),
+                            pack_i32(w, h), pack_i32(radius, (int)color)) == 0)
+        return;
     (void)ui_draw_rounded_rect_filled_ex(win, x, y, w, h, radius, color);
 }
 
 void ui_draw_string(ui_window_t win, int x, int y, const char *str, uint32_t color)
 {
+    ui_batch_t *b = ui_batch_active();
+    const char *copy;
+
+    if (b && str && (copy = ui_batch_text(b, str)) != 0 &&
+        ui_batch_queue(b, GUI_CMD_DRAW_STRING, win, pack_i32(x, y), (uint64_t)(uintptr_t)copy, color) == 0)
+        return;
     (void)ui_draw_string_ex(win, x, y, str, color);
 }
 
@@ -157,5 +335,19 @@ void ui_draw_image(ui_window_t win, int x, int y, int w, int h, const uint32_t *
 
 void ui_mark_dirty(ui_window_t win, int x, int y, int w, int h)
 {
+    ui_batch_t *b = ui_batch_active();
+
+    if (b && ui_batch_queue(b, GUI_CMD_MARK_DIRTY, win, pack_i32(x, y), pack_i32(w, h), 0) == 0)
+        return;
     (void)ui_mark_dirty_ex(win, x, y, w, h);
 }
+
+void ui_scroll_rect(ui_window_t win, int x, int y, int w, int h, int dy)
+{
+    ui_batch_t *b = ui_batch_active();
+
+    if (b && ui_batch_queue(b, GUI_CMD_SCROLL_RECT, win, pack_i32(x, y), pack_i32(w, h),
+                            (uint32_t)dy) == 0)
+        return;
+    (void)ui_scroll_rect_ex(win, x, y, w, h, dy);
+}
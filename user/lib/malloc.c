@@ -0,0 +1,250 @@
+/*
+ * malloc.c - User heap: size-class bins over anonymous-memory arenas.
+ *
+ * Small requests (<= MALLOC_SMALL_MAX) are rounded up to one of a handful of
+ * size classes.  Each process keeps a singly linked free list per class and
+ * a bump region carved from 64 KiB arena chunks obtained with
+ * mmap(MAP_ANONYMOUS); a malloc/free pair is a list push/pop with no
+ * syscall and no lock, since a process only ever touches its own slot.
+ * Larger requests get a dedicated mapping that free() returns to the kernel.
+ * Arena chunks are released by the kernel when the process exits.  free()
+ * of a pointer this heap did not hand out, or of a small block owned by
+ * another process's slot, is reported on stderr and the block is left alone.
+ */
+
+#include "../include/stdlib.h"
+
+#include "../include/string.h"
+#include "../include/sys/mman.h"
+#include "../include/unistd.h"
+#include "proc_local.h"
+
+#include <stdint.h>
+
+#define MALLOC_ALIGN        16u
+#define MALLOC_CHUNK_SIZE   (64u * 1024u)
+#define MALLOC_SMALL_MAX    2048u
+#define MALLOC_PAGE_SIZE    4096u
+#define MALLOC_MAGIC        0x4D41u     /* "MA" */
+#define MALLOC_CLASS_LARGE  0xFFu
+
+/* Precedes every block; keeps the payload MALLOC_ALIGN-aligned. */
+typedef struct malloc_hdr {
+    uint16_t magic;
+    uint8_t cls;                /* size class, or MALLOC_CLASS_LARGE */
+    uint8_t slot;               /* owning proc_local slot */
+    uint32_t reserved;
+    size_t size;                /* usable bytes (large: mapping length) */
+} malloc_hdr_t;
+
+typedef struct malloc_free {
+    struct malloc_free *next;
+} malloc_free_t;
+
+static const uint16_t k_class_size[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+#define MALLOC_CLASSES (sizeof(k_class_size) / sizeof(k_class_size[0]))
+
+typedef struct malloc_arena {
+    uint32_t gen;
+    char *bump;
+    char *bump_end;
+    malloc_free_t *bins[MALLOC_CLASSES];
+} malloc_arena_t;
+
+static malloc_arena_t g_arenas[PROC_LOCAL_SLOTS];
+
+static malloc_arena_t *malloc_current_arena(int *slot_out)
+{
+    uint32_t gen = 0;
+    int idx = proc_local_slot(1, &gen);
+    malloc_arena_t *a;
+
+    if (idx < 0)
+        return 0;
+    a = &g_arenas[idx];
+    if (a->gen != gen) {
+        /*
+         * Fresh owner (new process, or the same pid after exec): the
+         * previous owner's chunks were unmapped by the kernel.
+         */
+        memset(a, 0, sizeof(*a));
+        a->gen = gen;
+    }
+    *slot_out = idx;
+    return a;
+}
+
+static int malloc_class_for(size_t size)
+{
+    for (size_t i = 0; i < MALLOC_CLASSES; i++) {
+        if (size <= k_class_size[i])
+            return (int)i;
+    }
+    return -1;
+}
+
+static void *malloc_large(size_t size, int slot)
+{
+    size_t total;
+    malloc_hdr_t *h;
+
+    if (size > SIZE_MAX - sizeof(malloc_hdr_t) - MALLOC_PAGE_SIZE)
+        return 0;
+    total = (size + sizeof(malloc_hdr_t) + MALLOC_PAGE_SIZE - 1) & ~(size_t)(MALLOC_PAGE_SIZE - 1);
+    h = (malloc_hdr_t *)mmap(0, total, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (h == (malloc_hdr_t *)MAP_FAILED)
+        return 0;
+    h->magic = MALLOC_MAGIC;
+    h->cls = MALLOC_CLASS_LARGE;
+    h->slot = (uint8_t)slot;
+    h->size = total - sizeof(malloc_hdr_t);
+    return h + 1;
+}
+
+static void *malloc_carve(malloc_arena_t *a, int cls, int slot)
+{
+    size_t need = sizeof(malloc_hdr_t) + k_class_size[cls];
+    malloc_hdr_t *h;
+
+    if (!a->bump || (size_t)(a->bump_end - a->bump) < need) {
+        /* The tail of the old chunk is abandoned; at most one block's worth. */
+        char *chunk = (char *)mmap(0, MALLOC_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (chunk == (char *)MAP_FAILED)
+            return 0;
+        a->bump = chunk;
+        a->bump_end = chunk + MALLOC_CHUNK_SIZE;
+    }
+
+    h = (malloc_hdr_t *)a->bump;
+    a->bump += need;
+    h->magic = MALLOC_MAGIC;
+    h->cls = (uint8_t)cls;
+    h->slot = (uint8_t)slot;
+    h->size = k_class_size[cls];
+    return h + 1;
+}
+
+void *malloc(size_t size)
+{
+    malloc_arena_t *a;
+    int slot = 0;
+    int cls;
+
+    if (size == 0)
+        size = 1;
+
+    a = malloc_current_arena(&slot);
+    if (!a)
+        return 0;
+
+    if (size > MALLOC_SMALL_MAX)
+        return malloc_large(size, slot);
+
+    cls = malloc_class_for(size);
+    if (a->bins[cls]) {
+        malloc_free_t *f = a->bins[cls];
+        a->bins[cls] = f->next;
+        return f;
+    }
+    return malloc_carve(a, cls, slot);
+}
+
+static malloc_hdr_t *malloc_header(void *ptr)
+{
+    malloc_hdr_t *h = (malloc_hdr_t *)ptr - 1;
+    if (h->magic != MALLOC_MAGIC)
+        return 0;
+    return h;
+}
+
+/* No stdio here: the report must not allocate or take the stream locks. */
+static void malloc_report(const char *what)
+{
+    static const char prefix[] = "free(): ";
+    write(2, prefix, sizeof(prefix) - 1);
+    write(2, what, strlen(what));
+    write(2, "\n", 1);
+}
+
+void free(void *ptr)
+{
+    malloc_arena_t *a;
+    malloc_hdr_t *h;
+    malloc_free_t *f;
+    int slot = 0;
+
+    if (!ptr)
+        return;
+    h = malloc_header(ptr);
+    if (!h || (h->cls >= MALLOC_CLASSES && h->cls != MALLOC_CLASS_LARGE)) {
+        malloc_report("invalid pointer");
+        return;
+    }
+
+    if (h->cls == MALLOC_CLASS_LARGE) {
+        h->magic = 0;
+        munmap(h, h->size + sizeof(malloc_hdr_t));
+        return;
+    }
+
+    /*
+     * Another slot's bins are unlocked and belong to their owner alone, who
+     * may also have exited or exec'd and had the chunk unmapped since; the
+     * block cannot safely go on its lists or ours.
+     */
+    a = malloc_current_arena(&slot);
+    if (!a || h->slot != (uint8_t)slot) {
+        malloc_report("pointer belongs to another process's slot");
+        return;
+    }
+
+    f = (malloc_free_t *)ptr;
+    f->next = a->bins[h->cls];
+    a->bins[h->cls] = f;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (size != 0 && nmemb > SIZE_MAX / size)
+        return 0;
+    p = malloc(nmemb * size);
+    if (!p)
+        return 0;
+    /* Fresh large mappings are already zero; recycled small blocks are not. */
+    if (malloc_header(p)->cls != MALLOC_CLASS_LARGE)
+        memset(p, 0, nmemb * size);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    malloc_hdr_t *h;
+    void *np;
+
+    if (!ptr)
+        return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return 0;
+    }
+
+    h = malloc_header(ptr);
+    if (!h)
+        return 0;
+    if (size <= h->size)
+        return ptr;
+
+    np = malloc(size);
+    if (!np)
+        return 0;
+    memcpy(np, ptr, h->size);
+    free(ptr);
+    return np;
+}
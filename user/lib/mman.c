@@ -5,10 +5,20 @@ void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
     if (offset < 0)
         return MAP_FAILED;
+    if (flags & MAP_ANONYMOUS) {
+        void *p;
+        (void)addr;
+        (void)prot;
+        (void)fd;
+        p = system_mem_map_anon(length);
+        return p ? p : MAP_FAILED;
+    }
     return fs_mmap(addr, length, prot, flags, fd, (size_t)offset);
 }
 
 int munmap(void *addr, size_t length)
 {
+    if (system_mem_unmap_anon(addr, length) == 0)
+        return 0;
     return fs_munmap(addr, length);
 }
@@ -0,0 +1,94 @@
+/*
+ * proc_local.c - Per-process state slots for the user library.
+ *
+ * Builtin apps run as kernel processes sharing this image, so library state
+ * that must be private to a process (stdio buffers, the malloc arena) is
+ * indexed by a slot claimed per pid.  Slots of processes that died without
+ * exit() are reclaimed lazily.  exec keeps the pid but unmaps the old image's
+ * anonymous memory, so a slot also records the image it was claimed by and
+ * is claimed afresh (new generation) once that changes.  Standalone ELF
+ * builds have a single slot.
+ */
+
+#include "proc_local.h"
+
+#include "../include/signal.h"
+
+typedef struct proc_local {
+    volatile int pid;
+    volatile uint32_t gen;
+    volatile uint32_t image;        /* owner's image generation at claim */
+} proc_local_t;
+
+static proc_local_t g_proc_local[PROC_LOCAL_SLOTS];
+
+#ifdef TSUKASA_USERLIB_KERNEL
+extern int process_current_pid(void);
+extern uint32_t process_current_image_gen(void);
+
+int proc_local_slot(int create, uint32_t *gen_out)
+{
+    int pid = process_current_pid();
+    uint32_t image = process_current_image_gen();
+    if (pid <= 0)
+        return -1;
+    for (int i = 0; i < PROC_LOCAL_SLOTS; i++) {
+        if (g_proc_local[i].pid == pid) {
+            if (g_proc_local[i].image != image) {
+                /* Same pid after exec: hand the slot over as a fresh claim. */
+                g_proc_local[i].image = image;
+                __atomic_add_fetch(&g_proc_local[i].gen, 1u, __ATOMIC_RELAXED);
+            }
+            if (gen_out)
+                *gen_out = g_proc_local[i].gen;
+            return i;
+        }
+    }
+    if (!create)
+        return -1;
+    for (int i = 0; i < PROC_LOCAL_SLOTS; i++) {
+        int owner = g_proc_local[i].pid;
+        if (owner != 0 && kill(owner, 0) == 0)
+            continue;
+        if (__atomic_compare_exchange_n(&g_proc_local[i].pid, &owner, pid, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            uint32_t gen;
+            g_proc_local[i].image = image;
+            gen = __atomic_add_fetch(&g_proc_local[i].gen, 1u, __ATOMIC_RELAXED);
+            if (gen_out)
+                *gen_out = gen;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void proc_local_release(void)
+{
+    int pid = process_current_pid();
+    for (int i = 0; i < PROC_LOCAL_SLOTS; i++) {
+        if (g_proc_local[i].pid == pid) {
+            __atomic_store_n(&g_proc_local[i].pid, 0, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+}
+#else
+int proc_local_slot(int create, uint32_t *gen_out)
+{
+    if (g_proc_local[0].pid == 0) {
+        if (!create)
+            return -1;
+        g_proc_local[0].pid = 1;
+        g_proc_local[0].gen++;
+    }
+    if (gen_out)
+        *gen_out = g_proc_local[0].gen;
+    return 0;
+}
+
+void proc_local_release(void)
+{
+    g_proc_local[0].pid = 0;
+}
+#endif
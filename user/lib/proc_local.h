@@ -0,0 +1,27 @@
+/*
+ * proc_local.h - Per-process state slots for the user library.
+ */
+
+#ifndef USER_PROC_LOCAL_H
+#define USER_PROC_LOCAL_H
+
+#include <stdint.h>
+
+#ifdef TSUKASA_USERLIB_KERNEL
+#define PROC_LOCAL_SLOTS 32
+#else
+#define PROC_LOCAL_SLOTS 1
+#endif
+
+/*
+ * Return the calling process's slot index, claiming one if needed, or -1
+ * when none is free (or create == 0 and none is held).  *gen_out receives
+ * the slot generation, bumped on every claim; callers keep it next to their
+ * per-slot state and reinitialise when it changes.
+ */
+int proc_local_slot(int create, uint32_t *gen_out);
+
+/* Give the calling process's slot back (exit path). */
+void proc_local_release(void);
+
+#endif /* USER_PROC_LOCAL_H */
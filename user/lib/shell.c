@@ -260,6 +260,17 @@ int shell_exec_line(const char *line, int out_fd, int err_fd)
         }
     }
 
+    /*
+     * Each stage holds its own copies of the pipe ends; ours would keep
+     * readers from ever seeing EOF now that pipe reads block.
+     */
+    for (int i = 0; i + 1 < stage_count; i++) {
+        close(pipefds[i][0]);
+        close(pipefds[i][1]);
+        pipefds[i][0] = -1;
+        pipefds[i][1] = -1;
+    }
+
     for (int i = 0; i < stage_count; i++) {
         if (pids[i] >= 0) {
             int st = 0;
@@ -14,6 +14,8 @@ static mode_t map_mode(const struct tsukasa_stat *in)
         mode |= S_IFCHR;
     else if (in->type == TSUKASA_STAT_TYPE_PIPE)
         mode |= S_IFIFO;
+    else if (in->type == TSUKASA_STAT_TYPE_SOCKET)
+        mode |= S_IFSOCK;
     else
         mode |= S_IFREG;
 
@@ -1,12 +1,229 @@
 #include "../include/stdio.h"
 
+#include "../include/sys/stat.h"
 #include "../include/unistd.h"
 #include "../include/string.h"
+#include "proc_local.h"
 
 #include <stdint.h>
 
+/* ---- streams ------------------------------------------------------------ */
+
+typedef struct stdio_slot {
+    uint32_t gen;
+    FILE out;
+    FILE err;
+    char out_buf[BUFSIZ];
+} stdio_slot_t;
+
+/* One stream set per process slot (see proc_local.c). */
+static stdio_slot_t g_stdio_slots[PROC_LOCAL_SLOTS];
+/* Used when every slot is taken: unbuffered, so no per-process state. */
+static FILE g_stdio_nobuf[3] = {
+    { 0, _IONBF, 0, 0, 0, 0 },
+    { 1, _IONBF, 0, 0, 0, 0 },
+    { 2, _IONBF, 0, 0, 0, 0 },
+};
+
+static void stdio_slot_reset(stdio_slot_t *slot)
+{
+    slot->out.fd = STDOUT_FILENO;
+    slot->out.mode = -1;
+    slot->out.error = 0;
+    slot->out.buf = slot->out_buf;
+    slot->out.cap = sizeof(slot->out_buf);
+    slot->out.len = 0;
+
+    slot->err.fd = STDERR_FILENO;
+    slot->err.mode = _IONBF;
+    slot->err.error = 0;
+    slot->err.buf = 0;
+    slot->err.cap = 0;
+    slot->err.len = 0;
+}
+
+static stdio_slot_t *stdio_current_slot(int create)
+{
+    uint32_t gen = 0;
+    int idx = proc_local_slot(create, &gen);
+    stdio_slot_t *slot;
+
+    if (idx < 0)
+        return 0;
+    slot = &g_stdio_slots[idx];
+    if (slot->gen != gen) {
+        stdio_slot_reset(slot);
+        slot->gen = gen;
+    }
+    return slot;
+}
+
+FILE *__stdio_stream(int fd)
+{
+    stdio_slot_t *slot = stdio_current_slot(1);
+    if (fd != STDOUT_FILENO && fd != STDERR_FILENO)
+        return 0;
+    if (!slot)
+        return &g_stdio_nobuf[fd];
+    return (fd == STDOUT_FILENO) ? &slot->out : &slot->err;
+}
+
+static void stream_resolve_mode(FILE *f)
+{
+    struct stat st;
+    if (f->mode >= 0)
+        return;
+    if (fstat(f->fd, &st) == 0 && S_ISCHR(st.st_mode))
+        f->mode = _IOLBF;
+    else
+        f->mode = _IOFBF;
+}
+
+static int stream_write_all(FILE *f, const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = write(f->fd, p, n);
+        if (w <= 0) {
+            f->error = 1;
+            return EOF;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int stream_flush(FILE *f)
+{
+    size_t n = f->len;
+    f->len = 0;
+    if (n == 0)
+        return 0;
+    return stream_write_all(f, f->buf, n);
+}
+
+static int stream_write(FILE *f, const char *p, size_t n)
+{
+    int flush_line = 0;
+
+    stream_resolve_mode(f);
+    if (f->mode == _IONBF || !f->buf || f->cap == 0)
+        return stream_write_all(f, p, n);
+
+    if (f->mode == _IOLBF) {
+        for (size_t i = 0; i < n; i++) {
+            if (p[i] == '\n') {
+                flush_line = 1;
+                break;
+            }
+        }
+    }
+
+    if (f->len + n > f->cap) {
+        if (stream_flush(f) != 0)
+            return EOF;
+        /* Too large to stage: skip the copy. */
+        if (n >= f->cap)
+            return stream_write_all(f, p, n);
+    }
+    memcpy(f->buf + f->len, p, n);
+    f->len += n;
+    if (flush_line || f->len == f->cap)
+        return stream_flush(f);
+    return 0;
+}
+
+int fflush(FILE *stream)
+{
+    int rc = 0;
+    if (stream)
+        return stream_flush(stream);
+    {
+        stdio_slot_t *slot = stdio_current_slot(0);
+        if (!slot)
+            return 0;
+        if (stream_flush(&slot->out) != 0)
+            rc = EOF;
+        if (stream_flush(&slot->err) != 0)
+            rc = EOF;
+    }
+    return rc;
+}
+
+void __stdio_exit(void)
+{
+    stdio_slot_t *slot = stdio_current_slot(0);
+    if (!slot)
+        return;
+    (void)fflush(0);
+}
+
+int setvbuf(FILE *stream, char *buf, int mode, size_t size)
+{
+    if (!stream || (mode != _IOFBF && mode != _IOLBF && mode != _IONBF))
+        return -1;
+    if (stream_flush(stream) != 0)
+        return -1;
+    stream->mode = mode;
+    if (mode == _IONBF)
+        return 0;
+    if (buf && size > 0) {
+        stream->buf = buf;
+        stream->cap = size;
+    } else if (!stream->buf) {
+        /* No library buffer for this stream; behave unbuffered. */
+        stream->mode = _IONBF;
+    }
+    return 0;
+}
+
+int fileno(FILE *stream)
+{
+    return stream ? stream->fd : -1;
+}
+
+int ferror(FILE *stream)
+{
+    return stream ? stream->error : 1;
+}
+
+int fputc(int c, FILE *stream)
+{
+    char ch = (char)c;
+    if (!stream || stream_write(stream, &ch, 1) != 0)
+        return EOF;
+    return (unsigned char)ch;
+}
+
+int putc(int c, FILE *stream)
+{
+    return fputc(c, stream);
+}
+
+int fputs(const char *s, FILE *stream)
+{
+    if (!stream)
+        return EOF;
+    if (!s)
+        s = "(null)";
+    return stream_write(stream, s, strlen(s)) == 0 ? 0 : EOF;
+}
+
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+    if (!stream || !ptr || size == 0 || nmemb == 0)
+        return 0;
+    if (nmemb > SIZE_MAX / size)
+        return 0;
+    if (stream_write(stream, (const char *)ptr, size * nmemb) != 0)
+        return 0;
+    return nmemb;
+}
+
+/* ---- formatter ---------------------------------------------------------- */
+
 typedef struct fmt_out {
-    int fd;
+    FILE *stream;
     char *buf;
     size_t cap;
     size_t len;
@@ -28,7 +245,7 @@ static void out_char(fmt_out_t *o, char c)
         }
         return;
     }
-    (void)write(o->fd, &c, 1);
+    (void)stream_write(o->stream, &c, 1);
 }
 
 static void out_str(fmt_out_t *o, const char *s)
@@ -116,37 +333,87 @@ static int vfmt(fmt_out_t *o, const char *fmt, va_list ap)
 
 int putchar(int c)
 {
-    char ch = (char)c;
-    if (write(STDOUT_FILENO, &ch, 1) != 1)
-        return EOF;
-    return (unsigned char)ch;
+    return fputc(c, stdout);
 }
 
 int puts(const char *s)
 {
-    int n = 0;
+    FILE *f = stdout;
     if (!s)
         s = "(null)";
-    while (*s) {
-        if (putchar((unsigned char)*s++) == EOF)
-            return EOF;
-        n++;
-    }
-    if (putchar('\n') == EOF)
+    if (fputs(s, f) == EOF || fputc('\n', f) == EOF)
         return EOF;
-    return n + 1;
+    return (int)strlen(s) + 1;
 }
 
-int vdprintf(int fd, const char *fmt, va_list ap)
+int vfprintf(FILE *stream, const char *fmt, va_list ap)
 {
     fmt_out_t out;
-    out.fd = fd;
+    FILE tmp;
+    char tmp_buf[256];
+    int rc;
+
+    if (!stream)
+        return -1;
+    stream_resolve_mode(stream);
+
+    /*
+     * Unbuffered streams still get one write per call (or per 256 bytes)
+     * rather than one per character.
+     */
+    if (stream->mode == _IONBF || !stream->buf) {
+        tmp.fd = stream->fd;
+        tmp.mode = _IOFBF;
+        tmp.error = 0;
+        tmp.buf = tmp_buf;
+        tmp.cap = sizeof(tmp_buf);
+        tmp.len = 0;
+        out.stream = &tmp;
+    } else {
+        out.stream = stream;
+    }
     out.buf = 0;
     out.cap = 0;
     out.len = 0;
     out.to_buf = 0;
     out.count = 0;
-    return vfmt(&out, fmt, ap);
+    rc = vfmt(&out, fmt, ap);
+    if (out.stream == &tmp) {
+        (void)stream_flush(&tmp);
+        if (tmp.error)
+            stream->error = 1;
+    }
+    return rc;
+}
+
+int fprintf(FILE *stream, const char *fmt, ...)
+{
+    va_list ap;
+    int rc;
+    va_start(ap, fmt);
+    rc = vfprintf(stream, fmt, ap);
+    va_end(ap);
+    return rc;
+}
+
+int vdprintf(int fd, const char *fmt, va_list ap)
+{
+    FILE f;
+    stdio_slot_t *slot = stdio_current_slot(0);
+
+    /* Keep ordering with anything already staged on stdout/stderr. */
+    if (slot && fd == STDOUT_FILENO)
+        (void)stream_flush(&slot->out);
+    else if (slot && fd == STDERR_FILENO)
+        (void)stream_flush(&slot->err);
+
+    f.fd = fd;
+    f.mode = _IONBF;
+    f.error = 0;
+    f.buf = 0;
+    f.cap = 0;
+    f.len = 0;
+    return vfprintf(&f, fmt, ap);
 }
 
 int dprintf(int fd, const char *fmt, ...)
@@ -161,7 +428,7 @@ int dprintf(int fd, const char *fmt, ...)
 
 int vprintf(const char *fmt, va_list ap)
 {
-    return vdprintf(STDOUT_FILENO, fmt, ap);
+    return vfprintf(stdout, fmt, ap);
 }
 
 int printf(const char *fmt, ...)
@@ -169,7 +436,7 @@ int printf(const char *fmt, ...)
     va_list ap;
     int rc;
     va_start(ap, fmt);
-    rc = vdprintf(STDOUT_FILENO, fmt, ap);
+    rc = vfprintf(stdout, fmt, ap);
     va_end(ap);
     return rc;
 }
@@ -180,7 +447,7 @@ int vsnprintf(char *out, size_t size, const char *fmt, va_list ap)
     if (!out || size == 0)
         return 0;
     out[0] = '\0';
-    fo.fd = -1;
+    fo.stream = 0;
     fo.buf = out;
     fo.cap = size;
     fo.len = 0;
@@ -1,11 +1,12 @@
 #include "../include/string.h"
 
+#include "../../include/memops.h"
+
 size_t strlen(const char *s)
 {
-    size_t n = 0;
-    while (s && s[n])
-        n++;
-    return n;
+    if (!s)
+        return 0;
+    return memops_strlen(s);
 }
 
 int strcmp(const char *a, const char *b)
@@ -97,32 +98,19 @@ char *strncat(char *dst, const char *src, size_t n)
 
 void *memset(void *dst, int c, size_t n)
 {
-    unsigned char *p = (unsigned char *)dst;
-    for (size_t i = 0; i < n; i++)
-        p[i] = (unsigned char)c;
+    memops_set(dst, c, n);
     return dst;
 }
 
 void *memcpy(void *dst, const void *src, size_t n)
 {
-    unsigned char *d = (unsigned char *)dst;
-    const unsigned char *s = (const unsigned char *)src;
-    for (size_t i = 0; i < n; i++)
-        d[i] = s[i];
+    memops_copy(dst, src, n);
     return dst;
 }
 
 void *memmove(void *dst, const void *src, size_t n)
 {
-    unsigned char *d = (unsigned char *)dst;
-    const unsigned char *s = (const unsigned char *)src;
-    if (d <= s) {
-        for (size_t i = 0; i < n; i++)
-            d[i] = s[i];
-    } else {
-        for (size_t i = n; i > 0; i--)
-            d[i - 1] = s[i - 1];
-    }
+    memops_move(dst, src, n);
     return dst;
 }
 
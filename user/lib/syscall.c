@@ -3,7 +3,9 @@
  */
 
 #include "syscall.h"
+#include "../include/stdio.h"
 #include "../include/syscall_nums.h"
+#include "proc_local.h"
 
 #ifdef TSUKASA_USERLIB_KERNEL
 extern uintptr_t syscall_handler(uintptr_t num,
@@ -52,6 +54,8 @@ static long sys_fs(long cmd, long a1, long a2, long a3, long a4)
 
 void exit(int code)
 {
+    __stdio_exit();
+    proc_local_release();
     syscall1(SYS_EXIT, (long)code);
     __builtin_unreachable();
 }
@@ -162,6 +166,51 @@ int system_mem_dump(void)
     return (int)sys_system(SYSTEM_CMD_MEM_DUMP, 0, 0, 0, 0);
 }
 
+void *system_mem_map_anon(size_t length)
+{
+    return (void *)(uintptr_t)sys_system(SYSTEM_CMD_MEM_MAP_ANON, (long)length, 0, 0, 0);
+}
+
+int system_mem_unmap_anon(void *addr, size_t length)
+{
+    return (int)sys_system(SYSTEM_CMD_MEM_UNMAP_ANON, (long)addr, (long)length, 0, 0);
+}
+
+unsigned int system_trace_ctl(unsigned int mask, unsigned int flags)
+{
+    return (unsigned int)sys_system(SYSTEM_CMD_TRACE_CTL, (long)mask, (long)flags, 0, 0);
+}
+
+unsigned int system_profile_ctl(unsigned int hz)
+{
+    return (unsigned int)sys_system(SYSTEM_CMD_PROFILE_CTL, (long)hz, 0, 0, 0);
+}
+
+int system_bench_run(const char *filter, char *csv, size_t cap, unsigned int flags)
+{
+    return (int)sys_system(SYSTEM_CMD_BENCH_RUN, (long)filter, (long)csv, (long)cap, (long)flags);
+}
+
+uint64_t system_clock_us(void)
+{
+    return (uint64_t)sys_system(SYSTEM_CMD_CLOCK_US, 0, 0, 0, 0);
+}
+
+int system_ioring_setup(unsigned int entries, struct tsukasa_ioring_params *out)
+{
+    return (int)sys_system(SYSTEM_CMD_IORING_SETUP, (long)entries, (long)out, 0, 0);
+}
+
+int system_ioring_enter(int id, unsigned int max_submit)
+{
+    return (int)sys_system(SYSTEM_CMD_IORING_ENTER, (long)id, (long)max_submit, 0, 0);
+}
+
+int system_ioring_destroy(int id)
+{
+    return (int)sys_system(SYSTEM_CMD_IORING_DESTROY, (long)id, 0, 0, 0);
+}
+
 struct tsukasa_net_dns_req {
     const char *name;
     struct tsukasa_net_ipv4 *out_ip;
@@ -236,6 +285,11 @@ int net_dns_lookup(const char *name, struct tsukasa_net_ipv4 *out)
     return (int)sys_system(SYSTEM_CMD_NET_DNS_LOOKUP, (long)&req, 0, 0, 0);
 }
 
+int net_dns_start(const char *name, int flags)
+{
+    return (int)sys_system(SYSTEM_CMD_NET_DNS_START, (long)name, (long)flags, 0, 0);
+}
+
 int net_ping(const struct tsukasa_net_ipv4 *ip, uint32_t timeout_ms)
 {
     struct tsukasa_net_ping_req req;
@@ -280,6 +334,55 @@ int net_poll(void)
     return (int)sys_system(SYSTEM_CMD_NET_POLL, 0, 0, 0, 0);
 }
 
+int net_socket(int type, int flags)
+{
+    return (int)sys_system(SYSTEM_CMD_NET_SOCKET, (long)type, (long)flags, 0, 0);
+}
+
+int net_bind(int fd, const struct tsukasa_sockaddr *addr)
+{
+    return (int)sys_system(SYSTEM_CMD_NET_BIND, (long)fd, (long)addr, 0, 0);
+}
+
+int net_listen(int fd, int backlog)
+{
+    return (int)sys_system(SYSTEM_CMD_NET_LISTEN, (long)fd, (long)backlog, 0, 0);
+}
+
+int net_accept(int fd, struct tsukasa_sockaddr *peer)
+{
+    return (int)sys_system(SYSTEM_CMD_NET_ACCEPT, (long)fd, (long)peer, 0, 0);
+}
+
+int net_connect(int fd, const struct tsukasa_sockaddr *addr)
+{
+    return (int)sys_system(SYSTEM_CMD_NET_CONNECT, (long)fd, (long)addr, 0, 0);
+}
+
+long net_sendto(int fd, const void *buffer, size_t len, const struct tsukasa_sockaddr *to)
+{
+    struct tsukasa_net_msg msg;
+    msg.buffer = (void *)buffer;
+    msg.length = (uint32_t)len;
+    msg.has_addr = to != 0;
+    if (to)
+        msg.addr = *to;
+    return sys_system(SYSTEM_CMD_NET_SENDTO, (long)fd, (long)&msg, 0, 0);
+}
+
+long net_recvfrom(int fd, void *buffer, size_t len, struct tsukasa_sockaddr *from)
+{
+    struct tsukasa_net_msg msg;
+    long rc;
+    msg.buffer = buffer;
+    msg.length = (uint32_t)len;
+    msg.has_addr = 0;
+    rc = sys_system(SYSTEM_CMD_NET_RECVFROM, (long)fd, (long)&msg, 0, 0);
+    if (rc >= 0 && from)
+        *from = msg.addr;
+    return rc;
+}
+
 int theme_set_accent(uint32_t color_argb)
 {
     return (int)sys_system(SYSTEM_CMD_THEME_SET_ACCENT, (long)color_argb, 0, 0, 0);
@@ -416,3 +519,8 @@ int fs_poll(struct tsukasa_pollfd *fds, size_t nfds, int timeout_ms)
 {
     return (int)sys_fs(FS_CMD_POLL, (long)fds, (long)nfds, (long)timeout_ms, 0);
 }
+
+size_t fs_splice(int fd_in, int fd_out, size_t len)
+{
+    return (size_t)sys_fs(FS_CMD_SPLICE, (long)fd_in, (long)fd_out, (long)len, 0);
+}
@@ -70,6 +70,9 @@ struct tsukasa_mem_stats {
     uint64_t shm_regions;
     uint64_t shm_attachments;
     uint64_t shm_reserved_pages;
+
+    uint64_t anon_maps;
+    uint64_t anon_pages;
 };
 
 struct tsukasa_net_ipv4 {
@@ -106,6 +109,25 @@ struct tsukasa_net_tcp_connect_req {
     uint16_t port;
 };
 
+struct tsukasa_sockaddr {
+    struct tsukasa_net_ipv4 ip;
+    uint16_t port;
+};
+
+struct tsukasa_net_msg {
+    void *buffer;
+    uint32_t length;
+    int has_addr;
+    struct tsukasa_sockaddr addr;
+};
+
+/* Read from a SYSTEM_CMD_NET_DNS_START descriptor once it polls readable. */
+struct tsukasa_net_dns_result {
+    int32_t status;                 /* TSUKASA_DNS_* */
+    struct tsukasa_net_ipv4 ip;
+    uint32_t ttl;                   /* seconds the answer stays cached */
+};
+
 struct tsukasa_spawn_request {
     const char *path;
     const char *args;
@@ -142,6 +164,39 @@ struct tsukasa_gui_event {
     int32_t data2;
 };
 
+/* Submission ring layout; see SYSTEM_CMD_IORING_* and include/ioring.h. */
+struct tsukasa_ioring_sqe {
+    uint8_t nr;
+    uint8_t flags;
+    uint16_t cmd;
+    uint32_t reserved;
+    uint64_t user_data;
+    uint64_t args[4];
+};
+
+struct tsukasa_ioring_cqe {
+    uint64_t user_data;
+    int64_t res;
+};
+
+struct tsukasa_ioring {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_off;
+    uint32_t cq_off;
+};
+
+struct tsukasa_ioring_params {
+    int id;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    struct tsukasa_ioring *ring;
+};
+
 struct tsukasa_theme_state {
     uint32_t accent_color;
     uint32_t background_mode;
@@ -202,6 +257,20 @@ int u_shm_destroy(int id);
 
 int system_mem_stats(struct tsukasa_mem_stats *out);
 int system_mem_dump(void);
+void *system_mem_map_anon(size_t length);
+int system_mem_unmap_anon(void *addr, size_t length);
+/* Returns the previous trace event mask; flags are TRACE_CTL_*. */
+unsigned int system_trace_ctl(unsigned int mask, unsigned int flags);
+/* Start sampling at hz (0 stops); returns the rate achieved, 0 if none. */
+unsigned int system_profile_ctl(unsigned int hz);
+/* Run in-kernel benchmarks; fills csv, returns its length or -1. */
+int system_bench_run(const char *filter, char *csv, size_t cap, unsigned int flags);
+/* Monotonic microseconds since boot. */
+uint64_t system_clock_us(void);
+int system_ioring_setup(unsigned int entries, struct tsukasa_ioring_params *out);
+/* Run up to max_submit queued SQEs; returns how many were consumed. */
+int system_ioring_enter(int id, unsigned int max_submit);
+int system_ioring_destroy(int id);
 
 int net_init(void);
 int net_is_init(void);
@@ -214,6 +283,12 @@ int net_get_dns(struct tsukasa_net_ipv4 *out);
 int net_get_stats(struct tsukasa_net_stats *out);
 int net_dhcp(void);
 int net_dns_lookup(const char *name, struct tsukasa_net_ipv4 *out);
+/*
+ * Start a lookup without waiting: the fd polls TSUKASA_POLLIN once resolved
+ * and a read returns struct tsukasa_net_dns_result.  flags is
+ * TSUKASA_DNS_NONBLOCK or 0 (reads then wait for the answer).
+ */
+int net_dns_start(const char *name, int flags);
 int net_ping(const struct tsukasa_net_ipv4 *ip, uint32_t timeout_ms);
 int net_tcp_connect(const struct tsukasa_net_tcp_connect_req *req);
 int net_tcp_send(const void *buffer, size_t len);
@@ -222,6 +297,19 @@ int net_tcp_close(void);
 int net_udp_send(const struct tsukasa_net_udp_send_req *req);
 int net_poll(void);
 
+/*
+ * Socket descriptors: read/write/close/poll work on them like any fd;
+ * sendto/recvfrom carry datagram addresses.  Sizes are -1 on error or
+ * when a TSUKASA_SOCK_NONBLOCK socket would block.
+ */
+int net_socket(int type, int flags);
+int net_bind(int fd, const struct tsukasa_sockaddr *addr);
+int net_listen(int fd, int backlog);
+int net_accept(int fd, struct tsukasa_sockaddr *peer);
+int net_connect(int fd, const struct tsukasa_sockaddr *addr);
+long net_sendto(int fd, const void *buffer, size_t len, const struct tsukasa_sockaddr *to);
+long net_recvfrom(int fd, void *buffer, size_t len, struct tsukasa_sockaddr *from);
+
 int theme_set_accent(uint32_t color_argb);
 int theme_set_bg_mode(uint32_t mode);
 int theme_set_bg_mode_ex(uint32_t mode, uint32_t aux);
@@ -249,5 +337,6 @@ int fs_ioctl(int fd, unsigned long request, void *arg);
 void *fs_mmap(void *addr, size_t length, int prot, int flags, int fd, size_t offset);
 int fs_munmap(void *addr, size_t length);
 int fs_poll(struct tsukasa_pollfd *fds, size_t nfds, int timeout_ms);
+size_t fs_splice(int fd_in, int fd_out, size_t len);
 
 #endif /* USER_SYSCALL_H */
@@ -49,6 +49,14 @@ int pipe(int pipefd[2])
     return fs_pipe(pipefd);
 }
 
+ssize_t splice(int fd_in, int fd_out, size_t len)
+{
+    size_t rc = fs_splice(fd_in, fd_out, len);
+    if (rc == (size_t)-1)
+        return -1;
+    return (ssize_t)rc;
+}
+
 int chdir(const char *path)
 {
     return fs_chdir(path);